@@ -55,8 +55,12 @@ int main(int argc, char *argv[]) {
     /* Create the main thread */
     thread_create(&main_td, thread_main, NULL, THREAD_TYPE_ONE_ONE);
 
-    /* Wait for its completion */
-    while (!td_is_over(main_td));
+    /* Sleep till its completion (the kernel clears the wait word and wakes
+     * the waiters when the kernel thread exits) */
+    while (!td_is_over(main_td)) {
+
+        futex(&main_td->wait, FUTEX_WAIT, td_oo_get_ktid(main_td));
+    }
 
     /* If the main thread is not joined */
     if (!td_is_joined(main_td)) {
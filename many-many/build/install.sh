@@ -12,8 +12,8 @@ mkdir $BIN_DIR -p
 # For each C file
 for C_FILE in `ls -d $SRC_DIR/*.c $SRC_DIR/mods/*.c`
 do
-    # Get the object file
-    gcc -fpic -Wall -c $C_FILE
+    # Get the object file (with the compilation flags of the caller if any)
+    gcc -fpic -Wall $LIB_COMPILATION_FLAGS -c $C_FILE
 
     # If compilation resulted in error then exit
     if [ $? -ne 0 ]
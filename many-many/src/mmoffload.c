@@ -0,0 +1,222 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+
+#include "./mods/utils.h"
+#include "./mods/list.h"
+#include "./mods/lock.h"
+#include "./mods/stack.h"
+#include "./mods/sig.h"
+#include "./thread_descr.h"
+#include "./mmrll.h"
+#include "./mmoffload.h"
+
+/* Helper list */
+static List mmoffload_helpers;
+/* Threads waiting for a helper */
+static List mmoffload_jobs;
+/* Number of helpers */
+static int mmoffload_nb;
+/* Number of helpers waiting for a job */
+static int mmoffload_idle;
+/* Number of threads waiting for a helper */
+static int mmoffload_pending;
+/* Job word (changes whenever a job is submitted) */
+static int mmoffload_word;
+/* Offloading status */
+static int mmoffload_enabled;
+/* Offload lock */
+static Lock mmoffload_lk;
+
+/**
+ * @brief Run the offloaded calls
+ *
+ * Waits for a thread which offloaded a call, runs the call on behalf of the
+ * thread (with the FS register value of the thread) and puts the thread back
+ * on the ready list, till the offloading is disabled
+ *
+ * @param[in] arg Pointer to the helper instance (not used)
+ * @return NULL
+ */
+static void *_mmoffload_help(void *arg) {
+
+    OffloadJob *job;
+    Thread thread;
+    void *old_fs;
+    int word;
+
+    /* Get the FS register value of the helper */
+    old_fs = get_fs();
+
+    /* Block all the signals */
+    sig_block_all();
+
+    /* While the offloading is enabled */
+    while (mmoffload_enabled) {
+
+        /* Acquire the offload lock */
+        lock_acquire(&mmoffload_lk);
+
+        /* If there is no job */
+        if (list_is_empty(&mmoffload_jobs)) {
+
+            /* Note the helper is idle */
+            mmoffload_idle++;
+            word = mmoffload_word;
+
+            /* Release the offload lock */
+            lock_release(&mmoffload_lk);
+
+            /* Wait for a job */
+            futex(&mmoffload_word, FUTEX_WAIT, word);
+
+            /* Acquire the offload lock */
+            lock_acquire(&mmoffload_lk);
+
+            /* Note the helper is not idle */
+            mmoffload_idle--;
+
+            /* Release the offload lock */
+            lock_release(&mmoffload_lk);
+            continue;
+        }
+
+        /* Get the oldest job */
+        thread = list_dequeue(&mmoffload_jobs, struct Thread, ll_mem);
+        mmoffload_pending--;
+
+        /* Release the offload lock */
+        lock_release(&mmoffload_lk);
+
+        /* Run the call as the thread */
+        job = td_get_wait_job(thread);
+        set_fs(thread);
+        job->ret = job->func(job->arg);
+        set_fs(old_fs);
+
+        /* Push the thread to the ready list */
+        mmrll_push(thread);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Create a helper
+ * @note Should be done with the offload lock held
+ */
+static void _mmoffload_create(void) {
+
+    Helper *helper;
+    int ret;
+
+    /* Create a new helper */
+    helper = alloc_mem(Helper);
+    /* Check for errors */
+    assert(helper);
+
+    /* Allocate the stack */
+    stack_alloc(&helper->stack);
+
+    /* Create the kernel thread */
+    ret = kthread_create(&helper->kthread, _mmoffload_help, helper,
+                         &helper->stack);
+
+    /* Check for errors */
+    assert(!ret);
+
+    /* Add the helper to the list */
+    list_enqueue(&mmoffload_helpers, helper, hll_mem);
+    mmoffload_nb++;
+}
+
+/**
+ * @brief Initialize the offloading
+ * @note Should be done by the main thread, no helper is created till a call
+ *       is offloaded
+ */
+void mmoffload_init(void) {
+
+    /* Initialize the lists */
+    list_init(&mmoffload_helpers);
+    list_init(&mmoffload_jobs);
+
+    /* Initialize the counters */
+    mmoffload_nb = 0;
+    mmoffload_idle = 0;
+    mmoffload_pending = 0;
+    mmoffload_word = 0;
+
+    /* Initialize the offload lock */
+    lock_init(&mmoffload_lk);
+
+    /* Enable the offloading */
+    mmoffload_enabled = 1;
+}
+
+/**
+ * @brief Deinitialize the offloading
+ * @note Should be done by the main thread, after the schedulers stopped
+ */
+void mmoffload_deinit(void) {
+
+    Helper *helper;
+
+    /* Disable the offloading */
+    mmoffload_enabled = 0;
+
+    /* Wake all the helpers */
+    atomic_fetch_add(&mmoffload_word, 1);
+    futex(&mmoffload_word, FUTEX_WAKE, mmoffload_nb);
+
+    /* While there are helpers */
+    while (!list_is_empty(&mmoffload_helpers)) {
+
+        /* Get the helper */
+        helper = list_dequeue(&mmoffload_helpers, Helper, hll_mem);
+
+        /* Wait for the kernel thread to finish */
+        pthread_join(helper->kthread, NULL);
+
+        /* Free the stack */
+        stack_free(&helper->stack);
+
+        /* Free the structure */
+        free(helper);
+    }
+}
+
+/**
+ * @brief Hand a thread which offloaded a call to the helpers
+ *
+ * Should be done by the scheduler after the thread gave up the control, so
+ * that the call is not run before the context of the thread is saved. A
+ * helper is created if the idle helpers cannot take all the jobs and the
+ * maximum is not reached
+ *
+ * @param[in] thread Thread handle
+ */
+void mmoffload_submit(Thread thread) {
+
+    /* Acquire the offload lock */
+    lock_acquire(&mmoffload_lk);
+
+    /* Add the thread to the jobs */
+    list_enqueue(&mmoffload_jobs, thread, ll_mem);
+    mmoffload_pending++;
+    mmoffload_word++;
+
+    /* If the idle helpers cannot take all the jobs and another helper can be
+     * created */
+    if ((mmoffload_pending > mmoffload_idle) &&
+        (mmoffload_nb < MMOFFLOAD_MAX_HELPERS)) {
+
+        /* Create a helper */
+        _mmoffload_create();
+    }
+
+    /* Release the offload lock */
+    lock_release(&mmoffload_lk);
+
+    /* Wake an idle helper */
+    futex(&mmoffload_word, FUTEX_WAKE, 1);
+}
@@ -0,0 +1,55 @@
+#ifndef _MMOFFLOAD_H_
+#define _MMOFFLOAD_H_
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <signal.h>
+
+#include "./mods/list.h"
+#include "./thread.h"
+
+/**
+ * Offloaded function call
+ */
+typedef struct OffloadJob {
+
+    /* Function to be run */
+    thread_start_t func;
+
+    /* Argument */
+    ptr_t arg;
+
+    /* Return value */
+    ptr_t ret;
+
+} OffloadJob;
+
+/**
+ * Helper kernel thread state
+ */
+typedef struct Helper {
+
+    /* Kernel thread handle */
+    pthread_t kthread;
+
+    /* Thread stack */
+    stack_t stack;
+
+    /* List member */
+    ListMember hll_mem;
+
+} Helper;
+
+/* Maximum number of helper kernel threads (created as they are needed,
+ * independently of the number of schedulers) */
+#ifndef MMOFFLOAD_MAX_HELPERS
+#define MMOFFLOAD_MAX_HELPERS (4)
+#endif
+
+void mmoffload_init(void);
+
+void mmoffload_deinit(void);
+
+void mmoffload_submit(Thread thread);
+
+#endif
@@ -0,0 +1,409 @@
+#include <sys/epoll.h>
+#include <sys/mman.h>
+
+#include "./mods/utils.h"
+#include "./mods/list.h"
+#include "./mods/lock.h"
+#include "./thread_descr.h"
+#include "./mmrll.h"
+#include "./mmpoll.h"
+
+/* Number of file descriptors per chunk of the descriptor table */
+#define MMPOLL_CHUNK_SIZE (1024)
+/* Number of chunks of the descriptor table */
+#define MMPOLL_NB_CHUNKS  (1024)
+
+/**
+ * Poll state of a file descriptor
+ */
+typedef struct PollDesc {
+
+    /* Threads waiting for the file descriptor to be readable */
+    List readers;
+
+    /* Threads waiting for the file descriptor to be writable */
+    List writers;
+
+    /* Lock for accessing members */
+    Lock lk;
+
+} PollDesc;
+
+/* Epoll instance */
+static int mmpoll_fd;
+/* Descriptor table, allocated in chunks as file descriptors are used */
+static PollDesc *mmpoll_descs[MMPOLL_NB_CHUNKS];
+/* Descriptor table lock */
+static Lock mmpoll_descs_lk;
+/* Number of threads waiting for readiness */
+static int mmpoll_nb_waiting;
+/* Polling status (only one scheduler polls at a time) */
+static int mmpoll_polling;
+
+/**
+ * Get the poll state of a file descriptor (its chunk should be allocated)
+ */
+#define _get_desc(fd)                                       \
+    (&mmpoll_descs[(fd) / MMPOLL_CHUNK_SIZE]                \
+                  [(fd) % MMPOLL_CHUNK_SIZE])
+
+/**
+ * @brief Arm the epoll instance for the waiting threads of a descriptor
+ *
+ * The file descriptor is registered for one readiness event of the
+ * directions the threads are waiting for
+ *
+ * @param[in] fd File descriptor
+ * @param[in] desc Pointer to the poll state of the descriptor
+ * @return 0 or negated errno
+ */
+static long _mmpoll_arm(int fd, PollDesc *desc) {
+
+    struct epoll_event event;
+    long ret;
+
+    /* Set the events of the waiting directions */
+    event.events = EPOLLONESHOT;
+    event.events |= list_is_empty(&desc->readers) ? 0 : EPOLLIN;
+    event.events |= list_is_empty(&desc->writers) ? 0 : EPOLLOUT;
+    event.data.fd = fd;
+
+    /* Re-arm the file descriptor */
+    ret = raw_syscall(SYS_epoll_ctl, mmpoll_fd, EPOLL_CTL_MOD, fd,
+                      (long)&event, 0, 0);
+
+    /* If the file descriptor is not registered yet */
+    if (ret == -ENOENT) {
+
+        /* Register it */
+        ret = raw_syscall(SYS_epoll_ctl, mmpoll_fd, EPOLL_CTL_ADD, fd,
+                          (long)&event, 0, 0);
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Move a waiting thread of a descriptor to a list of ready threads
+ * @param[out] ready Pointer to the list of ready threads
+ * @param[in] waiting Pointer to the list of waiting threads
+ * @param[in] err Error number to be reported to the thread (0 if none)
+ */
+static void _mmpoll_wake(List *ready, List *waiting, int err) {
+
+    Thread thread;
+
+    /* Get the oldest waiting thread */
+    thread = list_dequeue(waiting, struct Thread, ll_mem);
+
+    /* Set the error to be reported */
+    td_set_io_err(thread, err);
+
+    /* Add the thread to the ready threads */
+    list_enqueue(ready, thread, ll_mem);
+
+    /* Uncount the thread */
+    atomic_fetch_sub(&mmpoll_nb_waiting, 1);
+}
+
+/**
+ * @brief Move all the waiting threads of a descriptor to a list of ready
+ *        threads
+ * @param[out] ready Pointer to the list of ready threads
+ * @param[in] desc Pointer to the poll state of the descriptor
+ * @param[in] err Error number to be reported to the threads (0 if none)
+ */
+static void _mmpoll_wake_all(List *ready, PollDesc *desc, int err) {
+
+    /* While threads wait for reading */
+    while (!list_is_empty(&desc->readers)) {
+
+        _mmpoll_wake(ready, &desc->readers, err);
+    }
+
+    /* While threads wait for writing */
+    while (!list_is_empty(&desc->writers)) {
+
+        _mmpoll_wake(ready, &desc->writers, err);
+    }
+}
+
+/**
+ * @brief Add a list of threads to the many-many ready list
+ * @param[in] ready Pointer to the list of threads
+ */
+static void _mmpoll_enqueue(List *ready) {
+
+    Thread thread;
+
+    /* If there is nothing to add */
+    if (list_is_empty(ready)) {
+
+        return;
+    }
+
+    /* Lock the ready list */
+    mmrll_lock();
+
+    /* While there are threads */
+    while (!list_is_empty(ready)) {
+
+        /* Add the thread to the ready list */
+        thread = list_dequeue(ready, struct Thread, ll_mem);
+        mmrll_enqueue(thread);
+    }
+
+    /* Unlock the ready list */
+    mmrll_unlock();
+}
+
+/**
+ * @brief Initialize the poller
+ * @note Should be done by the main thread
+ */
+void mmpoll_init(void) {
+
+    /* Create the epoll instance */
+    mmpoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    /* Check for errors */
+    assert(mmpoll_fd != -1);
+
+    /* Initialize the descriptor table lock */
+    lock_init(&mmpoll_descs_lk);
+
+    /* Initialize the counters */
+    mmpoll_nb_waiting = 0;
+    mmpoll_polling = 0;
+}
+
+/**
+ * @brief Deinitialize the poller
+ * @note Should be done by the main thread, after the schedulers stopped
+ */
+void mmpoll_deinit(void) {
+
+    /* For every chunk of the descriptor table */
+    for (int i = 0; i < MMPOLL_NB_CHUNKS; i++) {
+
+        /* If the chunk is allocated */
+        if (mmpoll_descs[i]) {
+
+            /* Free the chunk */
+            munmap(mmpoll_descs[i], MMPOLL_CHUNK_SIZE * sizeof(PollDesc));
+        }
+    }
+
+    /* Close the epoll instance */
+    close(mmpoll_fd);
+}
+
+/**
+ * @brief Prepare the poll state of a file descriptor
+ *
+ * Allocates the chunk of the descriptor table covering the descriptor if
+ * required. Should be called by a thread before it waits for readiness
+ *
+ * @param[in] fd File descriptor
+ * @return 0 or negated errno
+ */
+int mmpoll_prepare(int fd) {
+
+    PollDesc *chunk;
+    int index;
+
+    /* Get the index of the chunk */
+    index = fd / MMPOLL_CHUNK_SIZE;
+
+    /* Check for errors */
+    if ((fd < 0) || (index >= MMPOLL_NB_CHUNKS)) {
+
+        return -EBADF;
+    }
+
+    /* If the chunk is allocated */
+    if (atomic_load(&mmpoll_descs[index])) {
+
+        return 0;
+    }
+
+    /* Acquire the descriptor table lock */
+    lock_acquire(&mmpoll_descs_lk);
+
+    /* If the chunk is still not allocated */
+    if (!mmpoll_descs[index]) {
+
+        /* Map the chunk (without the glibc allocator, as it may be called
+         * from any thread) */
+        chunk = (PollDesc *)raw_syscall(SYS_mmap, 0,
+                                        MMPOLL_CHUNK_SIZE * sizeof(PollDesc),
+                                        PROT_READ | PROT_WRITE,
+                                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        /* Check for errors */
+        if ((long)chunk < 0) {
+
+            /* Release the descriptor table lock */
+            lock_release(&mmpoll_descs_lk);
+            return (long)chunk;
+        }
+
+        /* For every descriptor of the chunk */
+        for (int i = 0; i < MMPOLL_CHUNK_SIZE; i++) {
+
+            /* Initialize the poll state */
+            list_init(&chunk[i].readers);
+            list_init(&chunk[i].writers);
+            lock_init(&chunk[i].lk);
+        }
+
+        /* Publish the chunk */
+        atomic_store(&mmpoll_descs[index], chunk);
+    }
+
+    /* Release the descriptor table lock */
+    lock_release(&mmpoll_descs_lk);
+
+    return 0;
+}
+
+/**
+ * @brief Park a thread till its file descriptor is ready
+ *
+ * Adds the thread to the waiting threads of the descriptor and arms the
+ * epoll instance. Should be done by the scheduler after the thread gave up
+ * the control, so that the thread is not run by another scheduler before its
+ * context is saved. If the descriptor cannot be polled, the thread is made
+ * ready right away with the error
+ *
+ * @param[in] thread Thread handle
+ */
+void mmpoll_wait(Thread thread) {
+
+    PollDesc *desc;
+    List ready;
+    long ret;
+
+    /* Get the poll state of the descriptor */
+    desc = _get_desc(td_get_io_fd(thread));
+
+    /* Initialize the list of ready threads */
+    list_init(&ready);
+
+    /* Acquire the member lock */
+    lock_acquire(&desc->lk);
+
+    /* Add the thread to the waiting threads of its direction */
+    if (td_get_io_events(thread) & EPOLLIN) {
+
+        list_enqueue(&desc->readers, thread, ll_mem);
+    } else {
+
+        list_enqueue(&desc->writers, thread, ll_mem);
+    }
+
+    /* Count the thread */
+    atomic_fetch_add(&mmpoll_nb_waiting, 1);
+
+    /* Arm the epoll instance */
+    ret = _mmpoll_arm(td_get_io_fd(thread), desc);
+
+    /* If the descriptor cannot be polled */
+    if (ret) {
+
+        /* Make all its waiting threads ready with the error */
+        _mmpoll_wake_all(&ready, desc, -ret);
+    }
+
+    /* Release the member lock */
+    lock_release(&desc->lk);
+
+    /* Add the threads made ready to the ready list */
+    _mmpoll_enqueue(&ready);
+}
+
+/**
+ * @brief Poll for readiness events
+ *
+ * For every ready descriptor, the oldest thread waiting for each ready
+ * direction is moved to the many-many ready list, the epoll instance is
+ * armed again for the remaining waiting threads. Only one scheduler polls
+ * at a time, the others return right away
+ *
+ * @param[in] timeout_ms Time to wait for an event in milli seconds
+ * @return Number of readiness events handled
+ */
+int mmpoll_poll(int timeout_ms) {
+
+    struct epoll_event events[MMPOLL_BATCH];
+    PollDesc *desc;
+    List ready;
+    long nb, ret;
+    int fd;
+
+    /* If no thread is waiting or another scheduler is polling */
+    if (!atomic_load(&mmpoll_nb_waiting) ||
+        !atomic_cas(&mmpoll_polling, 0, 1)) {
+
+        return 0;
+    }
+
+    /* Get the readiness events */
+    nb = raw_syscall(SYS_epoll_wait, mmpoll_fd, (long)events, MMPOLL_BATCH,
+                     timeout_ms, 0, 0);
+
+    /* Let the other schedulers poll */
+    atomic_store(&mmpoll_polling, 0);
+
+    /* Initialize the list of ready threads */
+    list_init(&ready);
+
+    /* For every event */
+    for (long i = 0; i < nb; i++) {
+
+        /* Get the poll state of the descriptor */
+        fd = events[i].data.fd;
+        desc = _get_desc(fd);
+
+        /* Acquire the member lock */
+        lock_acquire(&desc->lk);
+
+        /* If the descriptor is readable and a thread waits for it */
+        if ((events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) &&
+            !list_is_empty(&desc->readers)) {
+
+            /* Make the oldest reader ready */
+            _mmpoll_wake(&ready, &desc->readers, 0);
+        }
+
+        /* If the descriptor is writable and a thread waits for it */
+        if ((events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) &&
+            !list_is_empty(&desc->writers)) {
+
+            /* Make the oldest writer ready */
+            _mmpoll_wake(&ready, &desc->writers, 0);
+        }
+
+        /* If threads are still waiting */
+        if (!list_is_empty(&desc->readers) ||
+            !list_is_empty(&desc->writers)) {
+
+            /* Arm the epoll instance again */
+            ret = _mmpoll_arm(fd, desc);
+
+            /* If the descriptor cannot be polled anymore */
+            if (ret) {
+
+                /* Make all its waiting threads ready with the error */
+                _mmpoll_wake_all(&ready, desc, -ret);
+            }
+        }
+
+        /* Release the member lock */
+        lock_release(&desc->lk);
+    }
+
+    /* Add the threads made ready to the ready list */
+    _mmpoll_enqueue(&ready);
+
+    return (nb > 0) ? nb : 0;
+}
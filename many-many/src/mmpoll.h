@@ -0,0 +1,33 @@
+#ifndef _MMPOLL_H_
+#define _MMPOLL_H_
+
+#include "./thread.h"
+
+/* Maximum number of readiness events handled by one poll */
+#ifndef MMPOLL_BATCH
+#define MMPOLL_BATCH (64)
+#endif
+
+/* Time after which a busy scheduler polls for readiness events (in micro
+ * seconds) */
+#ifndef MMPOLL_PERIOD_us
+#define MMPOLL_PERIOD_us (1000u)
+#endif
+
+/* Time for which a scheduler finding no ready thread waits for readiness
+ * events (in milli seconds, 0 disables waiting) */
+#ifndef MMPOLL_IDLE_WAIT_ms
+#define MMPOLL_IDLE_WAIT_ms (1)
+#endif
+
+void mmpoll_init(void);
+
+void mmpoll_deinit(void);
+
+int mmpoll_prepare(int fd);
+
+void mmpoll_wait(Thread thread);
+
+int mmpoll_poll(int timeout_ms);
+
+#endif
@@ -1,33 +1,661 @@
 #include "./mods/list.h"
+#include "./mods/heap.h"
 #include "./mods/lock.h"
+#include "./mods/mpsc.h"
+#include "./mods/mpmc.h"
 #include "./thread_descr.h"
 #include "./mmrll.h"
+#include "./mmsched.h"
 
-/* Many-many ready threads linked list */
-static List mmrll;
+#if !MMRLL_LOCKFREE
+
+/* Many-many ready threads linked lists (one per priority level) */
+static List mmrll[MMRLL_NB_PRIOS];
+/* Bitmap of the non empty priority levels */
+static unsigned int mmrll_bitmap;
+#if MMRLL_AGING_PERIOD
+/* Number of dequeues since the last aging */
+static unsigned int mmrll_age_cnt;
+#endif
+/* Many-many ready threads heap ordered by virtual runtime */
+static Heap mmrll_fair;
+/* Virtual runtime below which no ready thread is placed */
+static unsigned long mmrll_min_vruntime;
+/* Many-many ready threads heap ordered by deadline */
+static Heap mmrll_edf;
+/* Many-many ready threads linked lists of the preferred schedulers (one per
+ * scheduler) */
+static List mmrll_affine[MMSCHED_MAX_SCHEDS];
+/* Number of active schedulers */
+static int mmrll_nb_scheds;
+/* Number of threads on the lists of the preferred schedulers */
+static int mmrll_nb_affine;
+/* Number of ready threads */
+static int mmrll_len;
+/* Scheduling policy */
+static int mmrll_policy;
 /* Many-many ready threads linked list lock */
 static Lock mmrll_lk;
+/* Ready threads pushed without the lock, moved to the structures above by
+ * the next holder of the lock */
+static Mpsc mmrll_stage;
+
+/**
+ * Priority level bitmap handling
+ */
+#define _level_set(level)   (mmrll_bitmap |= (1u << (level)))
+#define _level_clear(level) (mmrll_bitmap &= ~(1u << (level)))
+#define _level_highest()    (31 - __builtin_clz(mmrll_bitmap))
+#define _level_lowest()     (__builtin_ctz(mmrll_bitmap))
+
+/**
+ * Fair policy weights of the priority levels, each level gets about 25% more
+ * CPU time than the level below it (same as the nice weights of Linux)
+ */
+static const unsigned long mmrll_weight[MMRLL_NB_PRIOS] = {
+    29, 36, 45, 56, 70, 87, 110, 137,
+    172, 215, 272, 335, 423, 526, 655, 820,
+    1024, 1277, 1586, 1991, 2501, 3121, 3906, 4904,
+    6100, 7620, 9548, 11916, 14949, 18705, 23254, 29154
+};
+
+/**
+ * @brief Add a thread descriptor to the tail of its effective priority level
+ * @param[in] thread Thread handle
+ */
+static void _mmrll_prio_insert(Thread thread) {
+
+    int level;
+
+    /* Get the level of the thread */
+    level = td_get_eff_prio(thread) - THREAD_PRIO_MIN;
+
+    /* Add the thread descriptor to the list of the level */
+    list_enqueue(&mmrll[level], thread, ll_mem);
+
+    /* Mark the level as non empty */
+    _level_set(level);
+
+    /* Mark the thread as queued */
+    td_set_queued(thread, THREAD_QUEUED_PRIO);
+}
+
+/**
+ * @brief Remove a thread descriptor from its effective priority level
+ * @param[in] thread Thread handle
+ */
+static void _mmrll_prio_delete(Thread thread) {
+
+    int level;
+
+    /* Get the level of the thread */
+    level = td_get_eff_prio(thread) - THREAD_PRIO_MIN;
+
+    /* Remove the thread descriptor from the list of the level */
+    list_remove(&mmrll[level], thread, ll_mem);
+
+    /* If the level became empty */
+    if (list_is_empty(&mmrll[level])) {
+
+        /* Mark the level as empty */
+        _level_clear(level);
+    }
+
+    /* Mark the thread as not queued */
+    td_clear_queued(thread);
+}
+
+#if MMRLL_AGING_PERIOD
+/**
+ * @brief Age the oldest thread of the lowest non empty priority level
+ *
+ * Moves the thread one level up so that a continuous stream of higher
+ * priority threads cannot starve it indefinitely
+ */
+static void _mmrll_age(void) {
+
+    Thread thread;
+    int level;
+
+    /* Get the lowest non empty level */
+    level = _level_lowest();
+
+    /* If it is already the highest level it cannot be aged further */
+    if (level == MMRLL_NB_PRIOS - 1) {
+
+        return;
+    }
+
+    /* Get the oldest thread of the level */
+    thread = list_dequeue(&mmrll[level], struct Thread, ll_mem);
+
+    /* If the level became empty */
+    if (list_is_empty(&mmrll[level])) {
+
+        /* Mark the level as empty */
+        _level_clear(level);
+    }
+
+    /* Raise its effective priority by one level */
+    td_set_eff_prio(thread, td_get_eff_prio(thread) + 1);
+
+    /* Add it to the tail of the next level */
+    _mmrll_prio_insert(thread);
+}
+#endif
+
+/**
+ * @brief Remove the oldest thread descriptor of the highest priority level
+ *
+ * The effective priority of the returned thread is reset to its base
+ * priority
+ *
+ * @return Thread handle
+ */
+static Thread _mmrll_prio_pop(void) {
+
+    Thread thread;
+    int level;
+
+    /* Get the highest non empty level */
+    level = _level_highest();
+
+    /* Dequeue the first thread descriptor from the level */
+    thread = list_dequeue(&mmrll[level], struct Thread, ll_mem);
+
+    /* If the level became empty */
+    if (list_is_empty(&mmrll[level])) {
+
+        /* Mark the level as empty */
+        _level_clear(level);
+    }
+
+    /* Mark the thread as not queued */
+    td_clear_queued(thread);
+
+    /* Drop the priority gained while waiting */
+    td_reset_eff_prio(thread);
+
+#if MMRLL_AGING_PERIOD
+    /* If the aging period has elapsed and threads are still waiting */
+    if ((++mmrll_age_cnt >= MMRLL_AGING_PERIOD) && mmrll_bitmap) {
+
+        /* Age the threads */
+        _mmrll_age();
+
+        /* Restart the period */
+        mmrll_age_cnt = 0;
+    }
+#endif
+
+    return thread;
+}
+
+/**
+ * @brief Add a thread descriptor to the fair heap
+ *
+ * A thread which has been away from the heap (new or blocked) does not get
+ * credit for the time it did not run, so it is placed at the minimum virtual
+ * runtime
+ *
+ * @param[in] thread Thread handle
+ */
+static void _mmrll_fair_insert(Thread thread) {
+
+    /* If the thread is behind the ready threads */
+    if (td_get_vruntime(thread) < mmrll_min_vruntime) {
+
+        /* Catch it up */
+        td_set_vruntime(thread, mmrll_min_vruntime);
+    }
+
+    /* Add the thread descriptor to the heap */
+    heap_insert(&mmrll_fair, thread, hp_mem, td_get_vruntime(thread));
+
+    /* Mark the thread as queued */
+    td_set_queued(thread, THREAD_QUEUED_FAIR);
+}
+
+/**
+ * @brief Remove the thread descriptor with the least virtual runtime
+ * @return Thread handle
+ */
+static Thread _mmrll_fair_pop(void) {
+
+    Thread thread;
+
+    /* Remove the thread descriptor from the heap */
+    thread = heap_pop(&mmrll_fair, struct Thread, hp_mem);
+
+    /* Advance the minimum virtual runtime */
+    if (td_get_vruntime(thread) > mmrll_min_vruntime) {
+
+        mmrll_min_vruntime = td_get_vruntime(thread);
+    }
+
+    /* Mark the thread as not queued */
+    td_clear_queued(thread);
+
+    return thread;
+}
+
+/**
+ * @brief Add a thread descriptor to the earliest deadline first heap
+ * @param[in] thread Thread handle
+ */
+static void _mmrll_edf_insert(Thread thread) {
+
+    /* Add the thread descriptor to the heap */
+    heap_insert(&mmrll_edf, thread, hp_mem, td_get_deadline(thread));
+
+    /* Mark the thread as queued */
+    td_set_queued(thread, THREAD_QUEUED_EDF);
+}
+
+/**
+ * @brief Remove the thread descriptor with the earliest deadline
+ * @return Thread handle
+ */
+static Thread _mmrll_edf_pop(void) {
+
+    Thread thread;
+
+    /* Remove the thread descriptor from the heap */
+    thread = heap_pop(&mmrll_edf, struct Thread, hp_mem);
+
+    /* Mark the thread as not queued */
+    td_clear_queued(thread);
+
+    return thread;
+}
+
+/**
+ * @brief Add a thread descriptor to the list of its preferred scheduler
+ * @param[in] thread Thread handle
+ */
+static void _mmrll_affine_insert(Thread thread) {
+
+    /* Under the fair policy, do not give credit for the time the thread did
+     * not run, as for the heap (so that it ranks with the heap) */
+    if ((mmrll_policy == THREAD_SCHED_FAIR) &&
+        (td_get_vruntime(thread) < mmrll_min_vruntime)) {
+
+        td_set_vruntime(thread, mmrll_min_vruntime);
+    }
+
+    /* Add the thread descriptor to the list of the scheduler */
+    list_enqueue(&mmrll_affine[td_get_affine(thread)], thread, ll_mem);
+
+    /* Count the thread */
+    mmrll_nb_affine++;
+
+    /* Mark the thread as queued */
+    td_set_queued(thread, THREAD_QUEUED_AFFINE);
+}
+
+/**
+ * @brief Remove a thread descriptor from the list of its preferred scheduler
+ * @param[in] thread Thread handle
+ */
+static void _mmrll_affine_delete(Thread thread) {
+
+    /* Remove the thread descriptor from the list of the scheduler */
+    list_remove(&mmrll_affine[td_get_affine(thread)], thread, ll_mem);
+
+    /* Uncount the thread */
+    mmrll_nb_affine--;
+
+    /* Mark the thread as not queued */
+    td_clear_queued(thread);
+}
+
+/**
+ * @brief Remove the oldest thread descriptor preferring a scheduler
+ * @param[in] sched Scheduler index
+ * @return Thread handle
+ */
+static Thread _mmrll_affine_pop(int sched) {
+
+    Thread thread;
+
+    /* Dequeue the first thread descriptor from the list of the scheduler */
+    thread = list_dequeue(&mmrll_affine[sched], struct Thread, ll_mem);
+
+    /* Uncount the thread */
+    mmrll_nb_affine--;
+
+    /* Mark the thread as not queued */
+    td_clear_queued(thread);
+
+    return thread;
+}
+
+/**
+ * @brief Steal the oldest thread descriptor preferring another scheduler
+ *
+ * The lists of the other schedulers are visited starting from the next
+ * scheduler so that the thieves do not all drain the same list
+ *
+ * @param[in] sched Index of the stealing scheduler
+ * @return Thread handle
+ */
+static Thread _mmrll_affine_steal(int sched) {
+
+    int victim;
+
+    /* For every scheduler */
+    for (int i = 1; i <= mmrll_nb_scheds; i++) {
+
+        /* Get the scheduler index */
+        victim = (sched + i) % mmrll_nb_scheds;
+
+        /* If the scheduler has waiting threads */
+        if (!list_is_empty(&mmrll_affine[victim])) {
+
+            /* Take the oldest one */
+            return _mmrll_affine_pop(victim);
+        }
+    }
+
+    /* Unreachable when the ready list is not empty */
+    assert(0);
+
+    return NULL;
+}
+
+/**
+ * @brief Add a thread descriptor to the structure of the scheduling policy
+ * @param[in] thread Thread handle
+ */
+static void _mmrll_policy_insert(Thread thread) {
+
+    /* If the fair policy is used */
+    if (mmrll_policy == THREAD_SCHED_FAIR) {
+
+        /* Add a thread descriptor to the heap */
+        _mmrll_fair_insert(thread);
+    } else {
+
+        /* Add a thread descriptor to its priority level */
+        _mmrll_prio_insert(thread);
+    }
+}
+
+/**
+ * @brief Remove the next thread descriptor of the scheduling policy
+ * @return Thread handle
+ */
+static Thread _mmrll_policy_pop(void) {
+
+    /* If the fair policy is used */
+    if (mmrll_policy == THREAD_SCHED_FAIR) {
+
+        /* Get the thread which got the least CPU time */
+        return _mmrll_fair_pop();
+    }
+
+    /* Get the oldest thread of the highest priority */
+    return _mmrll_prio_pop();
+}
+
+/**
+ * @brief Are the structures of the scheduling policy empty
+ * @return 0 if not empty
+ * @return 1 if empty
+ */
+static int _mmrll_policy_is_empty(void) {
+
+    /* If the fair policy is used */
+    if (mmrll_policy == THREAD_SCHED_FAIR) {
+
+        /* Check if the heap is empty */
+        return heap_is_empty(&mmrll_fair);
+    }
+
+    /* Check if all the levels are empty */
+    return !mmrll_bitmap;
+}
+
+/**
+ * @brief Does a thread descriptor rank below the next thread of the policy
+ * @param[in] thread Thread handle
+ * @return 1 if it ranks below
+ * @return 0 otherwise (ranks with it or above it, or the policy is empty)
+ */
+static int _mmrll_ranks_below(Thread thread) {
+
+    /* If no thread is ready under the policy */
+    if (_mmrll_policy_is_empty()) {
+
+        return 0;
+    }
+
+    /* If the fair policy is used */
+    if (mmrll_policy == THREAD_SCHED_FAIR) {
+
+        /* Compare with the least virtual runtime */
+        return td_get_vruntime(thread) > heap_min_key(&mmrll_fair);
+    }
+
+    /* Compare with the highest level */
+    return td_get_eff_prio(thread) - THREAD_PRIO_MIN < _level_highest();
+}
+
+/**
+ * @brief Is a thread preferring a scheduler to be dispatched next by it
+ *
+ * The preferred scheduler only breaks the ties of the policy: the threads
+ * preferring the scheduler which rank below the next thread of the policy
+ * are moved to the structures of the policy, where they age (or get their
+ * share) as the other threads and can be dispatched by any scheduler
+ *
+ * @param[in] sched Scheduler index
+ * @return 1 if the oldest thread preferring the scheduler is next
+ * @return 0 otherwise
+ */
+static int _mmrll_affine_is_next(int sched) {
+
+    Thread thread;
+
+    /* While threads prefer the scheduler */
+    while (!list_is_empty(&mmrll_affine[sched])) {
+
+        /* If the oldest one ranks with the next thread of the policy */
+        thread = list_peek(&mmrll_affine[sched], struct Thread, ll_mem);
+        if (!_mmrll_ranks_below(thread)) {
+
+            return 1;
+        }
+
+        /* Move it under the policy */
+        _mmrll_affine_pop(sched);
+        _mmrll_policy_insert(thread);
+    }
+
+    return 0;
+}
 
 /**
  * @brief Initialize the many-many ready list
  */
 void mmrll_init(void) {
 
-    /* Initialize the list */
-    list_init(&mmrll);
+    /* For every priority level */
+    for (int i = 0; i < MMRLL_NB_PRIOS; i++) {
+
+        /* Initialize the list */
+        list_init(&mmrll[i]);
+    }
+
+    /* Initialize the bitmap */
+    mmrll_bitmap = 0;
+
+#if MMRLL_AGING_PERIOD
+    /* Initialize the aging counter */
+    mmrll_age_cnt = 0;
+#endif
+
+    /* Initialize the heaps */
+    heap_init(&mmrll_fair);
+    heap_init(&mmrll_edf);
+
+    /* For every scheduler */
+    for (int i = 0; i < MMSCHED_MAX_SCHEDS; i++) {
+
+        /* Initialize the list */
+        list_init(&mmrll_affine[i]);
+    }
+
+    /* No scheduler is active yet */
+    mmrll_nb_scheds = 0;
+
+    /* No thread prefers a scheduler yet */
+    mmrll_nb_affine = 0;
+
+    /* No thread is ready yet */
+    mmrll_len = 0;
+
+    /* Initialize the minimum virtual runtime */
+    mmrll_min_vruntime = 0;
+
+    /* Use the priority policy by default */
+    mmrll_policy = THREAD_SCHED_PRIO;
 
     /* Initialize the lock */
     lock_init(&mmrll_lk);
+
+    /* No thread is pushed yet */
+    mpsc_init(&mmrll_stage);
 }
 
 /**
  * @brief Dequeue a thread descriptor from the many-many ready list
+ *
+ * Threads with a deadline and budget left are dispatched first, earliest
+ * deadline first. Otherwise under the priority policy returns the oldest
+ * thread of the highest non empty priority level, and under the fair policy
+ * returns the thread with the least virtual runtime. The oldest thread
+ * preferring the dequeuing scheduler is returned first if it ranks with that
+ * thread (see _mmrll_affine_is_next()). If only threads preferring other
+ * schedulers are left, one of them is stolen
+ *
+ * @param[in] sched Index of the dequeuing scheduler
  * @return Thread handle
  */
-Thread mmrll_dequeue(void) {
+Thread mmrll_dequeue(int sched) {
+
+    /* Uncount the thread */
+    mmrll_len--;
+
+    /* If a deadline thread is ready */
+    if (!heap_is_empty(&mmrll_edf)) {
+
+        /* Get the thread with the earliest deadline */
+        return _mmrll_edf_pop();
+    }
+
+    /* If a thread preferring the scheduler ranks with the next thread of the
+     * policy */
+    if (_mmrll_affine_is_next(sched)) {
+
+        /* Get the oldest such thread */
+        return _mmrll_affine_pop(sched);
+    }
 
-    /* Dequeue the first thread descriptor from the list */
-    return list_dequeue(&mmrll, struct Thread, ll_mem);
+    /* If a thread is ready under the policy */
+    if (!_mmrll_policy_is_empty()) {
+
+        /* Get the next thread of the policy */
+        return _mmrll_policy_pop();
+    }
+
+    /* Steal a thread preferring another scheduler */
+    return _mmrll_affine_steal(sched);
+}
+
+/**
+ * @brief Dequeue a batch of thread descriptors from the many-many ready list
+ *
+ * The first thread is the one mmrll_dequeue() returns. It is followed by the
+ * threads which would be dequeued next and rank with it: the threads of the
+ * same priority level under the priority policy, the threads with the least
+ * virtual runtime under the fair policy. A deadline thread, a thread
+ * preferring a scheduler or a stolen thread is dequeued alone
+ *
+ * @param[in] sched Index of the dequeuing scheduler
+ * @param[out] batch Pointer to the batch list (threads added to its tail)
+ * @param[in] nb Maximum number of threads (at least one)
+ * @return Number of threads dequeued
+ */
+int mmrll_dequeue_batch(int sched, List *batch, int nb) {
+
+    Thread thread;
+    int level = 0, taken = 1;
+
+    /* If the next thread is a deadline thread, prefers the scheduler, or is
+     * stolen, dequeue it alone */
+    if (!heap_is_empty(&mmrll_edf) || _mmrll_affine_is_next(sched) ||
+        _mmrll_policy_is_empty()) {
+
+        nb = 1;
+    } else if (mmrll_policy == THREAD_SCHED_PRIO) {
+
+        /* Note the level of the first thread */
+        level = _level_highest();
+    }
+
+    /* Dequeue the first thread */
+    thread = mmrll_dequeue(sched);
+    list_enqueue(batch, thread, ll_mem);
+
+    /* While threads ranking with the first one are ready */
+    while ((taken < nb) && heap_is_empty(&mmrll_edf) &&
+           !_mmrll_affine_is_next(sched) &&
+           !_mmrll_policy_is_empty()) {
+
+        /* Under the priority policy stop at a lower level */
+        if ((mmrll_policy == THREAD_SCHED_PRIO) &&
+            (_level_highest() != level)) {
+
+            break;
+        }
+
+        /* Dequeue the thread */
+        mmrll_len--;
+        thread = _mmrll_policy_pop();
+        list_enqueue(batch, thread, ll_mem);
+        taken++;
+    }
+
+    return taken;
+}
+
+/**
+ * @brief Is a thread ranking above a thread descriptor ready
+ *
+ * Reads the structures without the lock, hence the answer is a hint. The
+ * threads pushed since the lock was last held are not seen
+ *
+ * @param[in] thread Thread handle
+ * @return 1 if a deadline thread or a thread of a higher priority level is
+ *         ready
+ * @return 0 otherwise
+ */
+int mmrll_outranks(Thread thread) {
+
+    unsigned int bitmap;
+
+    /* If a deadline thread is ready */
+    if (!heap_is_empty(&mmrll_edf)) {
+
+        return 1;
+    }
+
+    /* Under the priority policy check for a higher level */
+    bitmap = atomic_load(&mmrll_bitmap);
+    return ((mmrll_policy == THREAD_SCHED_PRIO) && bitmap &&
+            ((int)(31 - __builtin_clz(bitmap)) >
+             td_get_eff_prio(thread) - THREAD_PRIO_MIN));
 }
 
 /**
@@ -36,8 +664,217 @@ Thread mmrll_dequeue(void) {
  */
 void mmrll_enqueue(Thread thread) {
 
-    /* Add a thread descriptor to the list */
-    list_enqueue(&mmrll, thread, ll_mem);
+    /* Count the thread */
+    mmrll_len++;
+
+    /* If the thread has a deadline and budget left */
+    if (td_is_edf(thread)) {
+
+        /* Add a thread descriptor to the deadline heap */
+        _mmrll_edf_insert(thread);
+    } else if (td_has_affine(thread) &&
+               (td_get_affine(thread) < mmrll_nb_scheds)) {
+
+        /* Add a thread descriptor to its preferred scheduler */
+        _mmrll_affine_insert(thread);
+    } else {
+
+        /* Add a thread descriptor under the policy */
+        _mmrll_policy_insert(thread);
+    }
+}
+
+/**
+ * @brief Push a thread descriptor to the many-many ready list without the
+ *        lock
+ *
+ * The thread is queued on a lock-free queue, it is added to the structures
+ * of the ready list by the next holder of the lock (see mmrll_lock())
+ *
+ * @param[in] thread Thread handle
+ * @note Interrupts should be disabled when called from a user thread, as
+ *       the threads pushed after it are not seen till the push completes
+ *       (see mmrll_is_staged())
+ */
+void mmrll_push(Thread thread) {
+
+    /* Queue the thread descriptor */
+    mpsc_push(&mmrll_stage, thread, rl_mem);
+}
+
+/**
+ * @brief Add a new thread descriptor to a batch
+ *
+ * The batch is private to the caller, hence the ready list lock is not
+ * needed. The thread should have the default priority, no deadline and no
+ * preferred scheduler, so that under the priority policy the whole batch
+ * can be added to the default level at once
+ *
+ * @param[in/out] batch Pointer to the batch list
+ * @param[in] thread Thread handle
+ */
+void mmrll_batch(List *batch, Thread thread) {
+
+    /* Add the thread descriptor to the batch */
+    list_enqueue(batch, thread, ll_mem);
+
+    /* Mark the thread as queued on its priority level */
+    td_set_queued(thread, THREAD_QUEUED_PRIO);
+}
+
+/**
+ * @brief Add a batch of new thread descriptors to the many-many ready list
+ *
+ * Under the priority policy the batch is appended to the default level in
+ * constant time, under the fair policy the threads are added one by one
+ *
+ * @param[in/out] batch Pointer to the batch list (left empty)
+ * @param[in] nb Number of threads in the batch
+ */
+void mmrll_enqueue_batch(List *batch, int nb) {
+
+    Thread thread;
+    int level;
+
+    /* Count the threads */
+    mmrll_len += nb;
+
+    /* If the fair policy is used */
+    if (mmrll_policy == THREAD_SCHED_FAIR) {
+
+        /* While there are threads in the batch */
+        while (!list_is_empty(batch)) {
+
+            /* Add a thread descriptor to the heap */
+            thread = list_dequeue(batch, struct Thread, ll_mem);
+            _mmrll_fair_insert(thread);
+        }
+
+        return;
+    }
+
+    /* Get the default level */
+    level = THREAD_PRIO_DEFAULT - THREAD_PRIO_MIN;
+
+    /* Append the batch to the list of the level */
+    list_splice(&mmrll[level], batch);
+
+    /* Mark the level as non empty */
+    _level_set(level);
+}
+
+/**
+ * @brief Remove a thread descriptor from the many-many ready list
+ *
+ * Used to update the scheduling parameters of a ready thread, the thread
+ * should be enqueued back after the update. A thread taken ahead by a
+ * scheduler is taken off its batch
+ *
+ * @param[in] thread Thread handle
+ * @return 0 if the thread was not on the ready list
+ * @return 1 if the thread was removed
+ */
+int mmrll_remove(Thread thread) {
+
+    /* Remove the thread from the structure holding it */
+    switch (td_get_queued(thread)) {
+
+        case THREAD_QUEUED_PRIO:
+
+            /* Remove from the priority level */
+            _mmrll_prio_delete(thread);
+            break;
+
+        case THREAD_QUEUED_FAIR:
+
+            /* Remove from the fair heap */
+            heap_remove(&mmrll_fair, thread, hp_mem);
+            break;
+
+        case THREAD_QUEUED_EDF:
+
+            /* Remove from the deadline heap */
+            heap_remove(&mmrll_edf, thread, hp_mem);
+            break;
+
+        case THREAD_QUEUED_AFFINE:
+
+            /* Remove from the list of the preferred scheduler */
+            _mmrll_affine_delete(thread);
+            break;
+
+        case THREAD_QUEUED_BATCH:
+
+            /* Remove from the batch of the scheduler which took it ahead,
+             * the thread is not counted on the ready list anymore */
+            return mmsched_unbatch(thread, 0);
+
+        default:
+
+            /* Not on the ready list */
+            return 0;
+    }
+
+    /* Mark the thread as not queued */
+    td_clear_queued(thread);
+
+    /* Uncount the thread */
+    mmrll_len--;
+
+    return 1;
+}
+
+/**
+ * @brief Remove a thread descriptor if it is the next one to be dequeued
+ *
+ * A thread preferring a scheduler is never claimed, nor is a thread behind a
+ * deadline thread or a thread preferring a scheduler
+ *
+ * @param[in] thread Thread handle
+ * @return 0 if the thread is not the next one to be dequeued
+ * @return 1 if the thread was removed
+ */
+int mmrll_claim(Thread thread) {
+
+    int next;
+
+    /* Check if the thread is at the head of the structure holding it */
+    switch (td_get_queued(thread)) {
+
+        case THREAD_QUEUED_PRIO:
+
+            /* The oldest thread of the highest priority level */
+            next = (heap_is_empty(&mmrll_edf) && !mmrll_nb_affine &&
+                    (mmrll[_level_highest()].head == &thread->ll_mem));
+            break;
+
+        case THREAD_QUEUED_FAIR:
+
+            /* The thread with the least virtual runtime */
+            next = (heap_is_empty(&mmrll_edf) && !mmrll_nb_affine &&
+                    (mmrll_fair.root == &thread->hp_mem));
+            break;
+
+        case THREAD_QUEUED_EDF:
+
+            /* The thread with the earliest deadline */
+            next = (mmrll_edf.root == &thread->hp_mem);
+            break;
+
+        case THREAD_QUEUED_BATCH:
+
+            /* The oldest thread taken ahead by a scheduler, which would
+             * dispatch it next */
+            return mmsched_unbatch(thread, 1);
+
+        default:
+
+            /* Not on the ready list or preferring a scheduler */
+            next = 0;
+    }
+
+    /* Remove the thread if it is the next one */
+    return (next && mmrll_remove(thread));
 }
 
 /**
@@ -47,17 +884,160 @@ void mmrll_enqueue(Thread thread) {
  */
 int mmrll_is_empty(void) {
 
-    /* Check if list is empty */
-    return list_is_empty(&mmrll);
+    /* Check if the deadline heap, the lists of the preferred schedulers and
+     * the policy structures are empty */
+    return (heap_is_empty(&mmrll_edf) && !mmrll_nb_affine &&
+            _mmrll_policy_is_empty());
+}
+
+/**
+ * @brief Is a push to the many-many ready list not complete yet
+ *
+ * The threads pushed by a producer stalled in the middle of its push, and
+ * the ones pushed after it, are seen by mmrll_lock() once the push completes
+ *
+ * @return 0 if every thread pushed has been added to the structures
+ * @return 1 if a push is not complete yet
+ * @note Should be called with the lock held
+ */
+int mmrll_is_staged(void) {
+
+    /* Check if the threads pushed have all been taken from the queue */
+    return !mpsc_is_empty(&mmrll_stage);
+}
+
+/**
+ * @brief Get the number of ready threads
+ * @return Number of threads on the many-many ready list
+ */
+int mmrll_length(void) {
+
+    /* Return the count */
+    return mmrll_len;
+}
+
+/**
+ * @brief Change the number of active schedulers
+ *
+ * The threads preferring a scheduler which is no longer active are moved to
+ * the structures of the scheduling policy
+ *
+ * @param[in] nb_scheds Number of active schedulers
+ */
+void mmrll_set_nb_scheds(int nb_scheds) {
+
+    Thread thread;
+
+    /* For every scheduler which is no longer active */
+    for (int i = nb_scheds; i < mmrll_nb_scheds; i++) {
+
+        /* While threads prefer the scheduler */
+        while (!list_is_empty(&mmrll_affine[i])) {
+
+            /* Move the thread under the policy */
+            thread = _mmrll_affine_pop(i);
+            _mmrll_policy_insert(thread);
+        }
+    }
+
+    /* Update the number of schedulers */
+    mmrll_nb_scheds = nb_scheds;
+}
+
+/**
+ * @brief Change the scheduling policy
+ *
+ * Moves all the ready threads to the structure of the new policy
+ *
+ * @param[in] policy Scheduling policy
+ */
+void mmrll_set_policy(int policy) {
+
+    List tmp;
+    Thread thread;
+
+    /* If the policy does not change */
+    if (policy == mmrll_policy) {
+
+        return;
+    }
+
+    /* Take all the ready threads out of the old policy */
+    list_init(&tmp);
+    while (!_mmrll_policy_is_empty()) {
+
+        thread = _mmrll_policy_pop();
+        list_enqueue(&tmp, thread, ll_mem);
+    }
+
+    /* Update the policy */
+    mmrll_policy = policy;
+
+    /* Add the ready threads under the new policy */
+    while (!list_is_empty(&tmp)) {
+
+        thread = list_dequeue(&tmp, struct Thread, ll_mem);
+        _mmrll_policy_insert(thread);
+    }
+}
+
+/**
+ * @brief Get the scheduling policy
+ * @return Scheduling policy
+ */
+int mmrll_get_policy(void) {
+
+    /* Return the policy */
+    return mmrll_policy;
+}
+
+/**
+ * @brief Charge CPU time to a thread descriptor
+ *
+ * Advances the virtual runtime of the thread by the CPU time consumed scaled
+ * inversely with the weight of its priority, and consumes the budget of its
+ * deadline if any
+ *
+ * @param[in] thread Thread handle
+ * @param[in] ns CPU time consumed in nano seconds
+ */
+void mmrll_charge(Thread thread, unsigned long ns) {
+
+    unsigned long weight;
+
+    /* Get the weight of the thread */
+    weight = mmrll_weight[td_get_prio(thread) - THREAD_PRIO_MIN];
+
+    /* Advance the virtual runtime */
+    td_set_vruntime(thread, td_get_vruntime(thread) +
+                    ns * MMRLL_FAIR_WEIGHT_DEFAULT / weight);
+
+    /* If the thread has a deadline */
+    if (td_has_deadline(thread)) {
+
+        /* Consume the budget */
+        td_use_budget(thread, ns);
+    }
 }
 
 /**
  * @brief Acquire the lock for the many-many ready list
+ *
+ * Adds the threads pushed without the lock to the structures, so that the
+ * holder of the lock sees every ready thread
  */
 void mmrll_lock(void) {
 
+    Thread thread;
+
     /* Acquire the lock */
     lock_acquire(&mmrll_lk);
+
+    /* Add the threads pushed meanwhile, in the order they were pushed */
+    while ((thread = mpsc_pop(&mmrll_stage, struct Thread, rl_mem))) {
+
+        mmrll_enqueue(thread);
+    }
 }
 
 /**
@@ -68,3 +1048,319 @@ void mmrll_unlock(void) {
     /* Release the lock */
     lock_release(&mmrll_lk);
 }
+
+#else
+
+/* Cells of the many-many ready threads ring */
+static MpmcCell mmrll_cells[MMRLL_RING_SIZE];
+/* Many-many ready threads ring */
+static Mpmc mmrll_ring;
+/* Ready threads which did not fit in the ring, moved to it by the holder of
+ * the overflow lock */
+static Mpsc mmrll_stage;
+/* Thread taken from the overflow queue which did not fit in the ring yet */
+static Thread mmrll_held;
+/* Number of threads on the overflow queue (held one included) */
+static int mmrll_nb_staged;
+/* Overflow queue lock */
+static Lock mmrll_lk;
+/* Number of ready threads (counted from the start of their push) */
+static int mmrll_len;
+
+/**
+ * @brief Move the threads of the overflow queue to the ring
+ *
+ * Done by one dequeuer at a time, the others do not wait for it
+ */
+static void _mmrll_drain(void) {
+
+    /* If no thread overflowed, or another dequeuer is moving them */
+    if (!atomic_load(&mmrll_nb_staged) || !lock_try(&mmrll_lk)) {
+
+        return;
+    }
+
+    /* Till the overflow queue is empty or the ring is full */
+    for (;;) {
+
+        /* Take the oldest thread of the overflow queue */
+        if (!mmrll_held) {
+
+            mmrll_held = mpsc_pop(&mmrll_stage, struct Thread, rl_mem);
+            if (!mmrll_held) {
+
+                break;
+            }
+        }
+
+        /* Move it to the ring if it fits */
+        if (mpmc_push(&mmrll_ring, mmrll_held)) {
+
+            break;
+        }
+
+        /* Uncount it */
+        mmrll_held = NULL;
+        atomic_fetch_sub(&mmrll_nb_staged, 1);
+    }
+
+    /* Release the lock */
+    lock_release(&mmrll_lk);
+}
+
+/**
+ * @brief Initialize the many-many ready list
+ */
+void mmrll_init(void) {
+
+    /* Initialize the ring */
+    mpmc_init(&mmrll_ring, mmrll_cells, MMRLL_RING_SIZE);
+
+    /* No thread overflowed yet */
+    mpsc_init(&mmrll_stage);
+    mmrll_held = NULL;
+    mmrll_nb_staged = 0;
+
+    /* Initialize the lock */
+    lock_init(&mmrll_lk);
+
+    /* No thread is ready yet */
+    mmrll_len = 0;
+}
+
+/**
+ * @brief Dequeue a thread descriptor from the many-many ready list
+ *
+ * Returns the oldest thread of the ring, after moving the threads which
+ * overflowed to it
+ *
+ * @param[in] sched Index of the dequeuing scheduler
+ * @return Thread handle
+ * @return NULL if the ring is empty, or the push of its oldest thread is not
+ *         complete yet
+ */
+Thread mmrll_dequeue(int sched) {
+
+    Thread thread;
+
+    /* Move the threads which overflowed */
+    _mmrll_drain();
+
+    /* Take the oldest thread */
+    thread = mpmc_pop(&mmrll_ring);
+    if (thread) {
+
+        /* Uncount it */
+        atomic_fetch_sub(&mmrll_len, 1);
+    }
+
+    return thread;
+}
+
+/**
+ * @brief Dequeue a batch of thread descriptors from the many-many ready list
+ *
+ * @param[in] sched Index of the dequeuing scheduler
+ * @param[out] batch Pointer to the batch list (threads added to its tail)
+ * @param[in] nb Maximum number of threads
+ * @return Number of threads dequeued (0 if none could be taken)
+ */
+int mmrll_dequeue_batch(int sched, List *batch, int nb) {
+
+    Thread thread;
+    int taken;
+
+    /* While threads can be taken */
+    for (taken = 0; taken < nb; taken++) {
+
+        /* Dequeue the oldest one */
+        thread = mmrll_dequeue(sched);
+        if (!thread) {
+
+            break;
+        }
+        list_enqueue(batch, thread, ll_mem);
+    }
+
+    return taken;
+}
+
+/**
+ * @brief Is a thread ranking above a thread descriptor ready
+ * @param[in] thread Thread handle
+ * @return 0 as the threads do not rank
+ */
+int mmrll_outranks(Thread thread) {
+
+    return 0;
+}
+
+/**
+ * @brief Push a thread descriptor to the many-many ready list
+ *
+ * The thread goes to the ring, or to the overflow queue if the ring is full
+ * or threads are already waiting there (so that they keep their order)
+ *
+ * @param[in] thread Thread handle
+ */
+void mmrll_push(Thread thread) {
+
+    /* Count the thread */
+    atomic_fetch_add(&mmrll_len, 1);
+
+    /* If threads overflowed, or the ring is full */
+    if (atomic_load(&mmrll_nb_staged) || mpmc_push(&mmrll_ring, thread)) {
+
+        /* Queue the thread descriptor behind them */
+        atomic_fetch_add(&mmrll_nb_staged, 1);
+        mpsc_push(&mmrll_stage, thread, rl_mem);
+    }
+}
+
+/**
+ * @brief Enqueue a thread descriptor to the many-many ready list
+ * @param[in] thread Thread handle
+ */
+void mmrll_enqueue(Thread thread) {
+
+    /* Push the thread descriptor */
+    mmrll_push(thread);
+}
+
+/**
+ * @brief Add a new thread descriptor to a batch
+ * @param[in/out] batch Pointer to the batch list
+ * @param[in] thread Thread handle
+ */
+void mmrll_batch(List *batch, Thread thread) {
+
+    /* Add the thread descriptor to the batch */
+    list_enqueue(batch, thread, ll_mem);
+}
+
+/**
+ * @brief Add a batch of new thread descriptors to the many-many ready list
+ * @param[in/out] batch Pointer to the batch list (left empty)
+ * @param[in] nb Number of threads in the batch
+ */
+void mmrll_enqueue_batch(List *batch, int nb) {
+
+    Thread thread;
+
+    /* While there are threads in the batch */
+    while (!list_is_empty(batch)) {
+
+        /* Push the thread descriptor */
+        thread = list_dequeue(batch, struct Thread, ll_mem);
+        mmrll_push(thread);
+    }
+}
+
+/**
+ * @brief Remove a thread descriptor from the many-many ready list
+ *
+ * A thread on the ring cannot be removed, only a thread taken ahead by a
+ * scheduler can be taken off its batch
+ *
+ * @param[in] thread Thread handle
+ * @return 0 if the thread was not removed
+ * @return 1 if the thread was removed
+ */
+int mmrll_remove(Thread thread) {
+
+    /* Remove the thread from the batch of the scheduler which took it
+     * ahead */
+    return ((td_get_queued(thread) == THREAD_QUEUED_BATCH) &&
+            mmsched_unbatch(thread, 0));
+}
+
+/**
+ * @brief Remove a thread descriptor if it is the next one to be dispatched
+ *
+ * Only the oldest thread taken ahead by a scheduler can be claimed
+ *
+ * @param[in] thread Thread handle
+ * @return 0 if the thread was not removed
+ * @return 1 if the thread was removed
+ */
+int mmrll_claim(Thread thread) {
+
+    /* Remove the thread if it is the next one of the batch of the
+     * scheduler which took it ahead */
+    return ((td_get_queued(thread) == THREAD_QUEUED_BATCH) &&
+            mmsched_unbatch(thread, 1));
+}
+
+/**
+ * @brief Is the many-many ready list empty
+ *
+ * A thread is counted from the start of its push, hence the list is not
+ * empty while a push is not complete
+ *
+ * @return 0 if list is not empty
+ * @return 1 if list is empty
+ */
+int mmrll_is_empty(void) {
+
+    /* Check the count */
+    return !atomic_load(&mmrll_len);
+}
+
+/**
+ * @brief Is a push to the many-many ready list not complete yet
+ * @return 0 as a push not complete is counted (see mmrll_is_empty())
+ */
+int mmrll_is_staged(void) {
+
+    return 0;
+}
+
+/**
+ * @brief Get the number of ready threads
+ * @return Number of threads on the many-many ready list
+ */
+int mmrll_length(void) {
+
+    /* Return the count */
+    return atomic_load(&mmrll_len);
+}
+
+/**
+ * @brief Change the number of active schedulers
+ * @param[in] nb_scheds Number of active schedulers (no thread prefers one)
+ */
+void mmrll_set_nb_scheds(int nb_scheds) {
+}
+
+/**
+ * @brief Change the scheduling policy
+ * @param[in] policy Scheduling policy (only the priority policy is kept)
+ */
+void mmrll_set_policy(int policy) {
+
+    /* Only the FIFO order is supported */
+    assert(policy == THREAD_SCHED_PRIO);
+}
+
+/**
+ * @brief Get the scheduling policy
+ * @return Scheduling policy
+ */
+int mmrll_get_policy(void) {
+
+    /* The ring is a single level */
+    return THREAD_SCHED_PRIO;
+}
+
+/**
+ * @brief Charge CPU time to a thread descriptor
+ *
+ * Nothing is accounted as the threads do not rank
+ *
+ * @param[in] thread Thread handle
+ * @param[in] ns CPU time consumed in nano seconds
+ */
+void mmrll_charge(Thread thread, unsigned long ns) {
+}
+
+#endif
@@ -1,18 +1,76 @@
 #ifndef _MMRLL_H_
 #define _MMRLL_H_
 
+#include "./mods/list.h"
 #include "./thread.h"
 
+/* Number of priority levels of the many-many ready list */
+#define MMRLL_NB_PRIOS (THREAD_PRIO_MAX - THREAD_PRIO_MIN + 1)
+
+/* Number of dequeues after which the oldest thread of the lowest non empty
+ * priority level is aged by one level (0 disables aging) */
+#ifndef MMRLL_AGING_PERIOD
+#define MMRLL_AGING_PERIOD (32u)
+#endif
+
+/* Weight of a thread of default priority under the fair policy */
+#define MMRLL_FAIR_WEIGHT_DEFAULT (1024ul)
+
+/* Lock-free backend of the many-many ready list, a plain FIFO queue without
+ * priorities, fair policy, deadlines or preferred schedulers (0 uses the
+ * locked structures) */
+#ifndef MMRLL_LOCKFREE
+#define MMRLL_LOCKFREE (0)
+#endif
+
+/* Number of cells of the ring of the lock-free backend (a power of two), the
+ * threads which do not fit wait on an overflow queue */
+#ifndef MMRLL_RING_SIZE
+#define MMRLL_RING_SIZE (4096u)
+#endif
+
 void mmrll_init(void);
 
-Thread mmrll_dequeue(void);
+Thread mmrll_dequeue(int sched);
+
+int mmrll_dequeue_batch(int sched, List *batch, int nb);
+
+int mmrll_outranks(Thread thread);
 
 void mmrll_enqueue(Thread thread);
 
+void mmrll_push(Thread thread);
+
+void mmrll_batch(List *batch, Thread thread);
+
+void mmrll_enqueue_batch(List *batch, int nb);
+
+int mmrll_remove(Thread thread);
+
+int mmrll_claim(Thread thread);
+
 int mmrll_is_empty(void);
 
+int mmrll_is_staged(void);
+
+int mmrll_length(void);
+
+void mmrll_set_nb_scheds(int nb_scheds);
+
+void mmrll_set_policy(int policy);
+
+int mmrll_get_policy(void);
+
+void mmrll_charge(Thread thread, unsigned long ns);
+
+#if MMRLL_LOCKFREE
+/* The lock-free backend has no lock */
+#define mmrll_lock()   ((void)0)
+#define mmrll_unlock() ((void)0)
+#else
 void mmrll_lock(void);
 
 void mmrll_unlock(void);
+#endif
 
 #endif
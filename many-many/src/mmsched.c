@@ -1,54 +1,178 @@
 #define _GNU_SOURCE
+#include <gnu/libc-version.h>
+#include <link.h>
 #include <sched.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "./mods/utils.h"
 #include "./mods/list.h"
+#include "./mods/lock.h"
 #include "./mods/stack.h"
 #include "./mods/sig.h"
 #include "./mmrll.h"
+#include "./mmoffload.h"
+#include "./mmpoll.h"
 #include "./mmsched.h"
+#include "./mmtask.h"
+#include "./mmtimer.h"
+#include "./mmuring.h"
 #include "./thread.h"
 #include "./thread_descr.h"
+#include "./thread_future.h"
 #include "./thread_sync.h"
 
-/* Clone flags for the kernel thread of the scheduler */
-#define MMSCHED_CLONE_FLAGS                     \
-    (CLONE_VM | CLONE_FS | CLONE_FILES |        \
-     CLONE_SIGHAND | CLONE_THREAD |             \
-     CLONE_SYSVSEM | CLONE_PARENT_SETTID |      \
-     CLONE_CHILD_CLEARTID)
-
-/* Scheduler list */
+/* Scheduler list (every scheduler created, active or not) */
 static List mmsched_list;
+/* Spare scheduler list (parked kernel threads not serving any index) */
+static List mmsched_spare;
+/* Schedulers indexed by the scheduler index */
+static Scheduler *mmsched_scheds[MMSCHED_MAX_SCHEDS];
 /* Scheduling status */
 static int mmsched_enabled;
+/* Number of active schedulers */
+static int mmsched_nb;
+/* Automatic scaling status */
+static int mmsched_auto;
+/* CPUs the process is allowed to run on */
+static cpu_set_t mmsched_set;
+/* Scheduler pool lock */
+static Lock mmsched_lk;
+/* Preemption status (cleared for cooperative scheduling) */
+static int mmsched_preempt;
+/* Number of schedulers which found nothing to dispatch */
+static int mmsched_nb_idle;
+/* Context the contexts of the threads are made from */
+static ucontext_t mmsched_cxt;
+#if MMSCHED_PREEMPT != MMSCHED_PREEMPT_NONE
+/* Code of the C library, where the threads are not preempted */
+static uintptr_t mmsched_libc_start;
+static uintptr_t mmsched_libc_end;
+#endif
+#if MMSCHED_PREEMPT == MMSCHED_PREEMPT_MONITOR
+/* Kernel thread handle of the monitor */
+static pthread_t mmsched_mon_kthread;
+/* Stack of the monitor */
+static stack_t mmsched_mon_stack;
+#endif
+
+static void _mmsched_resize(int nb_scheds);
+static void _mmsched_slice_start(Scheduler *sched, Thread thread);
+static void _mmsched_slice_stop(Scheduler *sched, Thread thread);
+
+#if MMSCHED_PREEMPT != MMSCHED_PREEMPT_NONE
+/**
+ * @brief Note the code of the C library, if it is in a module
+ * @param[in] info Information of the module
+ * @param[in] size Size of the information (not used)
+ * @param[in] addr Address of a function of the C library
+ * @return 1 if the module is the C library
+ * @return 0 otherwise
+ */
+static int _mmsched_libc_module(struct dl_phdr_info *info, size_t size,
+                                void *addr) {
+
+    const ElfW(Phdr) *phdr;
+    uintptr_t start;
+
+    /* For every program header of the module */
+    for (int i = 0; i < info->dlpi_phnum; i++) {
+
+        phdr = &info->dlpi_phdr[i];
+
+        /* If it is not a segment of code */
+        if ((phdr->p_type != PT_LOAD) || !(phdr->p_flags & PF_X)) {
+
+            continue;
+        }
+
+        /* If the segment holds the function, note it */
+        start = info->dlpi_addr + phdr->p_vaddr;
+        if (((uintptr_t)addr >= start) &&
+            ((uintptr_t)addr < start + phdr->p_memsz)) {
+
+            mmsched_libc_start = start;
+            mmsched_libc_end = start + phdr->p_memsz;
+            return 1;
+        }
+    }
+
+    return 0;
+}
 
 /**
  * @brief Yield the control to the dispatcher from the user thread
+ *
+ * A thread interrupted in the C library is not preempted, as it could hold
+ * a lock of the library (e.g. the one of malloc()) the threads run by the
+ * other schedulers would block their kernel thread on
+ *
  * @param[in] arg Not used
+ * @param[in] info Not used
+ * @param[in] cxt Interrupted context
  */
-static void _mmsched_yield(int arg) {
+static void _mmsched_yield(int arg, siginfo_t *info, void *cxt) {
 
     Thread thread;
+    uintptr_t pc;
 
     /* Get the thread handle */
     thread = thread_self();
 
-    /* If interrupts are disabled */
-    if (td_is_intr_off(thread)) {
+    /* If the preemption was disabled since the time slice started */
+    if (!atomic_load(&mmsched_preempt)) {
+
+        return;
+    }
+
+#if MMSCHED_PREEMPT == MMSCHED_PREEMPT_MONITOR
+    /* If the time slice of the thread has not ended (the thread was
+     * dispatched after the monitor signalled its scheduler) */
+    if (clock_ns(CLOCK_MONOTONIC) <
+        atomic_load(&td_get_sched(thread)->slice_ns)) {
+
+        return;
+    }
+#endif
+
+    /* Get the interrupted instruction */
+    pc = ((ucontext_t *)cxt)->uc_mcontext.gregs[REG_RIP];
+
+    /* If interrupts are disabled, or the thread runs the C library */
+    if (td_is_intr_off(thread) ||
+        ((pc >= mmsched_libc_start) && (pc < mmsched_libc_end))) {
+
+        /* If the thread is blocking in a system call, leave the time slice
+         * paused so that the system call is not interrupted */
+        if (td_get_sched(thread)->state == MMSCHED_STATE_DETACHED) {
 
-        /* Stop the current timer */
-        td_timer_stop(thread);
+            return;
+        }
+
+        /* Note that the thread used its whole slice */
+        td_set_preempted(thread, 1);
 
-        /* Restart the timer */
-        td_timer_start(thread);
+        /* Stop the current time slice */
+        _mmsched_slice_stop(td_get_sched(thread), thread);
+
+        /* Restart the time slice */
+        _mmsched_slice_start(td_get_sched(thread), thread);
 
         return;
     }
 
+    /* Note that the thread used its whole slice */
+    td_set_preempted(thread, 1);
+
+    /* Disable the interrupts till the thread runs again, as the signals are
+     * unblocked before the context of the thread is fully restored */
+    td_disable_intr(thread);
+
     /* Swap the context with the dispatcher */
     td_ret_cxt(thread);
+
+    /* Enable the interrupts */
+    td_enable_intr(thread);
 }
 
 /**
@@ -59,13 +183,158 @@ static void _mmsched_yield(int arg) {
         struct sigaction __action;              \
                                                 \
         /* Initialize the action */             \
-        __action.sa_handler = _mmsched_yield;   \
-        __action.sa_flags = 0;                  \
+        __action.sa_sigaction = _mmsched_yield; \
+        __action.sa_flags = SA_SIGINFO;         \
         sigfillset(&__action.sa_mask);          \
                                                 \
         /* Return the initialized action */     \
         __action;                               \
     })
+#endif
+
+/**
+ * @brief The actual start function of the thread
+ *
+ * This function launches the start function with the argument provided by
+ * the application program
+ */
+static void _mmsched_launch(void) {
+
+    Thread thread;
+
+    /* Get the thread handle */
+    thread = thread_self();
+
+    /* Enable the interrupts */
+    td_enable_intr(thread);
+
+    /* Launch the thread start function */
+    td_launch(thread);
+
+    /* Disable interrupt */
+    td_disable_intr(thread);
+
+    /* Set the state as exited */
+    td_set_state(thread, THREAD_STATE_EXITED);
+}
+
+/**
+ * Get the time slice of the thread (in micro seconds), a deadline thread is
+ * not given more than the budget left to it
+ */
+#define get_time_slice(thread)                                          \
+    ((td_is_edf(thread) &&                                              \
+      (td_get_budget(thread) < (long)td_get_slice(thread) * 1000l)) ?   \
+     ((td_get_budget(thread) + 999) / 1000) :                           \
+     td_get_slice(thread))
+
+/**
+ * @brief Adapt the time slice of a thread given back by the thread
+ *
+ * A thread preempted at the end of its time slice is CPU bound, its slice is
+ * doubled so that it is dispatched less often. A thread waiting before the
+ * end of its slice is I/O bound, its slice is halved and under the priority
+ * policy it is raised by MMSCHED_SLICE_BOOST levels till it is dispatched
+ * again, so that it runs soon after it is woken. A thread yielding keeps its
+ * slice
+ *
+ * @param[in] thread Thread handle
+ * @note Should be done before the thread is handed to a waker
+ */
+static void _mmsched_adapt_slice(Thread thread) {
+
+    unsigned long slice;
+    int prio;
+
+    /* Get the time slice */
+    slice = td_get_slice(thread);
+
+    /* If the thread used its whole slice */
+    if (td_is_preempted(thread)) {
+
+        /* Lengthen the slice */
+        td_set_preempted(thread, 0);
+        td_set_slice(thread, (slice * 2 < MMSCHED_SLICE_MAX_us) ?
+                             slice * 2 : MMSCHED_SLICE_MAX_us);
+
+        return;
+    }
+
+    /* If the thread does not wait */
+    if (!td_is_waiting(thread)) {
+
+        return;
+    }
+
+    /* Shorten the slice */
+    td_set_slice(thread, (slice / 2 > MMSCHED_SLICE_MIN_us) ?
+                         slice / 2 : MMSCHED_SLICE_MIN_us);
+
+    /* If the priority policy is not used */
+    if (!MMSCHED_SLICE_BOOST ||
+        (mmrll_get_policy() != THREAD_SCHED_PRIO)) {
+
+        return;
+    }
+
+    /* Lock the ready list */
+    mmrll_lock();
+
+    /* Raise the effective priority (reset once dispatched) */
+    prio = td_get_prio(thread) + MMSCHED_SLICE_BOOST;
+    if (prio > THREAD_PRIO_MAX) {
+
+        prio = THREAD_PRIO_MAX;
+    }
+    if (prio > td_get_eff_prio(thread)) {
+
+        td_set_eff_prio(thread, prio);
+    }
+
+    /* Unlock the ready list */
+    mmrll_unlock();
+}
+
+/**
+ * @brief Start the time slice of a thread dispatched by a scheduler
+ *
+ * With the timer engine the timer of the thread is armed. With the monitor
+ * engine the end of the slice is published to the monitor, along with a new
+ * dispatch sequence number
+ *
+ * @param[in] sched Pointer to the scheduler instance
+ * @param[in] thread Thread handle
+ */
+static void _mmsched_slice_start(Scheduler *sched, Thread thread) {
+
+#if MMSCHED_PREEMPT == MMSCHED_PREEMPT_MONITOR
+    /* Publish the end of the slice */
+    atomic_store(&sched->slice_ns, clock_ns(CLOCK_MONOTONIC) +
+                                   get_time_slice(thread) * 1000ul);
+
+    /* Start a new slice */
+    atomic_fetch_add(&sched->seq, 1);
+#elif MMSCHED_PREEMPT == MMSCHED_PREEMPT_TIMER
+    /* Start the timer */
+    td_timer_start(thread);
+#endif
+}
+
+/**
+ * @brief Stop the time slice of a thread dispatched by a scheduler
+ * @param[in] sched Pointer to the scheduler instance
+ * @param[in] thread Thread handle
+ */
+static void _mmsched_slice_stop(Scheduler *sched, Thread thread) {
+
+#if MMSCHED_PREEMPT == MMSCHED_PREEMPT_MONITOR
+    /* No thread is running */
+    atomic_store(&sched->slice_ns, 0);
+#elif MMSCHED_PREEMPT == MMSCHED_PREEMPT_TIMER
+    /* Stop the timer */
+    td_timer_stop(thread);
+#endif
+}
 
 /* Repeatation label name */
 #define REPEAT_LABEL repeat
@@ -76,24 +345,65 @@ static void _mmsched_yield(int arg) {
  *       continue statement. It will be blocking till it gets a ready thread
  *       on the list
  */
-#define get_next_thread(thread)                 \
+#define get_next_thread(thread, sched)          \
   {                                             \
+      int __len, __nb;                          \
+                                                \
       /* Lock the ready list */                 \
       mmrll_lock();                             \
                                                 \
       /* If the ready list is empty */          \
       if (mmrll_is_empty()) {                   \
                                                 \
-          /* Unlock the list and continue */    \
+          /* Note if a push is not complete */  \
+          __nb = mmrll_is_staged();             \
+                                                \
+          /* Unlock the list */                 \
+          mmrll_unlock();                       \
+                                                \
+          /* Note the scheduler is idle, unless \
+           * tasks are waiting or threads are   \
+           * about to be seen */                \
+          if (__nb || mmtask_pending()) {       \
+                                                \
+              _mmsched_poll(sched);             \
+          } else {                              \
+                                                \
+              _mmsched_set_idle(sched, 1);      \
+              _mmsched_idle(sched);             \
+          }                                     \
+          continue;                             \
+      }                                         \
+                                                \
+      /* Take a share of the ready threads, so  \
+       * that the schedulers keep up without    \
+       * the lock while the list is long */     \
+      __nb = mmrll_length() / (2 * mmsched_nb); \
+      __nb = (__nb < 1) ? 1 :                   \
+             (__nb > MMSCHED_DEQ_BATCH) ?       \
+             MMSCHED_DEQ_BATCH : __nb;          \
+      (thread) = _mmsched_take_ahead((sched),   \
+                                     __nb);     \
+                                                \
+      /* If the threads were taken by other     \
+       * schedulers meanwhile, or their pushes  \
+       * are not complete (lock-free ready list \
+       * only), look again */                   \
+      if (!(thread)) {                          \
+                                                \
           mmrll_unlock();                       \
+          _mmsched_poll(sched);                 \
           continue;                             \
       }                                         \
                                                 \
-      /* Get a thread from the list */          \
-      (thread) = mmrll_dequeue();               \
+      /* Get the number of threads left */     \
+      __len = mmrll_length();                   \
                                                 \
       /* Unlock the ready list */               \
       mmrll_unlock();                           \
+                                                \
+      /* Note the scheduler is busy */          \
+      _mmsched_busy(sched, __len);              \
   }
 
 /**
@@ -131,14 +441,8 @@ static void _mmsched_yield(int arg) {
             goto REPEAT_LABEL;                              \
         }                                                   \
                                                             \
-        /* Lock the ready list */                           \
-        mmrll_lock();                                       \
-                                                            \
-        /* Add the current thread to the ready list */      \
-        mmrll_enqueue(thread);                              \
-                                                            \
-        /* Unlock the ready list */                         \
-        mmrll_unlock();                                     \
+        /* Push the current thread to the ready list */     \
+        mmrll_push(thread);                                 \
     }
 
 /**
@@ -146,26 +450,26 @@ static void _mmsched_yield(int arg) {
  */
 #define post_schedule_exited_action(thread)                     \
     {                                                           \
+        /* Give the stack back now, so that the exited threads  \
+         * waiting to be joined hold only their descriptor */   \
+        td_put_cxt(thread);                                     \
+                                                                \
         /* Acquire the member lock */                           \
         td_lock(thread);                                        \
                                                                 \
         /* Clear the wait state */                              \
         td_set_over(thread);                                    \
                                                                 \
-        /* Check if the thread has thread waiting to join */    \
-        if (td_has_joining(thread)) {                           \
+        /* Check if the thread has thread waiting to join, and  \
+         * if its timeout did not expire first */               \
+        if (td_has_joining(thread) &&                           \
+            mmtimer_cancel(td_get_joining(thread))) {           \
                                                                 \
             /* Release the member lock */                       \
             td_unlock(thread);                                  \
                                                                 \
-            /* Lock the ready list */                           \
-            mmrll_lock();                                       \
-                                                                \
-            /* Add the current thread to the ready list */      \
-            mmrll_enqueue(td_get_joining(thread));              \
-                                                                \
-            /* Unlock the ready list */                         \
-            mmrll_unlock();                                     \
+            /* Push the joining thread to the ready list */     \
+            mmrll_push(td_get_joining(thread));                 \
         } else {                                                \
                                                                 \
             /* Release the member lock */                       \
@@ -173,197 +477,1436 @@ static void _mmsched_yield(int arg) {
         }                                                       \
     }
 /**
- * @brief Dispatch a user thread
+ * @brief Get the number of schedulers the automatic scaling can use
+ * @return Number of schedulers
+ */
+static int _mmsched_auto_max(void) {
+
+    /* One scheduler per CPU the process is allowed to run on */
+    return (CPU_COUNT(&mmsched_set) < MMSCHED_MAX_SCHEDS) ?
+           CPU_COUNT(&mmsched_set) : MMSCHED_MAX_SCHEDS;
+}
+
+/**
+ * @brief Note whether a scheduler found nothing to dispatch
  *
- * Continuously selects a thread from the global list of threads and schedules
- * it on the kernel thread on which the function is itself running
+ * The schedulers keep the threads taken ahead only while no other scheduler
+ * is idle
  *
- * @param[in] arg Not used
- * @return Integer (not used)
+ * @param[in] sched Pointer to the scheduler instance
+ * @param[in] idle 1 if the scheduler is idle, 0 otherwise
  */
-static int _mmsched_dispatch(void *arg) {
+static void _mmsched_set_idle(Scheduler *sched, int idle) {
 
-    Thread thread;
-    void *old_fs;
+    /* If the state changed, count it */
+    if (sched->idle != idle) {
 
-    /* Block all the signals */
-    sig_block_all();
+        sched->idle = idle;
+        atomic_fetch_add(&mmsched_nb_idle, idle ? 1 : -1);
+    }
+}
 
-    /* Get the current FS register value */
-    old_fs = get_fs();
+/**
+ * @brief Note that a scheduler found the ready list empty
+ *
+ * Waits up to MMPOLL_IDLE_WAIT_ms for completions on the ring of the
+ * scheduler if it has operations in flight, otherwise for readiness events.
+ * Under the automatic scaling, removes a scheduler once the scheduler has
+ * been idle for MMSCHED_AUTO_IDLE_ms
+ *
+ * @param[in] sched Pointer to the scheduler instance
+ */
+static void _mmsched_idle(Scheduler *sched) {
 
-    /* While the scheduling is enabled */
-    while (mmsched_enabled) {
+    unsigned long now;
+    int nb;
 
-        /* Get a thread to be scheduled */
-        get_next_thread(thread);
+    /* If operations are in flight on the ring of the scheduler */
+    if (mmuring_inflight(sched->index)) {
 
-        /* If the thread state is running */
-        if (td_is_running(thread)) {
+        /* Wait for completions, then poll for readiness events */
+        nb = mmuring_poll(sched->index, MMPOLL_IDLE_WAIT_ms);
+        nb += mmpoll_poll(0);
+    } else {
 
-            /* Send the pending signals */
-            send_pending_signals(thread);
-        }
+        /* Reap the other rings, then wait for readiness events */
+        nb = mmuring_poll(sched->index, 0);
+        nb += mmpoll_poll(MMPOLL_IDLE_WAIT_ms);
+    }
 
-        /* Initialize the timer */
-        td_timer_init(thread, TIMER_INTR_ACTION, MMSCHED_TIME_SLICE_ms);
+    /* If threads were made ready by completions or readiness events */
+    if (nb) {
 
-        REPEAT_LABEL:
+        /* The scheduler is not idle */
+        sched->idle_ns = 0;
+        return;
+    }
 
-        /* Set the FS register value */
-        set_fs(thread);
+    /* If the automatic scaling is not used */
+    if (!mmsched_auto) {
 
-        /* Start the timer */
-        td_timer_start(thread);
+        return;
+    }
 
-        /* Swap the context with the user thread */
-        td_set_cxt(thread);
+    /* Get the current time */
+    now = clock_ns(CLOCK_MONOTONIC);
 
-        /* Stop the timer */
-        td_timer_stop(thread);
+    /* If the scheduler just became idle */
+    if (!sched->idle_ns) {
 
-        /* Reset the FS register value to old value */
-        set_fs(old_fs);
+        /* Note the time */
+        sched->idle_ns = now;
+        return;
+    }
 
-        /* Take action depending on the state */
-        switch (td_get_state(thread)) {
+    /* If the scheduler has not been idle long enough */
+    if (now - sched->idle_ns < MMSCHED_AUTO_IDLE_ms * 1000000ul) {
 
-            case THREAD_STATE_RUNNING:
+        return;
+    }
 
-                /* Carry the post schedule running action */
-                post_schedule_running_action(thread);
-                break;
+    /* Restart the idle period */
+    sched->idle_ns = 0;
 
-            case THREAD_STATE_WAIT_JOIN:
+    /* Acquire the scheduler pool lock */
+    lock_acquire(&mmsched_lk);
 
-                /* Release the lock of the wait for thread */
-                td_unlock(td_get_wait_thread(thread));
+    /* If the scaling is still automatic and a scheduler can be removed */
+    if (mmsched_auto && (mmsched_nb > 1)) {
 
-                break;
+        /* Remove the last scheduler */
+        _mmsched_resize(mmsched_nb - 1);
+    }
 
-            case THREAD_STATE_WAIT_MUTEX:
+    /* Release the scheduler pool lock */
+    lock_release(&mmsched_lk);
+}
 
-                /* Release the mutex lock */
-                mut_unlock(td_get_wait_mutex(thread));
+/**
+ * @brief Note that a scheduler dequeued a thread
+ *
+ * Under the automatic scaling, adds a scheduler if more than
+ * MMSCHED_AUTO_GROW_LEN threads per scheduler are left on the ready list
+ *
+ * @param[in] sched Pointer to the scheduler instance
+ * @param[in] len Number of threads left on the ready list
+ */
+static void _mmsched_busy(Scheduler *sched, int len) {
 
-                break;
+    /* The scheduler is not idle */
+    sched->idle_ns = 0;
+    _mmsched_set_idle(sched, 0);
 
-            case THREAD_STATE_EXITED:
+    /* If the automatic scaling is not used or the schedulers keep up */
+    if (!mmsched_auto ||
+        (len <= mmsched_nb * MMSCHED_AUTO_GROW_LEN) ||
+        (mmsched_nb >= _mmsched_auto_max())) {
 
-                /* Carry the post schedule exited action */
-                post_schedule_exited_action(thread);
-                break;
+        return;
+    }
 
-            default:
-                break;
-        }
+    /* Acquire the scheduler pool lock */
+    lock_acquire(&mmsched_lk);
+
+    /* If the scaling is still automatic and a scheduler can be added */
+    if (mmsched_auto && (mmsched_nb < _mmsched_auto_max())) {
+
+        /* Add a scheduler */
+        _mmsched_resize(mmsched_nb + 1);
     }
 
-    return 0;
+    /* Release the scheduler pool lock */
+    lock_release(&mmsched_lk);
 }
 
 /**
- * @brief Create a scheduler
- * @return Pointer to the scheduler instance
+ * @brief Poll for completions and readiness events if the scheduler has not
+ *        polled for MMPOLL_PERIOD_us
+ *
+ * Submits the operations queued on the ring of the scheduler, and keeps the
+ * threads waiting for file descriptors from starving while the ready list is
+ * never empty
+ *
+ * @param[in] sched Pointer to the scheduler instance
  */
-static Scheduler *_mmsched_create(void) {
+static void _mmsched_poll(Scheduler *sched) {
 
-    Scheduler *sched;
+    unsigned long now;
 
-    /* Create a new scheduler */
-    sched = alloc_mem(Scheduler);
-    /* Check for errors */
-    assert(sched);
+    /* Get the current time */
+    now = clock_ns(CLOCK_MONOTONIC);
 
-    /* Allocate the stack */
-    stack_alloc(&sched->stack);
+    /* If the scheduler polled recently */
+    if (now - sched->poll_ns < MMPOLL_PERIOD_us * 1000ul) {
 
-    /* Create the kernel thread */
-    sched->ktid = clone(_mmsched_dispatch,
-                        sched->stack.ss_sp + sched->stack.ss_size,
-                        MMSCHED_CLONE_FLAGS,
-                        NULL,
-                        &sched->wait,
-                        NULL,
-                        &sched->wait);
+        return;
+    }
 
-    /* Check for errors */
-    assert(sched->ktid != -1);
+    /* Note the time */
+    sched->poll_ns = now;
 
-    return sched;
+    /* Poll without waiting */
+    mmuring_poll(sched->index, 0);
+    mmpoll_poll(0);
 }
 
 /**
- * @brief Destroy a scheduler
+ * @brief Pin the kernel thread of a scheduler to the CPU of the scheduler
+ *
+ * The threads dispatched by the scheduler do not migrate across CPUs then
+ * (on failure the kernel thread runs unpinned)
+ *
  * @param[in] sched Pointer to the scheduler instance
  */
-static void _mmsched_destroy(Scheduler *sched) {
+static void _mmsched_pin(Scheduler *sched) {
 
-    /* Check for errors */
-    assert(sched);
+#if MMSCHED_AFFINITY
+    cpu_set_t set;
 
-    /* Wait for the kernel thread to finish */
-    futex(&sched->wait, FUTEX_WAIT, sched->ktid);
+    /* Set the affinity of the kernel thread */
+    CPU_ZERO(&set);
+    CPU_SET(sched->cpu, &set);
+    sched_setaffinity(0, sizeof(set), &set);
+#endif
+}
 
-    /* Free the stack */
-    stack_free(&sched->stack);
+/**
+ * @brief Check if a scheduler is active
+ *
+ * A scheduler asked to retire is marked as retired (the retirement can be
+ * cancelled till then)
+ *
+ * @param[in] sched Pointer to the scheduler instance
+ * @return 0 if not active
+ * @return 1 if active
+ */
+static int _mmsched_is_active(Scheduler *sched) {
 
-    /* Free the structure */
-    free(sched);
+    /* If the scheduler is asked to retire */
+    if (sched->state == MMSCHED_STATE_RETIRING) {
+
+        /* Retire unless the retirement was cancelled meanwhile */
+        return !atomic_cas(&sched->state, MMSCHED_STATE_RETIRING,
+                           MMSCHED_STATE_RETIRED);
+    }
+
+    return (sched->state == MMSCHED_STATE_ACTIVE);
 }
 
 /**
- * @brief Initialize the schedulers
+ * @brief Park the kernel thread of an inactive scheduler
  *
- * Creates specified number of schedulers. The schedulers will be
- * responsible for scheduling the many-many type of user threads.
+ * A kernel thread which was lent to a blocking user thread becomes a spare.
+ * The kernel thread waits till the scheduler is activated again (for a
+ * spare, possibly with another index) or the scheduling is disabled
  *
- * @param[in] nb_scheds Number of schedulers
- * @note Should be done by the main thread
+ * @param[in] sched Pointer to the scheduler instance
  */
-void mmsched_init(int nb_scheds) {
+static void _mmsched_park(Scheduler *sched) {
 
-    Scheduler *sched;
+    /* A parked scheduler is not idle */
+    _mmsched_set_idle(sched, 0);
 
-    /* Initialize the list */
-    list_init(&mmsched_list);
+    /* If the kernel thread was lent to a blocking user thread */
+    if (sched->state == MMSCHED_STATE_DETACHED) {
 
-    /* Set the scheduling status */
-    mmsched_enabled = 1;
+        /* Acquire the scheduler pool lock */
+        lock_acquire(&mmsched_lk);
 
-    /* For every requested scheduler */
-    for (int i = 0; i < nb_scheds; i++) {
+        /* Add the scheduler to the spare list */
+        sched->state = MMSCHED_STATE_RETIRED;
+        list_enqueue(&mmsched_spare, sched, spare_mem);
 
-        /* Create a scheduler instance */
-        sched = _mmsched_create();
+        /* Release the scheduler pool lock */
+        lock_release(&mmsched_lk);
+    }
 
-        /* Add the scheduler to the list */
-        list_enqueue(&mmsched_list, sched, sll_mem);
+    /* Wait till activated */
+    while (mmsched_enabled && (sched->state == MMSCHED_STATE_RETIRED)) {
+
+        futex(&sched->state, FUTEX_WAIT, MMSCHED_STATE_RETIRED);
     }
+
+    /* The scheduler was not idle meanwhile */
+    sched->idle_ns = 0;
+
+    /* Pin the kernel thread to the CPU of the scheduler again */
+    _mmsched_pin(sched);
 }
 
 /**
- * @brief Deinitialize the many-many schedulers
+ * @brief Dequeue ready threads, and take the others ahead
  *
- * Frees the resources allocated to the scheduler. Also this function does
- * not return unless all the schedulers have not returned
+ * The threads after the first one are kept on the batch of the scheduler,
+ * where mmrll_remove() and mmrll_claim() still find them
  *
- * @note Should be done by the main thread
+ * @param[in] sched Pointer to the scheduler instance
+ * @param[in] nb Maximum number of threads to dequeue
+ * @return Handle of the first thread
+ * @return NULL if no thread could be dequeued (lock-free ready list only)
+ * @note The ready list lock should be held
  */
-void mmsched_deinit(void) {
+static Thread _mmsched_take_ahead(Scheduler *sched, int nb) {
 
-    Scheduler *sched;
+    ListMember *mem;
+    Thread thread;
 
-    /* Clear the scheduling status */
-    mmsched_enabled = 0;
+    /* Dequeue the threads */
+    if (!mmrll_dequeue_batch(sched->index, &sched->batch, nb)) {
 
-    /* While the scheduler list is not empty */
-    while (!list_is_empty(&mmsched_list)) {
+        return NULL;
+    }
 
-        /* Get the scheduler from the global list */
-        sched = list_dequeue(&mmsched_list, Scheduler, sll_mem);
+    /* Note the scheduler holding the threads taken ahead */
+    for (mem = sched->batch.head->next; mem; mem = mem->next) {
 
-        /* Destroy the thread */
-        _mmsched_destroy(sched);
+        thread = (Thread)((void *)mem - offsetof(struct Thread, ll_mem));
+        td_set_sched(thread, sched);
+        td_set_queued(thread, THREAD_QUEUED_BATCH);
     }
+
+    /* Take the first thread */
+    return list_dequeue(&sched->batch, struct Thread, ll_mem);
+}
+
+/**
+ * @brief Give the threads taken ahead back to the ready list
+ * @param[in] sched Pointer to the scheduler instance
+ */
+static void _mmsched_flush(Scheduler *sched) {
+
+    Thread thread;
+
+    /* If no thread was taken ahead */
+    if (list_is_empty(&sched->batch)) {
+
+        return;
+    }
+
+    /* Lock the ready list */
+    mmrll_lock();
+
+    /* Add the threads back (the ones removed meanwhile left the batch) */
+    while (!list_is_empty(&sched->batch)) {
+
+        thread = list_dequeue(&sched->batch, struct Thread, ll_mem);
+        td_clear_queued(thread);
+        mmrll_enqueue(thread);
+    }
+
+    /* Unlock the ready list */
+    mmrll_unlock();
+}
+
+/**
+ * @brief Take a thread taken ahead from the ready list
+ *
+ * The threads are given back if a thread ranking above them became ready
+ *
+ * @param[in] sched Pointer to the scheduler instance
+ * @return Thread handle
+ * @return NULL if no thread is left
+ */
+static Thread _mmsched_take(Scheduler *sched) {
+
+    Thread thread = NULL;
+
+    /* If no thread was taken ahead */
+    if (list_is_empty(&sched->batch)) {
+
+        return NULL;
+    }
+
+    /* Acquire the batch lock */
+    lock_acquire(&sched->batch_lk);
+
+    /* If a thread is left and no thread ranking above became ready */
+    if (!list_is_empty(&sched->batch) &&
+        !mmrll_outranks((Thread)((void *)sched->batch.head -
+                                 offsetof(struct Thread, ll_mem)))) {
+
+        /* Take the oldest thread */
+        thread = list_dequeue(&sched->batch, struct Thread, ll_mem);
+        td_clear_queued(thread);
+    }
+
+    /* Release the batch lock */
+    lock_release(&sched->batch_lk);
+
+    /* If a thread ranking above became ready */
+    if (!thread) {
+
+        /* Give the threads back */
+        _mmsched_flush(sched);
+        return NULL;
+    }
+
+    /* The scheduler is not idle */
+    sched->idle_ns = 0;
+    _mmsched_set_idle(sched, 0);
+
+    return thread;
+}
+
+/**
+ * @brief Take a thread off the batch of the scheduler which took it ahead
+ *
+ * Used by mmrll_remove() and mmrll_claim(), the thread is taken only if it
+ * is still on the batch
+ *
+ * @param[in] thread Thread handle
+ * @param[in] head Take the thread only if it is the next one on the batch
+ * @return 1 if the thread was taken
+ * @return 0 otherwise
+ * @note The ready list lock should be held
+ */
+int mmsched_unbatch(Thread thread, int head) {
+
+    Scheduler *sched;
+    int taken = 0;
+
+    /* Get the scheduler which took the thread ahead */
+    sched = td_get_sched(thread);
+
+    /* Acquire the batch lock */
+    lock_acquire(&sched->batch_lk);
+
+    /* If the scheduler did not take the thread off the batch meanwhile */
+    if ((td_get_queued(thread) == THREAD_QUEUED_BATCH) &&
+        (!head || (sched->batch.head == &thread->ll_mem))) {
+
+        /* Remove the thread from the batch */
+        list_remove(&sched->batch, thread, ll_mem);
+        td_clear_queued(thread);
+        taken = 1;
+    }
+
+    /* Release the batch lock */
+    lock_release(&sched->batch_lk);
+
+    return taken;
+}
+
+/**
+ * @brief Get the scheduler serving an index
+ *
+ * Read without the scheduler pool lock, the scheduler may be replaced
+ * meanwhile (it is not freed till the scheduling is disabled)
+ *
+ * @param[in] index Scheduler index
+ * @return Pointer to the scheduler instance
+ * @return NULL if no scheduler was created for the index
+ */
+Scheduler *mmsched_get(int index) {
+
+    /* Get the scheduler */
+    return atomic_load(&mmsched_scheds[index]);
+}
+
+/**
+ * @brief Dispatch a user thread
+ *
+ * Continuously selects a thread from the global list of threads and schedules
+ * it on the kernel thread on which the function is itself running, till the
+ * scheduling is disabled. The kernel thread parks while the scheduler is
+ * retired
+ *
+ * @param[in] arg Pointer to the scheduler instance
+ * @return NULL
+ */
+static void *_mmsched_dispatch(void *arg) {
+
+    Scheduler *sched;
+    Thread thread;
+    ptr_t wait_for;
+    void *old_fs;
+    unsigned long cpu_ns;
+    int account;
+
+    /* Get the scheduler instance */
+    sched = arg;
+
+    /* Note the kernel thread id, the monitor signals it */
+    atomic_store(&sched->ktid, KERNEL_THREAD_ID);
+
+    /* Block all the signals */
+    sig_block_all();
+
+    /* Pin the kernel thread to the CPU of the scheduler */
+    _mmsched_pin(sched);
+
+    /* Get the current FS register value */
+    old_fs = get_fs();
+
+    /* While the scheduling is enabled */
+    while (mmsched_enabled) {
+
+        /* If the scheduler is not active */
+        if (!_mmsched_is_active(sched)) {
+
+            /* Give the threads taken ahead back */
+            _mmsched_flush(sched);
+
+            /* Submit the operations queued on its ring, the other
+             * schedulers reap their completions */
+            mmuring_poll(sched->index, 0);
+
+            /* Park till activated again */
+            _mmsched_park(sched);
+            continue;
+        }
+
+        /* Wake the threads whose timeout expired */
+        mmtimer_expire();
+
+        /* If tasks are waiting */
+        if (mmtask_pending()) {
+
+            /* Fill the pool of free task structures */
+            mmtask_reserve(&sched->tasks);
+
+            /* Run a batch of tasks on the stack of the scheduler, as the
+             * task thread descriptor of the scheduler */
+            set_fs(sched->task_td);
+            mmtask_run(&sched->tasks, sched->index, MMTASK_BATCH);
+            set_fs(old_fs);
+        }
+
+        /* Get a thread taken ahead, or else a thread to be scheduled */
+        thread = _mmsched_take(sched);
+        if (!thread) {
+
+            get_next_thread(thread, sched);
+        }
+
+        /* Poll for readiness events once in a while */
+        _mmsched_poll(sched);
+
+        /* If the thread state is running */
+        if (td_is_running(thread)) {
+
+            /* Send the pending signals */
+            send_pending_signals(thread);
+        }
+
+        /* If the thread is dispatched first, set up its stack and its
+         * context, a thread waiting to start holds only its descriptor */
+        if (!td_has_cxt(thread) &&
+            !td_init_cxt(thread, &mmsched_cxt, _mmsched_launch)) {
+
+            /* If no stack is left, the thread waits to start till the
+             * stacks of exited threads are given back, push it back to the
+             * ready list and back off */
+            mmrll_push(thread);
+            _mmsched_idle(sched);
+            continue;
+        }
+
+        /* Note if the thread is preempted (it runs till it yields, waits
+         * or exits otherwise) */
+        sched->preempt = atomic_load(&mmsched_preempt);
+
+        /* Give the threads taken ahead back if they could wait long behind
+         * the thread (it is not preempted or has a long time slice), or if
+         * another scheduler could run them now */
+        if (!list_is_empty(&sched->batch) &&
+            (!sched->preempt ||
+             (get_time_slice(thread) > MMSCHED_BATCH_SLICE_us) ||
+             atomic_load(&mmsched_nb_idle))) {
+
+            _mmsched_flush(sched);
+        }
+
+#if MMSCHED_PREEMPT == MMSCHED_PREEMPT_TIMER
+        /* Initialize the timer */
+        if (sched->preempt) {
+
+            td_timer_init(thread, TIMER_INTR_ACTION, get_time_slice(thread));
+        }
+#endif
+
+        REPEAT_LABEL:
+
+        /* Note the scheduler of the thread */
+        td_set_sched(thread, sched);
+
+        /* Set the FS register value */
+        set_fs(thread);
+
+        /* Start the time slice */
+        if (sched->preempt) {
+
+            _mmsched_slice_start(sched, thread);
+        }
+
+        /* If the fair policy is used or the thread has a deadline */
+        account = ((mmrll_get_policy() == THREAD_SCHED_FAIR) ||
+                   td_has_deadline(thread));
+
+        /* Then note the CPU time */
+        if (account) {
+
+            cpu_ns = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+        }
+
+        /* Swap the context with the user thread */
+        sched->curr = thread;
+        td_set_cxt(thread);
+
+        /* Get the thread which gave the context back, which differs if a
+         * thread run inline started or ended meanwhile */
+        thread = sched->curr;
+
+        /* Stop the time slice */
+        if (sched->preempt) {
+
+            _mmsched_slice_stop(sched, thread);
+
+            /* Adapt the time slice of the thread */
+            if (td_is_slice_adaptive(thread)) {
+
+                _mmsched_adapt_slice(thread);
+            }
+        }
+
+        /* If the CPU time is accounted */
+        if (account) {
+
+            /* Charge the CPU time consumed by the user thread */
+            mmrll_charge(thread, clock_ns(CLOCK_THREAD_CPUTIME_ID) - cpu_ns);
+        }
+
+        /* Reset the FS register value to old value */
+        set_fs(old_fs);
+
+        /* Take action depending on the state */
+        switch (td_get_state(thread)) {
+
+            case THREAD_STATE_RUNNING:
+
+                /* Give the threads taken ahead back first, so that the
+                 * thread preempted or yielding is queued behind them */
+                _mmsched_flush(sched);
+
+                /* Carry the post schedule running action */
+                post_schedule_running_action(thread);
+                break;
+
+            case THREAD_STATE_WAIT_JOIN:
+
+                /* Get the wait for thread first, the thread may run again
+                 * as soon as its timeout is added */
+                wait_for = td_get_wait_thread(thread);
+
+                /* If the wait is timed, add the timeout */
+                if (td_is_timed(thread)) {
+
+                    mmtimer_add(thread);
+                }
+
+                /* Release the lock of the wait for thread */
+                td_unlock((Thread)wait_for);
+
+                break;
+
+            case THREAD_STATE_WAIT_MUTEX:
+
+                /* Get the mutex first, as for the join */
+                wait_for = td_get_wait_mutex(thread);
+
+                /* If the wait is timed, add the timeout */
+                if (td_is_timed(thread)) {
+
+                    mmtimer_add(thread);
+                }
+
+                /* Release the mutex lock */
+                mut_unlock((ThreadMutex)wait_for);
+
+                break;
+
+            case THREAD_STATE_WAIT_IO:
+
+                /* Hand the thread to the poller */
+                mmpoll_wait(thread);
+
+                break;
+
+            case THREAD_STATE_WAIT_SLEEP:
+
+                /* Add the timeout */
+                mmtimer_add(thread);
+
+                break;
+
+            case THREAD_STATE_WAIT_OFFLOAD:
+
+                /* Hand the thread to the helpers */
+                mmoffload_submit(thread);
+
+                break;
+
+            case THREAD_STATE_WAIT_RING:
+
+                /* Queue the operation on the ring of the scheduler */
+                mmuring_submit(thread, sched->index);
+
+                break;
+
+            case THREAD_STATE_WAIT_TASK:
+
+                /* Release the lock of the task group */
+                lock_release(&td_get_wait_group(thread)->mem_lock);
+
+                break;
+
+            case THREAD_STATE_WAIT_FUTURE:
+
+                /* Release the lock of the future */
+                fut_unlock(td_get_wait_future(thread));
+
+                break;
+
+            case THREAD_STATE_WAIT_MSG:
+
+                /* Park the thread on its mailbox, then look for a message
+                 * sent before the thread was parked */
+                td_park_mailbox(thread);
+                if (td_has_msg(thread) && td_unpark_mailbox(thread)) {
+
+                    /* Push the thread back to the ready list */
+                    mmrll_push(thread);
+                }
+
+                break;
+
+            case THREAD_STATE_EXITED:
+
+                /* Carry the post schedule exited action */
+                post_schedule_exited_action(thread);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    return NULL;
+}
+
+#if MMSCHED_PREEMPT == MMSCHED_PREEMPT_MONITOR
+/**
+ * @brief Preempt the threads which overran their time slice
+ *
+ * Scans the time slices of the schedulers every MMSCHED_MONITOR_PERIOD_us,
+ * and signals the kernel thread of a scheduler whose thread overran its
+ * slice, once per slice, till the scheduling is disabled. The cost of the
+ * preemption follows the number of overruns rather than the number of
+ * dispatches
+ *
+ * @param[in] arg Not used
+ * @return NULL
+ */
+static void *_mmsched_monitor(void *arg) {
+
+    struct timespec period = {0, MMSCHED_MONITOR_PERIOD_us * 1000l};
+    Scheduler *sched;
+    unsigned long now, seq, slice_ns;
+
+    /* Block all the signals */
+    sig_block_all();
+
+    /* While the scheduling is enabled */
+    while (mmsched_enabled) {
+
+        /* Wait for the next scan */
+        raw_syscall(SYS_nanosleep, (long)&period, 0, 0, 0, 0, 0);
+
+        /* Get the current time */
+        now = clock_ns(CLOCK_MONOTONIC);
+
+        /* For every scheduler index */
+        for (int i = 0; i < MMSCHED_MAX_SCHEDS; i++) {
+
+            /* Get the scheduler serving the index */
+            sched = atomic_load(&mmsched_scheds[i]);
+            if (!sched) {
+
+                continue;
+            }
+
+            /* Get its slice, the sequence number is read again so that a
+             * slice started meanwhile is not mistaken for the old one */
+            seq = atomic_load(&sched->seq);
+            slice_ns = atomic_load(&sched->slice_ns);
+
+            /* If no thread is running, the slice has not ended, the slice
+             * was already signalled or a new slice started */
+            if (!slice_ns || (now < slice_ns) || (seq == sched->sig_seq) ||
+                (seq != atomic_load(&sched->seq))) {
+
+                continue;
+            }
+
+            /* Signal the kernel thread of the scheduler */
+            sched->sig_seq = seq;
+            raw_syscall(SYS_tgkill, getpid(), atomic_load(&sched->ktid),
+                        SIGALRM, 0, 0, 0);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Start the monitor
+ *
+ * Installs the preemption handler, once for all the threads, and creates
+ * the kernel thread of the monitor
+ */
+static void _mmsched_monitor_start(void) {
+
+    struct sigaction action;
+    int ret;
+
+    /* Install the handler */
+    action = TIMER_INTR_ACTION;
+    sigaction(SIGALRM, &action, NULL);
+
+    /* Allocate the stack */
+    stack_alloc(&mmsched_mon_stack);
+
+    /* Create the kernel thread */
+    ret = kthread_create(&mmsched_mon_kthread, _mmsched_monitor, NULL,
+                         &mmsched_mon_stack);
+
+    /* Check for errors */
+    assert(!ret);
+}
+
+/**
+ * @brief Stop the monitor
+ * @note The scheduling should be disabled first
+ */
+static void _mmsched_monitor_stop(void) {
+
+    /* Wait for the kernel thread to finish */
+    pthread_join(mmsched_mon_kthread, NULL);
+
+    /* Free the stack */
+    stack_free(&mmsched_mon_stack);
+}
+#endif
+
+/**
+ * @brief Start the kernel thread of a scheduler
+ * @param[in] sched Pointer to the scheduler instance
+ */
+static void _mmsched_start(Scheduler *sched) {
+
+    int ret;
+
+    /* The scheduler is not idle */
+    sched->idle_ns = 0;
+
+    /* The scheduler has not polled yet */
+    sched->poll_ns = 0;
+
+    /* No thread is running */
+    sched->preempt = 0;
+    sched->seq = 0;
+    sched->slice_ns = 0;
+    sched->sig_seq = 0;
+
+    /* The kernel thread notes its id once it runs */
+    sched->ktid = 0;
+
+    /* Create the kernel thread */
+    ret = kthread_create(&sched->kthread, _mmsched_dispatch, sched,
+                         &sched->stack);
+
+    /* Check for errors */
+    assert(!ret);
+}
+
+/**
+ * @brief Create a scheduler
+ * @param[in] index Scheduler index
+ * @param[in] cpu CPU to pin the scheduler to
+ * @param[in] state Initial activity state (active or retired)
+ * @return Pointer to the scheduler instance
+ */
+static Scheduler *_mmsched_create(int index, int cpu, int state) {
+
+    Scheduler *sched;
+
+    /* Create a new scheduler */
+    sched = alloc_mem(Scheduler);
+    /* Check for errors */
+    assert(sched);
+
+    /* Set the index, the CPU and the state */
+    sched->index = index;
+    sched->cpu = cpu;
+    sched->state = state;
+
+    /* Allocate the stack */
+    stack_alloc(&sched->stack);
+
+    /* Allocate the thread descriptor the tasks run as */
+    sched->task_td = td_alloc();
+    /* Check for errors */
+    assert(sched->task_td);
+    td_init(sched->task_td, -1, NULL, NULL);
+    td_set_sched(sched->task_td, sched);
+
+    /* No free task structure yet */
+    mmtask_pool_init(&sched->tasks);
+
+    /* No thread taken ahead yet */
+    list_init(&sched->batch);
+    lock_init(&sched->batch_lk);
+    sched->idle = 0;
+
+    /* Start the kernel thread */
+    _mmsched_start(sched);
+
+    return sched;
+}
+
+/**
+ * @brief Destroy a scheduler
+ * @param[in] sched Pointer to the scheduler instance
+ */
+static void _mmsched_destroy(Scheduler *sched) {
+
+    /* Check for errors */
+    assert(sched);
+
+    /* Wait for the kernel thread to finish */
+    pthread_join(sched->kthread, NULL);
+
+    /* Free the stack */
+    stack_free(&sched->stack);
+
+    /* Give the free task structures back */
+    mmtask_pool_deinit(&sched->tasks);
+
+    /* Free the thread descriptor of the tasks */
+    td_free(sched->task_td);
+
+    /* Free the structure */
+    free(sched);
+}
+
+/**
+ * @brief Get the n-th CPU of a CPU set
+ * @param[in] set Pointer to the CPU set
+ * @param[in] n Position of the CPU in the set (wraps around)
+ * @return CPU number
+ */
+static int _mmsched_nth_cpu(const cpu_set_t *set, int n) {
+
+    /* Wrap around the number of CPUs in the set */
+    n %= CPU_COUNT(set);
+
+    /* For every CPU */
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+
+        /* If the CPU is in the set and it is the n-th one */
+        if (CPU_ISSET(cpu, set) && !n--) {
+
+            return cpu;
+        }
+    }
+
+    /* Unreachable for a non empty set */
+    return 0;
+}
+
+/**
+ * @brief Activate a scheduler
+ *
+ * Creates the scheduler of the index if it was never created. If it is
+ * retiring its retirement is cancelled, and if it is retired its parked
+ * kernel thread is woken up
+ *
+ * @param[in] index Scheduler index
+ */
+static void _mmsched_activate(int index) {
+
+    Scheduler *sched;
+
+    /* Get the scheduler */
+    sched = mmsched_scheds[index];
+
+    /* If the scheduler was never created */
+    if (!sched) {
+
+        /* Create a scheduler instance pinned to its CPU */
+        sched = _mmsched_create(index, _mmsched_nth_cpu(&mmsched_set, index),
+                                MMSCHED_STATE_ACTIVE);
+
+        /* Add the scheduler to the list */
+        list_enqueue(&mmsched_list, sched, sll_mem);
+        mmsched_scheds[index] = sched;
+        return;
+    }
+
+    /* If the scheduler has not retired yet */
+    if (atomic_cas(&sched->state, MMSCHED_STATE_RETIRING,
+                   MMSCHED_STATE_ACTIVE)) {
+
+        /* It keeps running */
+        return;
+    }
+
+    /* If the scheduler has retired */
+    if (atomic_cas(&sched->state, MMSCHED_STATE_RETIRED,
+                   MMSCHED_STATE_ACTIVE)) {
+
+        /* Wake up its kernel thread */
+        futex(&sched->state, FUTEX_WAKE, 1);
+    }
+}
+
+/**
+ * @brief Change the number of active schedulers
+ *
+ * Schedulers are added or removed at the end of the index range, so that the
+ * indices of the active schedulers stay contiguous. A removed scheduler
+ * retires once its current dispatch is over
+ *
+ * @param[in] nb_scheds Number of active schedulers
+ * @note Should be called with the scheduler pool lock acquired
+ */
+static void _mmsched_resize(int nb_scheds) {
+
+    /* For every scheduler to be added */
+    for (int i = mmsched_nb; i < nb_scheds; i++) {
+
+        /* Activate the scheduler */
+        _mmsched_activate(i);
+    }
+
+    /* For every scheduler to be removed */
+    for (int i = nb_scheds; i < mmsched_nb; i++) {
+
+        /* Ask the scheduler to retire */
+        atomic_store(&mmsched_scheds[i]->state, MMSCHED_STATE_RETIRING);
+    }
+
+    /* Update the number of schedulers of the ready list */
+    mmrll_lock();
+    mmrll_set_nb_scheds(nb_scheds);
+    mmrll_unlock();
+
+    /* Update the number of active schedulers */
+    mmsched_nb = nb_scheds;
+}
+
+/**
+ * @brief Parse a list of CPUs
+ *
+ * The list is made of CPU numbers and ranges of CPU numbers separated by
+ * commas (e.g. "0-3,6")
+ *
+ * @param[in] str List of CPUs
+ * @param[out] set Pointer to the CPU set
+ * @return 0 on success
+ * @return -1 if the list is malformed
+ */
+static int _mmsched_parse_cpus(const char *str, cpu_set_t *set) {
+
+    long first, last;
+    char *end;
+
+    CPU_ZERO(set);
+
+    /* For every CPU number or range */
+    do {
+
+        /* Get the first CPU */
+        first = strtol(str, &end, 10);
+        if ((end == str) || (first < 0)) {
+
+            return -1;
+        }
+
+        /* Get the last CPU of a range */
+        last = first;
+        if (*end == '-') {
+
+            str = end + 1;
+            last = strtol(str, &end, 10);
+            if ((end == str) || (last < first)) {
+
+                return -1;
+            }
+        }
+
+        /* Add the CPUs */
+        for (long cpu = first; (cpu <= last) && (cpu < CPU_SETSIZE); cpu++) {
+
+            CPU_SET(cpu, set);
+        }
+
+        /* Skip the separator */
+        str = end + 1;
+    } while (*end == ',');
+
+    /* Check for trailing characters */
+    return *end ? -1 : 0;
+}
+
+/**
+ * @brief Initialize the schedulers
+ *
+ * Creates specified number of schedulers. The schedulers will be
+ * responsible for scheduling the many-many type of user threads. The i-th
+ * scheduler is pinned to the (i mod n)-th of the n CPUs it can use, which
+ * are the CPUs the process is allowed to run on (e.g. set using taskset),
+ * restricted to the ones listed by the MMSCHED_CPUS_ENV environment
+ * variable if it is set
+ *
+ * @param[in] nb_scheds Number of schedulers, 0 for automatic scaling
+ * @note Should be done by the main thread
+ */
+void mmsched_init(int nb_scheds) {
+
+    cpu_set_t set;
+    char *cpus;
+
+    /* Initialize the lists */
+    list_init(&mmsched_list);
+    list_init(&mmsched_spare);
+
+    /* Initialize the scheduler pool lock */
+    lock_init(&mmsched_lk);
+
+    /* No scheduler is active yet */
+    mmsched_nb = 0;
+
+    /* Set the scheduling status */
+    mmsched_enabled = 1;
+
+    /* Get the context of the main thread, the threads start with its signal
+     * mask and floating point environment */
+    getcontext(&mmsched_cxt);
+
+    /* Preempt the threads unless the preemption is compiled out */
+    mmsched_preempt = (MMSCHED_PREEMPT != MMSCHED_PREEMPT_NONE);
+
+#if MMSCHED_PREEMPT != MMSCHED_PREEMPT_NONE
+    /* Get the code of the C library */
+    dl_iterate_phdr(_mmsched_libc_module, (void *)gnu_get_libc_version);
+#endif
+
+    /* Get the CPUs the process is allowed to run on */
+    if (sched_getaffinity(0, sizeof(mmsched_set), &mmsched_set) ||
+        !CPU_COUNT(&mmsched_set)) {
+
+        /* Fall back to the first CPU */
+        CPU_ZERO(&mmsched_set);
+        CPU_SET(0, &mmsched_set);
+    }
+
+    /* If the CPUs of the schedulers are listed */
+    cpus = getenv(MMSCHED_CPUS_ENV);
+    if (cpus && !_mmsched_parse_cpus(cpus, &set)) {
+
+        /* Keep the listed CPUs the process is allowed to run on, unless
+         * none is */
+        CPU_AND(&set, &set, &mmsched_set);
+        if (CPU_COUNT(&set)) {
+
+            mmsched_set = set;
+        }
+    }
+
+    /* Keep the number of schedulers in range */
+    if (nb_scheds < 0) {
+
+        nb_scheds = 0;
+    } else if (nb_scheds > MMSCHED_MAX_SCHEDS) {
+
+        nb_scheds = MMSCHED_MAX_SCHEDS;
+    }
+
+#if MMSCHED_PREEMPT == MMSCHED_PREEMPT_MONITOR
+    /* Start the monitor */
+    _mmsched_monitor_start();
+#endif
+
+    /* Create the schedulers */
+    mmsched_setconcurrency(nb_scheds);
+}
+
+/**
+ * @brief Deinitialize the many-many schedulers
+ *
+ * Frees the resources allocated to the scheduler. Also this function does
+ * not return unless all the schedulers have not returned
+ *
+ * @note Should be done by the main thread
+ */
+void mmsched_deinit(void) {
+
+    Scheduler *sched;
+
+    /* Clear the scheduling status */
+    mmsched_enabled = 0;
+
+#if MMSCHED_PREEMPT == MMSCHED_PREEMPT_MONITOR
+    /* Stop the monitor */
+    _mmsched_monitor_stop();
+#endif
+
+    /* While the scheduler list is not empty */
+    while (!list_is_empty(&mmsched_list)) {
+
+        /* Get the scheduler from the global list */
+        sched = list_dequeue(&mmsched_list, Scheduler, sll_mem);
+
+        /* If the kernel thread is lent to a blocking user thread */
+        if (sched->state == MMSCHED_STATE_DETACHED) {
+
+            /* It may never return, it is left to the process exit */
+            continue;
+        }
+
+        /* If the kernel thread is parked */
+        if (atomic_cas(&sched->state, MMSCHED_STATE_RETIRED,
+                       MMSCHED_STATE_ACTIVE)) {
+
+            /* Wake it up to see the scheduling is disabled */
+            futex(&sched->state, FUTEX_WAKE, 1);
+        }
+
+        /* Destroy the thread */
+        _mmsched_destroy(sched);
+    }
+}
+
+/**
+ * @brief Set the number of active schedulers
+ *
+ * With zero the number of schedulers is scaled automatically, between one
+ * and the number of CPUs the process is allowed to run on, depending on
+ * the number of ready threads
+ *
+ * @param[in] nb_scheds Number of schedulers (0 to MMSCHED_MAX_SCHEDS)
+ * @note Interrupts should be disabled if called from a user thread
+ */
+void mmsched_setconcurrency(int nb_scheds) {
+
+    /* Acquire the scheduler pool lock */
+    lock_acquire(&mmsched_lk);
+
+    /* Set the automatic scaling status */
+    mmsched_auto = !nb_scheds;
+
+    /* If the scaling is automatic */
+    if (mmsched_auto) {
+
+        /* Start from the current number of schedulers (at least one) */
+        nb_scheds = mmsched_nb ? mmsched_nb : 1;
+    }
+
+    /* Update the number of schedulers */
+    _mmsched_resize(nb_scheds);
+
+    /* Release the scheduler pool lock */
+    lock_release(&mmsched_lk);
+}
+
+/**
+ * @brief Get the number of active schedulers
+ * @return Number of schedulers
+ */
+int mmsched_getconcurrency(void) {
+
+    /* Return the number of schedulers */
+    return mmsched_nb;
+}
+
+/**
+ * @brief Hand the role of a scheduler to another kernel thread
+ *
+ * Called by a user thread before a system call which may block. The kernel
+ * thread of the scheduler stays with the user thread, while a spare kernel
+ * thread (or a new one if there is no spare) takes over the index of the
+ * scheduler. The lent kernel thread becomes a spare once the user thread
+ * gives up the control back to it
+ *
+ * @param[in] sched Pointer to the scheduler instance of the user thread
+ * @note Interrupts should be disabled
+ */
+void mmsched_detach(Scheduler *sched) {
+
+    Scheduler *repl;
+    int state;
+
+    /* Acquire the scheduler pool lock */
+    lock_acquire(&mmsched_lk);
+
+    /* Get the state of the scheduler */
+    state = sched->state;
+
+    /* If the kernel thread is already lent */
+    if (state == MMSCHED_STATE_DETACHED) {
+
+        /* Release the scheduler pool lock */
+        lock_release(&mmsched_lk);
+        return;
+    }
+
+    /* Lend the kernel thread */
+    sched->state = MMSCHED_STATE_DETACHED;
+
+    /* Give the threads taken ahead back, they would wait for the system
+     * call otherwise */
+    _mmsched_flush(sched);
+
+    /* Give the tasks spawned on the scheduler to the shared queue, the
+     * other schedulers steal only from the schedulers serving an index */
+    mmtask_pool_flush(&sched->tasks);
+
+    /* If there is a spare kernel thread */
+    if (!list_is_empty(&mmsched_spare)) {
+
+        /* Take over the index of the scheduler */
+        repl = list_dequeue(&mmsched_spare, Scheduler, spare_mem);
+        repl->index = sched->index;
+        repl->cpu = sched->cpu;
+        mmsched_scheds[sched->index] = repl;
+
+        /* If the scheduler was active (not retiring) */
+        if (state == MMSCHED_STATE_ACTIVE) {
+
+            /* Wake up the spare kernel thread */
+            atomic_store(&repl->state, MMSCHED_STATE_ACTIVE);
+            futex(&repl->state, FUTEX_WAKE, 1);
+        }
+    } else {
+
+        /* Create a new scheduler for the index, it stays parked if the
+         * scheduler was retiring */
+        repl = _mmsched_create(sched->index, sched->cpu,
+                               (state == MMSCHED_STATE_ACTIVE) ?
+                               MMSCHED_STATE_ACTIVE : MMSCHED_STATE_RETIRED);
+
+        /* Add the scheduler to the list */
+        list_enqueue(&mmsched_list, repl, sll_mem);
+        mmsched_scheds[sched->index] = repl;
+    }
+
+    /* Release the scheduler pool lock */
+    lock_release(&mmsched_lk);
+}
+
+/**
+ * @brief Pause the time slice of a thread blocking in a system call
+ *
+ * The thread is not preempted till it is dispatched again, so that the
+ * system call is not interrupted
+ *
+ * @param[in] thread Thread handle
+ * @note Interrupts should be disabled
+ */
+void mmsched_pause(Thread thread) {
+
+#if MMSCHED_PREEMPT == MMSCHED_PREEMPT_MONITOR
+    /* The monitor does not see a running thread anymore */
+    atomic_store(&td_get_sched(thread)->slice_ns, 0);
+#elif MMSCHED_PREEMPT == MMSCHED_PREEMPT_TIMER
+    /* Disarm the timer of the thread, if it was armed */
+    if (td_get_sched(thread)->preempt) {
+
+        td_timer_pause(thread);
+    }
+#endif
+}
+
+/**
+ * @brief Enable or disable the preemption of the threads
+ *
+ * Takes effect from the next dispatch of every scheduler. The preemption
+ * cannot be enabled if it is compiled out
+ *
+ * @param[in] enabled 1 to enable the preemption, 0 to disable it
+ * @return 1 if the preemption status is set
+ * @return 0 if the preemption is compiled out
+ */
+int mmsched_setpreemption(int enabled) {
+
+#if MMSCHED_PREEMPT == MMSCHED_PREEMPT_NONE
+    /* If the preemption is to be enabled */
+    if (enabled) {
+
+        return 0;
+    }
+#endif
+
+    /* Set the preemption status */
+    atomic_store(&mmsched_preempt, enabled);
+
+    return 1;
+}
+
+/**
+ * @brief Get the preemption status
+ * @return 1 if the threads are preempted, 0 otherwise
+ */
+int mmsched_getpreemption(void) {
+
+    return atomic_load(&mmsched_preempt);
+}
+
+/**
+ * @brief Find the schedulers pinned to the CPUs of a CPU set
+ * @param[in] setsize Size of the CPU set in bytes
+ * @param[in] set Pointer to the CPU set
+ * @param[out] sched Index of the first scheduler pinned to a CPU of the set,
+ *                   or -1 if every scheduler is pinned to a CPU of the set
+ * @return Number of schedulers pinned to a CPU of the set
+ * @note Interrupts should be disabled if called from a user thread
+ */
+int mmsched_find_cpu(size_t setsize, const cpu_set_t *set, int *sched) {
+
+    int nb;
+
+    /* Set the scheduler as none */
+    *sched = -1;
+    nb = 0;
+
+    /* Acquire the scheduler pool lock */
+    lock_acquire(&mmsched_lk);
+
+    /* For every active scheduler */
+    for (int i = 0; i < mmsched_nb; i++) {
+
+        /* If its CPU is in the set */
+        if (CPU_ISSET_S(mmsched_scheds[i]->cpu, setsize, set)) {
+
+            /* If it is the first one */
+            if (!nb++) {
+
+                /* Note it */
+                *sched = i;
+            }
+        }
+    }
+
+    /* If every scheduler is pinned to a CPU of the set */
+    if (nb == mmsched_nb) {
+
+        /* No scheduler is preferred */
+        *sched = -1;
+    }
+
+    /* Release the scheduler pool lock */
+    lock_release(&mmsched_lk);
+
+    return nb;
 }
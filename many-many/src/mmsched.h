@@ -1,9 +1,33 @@
 #ifndef _MMSCHED_H_
 #define _MMSCHED_H_
 
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
 #include <signal.h>
 
 #include "./mods/list.h"
+#include "./mods/lock.h"
+#include "./mmtask.h"
+#include "./thread.h"
+
+/**
+ * Scheduler activity states
+ */
+enum {
+
+    /* Scheduler is dispatching threads */
+    MMSCHED_STATE_ACTIVE,
+
+    /* Scheduler will stop after its current dispatch */
+    MMSCHED_STATE_RETIRING,
+
+    /* Scheduler has stopped (its kernel thread is parked) */
+    MMSCHED_STATE_RETIRED,
+
+    /* Kernel thread is lent to a user thread blocking in a system call */
+    MMSCHED_STATE_DETACHED
+};
 
 /**
  * Scheduler state
@@ -13,8 +37,56 @@ typedef struct Scheduler {
     /* Kernel thread id */
     int ktid;
 
-    /* Wait word */
-    int wait;
+    /* Scheduler index */
+    int index;
+
+    /* CPU the kernel thread is pinned to */
+    int cpu;
+
+    /* Activity state */
+    int state;
+
+    /* Time since which the ready list is found empty (0 if not idle) */
+    unsigned long idle_ns;
+
+    /* Time of the last poll for readiness events */
+    unsigned long poll_ns;
+
+    /* Dispatch sequence number (changes whenever a time slice starts) */
+    unsigned long seq;
+
+    /* Time at which the time slice of the running thread ends (0 if no
+     * thread is running) */
+    unsigned long slice_ns;
+
+    /* Sequence number of the last time slice the monitor signalled */
+    unsigned long sig_seq;
+
+    /* Preemption status of the running thread */
+    int preempt;
+
+    /* Running thread (a thread run inline takes the place of the thread
+     * running it) */
+    Thread curr;
+
+    /* Thread descriptor the tasks run as */
+    Thread task_td;
+
+    /* Free task structures of the tasks spawned on the scheduler */
+    TaskPool tasks;
+
+    /* Ready threads taken ahead from the ready list */
+    List batch;
+
+    /* Lock for taking a thread off the batch (the owner adds threads with
+     * the ready list lock) */
+    Lock batch_lk;
+
+    /* Scheduler found nothing to dispatch */
+    int idle;
+
+    /* Kernel thread handle */
+    pthread_t kthread;
 
     /* Thread stack */
     stack_t stack;
@@ -22,13 +94,111 @@ typedef struct Scheduler {
     /* List member */
     ListMember sll_mem;
 
+    /* Spare list member */
+    ListMember spare_mem;
+
 } Scheduler;
 
-/* Many-many thread time slice (in milli seconds) */
-#define MMSCHED_TIME_SLICE_ms (10u)
+/* Maximum number of ready threads a scheduler dequeues at once, the threads
+ * after the first one are dispatched without the ready list lock (1 disables
+ * the batches) */
+#ifndef MMSCHED_DEQ_BATCH
+#define MMSCHED_DEQ_BATCH (8)
+#endif
+
+/* Time slice (in micro seconds) above which the threads taken ahead are
+ * given back before a thread is dispatched, as they would wait too long */
+#ifndef MMSCHED_BATCH_SLICE_us
+#define MMSCHED_BATCH_SLICE_us (10000u)
+#endif
+
+/* Default time slice of the many-many threads (in micro seconds) */
+#ifndef MMSCHED_TIME_SLICE_us
+#define MMSCHED_TIME_SLICE_us (10000u)
+#endif
+
+/* Bounds of the time slices (in micro seconds), an adaptive time slice is
+ * doubled when the thread is preempted and halved when it waits before the
+ * end of its slice */
+#ifndef MMSCHED_SLICE_MIN_us
+#define MMSCHED_SLICE_MIN_us (1000u)
+#endif
+#ifndef MMSCHED_SLICE_MAX_us
+#define MMSCHED_SLICE_MAX_us (100000u)
+#endif
+
+/* Number of priority levels a thread with an adaptive time slice is raised
+ * by when it waits before the end of its slice (0 disables the boost) */
+#ifndef MMSCHED_SLICE_BOOST
+#define MMSCHED_SLICE_BOOST (1)
+#endif
+
+/* Preemption engines */
+#define MMSCHED_PREEMPT_TIMER   (0)
+#define MMSCHED_PREEMPT_MONITOR (1)
+#define MMSCHED_PREEMPT_NONE    (2)
+
+/* Preemption engine, a timer per thread armed at every dispatch, a monitor
+ * kernel thread signalling the schedulers whose thread overran its time
+ * slice, or none (cooperative scheduling, a thread runs till it yields,
+ * waits or exits) */
+#ifndef MMSCHED_PREEMPT
+#define MMSCHED_PREEMPT MMSCHED_PREEMPT_TIMER
+#endif
+
+/* Period of the scans of the monitor (in micro seconds) */
+#ifndef MMSCHED_MONITOR_PERIOD_us
+#define MMSCHED_MONITOR_PERIOD_us (1000u)
+#endif
+
+/* Pin the kernel threads of the schedulers to CPUs (0 disables pinning) */
+#ifndef MMSCHED_AFFINITY
+#define MMSCHED_AFFINITY (1)
+#endif
+
+/* Environment variable listing the CPUs the schedulers run on (e.g.
+ * "0-3,6"), all the CPUs the process is allowed to run on when not set */
+#ifndef MMSCHED_CPUS_ENV
+#define MMSCHED_CPUS_ENV "THREAD_CPUS"
+#endif
+
+/* Maximum number of schedulers */
+#ifndef MMSCHED_MAX_SCHEDS
+#define MMSCHED_MAX_SCHEDS (64)
+#endif
+
+/* Number of ready threads per scheduler above which the automatic scaling
+ * adds a scheduler */
+#ifndef MMSCHED_AUTO_GROW_LEN
+#define MMSCHED_AUTO_GROW_LEN (2u)
+#endif
+
+/* Time for which a scheduler finds the ready list empty before the automatic
+ * scaling removes a scheduler (in milli seconds) */
+#ifndef MMSCHED_AUTO_IDLE_ms
+#define MMSCHED_AUTO_IDLE_ms (100u)
+#endif
 
 void mmsched_init(int nb_scheds);
 
 void mmsched_deinit(void);
 
+void mmsched_setconcurrency(int nb_scheds);
+
+int mmsched_getconcurrency(void);
+
+void mmsched_detach(Scheduler *sched);
+
+void mmsched_pause(Thread thread);
+
+int mmsched_unbatch(Thread thread, int head);
+
+Scheduler *mmsched_get(int index);
+
+int mmsched_setpreemption(int enabled);
+
+int mmsched_getpreemption(void);
+
+int mmsched_find_cpu(size_t setsize, const cpu_set_t *set, int *sched);
+
 #endif
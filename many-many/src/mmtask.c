@@ -0,0 +1,545 @@
+#include "./mods/utils.h"
+#include "./mods/list.h"
+#include "./mods/lock.h"
+#include "./mods/deque.h"
+#include "./thread_descr.h"
+#include "./mmrll.h"
+#include "./mmtask.h"
+
+/* Tasks spawned outside a scheduler, or on a full deque */
+static List mmtask_queue;
+/* Free task structures shared by the schedulers */
+static List mmtask_free;
+/* Number of tasks on the shared queue */
+static int mmtask_len;
+/* Task lock */
+static Lock mmtask_lk;
+
+/**
+ * @brief Note the completion of a task of a group
+ *
+ * Wakes the thread waiting for the group once the last task completed
+ *
+ * @param[in] group Task group handle
+ */
+static void _mmtask_done(ThreadTaskGroup group) {
+
+    Thread waiter = NULL;
+
+    /* Acquire the member lock */
+    lock_acquire(&group->mem_lock);
+
+    /* If the last task completed and a thread waits for the group */
+    if (!--group->pending && group->waiter) {
+
+        /* Take the waiting thread */
+        waiter = group->waiter;
+        group->waiter = NULL;
+    }
+
+    /* Release the member lock */
+    lock_release(&group->mem_lock);
+
+    /* If a thread is to be woken */
+    if (waiter) {
+
+        /* Push the thread to the many many ready list */
+        mmrll_push(waiter);
+    }
+}
+
+/**
+ * @brief Free the task structures of a list
+ * @param[in/out] list Pointer to the list (left empty)
+ */
+static void _mmtask_free_all(List *list) {
+
+    Task *task;
+
+    /* While there are task structures */
+    while (!list_is_empty(list)) {
+
+        /* Free the task structure */
+        task = list_dequeue(list, Task, tll_mem);
+        free(task);
+    }
+}
+
+/**
+ * @brief Take free task structures from the shared free list
+ * @param[in/out] pool Pointer to the pool of the scheduler
+ */
+static void _mmtask_refill(TaskPool *pool) {
+
+    Task *task;
+
+    /* Acquire the task lock */
+    lock_acquire(&mmtask_lk);
+
+    /* Take up to a batch of task structures */
+    while ((pool->nb < MMTASK_POOL_BATCH) && !list_is_empty(&mmtask_free)) {
+
+        task = list_dequeue(&mmtask_free, Task, tll_mem);
+        list_enqueue(&pool->free, task, tll_mem);
+        pool->nb++;
+    }
+
+    /* Release the task lock */
+    lock_release(&mmtask_lk);
+}
+
+/**
+ * @brief Give the free task structures above the maximum to the shared free
+ *        list
+ * @param[in/out] pool Pointer to the pool of the scheduler
+ */
+static void _mmtask_trim(TaskPool *pool) {
+
+    List extra;
+    Task *task;
+
+    /* Take the task structures above the maximum */
+    list_init(&extra);
+    while (pool->nb > MMTASK_POOL_MAX) {
+
+        task = list_dequeue(&pool->free, Task, tll_mem);
+        list_enqueue(&extra, task, tll_mem);
+        pool->nb--;
+    }
+
+    /* Acquire the task lock */
+    lock_acquire(&mmtask_lk);
+
+    /* Add them to the shared free list */
+    list_splice(&mmtask_free, &extra);
+
+    /* Release the task lock */
+    lock_release(&mmtask_lk);
+}
+
+/**
+ * @brief Queue a task on the shared queue
+ * @param[in] task Pointer to the task structure
+ */
+static void _mmtask_share(Task *task) {
+
+    /* Acquire the task lock */
+    lock_acquire(&mmtask_lk);
+
+    /* Queue the task */
+    list_enqueue(&mmtask_queue, task, tll_mem);
+    mmtask_len++;
+
+    /* Release the task lock */
+    lock_release(&mmtask_lk);
+}
+
+/**
+ * @brief Get the pool of the scheduler a thread spawns tasks on
+ *
+ * A thread runs on its scheduler unless its kernel thread is lent to it for
+ * a blocking system call, or a helper runs an offloaded call as the thread
+ *
+ * @param[in] thread Thread handle
+ * @return Pointer to the pool of the scheduler
+ * @return NULL if the thread does not run on a scheduler
+ * @note Interrupts should be disabled
+ */
+static TaskPool *_mmtask_pool_of(Thread thread) {
+
+    Scheduler *sched;
+
+    /* Get the scheduler of the thread */
+    sched = td_get_sched(thread);
+
+    /* If the thread does not run on it */
+    if (!sched || (sched->state == MMSCHED_STATE_DETACHED) ||
+        (td_get_state(thread) == THREAD_STATE_WAIT_OFFLOAD)) {
+
+        return NULL;
+    }
+
+    return &sched->tasks;
+}
+
+/**
+ * @brief Take the next task to run on a scheduler
+ *
+ * Takes the newest task spawned on the scheduler, or else the oldest task
+ * of the shared queue, or else steals the oldest task of another scheduler,
+ * visiting them from the next index so that the thieves spread
+ *
+ * @param[in/out] pool Pointer to the pool of the scheduler
+ * @param[in] index Index of the scheduler
+ * @return Pointer to the task structure
+ * @return NULL if no task was found
+ */
+static Task *_mmtask_take(TaskPool *pool, int index) {
+
+    Scheduler *victim;
+    Task *task;
+    int nb;
+
+    /* If a task was spawned on the scheduler */
+    task = deque_pop(&pool->deque);
+    if (task) {
+
+        return task;
+    }
+
+    /* If tasks are on the shared queue */
+    if (atomic_load(&mmtask_len)) {
+
+        /* Acquire the task lock */
+        lock_acquire(&mmtask_lk);
+
+        /* Take the oldest one */
+        if (!list_is_empty(&mmtask_queue)) {
+
+            task = list_dequeue(&mmtask_queue, Task, tll_mem);
+            mmtask_len--;
+        }
+
+        /* Release the task lock */
+        lock_release(&mmtask_lk);
+
+        if (task) {
+
+            return task;
+        }
+    }
+
+    /* Count the schedulers created (their indices are contiguous) */
+    for (nb = 0; (nb < MMSCHED_MAX_SCHEDS) && mmsched_get(nb); nb++);
+
+    /* For every other scheduler */
+    for (int i = 1; i < nb; i++) {
+
+        /* Steal its oldest task */
+        victim = mmsched_get((index + i) % nb);
+        task = deque_steal(&victim->tasks.deque);
+        if (task) {
+
+            return task;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Initialize the tasks
+ */
+void mmtask_init(void) {
+
+    /* Initialize the lists */
+    list_init(&mmtask_queue);
+    list_init(&mmtask_free);
+
+    /* No task yet */
+    mmtask_len = 0;
+
+    /* Initialize the lock */
+    lock_init(&mmtask_lk);
+}
+
+/**
+ * @brief Deinitialize the tasks
+ *
+ * The tasks which did not run are dropped
+ *
+ * @note Should be done after the pools of the schedulers are deinitialized
+ */
+void mmtask_deinit(void) {
+
+    /* Free the task structures */
+    _mmtask_free_all(&mmtask_queue);
+    _mmtask_free_all(&mmtask_free);
+
+    /* No task left */
+    mmtask_len = 0;
+}
+
+/**
+ * @brief Initialize the pool of a scheduler
+ * @param[out] pool Pointer to the pool
+ */
+void mmtask_pool_init(TaskPool *pool) {
+
+    /* No task spawned yet */
+    deque_init(&pool->deque, pool->cells, MMTASK_DEQUE_SIZE);
+
+    /* The pool is empty */
+    list_init(&pool->free);
+    pool->nb = 0;
+}
+
+/**
+ * @brief Deinitialize the pool of a scheduler
+ *
+ * Gives the tasks left on the deque to the shared queue, and the free task
+ * structures of the pool to the shared free list
+ *
+ * @param[in/out] pool Pointer to the pool
+ */
+void mmtask_pool_deinit(TaskPool *pool) {
+
+    /* Give the tasks left */
+    mmtask_pool_flush(pool);
+
+    /* Acquire the task lock */
+    lock_acquire(&mmtask_lk);
+
+    /* Give the task structures */
+    list_splice(&mmtask_free, &pool->free);
+    pool->nb = 0;
+
+    /* Release the task lock */
+    lock_release(&mmtask_lk);
+}
+
+/**
+ * @brief Give the tasks spawned on a scheduler to the shared queue
+ *
+ * Used when no other scheduler would steal them anymore, oldest first so
+ * that they keep their order
+ *
+ * @param[in/out] pool Pointer to the pool of the scheduler
+ * @note Should be called by the kernel thread of the scheduler, with the
+ *       interrupts disabled
+ */
+void mmtask_pool_flush(TaskPool *pool) {
+
+    Task *task;
+
+    /* While tasks are left (the thieves may take some meanwhile) */
+    while ((task = deque_steal(&pool->deque)) ||
+           !deque_is_empty(&pool->deque)) {
+
+        /* Queue the task on the shared queue */
+        if (task) {
+
+            _mmtask_share(task);
+        }
+    }
+}
+
+/**
+ * @brief Fill the pool of a scheduler before it runs tasks
+ *
+ * Takes free task structures from the shared free list, and allocates the
+ * missing ones, so that the tasks about to run can spawn tasks
+ *
+ * @param[in/out] pool Pointer to the pool of the scheduler
+ * @note Should be called by a scheduler, not by a task
+ */
+void mmtask_reserve(TaskPool *pool) {
+
+    Task *task;
+
+    /* If the pool is full enough */
+    if (pool->nb >= MMTASK_POOL_BATCH) {
+
+        return;
+    }
+
+    /* Take free task structures */
+    _mmtask_refill(pool);
+
+    /* Allocate the missing ones */
+    while (pool->nb < MMTASK_POOL_BATCH) {
+
+        task = alloc_mem(Task);
+        /* Check for errors */
+        if (!task) {
+
+            break;
+        }
+
+        list_enqueue(&pool->free, task, tll_mem);
+        pool->nb++;
+    }
+}
+
+/**
+ * @brief Queue a task
+ *
+ * The task is pushed to the deque of the scheduler of the caller, where the
+ * scheduler takes it first and the other schedulers steal it. It is queued
+ * on the shared queue if the caller does not run on a scheduler or the deque
+ * is full. The task structure is taken from the pool of the scheduler, it
+ * is allocated only if the pool and the shared free list are empty, and
+ * never from a task
+ *
+ * @param[in] group Task group handle (NULL if none)
+ * @param[in] func Function to be run
+ * @param[in] arg Argument
+ * @return 1 if the task is queued
+ * @return 0 if no memory is left
+ */
+int mmtask_spawn(ThreadTaskGroup group, thread_task_t func, ptr_t arg) {
+
+    Thread curr_thread;
+    TaskPool *pool;
+    Task *task;
+    int intr;
+
+    /* Get the current thread handle */
+    curr_thread = thread_self();
+
+    /* Disable the interrupts, the thread stays on the scheduler of the pool */
+    intr = !td_is_intr_off(curr_thread);
+    if (intr) {
+
+        td_disable_intr(curr_thread);
+    }
+
+    /* Get the pool of the scheduler */
+    pool = _mmtask_pool_of(curr_thread);
+
+    /* If the pool is empty, refill it */
+    if (pool && list_is_empty(&pool->free)) {
+
+        _mmtask_refill(pool);
+    }
+
+    /* If a free task structure is left, reuse it */
+    if (pool && !list_is_empty(&pool->free)) {
+
+        task = list_dequeue(&pool->free, Task, tll_mem);
+        pool->nb--;
+    } else if (!td_is_task(curr_thread)) {
+
+        /* Else allocate one, unless called from a task */
+        task = alloc_mem(Task);
+    } else {
+
+        task = NULL;
+    }
+
+    /* Check for errors */
+    if (!task) {
+
+        /* Enable the interrupts */
+        if (intr) {
+
+            td_enable_intr(curr_thread);
+        }
+
+        return 0;
+    }
+
+    /* Set the task */
+    task->func = func;
+    task->arg = arg;
+    task->group = group;
+
+    /* If the task belongs to a group */
+    if (group) {
+
+        /* Count it before it can complete */
+        lock_acquire(&group->mem_lock);
+        group->pending++;
+        lock_release(&group->mem_lock);
+    }
+
+    /* Push the task to the deque of the scheduler, or else queue it on the
+     * shared queue */
+    if (!pool || deque_push(&pool->deque, task)) {
+
+        _mmtask_share(task);
+    }
+
+    /* Enable the interrupts */
+    if (intr) {
+
+        td_enable_intr(curr_thread);
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Are tasks waiting to run
+ *
+ * Reads the deques without synchronizing with their owners, hence the
+ * answer is a hint
+ *
+ * @return 0 if no task is waiting
+ * @return 1 if tasks are waiting
+ */
+int mmtask_pending(void) {
+
+    Scheduler *sched;
+
+    /* If tasks are on the shared queue */
+    if (atomic_load(&mmtask_len)) {
+
+        return 1;
+    }
+
+    /* For every scheduler created (their indices are contiguous) */
+    for (int i = 0; (i < MMSCHED_MAX_SCHEDS) && (sched = mmsched_get(i));
+         i++) {
+
+        /* If tasks are on its deque */
+        if (!deque_is_empty(&sched->tasks.deque)) {
+
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Run the tasks waiting
+ *
+ * Takes the tasks one at a time (see _mmtask_take()) and runs them to
+ * completion on the stack of the caller, so that the tasks they spawn run
+ * next on the same scheduler. The task structures are then kept in the pool
+ * of the scheduler up to MMTASK_POOL_MAX
+ *
+ * @param[in/out] pool Pointer to the pool of the scheduler
+ * @param[in] index Index of the scheduler
+ * @param[in] max Maximum number of tasks to run
+ * @return Number of tasks run
+ * @note Should be called by a scheduler with the signals blocked
+ */
+int mmtask_run(TaskPool *pool, int index, int max) {
+
+    Task *task;
+    int nb;
+
+    /* While tasks are left, up to max */
+    for (nb = 0; nb < max; nb++) {
+
+        /* Take a task */
+        task = _mmtask_take(pool, index);
+        if (!task) {
+
+            break;
+        }
+
+        /* Run the task */
+        task->func(task->arg);
+
+        /* If the task belongs to a group, note its completion */
+        if (task->group) {
+
+            _mmtask_done(task->group);
+        }
+
+        /* Keep the task structure */
+        list_enqueue(&pool->free, task, tll_mem);
+        pool->nb++;
+    }
+
+    /* If the pool grew above the maximum, give the extra structures */
+    if (pool->nb > MMTASK_POOL_MAX) {
+
+        _mmtask_trim(pool);
+    }
+
+    return nb;
+}
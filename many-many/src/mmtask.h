@@ -0,0 +1,197 @@
+#ifndef _MMTASK_H_
+#define _MMTASK_H_
+
+#include "./mods/list.h"
+#include "./mods/lock.h"
+#include "./mods/deque.h"
+#include "./thread.h"
+
+/**
+ * Run to completion task
+ */
+typedef struct Task {
+
+    /* Function to be run */
+    thread_task_t func;
+
+    /* Argument */
+    ptr_t arg;
+
+    /* Group of the task (NULL if none) */
+    ThreadTaskGroup group;
+
+    /* List member */
+    ListMember tll_mem;
+
+} Task;
+
+/* Number of tasks the deque of a scheduler holds (a power of two), the
+ * tasks spawned on a full deque are queued on the shared queue */
+#ifndef MMTASK_DEQUE_SIZE
+#define MMTASK_DEQUE_SIZE (1024)
+#endif
+
+/**
+ * Tasks and free task structures of a scheduler, used by its kernel thread
+ * only (the other schedulers steal from the deque)
+ */
+typedef struct TaskPool {
+
+    /* Tasks spawned on the scheduler */
+    Deque deque;
+
+    /* Cells of the deque */
+    void *cells[MMTASK_DEQUE_SIZE];
+
+    /* Free task structures */
+    List free;
+
+    /* Number of free task structures */
+    int nb;
+
+} TaskPool;
+
+/**
+ * Task group
+ */
+struct ThreadTaskGroup {
+
+    /* Number of tasks of the group which did not complete */
+    int pending;
+
+    /* Thread waiting for the group (NULL if none) */
+    Thread waiter;
+
+    /* Lock for members */
+    Lock mem_lock;
+};
+
+/**
+ * Parallel loop over a range
+ */
+typedef struct RangeJob {
+
+    /* Function run on the chunks of a loop (NULL for a reduction) */
+    thread_range_t body;
+
+    /* Function mapping the chunks of a reduction */
+    thread_map_t map;
+
+    /* Function combining the results of two adjacent chunks */
+    thread_combine_t combine;
+
+    /* Argument of the functions */
+    ptr_t ctx;
+
+    /* Size below which a range is not split */
+    long grain;
+
+    /* Result of the reduction */
+    ptr_t ret;
+
+    /* Task group of the chunks */
+    ThreadTaskGroup group;
+
+    /* Ranges of the loop, allocated by the calling thread */
+    struct Range *ranges;
+
+    /* Split points of the reduction, allocated by the calling thread */
+    struct RangeNode *nodes;
+
+    /* Number of ranges taken */
+    int nb_ranges;
+
+    /* Number of split points taken */
+    int nb_nodes;
+
+} RangeJob;
+
+/**
+ * Split point of a parallel reduction, combines the results of its halves
+ */
+typedef struct RangeNode {
+
+    /* Enclosing split point (NULL for the whole range) */
+    struct RangeNode *parent;
+
+    /* Half of the enclosing split point (0 lower, 1 upper) */
+    int side;
+
+    /* Results of the lower and the upper halves */
+    ptr_t res[2];
+
+    /* Number of halves without a result */
+    int pending;
+
+} RangeNode;
+
+/**
+ * Range of a parallel loop
+ */
+typedef struct Range {
+
+    /* First index */
+    long begin;
+
+    /* Index past the last one */
+    long end;
+
+    /* Loop of the range */
+    RangeJob *job;
+
+    /* Split point the range is a half of (NULL for the whole range) */
+    RangeNode *parent;
+
+    /* Half of the split point (0 lower, 1 upper) */
+    int side;
+
+} Range;
+
+/* Maximum number of tasks a scheduler runs between two thread dispatches */
+#ifndef MMTASK_BATCH
+#define MMTASK_BATCH (64)
+#endif
+
+/* Number of chunks per kernel thread a parallel loop is split into when no
+ * grain is given */
+#ifndef MMTASK_CHUNKS
+#define MMTASK_CHUNKS (8)
+#endif
+
+/* Maximum number of chunks a parallel loop is split into (a power of two),
+ * the grain is raised above a finer one */
+#ifndef MMTASK_CHUNKS_MAX
+#define MMTASK_CHUNKS_MAX (4096)
+#endif
+
+/* Maximum number of free task structures a scheduler keeps, the others are
+ * moved to the shared free list */
+#ifndef MMTASK_POOL_MAX
+#define MMTASK_POOL_MAX (128)
+#endif
+
+/* Number of free task structures a scheduler takes at once from the shared
+ * free list */
+#ifndef MMTASK_POOL_BATCH
+#define MMTASK_POOL_BATCH (32)
+#endif
+
+void mmtask_init(void);
+
+void mmtask_deinit(void);
+
+void mmtask_pool_init(TaskPool *pool);
+
+void mmtask_pool_deinit(TaskPool *pool);
+
+void mmtask_pool_flush(TaskPool *pool);
+
+void mmtask_reserve(TaskPool *pool);
+
+int mmtask_spawn(ThreadTaskGroup group, thread_task_t func, ptr_t arg);
+
+int mmtask_pending(void);
+
+int mmtask_run(TaskPool *pool, int index, int max);
+
+#endif
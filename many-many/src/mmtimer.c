@@ -0,0 +1,244 @@
+#include "./mods/utils.h"
+#include "./mods/list.h"
+#include "./mods/lock.h"
+#include "./mods/wheel.h"
+#include "./thread_descr.h"
+#include "./thread_sync.h"
+#include "./mmrll.h"
+#include "./mmtimer.h"
+
+/* Timer wheel of the timed waits */
+static Wheel mmtimer_wheel;
+/* Timer wheel lock */
+static Lock mmtimer_lk;
+/* Expiry status (only one scheduler expires the timeouts at a time) */
+static int mmtimer_expiring;
+
+/**
+ * Get the current tick
+ */
+#define _get_tick()                                             \
+    (clock_ns(CLOCK_MONOTONIC) / (MMTIMER_TICK_us * 1000ul))
+
+/**
+ * @brief Remove a thread whose timeout expired from the mutex it waits for
+ *
+ * The list links of the thread are used by the mutex wait list as well as
+ * the ready list, hence the thread is removed before it is made ready. It
+ * may have been removed by an unlock meanwhile
+ *
+ * @param[in] thread Thread handle
+ */
+static void _mmtimer_detach_mutex(Thread thread) {
+
+    ThreadMutex mutex;
+
+    /* Get the mutex (cleared by an unlock removing the thread) */
+    mutex = td_get_wait_mutex(thread);
+    if (!mutex) {
+
+        return;
+    }
+
+    /* Acquire the member lock */
+    mut_lock(mutex);
+
+    /* If the thread is still on the list, remove it */
+    if (td_get_wait_mutex(thread)) {
+
+        mut_del_wait_thread(mutex, thread);
+        td_set_wait_mutex(thread, NULL);
+    }
+
+    /* Release the member lock */
+    mut_unlock(mutex);
+}
+
+/**
+ * @brief Initialize the timer wheel
+ * @note Should be done by the main thread
+ */
+void mmtimer_init(void) {
+
+    /* Initialize the wheel at the current tick */
+    wheel_init(&mmtimer_wheel, _get_tick());
+
+    /* Initialize the wheel lock */
+    lock_init(&mmtimer_lk);
+
+    /* Initialize the expiry status */
+    mmtimer_expiring = 0;
+}
+
+/**
+ * @brief Get the expiry tick of a timeout
+ * @param[in] timeout_ns Timeout from now (in nano seconds)
+ * @return Expiry tick (the timeout is rounded up to the next tick)
+ */
+unsigned long mmtimer_tick(unsigned long timeout_ns) {
+
+    unsigned long tick_ns = MMTIMER_TICK_us * 1000ul;
+
+    return (clock_ns(CLOCK_MONOTONIC) + timeout_ns + tick_ns - 1) / tick_ns;
+}
+
+/**
+ * @brief Add the timeout of a thread to the timer wheel
+ *
+ * Should be done by the scheduler after the thread gave up the control, and
+ * before the wait object of the thread is released, so that the thread
+ * cannot be woken before its timeout is added
+ *
+ * @param[in] thread Thread handle
+ */
+void mmtimer_add(Thread thread) {
+
+    /* Acquire the wheel lock */
+    lock_acquire(&mmtimer_lk);
+
+    /* If the wheel is empty, it is not advanced and may lag behind, hence
+     * move it to the current tick so as not to process the idle ticks */
+    if (wheel_is_empty(&mmtimer_wheel)) {
+
+        mmtimer_wheel.now = _get_tick();
+    }
+
+    /* Add the thread at its expiry tick */
+    wheel_insert(&mmtimer_wheel, thread, wh_mem, td_get_timeout(thread));
+
+    /* Release the wheel lock */
+    lock_release(&mmtimer_lk);
+}
+
+/**
+ * @brief Claim the wake up of a waiting thread
+ *
+ * Should be called by a waker holding the wait object of the thread before
+ * the thread is put on the ready list. If the thread waits with a timeout,
+ * the timeout is removed from the timer wheel
+ *
+ * @param[in] thread Thread handle
+ * @return 1 if the waker should wake the thread
+ * @return 0 if the timeout expired first (the thread is woken by the timer)
+ */
+int mmtimer_cancel(Thread thread) {
+
+    /* If the thread waits without a timeout */
+    if (!td_is_timed(thread)) {
+
+        return 1;
+    }
+
+    /* If the timeout expired first */
+    if (!td_set_timed(thread, THREAD_TIMED_ARMED, THREAD_TIMED_WOKEN)) {
+
+        return 0;
+    }
+
+    /* Acquire the wheel lock */
+    lock_acquire(&mmtimer_lk);
+
+    /* Remove the timeout */
+    wheel_remove(&mmtimer_wheel, thread, wh_mem);
+
+    /* Release the wheel lock */
+    lock_release(&mmtimer_lk);
+
+    return 1;
+}
+
+/**
+ * @brief Expire the timeouts up to the current tick
+ *
+ * The threads whose timeout expired before they were woken are added to the
+ * many-many ready list in one batch. Only one scheduler expires the timeouts
+ * at a time, the others return right away
+ */
+void mmtimer_expire(void) {
+
+    unsigned long tick;
+    List expired, ready;
+    Thread thread;
+
+    /* If no timeout is pending */
+    if (!atomic_load(&mmtimer_wheel.count)) {
+
+        return;
+    }
+
+    /* If the wheel already reached the current tick or another scheduler is
+     * expiring the timeouts */
+    tick = _get_tick();
+    if (((long)(tick - atomic_load(&mmtimer_wheel.now)) < 0) ||
+        !atomic_cas(&mmtimer_expiring, 0, 1)) {
+
+        return;
+    }
+
+    /* Initialize the lists */
+    list_init(&expired);
+    list_init(&ready);
+
+    /* Acquire the wheel lock */
+    lock_acquire(&mmtimer_lk);
+
+    /* Get the expired timeouts */
+    wheel_advance(&mmtimer_wheel, tick, &expired);
+
+    /* While there are expired timeouts */
+    while (!list_is_empty(&expired)) {
+
+        /* Get the thread */
+        thread = wheel_dequeue(&expired, struct Thread, wh_mem);
+
+        /* If the thread has not been woken meanwhile */
+        if (td_set_timed(thread, THREAD_TIMED_ARMED, THREAD_TIMED_EXPIRED)) {
+
+            /* The thread is woken by the timer */
+            wheel_enqueue(&ready, thread, wh_mem);
+        }
+    }
+
+    /* Release the wheel lock */
+    lock_release(&mmtimer_lk);
+
+    /* Let the other schedulers expire the timeouts */
+    atomic_store(&mmtimer_expiring, 0);
+
+    /* If no thread is to be woken */
+    if (list_is_empty(&ready)) {
+
+        return;
+    }
+
+    /* While there are threads to be woken */
+    while (!list_is_empty(&ready)) {
+
+        /* Get the thread */
+        thread = wheel_dequeue(&ready, struct Thread, wh_mem);
+
+        /* If it waits for a mutex, remove it from the mutex wait list (the
+         * wheel lock is not held, as an unlock holds the mutex first) */
+        if (td_get_state(thread) == THREAD_STATE_WAIT_MUTEX) {
+
+            _mmtimer_detach_mutex(thread);
+        }
+
+        /* Keep it to be added to the ready list */
+        wheel_enqueue(&expired, thread, wh_mem);
+    }
+
+    /* Lock the ready list */
+    mmrll_lock();
+
+    /* While there are threads */
+    while (!list_is_empty(&expired)) {
+
+        /* Add the thread to the ready list */
+        thread = wheel_dequeue(&expired, struct Thread, wh_mem);
+        mmrll_enqueue(thread);
+    }
+
+    /* Unlock the ready list */
+    mmrll_unlock();
+}
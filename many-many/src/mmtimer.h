@@ -0,0 +1,21 @@
+#ifndef _MMTIMER_H_
+#define _MMTIMER_H_
+
+#include "./thread.h"
+
+/* Timer wheel tick (in micro seconds), timeouts are rounded up to it */
+#ifndef MMTIMER_TICK_us
+#define MMTIMER_TICK_us (1000u)
+#endif
+
+void mmtimer_init(void);
+
+unsigned long mmtimer_tick(unsigned long timeout_ns);
+
+void mmtimer_add(Thread thread);
+
+int mmtimer_cancel(Thread thread);
+
+void mmtimer_expire(void);
+
+#endif
@@ -0,0 +1,525 @@
+#include <string.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+
+#include "./mods/utils.h"
+#include "./mods/list.h"
+#include "./mods/lock.h"
+#include "./thread_descr.h"
+#include "./mmrll.h"
+#include "./mmsched.h"
+#include "./mmuring.h"
+
+/* Features of the kernel the backend relies on (a single mapping of the
+ * queues and the timeout of the waits) */
+#define MMURING_FEATURES (IORING_FEAT_SINGLE_MMAP | IORING_FEAT_EXT_ARG)
+
+/**
+ * Completion ring of a scheduler
+ */
+typedef struct Ring {
+
+    /* Ring file descriptor (-1 if not set up) */
+    int fd;
+
+    /* Submission queue tail */
+    unsigned int *sq_tail;
+
+    /* Submission queue index mask */
+    unsigned int sq_mask;
+
+    /* Submission queue entries */
+    struct io_uring_sqe *sqes;
+
+    /* Completion queue head */
+    unsigned int *cq_head;
+
+    /* Completion queue tail */
+    unsigned int *cq_tail;
+
+    /* Completion queue index mask */
+    unsigned int cq_mask;
+
+    /* Completion queue entries */
+    struct io_uring_cqe *cqes;
+
+    /* Number of completion queue entries */
+    int nb_cqes;
+
+    /* Mapped queues and their size */
+    void *queues;
+    size_t queues_size;
+
+    /* Number of operations queued but not submitted */
+    int nb_queued;
+
+    /* Number of operations not completed */
+    int nb_inflight;
+
+    /* Reaping status (only one scheduler reaps a ring at a time) */
+    int reaping;
+
+    /* Lock for accessing the submission queue */
+    Lock lk;
+
+} Ring;
+
+/* Rings, indexed by the index of their scheduler */
+static Ring mmuring_rings[MMSCHED_MAX_SCHEDS];
+/* Backend status */
+static int mmuring_enabled;
+
+/**
+ * @brief Set up the ring of a scheduler
+ *
+ * Creates the ring and maps its queues. The ring is not used if the kernel
+ * lacks one of the MMURING_FEATURES
+ *
+ * @param[out] ring Pointer to the ring instance
+ * @return 0 or negated errno
+ */
+static long _mmuring_setup(Ring *ring) {
+
+    struct io_uring_params params;
+    size_t sq_size, cq_size;
+    unsigned int *sq_array;
+    char *queues;
+    long fd, sqes;
+
+    /* Create the ring */
+    memset(&params, 0, sizeof(params));
+    fd = raw_syscall(SYS_io_uring_setup, MMURING_ENTRIES, (long)&params,
+                     0, 0, 0, 0);
+
+    /* Check for errors */
+    if (fd < 0) {
+
+        return fd;
+    }
+
+    /* If a required feature is missing */
+    if ((params.features & MMURING_FEATURES) != MMURING_FEATURES) {
+
+        close(fd);
+        return -ENOSYS;
+    }
+
+    /* Get the size of the queues, mapped at once */
+    sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    cq_size = params.cq_off.cqes +
+              params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->queues_size = (sq_size > cq_size) ? sq_size : cq_size;
+
+    /* Map the queues */
+    queues = (char *)raw_syscall(SYS_mmap, 0, ring->queues_size,
+                                 PROT_READ | PROT_WRITE,
+                                 MAP_SHARED | MAP_POPULATE, fd,
+                                 IORING_OFF_SQ_RING);
+
+    /* Check for errors */
+    if ((long)queues < 0) {
+
+        close(fd);
+        return (long)queues;
+    }
+
+    /* Map the submission queue entries */
+    sqes = raw_syscall(SYS_mmap, 0,
+                       params.sq_entries * sizeof(struct io_uring_sqe),
+                       PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       fd, IORING_OFF_SQES);
+
+    /* Check for errors */
+    if (sqes < 0) {
+
+        munmap(queues, ring->queues_size);
+        close(fd);
+        return sqes;
+    }
+
+    /* Get the submission queue */
+    ring->sq_tail = (unsigned int *)(queues + params.sq_off.tail);
+    ring->sq_mask = *(unsigned int *)(queues + params.sq_off.ring_mask);
+    ring->sqes = (struct io_uring_sqe *)sqes;
+
+    /* Entries are submitted in order, hence the index array of the
+     * submission queue is filled once */
+    sq_array = (unsigned int *)(queues + params.sq_off.array);
+    for (unsigned int i = 0; i < params.sq_entries; i++) {
+
+        sq_array[i] = i;
+    }
+
+    /* Get the completion queue */
+    ring->cq_head = (unsigned int *)(queues + params.cq_off.head);
+    ring->cq_tail = (unsigned int *)(queues + params.cq_off.tail);
+    ring->cq_mask = *(unsigned int *)(queues + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(queues + params.cq_off.cqes);
+    ring->nb_cqes = params.cq_entries;
+    ring->queues = queues;
+
+    /* Publish the ring */
+    atomic_store(&ring->fd, fd);
+
+    return 0;
+}
+
+/**
+ * @brief Submit the queued operations of a ring
+ * @note Should be done with the ring lock held
+ * @param[in] ring Pointer to the ring instance
+ */
+static void _mmuring_flush(Ring *ring) {
+
+    long ret;
+
+    /* If nothing is queued */
+    if (!ring->nb_queued) {
+
+        return;
+    }
+
+    /* Submit all the queued operations with one system call */
+    ret = raw_syscall(SYS_io_uring_enter, ring->fd, ring->nb_queued,
+                      0, 0, 0, 0);
+
+    /* If operations were submitted (the others are submitted later) */
+    if (ret > 0) {
+
+        ring->nb_queued -= ret;
+    }
+}
+
+/**
+ * @brief Wait for a completion on a ring
+ * @param[in] ring Pointer to the ring instance
+ * @param[in] timeout_ms Time to wait in milli seconds
+ */
+static void _mmuring_wait(Ring *ring, int timeout_ms) {
+
+    struct io_uring_getevents_arg arg;
+    struct __kernel_timespec ts;
+
+    /* Set the timeout */
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (timeout_ms % 1000) * 1000000l;
+    memset(&arg, 0, sizeof(arg));
+    arg.ts = (unsigned long)&ts;
+
+    /* Wait for one completion */
+    raw_syscall(SYS_io_uring_enter, ring->fd, 0, 1,
+                IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                (long)&arg, sizeof(arg));
+}
+
+/**
+ * @brief Move the threads whose operation completed to a list of ready
+ *        threads
+ * @note Should be done with the reaping status of the ring set
+ * @param[in] ring Pointer to the ring instance
+ * @param[out] ready Pointer to the list of ready threads
+ * @return Number of completions
+ */
+static int _mmuring_reap(Ring *ring, List *ready) {
+
+    struct io_uring_cqe *cqe;
+    unsigned int head, tail;
+    Thread thread;
+    int nb;
+
+    /* Get the completions posted by the kernel */
+    head = *ring->cq_head;
+    tail = atomic_load(ring->cq_tail);
+
+    /* For every completion */
+    for (nb = 0; head != tail; head++, nb++) {
+
+        /* Get the thread and report the result of its operation */
+        cqe = &ring->cqes[head & ring->cq_mask];
+        thread = (Thread)cqe->user_data;
+        td_get_wait_op(thread)->res = cqe->res;
+
+        /* Add the thread to the ready threads */
+        list_enqueue(ready, thread, ll_mem);
+    }
+
+    /* Give the entries back to the kernel */
+    atomic_store(ring->cq_head, head);
+
+    /* Uncount the operations */
+    atomic_fetch_sub(&ring->nb_inflight, nb);
+
+    return nb;
+}
+
+/**
+ * @brief Add a list of threads to the many-many ready list
+ * @param[in] ready Pointer to the list of threads
+ */
+static void _mmuring_enqueue(List *ready) {
+
+    Thread thread;
+
+    /* If there is nothing to add */
+    if (list_is_empty(ready)) {
+
+        return;
+    }
+
+    /* Lock the ready list */
+    mmrll_lock();
+
+    /* While there are threads */
+    while (!list_is_empty(ready)) {
+
+        /* Add the thread to the ready list */
+        thread = list_dequeue(ready, struct Thread, ll_mem);
+        mmrll_enqueue(thread);
+    }
+
+    /* Unlock the ready list */
+    mmrll_unlock();
+}
+
+/**
+ * @brief Initialize the rings
+ *
+ * The ring of the first scheduler is set up to probe the kernel, if it
+ * fails the epoll backend is used. The other rings are set up as their
+ * scheduler first runs an operation
+ *
+ * @note Should be done by the main thread
+ */
+void mmuring_init(void) {
+
+    /* For every ring */
+    for (int i = 0; i < MMSCHED_MAX_SCHEDS; i++) {
+
+        /* The ring is not set up */
+        mmuring_rings[i].fd = -1;
+        mmuring_rings[i].nb_queued = 0;
+        mmuring_rings[i].nb_inflight = 0;
+        mmuring_rings[i].reaping = 0;
+
+        /* Initialize the ring lock */
+        lock_init(&mmuring_rings[i].lk);
+    }
+
+#if MMURING_ENABLE
+    /* Enable the backend if the kernel supports it */
+    mmuring_enabled = !_mmuring_setup(&mmuring_rings[0]);
+#else
+    mmuring_enabled = 0;
+#endif
+}
+
+/**
+ * @brief Deinitialize the rings
+ * @note Should be done by the main thread, after the schedulers stopped
+ */
+void mmuring_deinit(void) {
+
+    Ring *ring;
+
+    /* For every ring */
+    for (int i = 0; i < MMSCHED_MAX_SCHEDS; i++) {
+
+        ring = &mmuring_rings[i];
+
+        /* If the ring is set up */
+        if (ring->fd != -1) {
+
+            /* Unmap the queues */
+            munmap(ring->sqes,
+                   (ring->sq_mask + 1) * sizeof(struct io_uring_sqe));
+            munmap(ring->queues, ring->queues_size);
+
+            /* Close the ring */
+            close(ring->fd);
+            ring->fd = -1;
+        }
+    }
+
+    /* Disable the backend */
+    mmuring_enabled = 0;
+}
+
+/**
+ * @brief Check if the io_uring backend is used
+ * @return 1 if the operations are run on the rings
+ * @return 0 if the epoll backend is used only
+ */
+int mmuring_is_enabled(void) {
+
+    return mmuring_enabled;
+}
+
+/**
+ * @brief Get the number of operations not completed on a ring
+ * @param[in] index Index of the scheduler
+ * @return Number of operations
+ */
+int mmuring_inflight(int index) {
+
+    return atomic_load(&mmuring_rings[index].nb_inflight);
+}
+
+/**
+ * @brief Queue the operation of a thread on the ring of a scheduler
+ *
+ * Should be done by the scheduler after the thread gave up the control, so
+ * that the thread is not run by another scheduler before its context is
+ * saved. The operations are submitted in batches, once MMURING_BATCH are
+ * queued or at the next poll of the scheduler. If the ring cannot take the
+ * operation, the thread is made ready right away with -EAGAIN (it then
+ * falls back to the epoll backend)
+ *
+ * @param[in] thread Thread handle
+ * @param[in] index Index of the scheduler
+ */
+void mmuring_submit(Thread thread, int index) {
+
+    struct io_uring_sqe *sqe;
+    unsigned int tail;
+    RingOp *op;
+    Ring *ring;
+
+    /* Get the operation and the ring */
+    op = td_get_wait_op(thread);
+    ring = &mmuring_rings[index];
+
+    /* Acquire the ring lock */
+    lock_acquire(&ring->lk);
+
+    /* If the submission queue is full, submit the queued operations */
+    if ((ring->fd != -1) && (ring->nb_queued > ring->sq_mask)) {
+
+        _mmuring_flush(ring);
+    }
+
+    /* If the ring cannot be set up, its submission queue is still full, or
+     * the completion of one more operation may not fit in the completion
+     * queue */
+    if (((ring->fd == -1) && _mmuring_setup(ring)) ||
+        (ring->nb_queued > ring->sq_mask) ||
+        (ring->nb_inflight >= ring->nb_cqes)) {
+
+        /* Release the ring lock */
+        lock_release(&ring->lk);
+
+        /* Make the thread ready with the error */
+        op->res = -EAGAIN;
+        mmrll_push(thread);
+        return;
+    }
+
+    /* Fill the next submission queue entry */
+    tail = *ring->sq_tail;
+    sqe = &ring->sqes[tail & ring->sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = op->opcode;
+    sqe->fd = op->fd;
+    sqe->addr = op->addr;
+    sqe->len = op->len;
+    sqe->off = op->off;
+    sqe->rw_flags = op->op_flags;
+    sqe->user_data = (unsigned long)thread;
+
+    /* Queue the entry */
+    atomic_store(ring->sq_tail, tail + 1);
+
+    /* Count the operation */
+    ring->nb_queued++;
+    atomic_fetch_add(&ring->nb_inflight, 1);
+
+    /* If a batch is queued, submit it */
+    if (ring->nb_queued >= MMURING_BATCH) {
+
+        _mmuring_flush(ring);
+    }
+
+    /* Release the ring lock */
+    lock_release(&ring->lk);
+}
+
+/**
+ * @brief Submit the queued operations and reap the completions
+ *
+ * Submits the queued operations of the ring of the scheduler and moves the
+ * threads whose operation completed to the many-many ready list in one
+ * batch. If nothing completed, waits up to timeout_ms on the ring of the
+ * scheduler. The rings of the other schedulers are reaped too, so that the
+ * operations of a retired scheduler complete
+ *
+ * @param[in] index Index of the scheduler
+ * @param[in] timeout_ms Time to wait for a completion in milli seconds
+ * @return Number of completions
+ */
+int mmuring_poll(int index, int timeout_ms) {
+
+    List ready;
+    Ring *ring;
+    int nb;
+
+    /* If the backend is not used */
+    if (!mmuring_enabled) {
+
+        return 0;
+    }
+
+    /* Initialize the list of ready threads */
+    list_init(&ready);
+
+    /* Get the ring of the scheduler */
+    ring = &mmuring_rings[index];
+    nb = 0;
+
+    /* If operations are queued */
+    if (ring->nb_queued) {
+
+        /* Submit them */
+        lock_acquire(&ring->lk);
+        _mmuring_flush(ring);
+        lock_release(&ring->lk);
+    }
+
+    /* If operations are in flight and no other scheduler reaps the ring */
+    if (atomic_load(&ring->nb_inflight) &&
+        atomic_cas(&ring->reaping, 0, 1)) {
+
+        /* Reap the completions */
+        nb = _mmuring_reap(ring, &ready);
+
+        /* If nothing completed, wait for a completion */
+        if (!nb && timeout_ms) {
+
+            _mmuring_wait(ring, timeout_ms);
+            nb = _mmuring_reap(ring, &ready);
+        }
+
+        /* Let the other schedulers reap the ring */
+        atomic_store(&ring->reaping, 0);
+    }
+
+    /* For every other ring */
+    for (int i = 0; i < MMSCHED_MAX_SCHEDS; i++) {
+
+        ring = &mmuring_rings[i];
+
+        /* If operations are in flight and no other scheduler reaps it */
+        if ((i != index) && atomic_load(&ring->nb_inflight) &&
+            atomic_cas(&ring->reaping, 0, 1)) {
+
+            /* Reap the completions */
+            nb += _mmuring_reap(ring, &ready);
+
+            /* Let the other schedulers reap the ring */
+            atomic_store(&ring->reaping, 0);
+        }
+    }
+
+    /* Add the threads made ready to the ready list */
+    _mmuring_enqueue(&ready);
+
+    return nb;
+}
@@ -0,0 +1,63 @@
+#ifndef _MMURING_H_
+#define _MMURING_H_
+
+#include "./thread.h"
+
+/**
+ * I/O operation run on a completion ring
+ */
+typedef struct RingOp {
+
+    /* Operation code (IORING_OP_*) */
+    unsigned char opcode;
+
+    /* File descriptor */
+    int fd;
+
+    /* Buffer or address */
+    unsigned long addr;
+
+    /* Length of the buffer */
+    unsigned int len;
+
+    /* File offset, or address length */
+    unsigned long off;
+
+    /* Flags of the operation */
+    unsigned int op_flags;
+
+    /* Result (number of bytes, descriptor or negated errno) */
+    long res;
+
+} RingOp;
+
+/* Use the io_uring backend when the kernel supports it (0 uses the epoll
+ * backend only) */
+#ifndef MMURING_ENABLE
+#define MMURING_ENABLE (1)
+#endif
+
+/* Number of submission entries per ring (power of 2) */
+#ifndef MMURING_ENTRIES
+#define MMURING_ENTRIES (128u)
+#endif
+
+/* Number of queued operations after which a scheduler submits them right
+ * away, instead of at its next poll */
+#ifndef MMURING_BATCH
+#define MMURING_BATCH (32u)
+#endif
+
+void mmuring_init(void);
+
+void mmuring_deinit(void);
+
+int mmuring_is_enabled(void);
+
+int mmuring_inflight(int index);
+
+void mmuring_submit(Thread thread, int index);
+
+int mmuring_poll(int index, int timeout_ms);
+
+#endif
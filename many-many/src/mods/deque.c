@@ -0,0 +1,161 @@
+#include <assert.h>
+#include <stdatomic.h>
+#include "./deque.h"
+
+/**
+ * @brief Initialize the deque
+ * @param[out] deque Pointer to the deque instance
+ * @param[in] cells Pointer to the cells
+ * @param[in] size Number of cells (a power of two)
+ */
+void deque_init(Deque *deque, void **cells, long size) {
+
+    /* Check for errors */
+    assert(deque && cells && (size > 0) && !(size & (size - 1)));
+
+    /* Set the cells */
+    deque->cells = cells;
+    deque->mask = size - 1;
+
+    /* Both ends start at the first cell */
+    deque->top = 0;
+    deque->bottom = 0;
+}
+
+/**
+ * @brief Add a pointer to the bottom (owner only)
+ *
+ * @param[in/out] deque Pointer to the deque instance
+ * @param[in] data Pointer to be added
+ * @return 0 if the pointer was added
+ * @return -1 if the deque is full
+ */
+int deque_push(Deque *deque, void *data) {
+
+    long bottom, top;
+
+    /* Get both ends */
+    bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    top = atomic_load_explicit(&deque->top, memory_order_acquire);
+
+    /* If the deque is full */
+    if (bottom - top > deque->mask) {
+
+        return -1;
+    }
+
+    /* Fill the cell, then publish it to the thieves */
+    atomic_store_explicit(&deque->cells[bottom & deque->mask], data,
+                          memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+
+    return 0;
+}
+
+/**
+ * @brief Delete the bottom (owner only)
+ *
+ * Takes the newest pointer. The bottom is moved first, so that a thief
+ * either sees it moved or wins the last pointer with its compare and swap
+ *
+ * @param[in/out] deque Pointer to the deque instance
+ * @return Newest pointer
+ * @return NULL if the deque is empty, or a thief took the last pointer
+ */
+void *deque_pop(Deque *deque) {
+
+    long bottom, top;
+    void *data;
+
+    /* Claim the bottom cell */
+    bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    /* If the deque was empty */
+    if (top > bottom) {
+
+        /* Give the cell back */
+        atomic_store_explicit(&deque->bottom, bottom + 1,
+                              memory_order_relaxed);
+        return NULL;
+    }
+
+    /* Get the pointer */
+    data = atomic_load_explicit(&deque->cells[bottom & deque->mask],
+                               memory_order_relaxed);
+
+    /* If it is the last one, race with the thieves for it */
+    if (top == bottom) {
+
+        if (!atomic_compare_exchange_strong_explicit(&deque->top, &top,
+                                                     top + 1,
+                                                     memory_order_seq_cst,
+                                                     memory_order_relaxed)) {
+
+            /* A thief took it */
+            data = NULL;
+        }
+
+        /* The deque is empty */
+        atomic_store_explicit(&deque->bottom, bottom + 1,
+                              memory_order_relaxed);
+    }
+
+    return data;
+}
+
+/**
+ * @brief Delete the top (any thread)
+ *
+ * @param[in/out] deque Pointer to the deque instance
+ * @return Oldest pointer
+ * @return NULL if the deque is empty, or the owner or another thief took the
+ *         pointer meanwhile
+ */
+void *deque_steal(Deque *deque) {
+
+    long bottom, top;
+    void *data;
+
+    /* Get both ends */
+    top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+
+    /* If the deque is empty */
+    if (top >= bottom) {
+
+        return NULL;
+    }
+
+    /* Get the pointer, then claim its cell */
+    data = atomic_load_explicit(&deque->cells[top & deque->mask],
+                               memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                 memory_order_seq_cst,
+                                                 memory_order_relaxed)) {
+
+        return NULL;
+    }
+
+    return data;
+}
+
+/**
+ * @brief Is deque empty
+ *
+ * Reads both ends without synchronizing with the owner, hence the answer is
+ * a hint
+ *
+ * @param[in] deque Pointer to the deque instance
+ * @return 0 if not empty
+ * @return 1 if empty
+ */
+int deque_is_empty(Deque *deque) {
+
+    /* Check if the bottom is past the top */
+    return (atomic_load(&deque->bottom) <= atomic_load(&deque->top));
+}
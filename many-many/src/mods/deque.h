@@ -0,0 +1,42 @@
+#ifndef _DEQUE_H_
+#define _DEQUE_H_
+
+#include <stddef.h>
+
+/* Size of a cache line, the ends of the deque are kept on their own lines */
+#define DEQUE_LINE (64)
+
+/**
+ * Lock-free work stealing deque structure (Chase-Lev)
+ *
+ * The cells form a ring. The owner pushes and pops at the bottom, the
+ * thieves steal from the top with a compare and swap. The owner races with
+ * the thieves only for the last pointer left
+ */
+typedef struct Deque {
+
+    /* Pointer to the cells */
+    void **cells;
+
+    /* Number of cells less one (a power of two less one) */
+    long mask;
+
+    /* Position of the oldest pointer (thieves) */
+    _Alignas(DEQUE_LINE) long top;
+
+    /* Position past the newest pointer (owner) */
+    _Alignas(DEQUE_LINE) long bottom;
+
+} Deque;
+
+void deque_init(Deque *deque, void **cells, long size);
+
+int deque_push(Deque *deque, void *data);
+
+void *deque_pop(Deque *deque);
+
+void *deque_steal(Deque *deque);
+
+int deque_is_empty(Deque *deque);
+
+#endif
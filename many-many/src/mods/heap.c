@@ -0,0 +1,177 @@
+#include "./heap.h"
+
+/**
+ * @brief Meld two heaps
+ *
+ * Makes the root with the greater key the first child of the other root
+ *
+ * @param[in] a Root of the first heap
+ * @param[in] b Root of the second heap
+ * @return Root of the melded heap
+ */
+static HeapMember *_heap_meld(HeapMember *a, HeapMember *b) {
+
+    HeapMember *tmp;
+
+    /* If either of the heaps is empty */
+    if (!a || !b) {
+
+        return a ? a : b;
+    }
+
+    /* Make sure a has the smaller key (ties keep the insertion order) */
+    if (b->key < a->key) {
+
+        tmp = a;
+        a = b;
+        b = tmp;
+    }
+
+    /* Make b the first child of a */
+    b->sibling = a->child;
+    if (a->child) {
+
+        a->child->prev = b;
+    }
+    b->prev = a;
+    a->child = b;
+
+    return a;
+}
+
+/**
+ * @brief Meld the children of a node
+ *
+ * Melds the children using the two pass method
+ *
+ * @param[in] node Pointer to the parent heap member
+ * @return Root of the melded children
+ */
+static HeapMember *_heap_meld_children(HeapMember *node) {
+
+    HeapMember *pairs, *root;
+    HeapMember *a, *b, *next;
+
+    /* First pass, meld the children in pairs from left to right and
+     * chain the results in reverse order */
+    pairs = NULL;
+    for (a = node->child; a; a = next) {
+
+        /* Get the pair */
+        b = a->sibling;
+        next = b ? b->sibling : NULL;
+
+        /* Detach the pair */
+        a->sibling = a->prev = NULL;
+        if (b) {
+
+            b->sibling = b->prev = NULL;
+        }
+
+        /* Meld the pair */
+        a = _heap_meld(a, b);
+
+        /* Chain the result */
+        a->sibling = pairs;
+        pairs = a;
+    }
+
+    /* Second pass, meld the results from right to left */
+    root = NULL;
+    for (a = pairs; a; a = next) {
+
+        /* Get the next result */
+        next = a->sibling;
+        a->sibling = NULL;
+
+        /* Meld it */
+        root = _heap_meld(root, a);
+    }
+
+    /* The node has no children now */
+    node->child = NULL;
+
+    return root;
+}
+
+/**
+ * @brief Add node to the heap
+ *
+ * Melds the single node heap with the heap
+ *
+ * @param[in/out] heap Pointer to the heap instance
+ * @param[in/out] new Pointer to the heap member structure
+ */
+void do_heap_insert(Heap *heap, HeapMember *new) {
+
+    /* Make the new node a single node heap */
+    new->child = new->sibling = new->prev = NULL;
+
+    /* Meld it with the heap */
+    heap->root = _heap_meld(heap->root, new);
+}
+
+/**
+ * @brief Delete the root
+ *
+ * Deletes and returns the root of the heap
+ *
+ * @param[in/out] heap Pointer to the heap instance
+ * @return Pointer to the root heap member
+ */
+HeapMember *do_heap_pop(Heap *heap) {
+
+    HeapMember *root;
+
+    /* Get the root member */
+    root = heap->root;
+
+    /* Make the melded children the new root */
+    heap->root = _heap_meld_children(root);
+
+    return root;
+}
+
+/**
+ * @brief Delete a node
+ *
+ * Detaches the subtree of the node, and melds the children of the node back
+ * with the heap. The node must be a member of the given heap
+ *
+ * @param[in/out] heap Pointer to the heap instance
+ * @param[in/out] mem Pointer to the heap member structure
+ */
+void do_heap_remove(Heap *heap, HeapMember *mem) {
+
+    /* If the node is the root */
+    if (mem == heap->root) {
+
+        /* Remove the root */
+        do_heap_pop(heap);
+        return;
+    }
+
+    /* If the node is the first child of its parent */
+    if (mem->prev->child == mem) {
+
+        /* Update the child of the parent */
+        mem->prev->child = mem->sibling;
+    } else {
+
+        /* Update the sibling of the previous sibling */
+        mem->prev->sibling = mem->sibling;
+    }
+
+    /* If the node has a next sibling */
+    if (mem->sibling) {
+
+        /* Update its previous link */
+        mem->sibling->prev = mem->prev;
+    }
+
+    /* Clear the links of the node */
+    mem->sibling = mem->prev = NULL;
+
+    /* Meld the children of the node with the heap */
+    heap->root = _heap_meld(heap->root, _heap_meld_children(mem));
+}
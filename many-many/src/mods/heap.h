@@ -0,0 +1,140 @@
+#ifndef _HEAP_H_
+#define _HEAP_H_
+
+#include <stddef.h>
+#include <assert.h>
+
+/**
+ * Pairing heap member to order different structures by a key
+ *
+ * @note Insert this as a structure member which needs to be ordered in a heap
+ */
+typedef struct HeapMember {
+
+    /* Key of the member */
+    unsigned long key;
+
+    /* Pointer to the first child */
+    struct HeapMember *child;
+
+    /* Pointer to the next sibling */
+    struct HeapMember *sibling;
+
+    /* Pointer to the previous sibling (or the parent for the first child) */
+    struct HeapMember *prev;
+
+} HeapMember;
+
+/**
+ * Pairing heap structure (minimum key at the root)
+ */
+typedef struct Heap {
+
+    /* Pointer to the root member */
+    HeapMember *root;
+
+} Heap;
+
+/**
+ * Functions used internally
+ *
+ * @note One who feels himself/herself to be worthy shall be the one
+ *       to use these functions directly else use the macros defined below
+ */
+void do_heap_insert(Heap *heap, HeapMember *new);
+
+HeapMember *do_heap_pop(Heap *heap);
+
+void do_heap_remove(Heap *heap, HeapMember *mem);
+
+/**
+ * @brief Insert a new node to the heap
+ *
+ * @param[in] heap Pointer to the heap instance
+ * @param[in] new Pointer to the any structure to be added
+ * @param[in] mem Name of the HeapMember member in the structure type of #new
+ * @param[in] k Key of the new node
+ */
+#define heap_insert(heap, new, mem, k)              \
+    {                                               \
+        assert((new));                              \
+                                                    \
+        (new)->mem.key = (k);                       \
+                                                    \
+        do_heap_insert((heap), &(new)->mem);        \
+    }                                               \
+
+/**
+ * @brief Remove the node with the minimum key from the heap
+ *
+ * @param[in] heap Pointer to the heap instance
+ * @param[in] type Type of the structure to be returned
+ * @param[in] mem Name of the HeapMember member in the structure of given type
+ * @return Pointer to the structure containing the root HeapMember
+ */
+#define heap_pop(heap, type, mem)                               \
+    ({                                                          \
+        assert((heap)->root);                                   \
+                                                                \
+        int _offset = offsetof(type, mem);                      \
+                                                                \
+        (type *)((void *)do_heap_pop((heap)) - _offset);        \
+    })
+
+/**
+ * @brief Remove a node from anywhere in the heap
+ *
+ * @param[in] heap Pointer to the heap instance
+ * @param[in] node Pointer to the structure to be removed
+ * @param[in] mem Name of the HeapMember member in the structure type of #node
+ */
+#define heap_remove(heap, node, mem)                \
+    {                                               \
+        assert((node));                             \
+                                                    \
+        do_heap_remove((heap), &(node)->mem);       \
+    }                                               \
+
+/**
+ * @brief Get the minimum key of the heap
+ *
+ * @param[in] heap Pointer to the heap instance
+ */
+#define heap_min_key(heap) ((heap)->root->key)
+
+/* Heap initializer */
+#define HEAP_INITIALIZER (Heap){NULL}
+
+/**
+ * @brief Initializes the heap
+ *
+ * Sets the root pointer of the heap to point to nothing
+ *
+ * @param[out] heap Pointer to the heap instance
+ */
+static inline void heap_init(Heap *heap) {
+
+    /* Check for errors */
+    assert(heap);
+
+    /* Set the root to null */
+    heap->root = NULL;
+}
+
+/**
+ * @brief Is heap empty
+ *
+ * @param[in] heap Pointer to the heap instance
+ * @return 0 if not empty
+ * @return 1 if empty
+ */
+static inline int heap_is_empty(Heap *heap) {
+
+    /* Check for errors */
+    assert(heap);
+
+    /* Check if the root is NULL */
+    return !heap->root;
+}
+
+#endif
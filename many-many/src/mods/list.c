@@ -65,3 +65,40 @@ ListMember *do_list_dequeue(List *list) {
 
     return head;
 }
+
+/**
+ * @brief Delete a node
+ *
+ * Unlinks the given node from the linked list. The node must be a member of
+ * the given list
+ *
+ * @param[in/out] list Pointer to the list instance
+ * @param[in/out] mem Pointer to the list member structure
+ */
+void do_list_remove(List *list, ListMember *mem) {
+
+    /* If the node is the head */
+    if (!mem->prev) {
+
+        /* Update the head */
+        list->head = mem->next;
+    } else {
+
+        /* Update the next of the previous node */
+        mem->prev->next = mem->next;
+    }
+
+    /* If the node is the tail */
+    if (!mem->next) {
+
+        /* Update the tail */
+        list->tail = mem->prev;
+    } else {
+
+        /* Update the prev of the next node */
+        mem->next->prev = mem->prev;
+    }
+
+    /* Clear the links of the node */
+    mem->next = mem->prev = NULL;
+}
@@ -42,6 +42,8 @@ void do_list_enqueue(List *list, ListMember *new);
 
 ListMember *do_list_dequeue(List *list);
 
+void do_list_remove(List *list, ListMember *mem);
+
 /**
  * @brief Enqueue a new node to the list
  *
@@ -73,6 +75,37 @@ ListMember *do_list_dequeue(List *list);
         (type *)((void *)do_list_dequeue((list)) - _offset);    \
     })
 
+/**
+ * @brief Get the head node of the list without dequeuing it
+ *
+ * @param[in] list Pointer to the list instance
+ * @param[in] type Type of the structure to be returned
+ * @param[in] mem Name of the ListMember member in the structure of given type
+ * @return Pointer to the structure containing the head ListMember
+ */
+#define list_peek(list, type, mem)                              \
+    ({                                                          \
+        assert((list)->head);                                   \
+                                                                \
+        int _offset = offsetof(type, mem);                      \
+                                                                \
+        (type *)((void *)(list)->head - _offset);               \
+    })
+
+/**
+ * @brief Remove a node from anywhere in the list
+ *
+ * @param[in] list Pointer to the list instance
+ * @param[in] node Pointer to the structure to be removed
+ * @param[in] mem Name of the ListMember member in the structure type of #node
+ */
+#define list_remove(list, node, mem)                \
+    {                                               \
+        assert((node));                             \
+                                                    \
+        do_list_remove((list), &(node)->mem);       \
+    }                                               \
+
 /* List initializer */
 #define LIST_INITIALIZER (List){NULL, NULL}
 
@@ -111,4 +144,43 @@ static inline int list_is_empty(List *list) {
     return (!list->head && !list->tail);
 }
 
+/**
+ * @brief Append a list to another list
+ *
+ * Moves all the members of the source list to the tail of the destination
+ * list in constant time, the source list is left empty
+ *
+ * @param[in/out] list Pointer to the destination list instance
+ * @param[in/out] other Pointer to the source list instance
+ */
+static inline void list_splice(List *list, List *other) {
+
+    /* Check for errors */
+    assert(list && other);
+
+    /* If the source list is empty */
+    if (!other->head) {
+
+        return;
+    }
+
+    /* If the destination list is empty */
+    if (!list->tail) {
+
+        /* Take the head of the source list */
+        list->head = other->head;
+    } else {
+
+        /* Link the tail to the head of the source list */
+        list->tail->next = other->head;
+        other->head->prev = list->tail;
+    }
+
+    /* Take the tail of the source list */
+    list->tail = other->tail;
+
+    /* Empty the source list */
+    other->head = other->tail = NULL;
+}
+
 #endif
@@ -36,6 +36,25 @@ void lock_acquire(Lock *lock) {
     while (!atomic_cas(lock, LOCK_NOT_ACQUIRED, LOCK_ACQUIRED));
 }
 
+/**
+ * @brief Try to acquire the lock
+ *
+ * Atomically checks if the lock is not acquired and then acquires it, does
+ * not wait if it is acquired
+ *
+ * @param[in] lock Pointer to the lock variable
+ * @return 1 if the lock was acquired
+ * @return 0 if the lock is held
+ */
+int lock_try(Lock *lock) {
+
+    /* Check for errors */
+    assert(lock);
+
+    /* Try to update the lock's status once */
+    return atomic_cas(lock, LOCK_NOT_ACQUIRED, LOCK_ACQUIRED);
+}
+
 /**
  * @brief Releases the lock
  *
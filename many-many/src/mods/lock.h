@@ -21,6 +21,8 @@ void lock_init(Lock *lock);
 
 void lock_acquire(Lock *lock);
 
+int lock_try(Lock *lock);
+
 void lock_release(Lock *lock);
 
 #endif
@@ -0,0 +1,143 @@
+#include <assert.h>
+#include <stdatomic.h>
+#include "./mpmc.h"
+
+/**
+ * @brief Initialize the queue
+ *
+ * Hands every cell over to the producers of the first round of the ring
+ *
+ * @param[out] queue Pointer to the queue instance
+ * @param[in] cells Pointer to the cells
+ * @param[in] size Number of cells (a power of two)
+ */
+void mpmc_init(Mpmc *queue, MpmcCell *cells, size_t size) {
+
+    /* Check for errors */
+    assert(queue && cells && size && !(size & (size - 1)));
+
+    /* For every cell */
+    for (size_t i = 0; i < size; i++) {
+
+        /* The cell is free for the push at its position */
+        cells[i].seq = i;
+        cells[i].data = NULL;
+    }
+
+    /* Set the cells */
+    queue->cells = cells;
+    queue->mask = size - 1;
+
+    /* Both ends start at the first cell */
+    queue->tail = 0;
+    queue->head = 0;
+}
+
+/**
+ * @brief Add a pointer to the tail
+ *
+ * @param[in/out] queue Pointer to the queue instance
+ * @param[in] data Pointer to be added
+ * @return 0 if the pointer was added
+ * @return -1 if the queue is full
+ */
+int mpmc_push(Mpmc *queue, void *data) {
+
+    MpmcCell *cell;
+    size_t pos, seq;
+    long diff;
+
+    /* Get the position of the tail */
+    pos = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+
+    /* Till a cell is claimed */
+    for (;;) {
+
+        /* Get the sequence number of the cell at the position */
+        cell = &queue->cells[pos & queue->mask];
+        seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        diff = (long)seq - (long)pos;
+
+        /* If the cell is free for this round, try to claim it */
+        if (!diff) {
+
+            if (atomic_compare_exchange_weak_explicit(&queue->tail, &pos,
+                                                      pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+
+                break;
+            }
+        } else if (diff < 0) {
+
+            /* The cell is still full from the previous round */
+            return -1;
+        } else {
+
+            /* Another producer claimed the cell, reload the tail */
+            pos = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+        }
+    }
+
+    /* Fill the cell, then hand it over to the consumers */
+    cell->data = data;
+    atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+
+    return 0;
+}
+
+/**
+ * @brief Delete the head
+ *
+ * @param[in/out] queue Pointer to the queue instance
+ * @return Pointer held by the head cell
+ * @return NULL if the queue is empty, or the push of the head cell is not
+ *         complete yet
+ */
+void *mpmc_pop(Mpmc *queue) {
+
+    MpmcCell *cell;
+    size_t pos, seq;
+    void *data;
+    long diff;
+
+    /* Get the position of the head */
+    pos = atomic_load_explicit(&queue->head, memory_order_relaxed);
+
+    /* Till a cell is claimed */
+    for (;;) {
+
+        /* Get the sequence number of the cell at the position */
+        cell = &queue->cells[pos & queue->mask];
+        seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        diff = (long)seq - (long)(pos + 1);
+
+        /* If the cell is full for this round, try to claim it */
+        if (!diff) {
+
+            if (atomic_compare_exchange_weak_explicit(&queue->head, &pos,
+                                                      pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+
+                break;
+            }
+        } else if (diff < 0) {
+
+            /* The cell is not filled yet */
+            return NULL;
+        } else {
+
+            /* Another consumer claimed the cell, reload the head */
+            pos = atomic_load_explicit(&queue->head, memory_order_relaxed);
+        }
+    }
+
+    /* Empty the cell, then hand it over to the producers of the next
+     * round */
+    data = cell->data;
+    atomic_store_explicit(&cell->seq, pos + queue->mask + 1,
+                          memory_order_release);
+
+    return data;
+}
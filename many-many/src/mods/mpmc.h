@@ -0,0 +1,53 @@
+#ifndef _MPMC_H_
+#define _MPMC_H_
+
+#include <stddef.h>
+
+/* Size of a cache line, the ends of the queue are kept on their own lines */
+#define MPMC_LINE (64)
+
+/**
+ * Lock-free multi producer multi consumer queue cell
+ */
+typedef struct MpmcCell {
+
+    /* Sequence number of the cell */
+    size_t seq;
+
+    /* Pointer held by the cell */
+    void *data;
+
+} MpmcCell;
+
+/**
+ * Lock-free multi producer multi consumer bounded queue structure
+ *
+ * The cells form a ring. A producer (consumer) claims the position of the
+ * tail (head) with a compare and swap, once the sequence number of the cell
+ * says that the cell is free (full) for that round of the ring. The
+ * sequence number is then advanced to hand the cell over to the consumers
+ * (producers) of the round
+ */
+typedef struct Mpmc {
+
+    /* Pointer to the cells */
+    MpmcCell *cells;
+
+    /* Number of cells less one (a power of two less one) */
+    size_t mask;
+
+    /* Position of the next push (producers) */
+    _Alignas(MPMC_LINE) size_t tail;
+
+    /* Position of the next pop (consumers) */
+    _Alignas(MPMC_LINE) size_t head;
+
+} Mpmc;
+
+void mpmc_init(Mpmc *queue, MpmcCell *cells, size_t size);
+
+int mpmc_push(Mpmc *queue, void *data);
+
+void *mpmc_pop(Mpmc *queue);
+
+#endif
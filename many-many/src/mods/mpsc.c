@@ -0,0 +1,122 @@
+#include <stdatomic.h>
+#include "./mpsc.h"
+
+/**
+ * @brief Initialize the queue
+ *
+ * Points both ends of the queue to the stub member
+ *
+ * @param[out] queue Pointer to the queue instance
+ */
+void mpsc_init(Mpsc *queue) {
+
+    /* Check for errors */
+    assert(queue);
+
+    /* Set both ends to the stub */
+    queue->stub.next = NULL;
+    queue->head = &queue->stub;
+    queue->tail = &queue->stub;
+}
+
+/**
+ * @brief Add node to head
+ *
+ * Swaps the head with the new node, then links the previous head to it. Till
+ * the link is set the consumer sees the queue end at the previous head
+ *
+ * @param[in/out] queue Pointer to the queue instance
+ * @param[in/out] new Pointer to the queue member structure
+ */
+void do_mpsc_push(Mpsc *queue, MpscMember *new) {
+
+    MpscMember *prev;
+
+    /* Set the next of the new node to NULL */
+    atomic_store_explicit(&new->next, NULL, memory_order_relaxed);
+
+    /* Swap the head */
+    prev = atomic_exchange(&queue->head, new);
+
+    /* Link the previous head */
+    atomic_store_explicit(&prev->next, new, memory_order_release);
+}
+
+/**
+ * @brief Delete the tail
+ *
+ * Deletes and returns the oldest node of the queue, skipping the stub
+ *
+ * @param[in/out] queue Pointer to the queue instance
+ * @return Pointer to the tail queue member
+ * @return NULL if the queue is empty, or a push is not complete yet
+ */
+MpscMember *do_mpsc_pop(Mpsc *queue) {
+
+    MpscMember *tail, *next, *head;
+
+    /* Get the tail and its next */
+    tail = queue->tail;
+    next = atomic_load_explicit(&tail->next, memory_order_acquire);
+
+    /* If the tail is the stub, skip it */
+    if (tail == &queue->stub) {
+
+        /* If the queue is empty */
+        if (!next) {
+
+            return NULL;
+        }
+
+        queue->tail = next;
+        tail = next;
+        next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    }
+
+    /* If the tail is not the last node */
+    if (next) {
+
+        queue->tail = next;
+        return tail;
+    }
+
+    /* If a push is not complete yet */
+    head = atomic_load(&queue->head);
+    if (tail != head) {
+
+        return NULL;
+    }
+
+    /* Push the stub back, so that the last node can be taken */
+    do_mpsc_push(queue, &queue->stub);
+
+    /* If the stub got linked after the tail */
+    next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    if (next) {
+
+        queue->tail = next;
+        return tail;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Is queue empty
+ *
+ * Checks if no node was pushed since the last pop. A node whose push is not
+ * complete yet counts as pushed
+ *
+ * @param[in] queue Pointer to the queue instance
+ * @return 0 if not empty
+ * @return 1 if empty
+ */
+int mpsc_is_empty(Mpsc *queue) {
+
+    /* Check for errors */
+    assert(queue);
+
+    /* Only the stub is left if the head is the tail stub */
+    return ((queue->tail == &queue->stub) &&
+            (atomic_load(&queue->head) == &queue->stub));
+}
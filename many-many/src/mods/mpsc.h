@@ -0,0 +1,84 @@
+#ifndef _MPSC_H_
+#define _MPSC_H_
+
+#include <stddef.h>
+#include <assert.h>
+
+/**
+ * Lock-free multi producer single consumer queue member to chain different
+ * structures
+ *
+ * @note Insert this as a structure member which needs to be queued
+ */
+typedef struct MpscMember {
+
+    /* Forward pointer */
+    struct MpscMember *next;
+
+} MpscMember;
+
+/**
+ * Lock-free multi producer single consumer queue structure
+ *
+ * The producers swap the head atomically and link the previous head to the
+ * new member. The consumer takes the members from the tail. A stub member
+ * keeps the queue non empty so that the producers never touch the tail
+ */
+typedef struct Mpsc {
+
+    /* Pointer to the last member pushed (producers) */
+    MpscMember *head;
+
+    /* Pointer to the next member to pop (consumer) */
+    MpscMember *tail;
+
+    /* Stub member */
+    MpscMember stub;
+
+} Mpsc;
+
+/**
+ * Functions used internally
+ *
+ * @note One who feels himself/herself to be worthy shall be the one
+ *       to use these functions directly else use the macros defined below
+ */
+void do_mpsc_push(Mpsc *queue, MpscMember *new);
+
+MpscMember *do_mpsc_pop(Mpsc *queue);
+
+void mpsc_init(Mpsc *queue);
+
+int mpsc_is_empty(Mpsc *queue);
+
+/**
+ * @brief Push a new node to the queue (any thread)
+ *
+ * @param[in] queue Pointer to the queue instance
+ * @param[in] new Pointer to the any structure to be added
+ * @param[in] mem Name of the MpscMember member in the structure type of #new
+ */
+#define mpsc_push(queue, new, mem)                  \
+    {                                               \
+        assert((new));                              \
+                                                    \
+        do_mpsc_push((queue), &(new)->mem);         \
+    }                                               \
+
+/**
+ * @brief Pop a node from the queue (consumer only)
+ *
+ * @param[in] queue Pointer to the queue instance
+ * @param[in] type Type of the structure to be returned
+ * @param[in] mem Name of the MpscMember member in the structure of given type
+ * @return Pointer to the structure containing the tail MpscMember
+ * @return NULL if the queue is empty, or a push is not complete yet
+ */
+#define mpsc_pop(queue, type, mem)                                  \
+    ({                                                              \
+        MpscMember *_mem = do_mpsc_pop((queue));                    \
+                                                                    \
+        _mem ? (type *)((void *)_mem - offsetof(type, mem)) : NULL; \
+    })
+
+#endif
@@ -4,6 +4,7 @@
 #include <sys/time.h>
 #include <sys/resource.h>
 
+#include "./lock.h"
 #include "./stack.h"
 
 /* Page size */
@@ -15,6 +16,26 @@
 /* Stack guard flags */
 #define _STACK_GUARD_PROT_FLAGS (PROT_NONE)
 
+/**
+ * Free stack kept by the stack cache, stored at the base of the stack itself
+ */
+typedef struct StackNode {
+
+    /* Next free stack */
+    struct StackNode *next;
+
+    /* Size of the stack */
+    size_t size;
+
+} StackNode;
+
+/* Free stacks of the stack cache */
+static StackNode *stack_cache;
+/* Number of free stacks */
+static int stack_cache_nb;
+/* Stack cache lock */
+static Lock stack_cache_lk;
+
 /**
  * @brief Get stack limit
  *
@@ -34,18 +55,11 @@ static long _stack_limit(void) {
 }
 
 /**
- * @brief Allocates stack
- *
- * Memory maps a region in virtual address space to be used a stack. Prevents
- * uncontrolled growth of the stack by allocating stack guard equal to page size
- * at the end of the stack
- *
- * @param[out] stack Pointer to the stack instance to be initialized
+ * @brief Memory map a stack
+ * @param[out] stack Pointer to the stack instance to be initialized, its base
+ *             is MAP_FAILED if no memory is left
  */
-void stack_alloc(stack_t *stack) {
-
-    /* Check for errors */
-    assert(stack);
+static void _stack_map(stack_t *stack) {
 
     /* Get the stack limit */
     stack->ss_size = _stack_limit();
@@ -58,7 +72,10 @@ void stack_alloc(stack_t *stack) {
                         -1, 0);
 
     /* Check for errors */
-    assert(stack->ss_sp != MAP_FAILED);
+    if (stack->ss_sp == MAP_FAILED) {
+
+        return;
+    }
 
     /* Set the stack guard */
     mprotect(stack->ss_sp, _PAGE_SIZE, _STACK_GUARD_PROT_FLAGS);
@@ -70,6 +87,93 @@ void stack_alloc(stack_t *stack) {
     stack->ss_flags = 0;
 }
 
+/**
+ * @brief Allocates stack
+ *
+ * Memory maps a region in virtual address space to be used a stack. Prevents
+ * uncontrolled growth of the stack by allocating stack guard equal to page size
+ * at the end of the stack
+ *
+ * @param[out] stack Pointer to the stack instance to be initialized
+ */
+void stack_alloc(stack_t *stack) {
+
+    /* Check for errors */
+    assert(stack);
+
+    /* Memory map the stack */
+    _stack_map(stack);
+
+    /* Check for errors */
+    assert(stack->ss_sp != MAP_FAILED);
+}
+
+/**
+ * @brief Allocates several stacks
+ *
+ * Memory maps one region for all the stacks, each stack keeps its own stack
+ * guard and can be deallocated separately. Falls back to mapping the stacks
+ * one by one if the region cannot be mapped
+ *
+ * @param[out] stacks Pointers to the stack instances to be initialized
+ * @param[in] nb Number of stacks, at most STACK_BATCH
+ * @return Number of stacks allocated, the first ones of #stacks (less than
+ *         #nb if no memory is left)
+ */
+int stack_alloc_many(stack_t *stacks[], int nb) {
+
+    size_t size;
+    void *region;
+
+    /* Check for errors */
+    assert(stacks && (nb > 0) && (nb <= STACK_BATCH));
+
+    /* Get the stack limit */
+    size = _stack_limit();
+
+    /* Memory map the region of the stacks */
+    region = mmap(NULL,
+                  (size + _PAGE_SIZE) * nb,
+                  _STACK_PROT_FLAGS,
+                  _STACK_MAP_FLAGS,
+                  -1, 0);
+
+    /* If the region cannot be mapped */
+    if (region == MAP_FAILED) {
+
+        /* Map the stacks one by one, till no memory is left */
+        for (int i = 0; i < nb; i++) {
+
+            _stack_map(stacks[i]);
+            if (stacks[i]->ss_sp == MAP_FAILED) {
+
+                return i;
+            }
+        }
+
+        return nb;
+    }
+
+    /* For every stack */
+    for (int i = 0; i < nb; i++) {
+
+        /* Set the stack guard */
+        mprotect(region, _PAGE_SIZE, _STACK_GUARD_PROT_FLAGS);
+
+        /* Set the base and size of the stack */
+        stacks[i]->ss_sp = region + _PAGE_SIZE;
+        stacks[i]->ss_size = size;
+
+        /* Set no flags */
+        stacks[i]->ss_flags = 0;
+
+        /* Move to the next stack */
+        region += size + _PAGE_SIZE;
+    }
+
+    return nb;
+}
+
 /**
  * @brief Dellocates the stack
  *
@@ -85,3 +189,180 @@ void stack_free(stack_t *stack) {
     /* Unmap the previously mapped stack region */
     munmap(stack->ss_sp - _PAGE_SIZE, stack->ss_size + _PAGE_SIZE);
 }
+
+/**
+ * @brief Add a free stack to the stack cache
+ * @param[in] stack Pointer to the stack instance
+ * @note The stack cache lock should be held
+ */
+static void _stack_cache_push(stack_t *stack) {
+
+    StackNode *node;
+
+    /* Store the node at the base of the stack */
+    node = stack->ss_sp;
+    node->size = stack->ss_size;
+
+    /* Add the node */
+    node->next = stack_cache;
+    stack_cache = node;
+    stack_cache_nb++;
+}
+
+/**
+ * @brief Initialize the stack cache
+ * @note Should be done by the main thread
+ */
+void stack_cache_init(void) {
+
+    /* The cache is empty */
+    stack_cache = NULL;
+    stack_cache_nb = 0;
+
+    /* Initialize the lock */
+    lock_init(&stack_cache_lk);
+}
+
+/**
+ * @brief Deinitialize the stack cache
+ *
+ * Deallocates all the free stacks of the cache
+ *
+ * @note Should be done by the main thread
+ */
+void stack_cache_deinit(void) {
+
+    StackNode *node;
+    stack_t stack;
+
+    /* While there are free stacks */
+    while (stack_cache) {
+
+        /* Remove the node */
+        node = stack_cache;
+        stack_cache = node->next;
+
+        /* Deallocate the stack */
+        stack.ss_sp = node;
+        stack.ss_size = node->size;
+        stack_free(&stack);
+    }
+
+    /* The cache is empty */
+    stack_cache_nb = 0;
+}
+
+/**
+ * @brief Get a stack from the stack cache
+ *
+ * Takes a free stack from the cache. If the cache is empty, STACK_BATCH
+ * stacks are allocated together and the ones not taken are kept by the
+ * cache
+ *
+ * @param[out] stack Pointer to the stack instance to be initialized
+ * @return 0 on success
+ * @return -1 if no memory is left
+ * @note Should not be interrupted by a thread switch, as the cache is
+ *       protected by a spinlock
+ */
+int stack_cache_get(stack_t *stack) {
+
+    StackNode *node;
+    stack_t stacks[STACK_BATCH];
+    stack_t *ptrs[STACK_BATCH];
+    int nb;
+
+    /* Check for errors */
+    assert(stack);
+
+    /* Acquire the stack cache lock */
+    lock_acquire(&stack_cache_lk);
+
+    /* If there is a free stack */
+    node = stack_cache;
+    if (node) {
+
+        /* Remove the node */
+        stack_cache = node->next;
+        stack_cache_nb--;
+
+        /* Release the stack cache lock */
+        lock_release(&stack_cache_lk);
+
+        /* Set the stack */
+        stack->ss_sp = node;
+        stack->ss_size = node->size;
+        stack->ss_flags = 0;
+
+        return 0;
+    }
+
+    /* Release the stack cache lock */
+    lock_release(&stack_cache_lk);
+
+    /* Allocate a batch of stacks */
+    for (int i = 0; i < STACK_BATCH; i++) {
+
+        ptrs[i] = &stacks[i];
+    }
+    nb = stack_alloc_many(ptrs, STACK_BATCH);
+
+    /* Check for errors */
+    if (!nb) {
+
+        return -1;
+    }
+
+    /* Take the first stack */
+    *stack = stacks[0];
+
+    /* Acquire the stack cache lock */
+    lock_acquire(&stack_cache_lk);
+
+    /* Keep the other stacks */
+    for (int i = 1; i < nb; i++) {
+
+        _stack_cache_push(&stacks[i]);
+    }
+
+    /* Release the stack cache lock */
+    lock_release(&stack_cache_lk);
+
+    return 0;
+}
+
+/**
+ * @brief Put a stack back to the stack cache
+ *
+ * Keeps the stack for reuse, or deallocates it if the cache is full
+ *
+ * @param[in] stack Pointer to the stack instance
+ * @note Should not be interrupted by a thread switch, as the cache is
+ *       protected by a spinlock
+ */
+void stack_cache_put(stack_t *stack) {
+
+    /* Check for errors */
+    assert(stack);
+
+    /* Acquire the stack cache lock */
+    lock_acquire(&stack_cache_lk);
+
+    /* If the cache is not full */
+    if (stack_cache_nb < STACK_CACHE_MAX) {
+
+        /* Keep the stack */
+        _stack_cache_push(stack);
+
+        /* Release the stack cache lock */
+        lock_release(&stack_cache_lk);
+
+        return;
+    }
+
+    /* Release the stack cache lock */
+    lock_release(&stack_cache_lk);
+
+    /* Deallocate the stack */
+    stack_free(stack);
+}
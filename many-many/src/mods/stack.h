@@ -3,8 +3,26 @@
 
 #include <signal.h>
 
+/* Maximum number of stacks mapped together by stack_alloc_many() */
+#define STACK_BATCH (16)
+
+/* Maximum number of free stacks kept by the stack cache */
+#ifndef STACK_CACHE_MAX
+#define STACK_CACHE_MAX (64)
+#endif
+
 void stack_alloc(stack_t *stack);
 
+int stack_alloc_many(stack_t *stacks[], int nb);
+
 void stack_free(stack_t *stack);
 
+void stack_cache_init(void);
+
+void stack_cache_deinit(void);
+
+int stack_cache_get(stack_t *stack);
+
+void stack_cache_put(stack_t *stack);
+
 #endif
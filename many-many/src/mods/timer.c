@@ -3,25 +3,25 @@
 #include "./utils.h"
 #include "./timer.h"
 
-/* Convert milliseconds to nanoseconds */
-#define _MILLISECS_TO_NANOSECS(msec) ((msec) * 1000000)
-/* Get seconds in milliseconds */
-#define _SECS_IN_MILLISECS(msec)     (_MILLISECS_TO_NANOSECS(msec) / 1000000000)
-/* Get remainder nanoseconds in total milliseconds */
-#define _NANOSECS_IN_MILLISECS(msec) (_MILLISECS_TO_NANOSECS(msec) % 1000000000)
+/* Convert microseconds to nanoseconds */
+#define _MICROSECS_TO_NANOSECS(usec) ((usec) * 1000)
+/* Get seconds in microseconds */
+#define _SECS_IN_MICROSECS(usec)     (_MICROSECS_TO_NANOSECS(usec) / 1000000000)
+/* Get remainder nanoseconds in total microseconds */
+#define _NANOSECS_IN_MICROSECS(usec) (_MICROSECS_TO_NANOSECS(usec) % 1000000000)
 
 /**
  * @brief Initialize the timer
  *
  * Sets the required handler to be executed after the given time expires. The
- * time should be specified in milliseconds. The function uses SIGALRM signal
+ * time should be specified in microseconds. The function uses SIGALRM signal
  * and hence should be prevented from use internally
  *
  * @param[out] timer Pointer to the timer instance
  * @param[in] action Signal action after the timeout
- * @param[in] millisecs Timer out expiration period in milliseconds
+ * @param[in] microsecs Timer out expiration period in microseconds
  */
-void timer_set(Timer *timer, struct sigaction action, long millisecs) {
+void timer_set(Timer *timer, struct sigaction action, long microsecs) {
 
     /* Check for errors */
     assert(timer);
@@ -31,8 +31,8 @@ void timer_set(Timer *timer, struct sigaction action, long millisecs) {
     timer->interval.it_interval.tv_sec = 0;
 
     /* Initialize the expiration period of timeout */
-    timer->interval.it_value.tv_nsec = _NANOSECS_IN_MILLISECS(millisecs);
-    timer->interval.it_value.tv_sec = _SECS_IN_MILLISECS(millisecs);
+    timer->interval.it_value.tv_nsec = _NANOSECS_IN_MICROSECS(microsecs);
+    timer->interval.it_value.tv_sec = _SECS_IN_MICROSECS(microsecs);
 
     /* Initialize the signal event */
     timer->event.sigev_notify = SIGEV_THREAD_ID;
@@ -83,3 +83,24 @@ void timer_stop(Timer *timer) {
     /* timer_delete(timer->timerid); */
     syscall(SYS_timer_delete, timer->timerid);
 }
+
+/**
+ * @brief Pause the timer
+ *
+ * Disarms a previously started timer without deallocating it, hence the
+ * timer should still be stopped using timer_stop(). May be used from a user
+ * thread, as it does not set the errno of glibc
+ *
+ * @param[in] timer Pointer to the timer instance
+ */
+void timer_pause(Timer *timer) {
+
+    struct itimerspec disarm = {{0, 0}, {0, 0}};
+
+    /* Check for errors */
+    assert(timer);
+
+    /* Disarm the timer */
+    raw_syscall(SYS_timer_settime, (long)timer->timerid, 0, (long)&disarm,
+                0, 0, 0);
+}
@@ -20,10 +20,12 @@ typedef struct Timer {
 
 } Timer;
 
-void timer_set(Timer *timer, struct sigaction action, long millisecs);
+void timer_set(Timer *timer, struct sigaction action, long microsecs);
 
 void timer_start(Timer *timer);
 
 void timer_stop(Timer *timer);
 
+void timer_pause(Timer *timer);
+
 #endif
@@ -0,0 +1,326 @@
+#define _GNU_SOURCE
+#include <assert.h>
+#include <dlfcn.h>
+#include <link.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/rseq.h>
+
+#include "./utils.h"
+#include "./tls.h"
+
+/* Minimum alignment of the thread control blocks */
+#define _TLS_MIN_ALIGN (64ul)
+/* Dynamic thread vector value of a block the C library allocates on first
+ * use */
+#define _TLS_DTV_UNALLOCATED ((void *)-1l)
+/* Offset of a module whose block is not static */
+#define _TLS_NOT_STATIC ((size_t)-1)
+
+/**
+ * Entry of a dynamic thread vector, laid out as the one of the C library. The
+ * entry before the vector holds its capacity and the first entry its
+ * generation, the others point to the blocks of the modules (by module id)
+ */
+typedef union TlsDtv {
+
+    /* Capacity or generation */
+    size_t counter;
+
+    struct {
+
+        /* Block of the module */
+        void *val;
+
+        /* Memory to free with the vector (blocks allocated on first use) */
+        void *to_free;
+
+    } pointer;
+
+} TlsDtv;
+
+/* Size of the static Thread-Local-Storage below a thread control block */
+static size_t tls_size;
+/* Alignment of the thread control blocks */
+static size_t tls_align;
+/* Initial contents of the static Thread-Local-Storage */
+static char *tls_image;
+/* Header of the thread control block of the main thread */
+static TlsHeader tls_header;
+/* Offsets of the static blocks below a thread control block, by module id
+ * (0 for an unused id, _TLS_NOT_STATIC for a block allocated on first use) */
+static size_t *tls_offsets;
+/* Capacity of the dynamic thread vectors */
+static size_t tls_dtv_size;
+/* Generation of the dynamic thread vectors */
+static size_t tls_dtv_gen;
+/* Offset of the thread id in the thread descriptor of the C library (0 if
+ * unknown) */
+static size_t tls_tid_offset;
+/* Number of thread control blocks allocated */
+static int tls_nb;
+
+/**
+ * @brief Note the static Thread-Local-Storage block of a module
+ *
+ * Grows the size and the alignment of the static Thread-Local-Storage to
+ * cover the block, and copies its initialization image once the image is
+ * allocated. The block of a module lies at a fixed offset below the FS
+ * register value of every kernel thread. The blocks the C library allocated
+ * on first use (modules loaded at run time) are left to the C library
+ *
+ * @param[in] info Module information
+ * @param[in] size Size of the module information
+ * @param[in] fs FS register value of the calling kernel thread
+ * @return 0 to go on with the next module
+ */
+static int _tls_module(struct dl_phdr_info *info, size_t size, void *fs) {
+
+    const ElfW(Phdr) *phdr;
+    size_t offset;
+    size_t modid;
+
+    /* For every program header of the module */
+    for (int i = 0; i < info->dlpi_phnum; i++) {
+
+        phdr = &info->dlpi_phdr[i];
+
+        /* If it is not a static Thread-Local-Storage block */
+        modid = info->dlpi_tls_modid;
+        if ((phdr->p_type != PT_TLS) || !info->dlpi_tls_data ||
+            (modid > tls_dtv_size) ||
+            (tls_offsets[modid] == _TLS_NOT_STATIC)) {
+
+            continue;
+        }
+
+        /* Get the offset of the block below the thread control block */
+        offset = fs - info->dlpi_tls_data;
+        tls_offsets[modid] = offset;
+
+        /* If the image is not allocated yet, note the size and alignment */
+        if (!tls_image) {
+
+            if (offset > tls_size) {
+
+                tls_size = offset;
+            }
+            if (phdr->p_align > tls_align) {
+
+                tls_align = phdr->p_align;
+            }
+        } else {
+
+            /* Else copy the initialized part (the rest stays zero) */
+            memcpy(tls_image + tls_size - offset,
+                   (void *)(info->dlpi_addr + phdr->p_vaddr),
+                   phdr->p_filesz);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Initialize the Thread-Local-Storage areas
+ *
+ * Gets the layout of the static Thread-Local-Storage of the process and the
+ * initial contents of the blocks of its modules, so that the areas allocated
+ * later can be pointed to by the FS register like the one of a kernel thread.
+ * The size of the thread descriptor of the C library and the offset of its
+ * thread id are taken from the symbols it exports to the debuggers, when it
+ * does
+ *
+ * @note Should be done by the main thread
+ */
+void tls_init(void) {
+
+    void *fs = get_fs();
+    TlsDtv *dtv = ((TlsHeader *)fs)->dtv;
+    unsigned int *desc;
+
+    /* Check that the header covers the thread descriptor of the C library */
+    desc = dlsym(RTLD_DEFAULT, "_thread_db_sizeof_pthread");
+    assert(!desc || (*desc <= sizeof(TlsHeader)));
+
+    /* Get the offset of the thread id (size, count and offset) */
+    desc = dlsym(RTLD_DEFAULT, "_thread_db_pthread_tid");
+    tls_tid_offset = desc ? desc[2] : 0;
+
+    /* Get the capacity and the generation of the dynamic thread vector */
+    tls_dtv_size = dtv[-1].counter;
+    tls_dtv_gen = dtv[0].counter;
+
+    /* Note the modules which have a block, as not static till their static
+     * block is found */
+    tls_offsets = calloc(tls_dtv_size + 1, sizeof(size_t));
+    /* Check for errors */
+    assert(tls_offsets);
+    for (size_t i = 1; i <= tls_dtv_size; i++) {
+
+        if (dtv[i].pointer.val && !dtv[i].pointer.to_free) {
+
+            /* A static block, its offset is set below */
+            continue;
+        }
+        if (dtv[i].pointer.val) {
+
+            tls_offsets[i] = _TLS_NOT_STATIC;
+        }
+    }
+
+    /* Get the size and the alignment */
+    tls_size = 0;
+    tls_align = _TLS_MIN_ALIGN;
+    tls_image = NULL;
+    dl_iterate_phdr(_tls_module, fs);
+
+    /* Keep the thread control blocks aligned */
+    tls_size = (tls_size + tls_align - 1) & ~(tls_align - 1);
+
+    /* Allocate the image */
+    tls_image = calloc(1, tls_size ? tls_size : 1);
+    /* Check for errors */
+    assert(tls_image);
+
+    /* Copy the initial contents */
+    dl_iterate_phdr(_tls_module, fs);
+
+    /* Copy the fields of the header the other thread control blocks share
+     * (the guards) */
+    memcpy(&tls_header, fs, offsetof(TlsHeader, rest));
+    tls_nb = 0;
+}
+
+/**
+ * @brief Deinitialize the Thread-Local-Storage areas
+ */
+void tls_deinit(void) {
+
+    /* Free the image and the offsets */
+    free(tls_image);
+    tls_image = NULL;
+    free(tls_offsets);
+    tls_offsets = NULL;
+}
+
+/**
+ * @brief Allocate a thread control block
+ *
+ * Allocates the block with a static Thread-Local-Storage area below it, set
+ * to the initial contents, and sets the header of the block. The block gets
+ * its own dynamic thread vector, whose static entries point to its own area
+ * and whose other entries are allocated by the C library on first use, and
+ * its own thread id, which the C library compares to find the owner of a
+ * recursive lock
+ *
+ * @param[in] size Size of the thread control block (with its header)
+ * @return Pointer to the thread control block
+ * @return NULL if no memory is left
+ */
+void *tls_alloc(size_t size) {
+
+    char *area;
+    TlsHeader *header;
+    TlsDtv *dtv;
+    struct rseq *rseq;
+
+    /* Check for errors */
+    assert(size >= sizeof(TlsHeader));
+
+    /* Allocate the area and the block, keeping the block aligned */
+    size = (tls_size + size + tls_align - 1) & ~(tls_align - 1);
+    area = aligned_alloc(tls_align, size);
+    /* Check for errors */
+    if (!area) {
+
+        return NULL;
+    }
+
+    /* Allocate the dynamic thread vector with the allocator of the C
+     * library, which resizes it when modules are loaded */
+    dtv = calloc(tls_dtv_size + 2, sizeof(TlsDtv));
+    /* Check for errors */
+    if (!dtv) {
+
+        free(area);
+        return NULL;
+    }
+
+    /* Set the initial contents */
+    memcpy(area, tls_image, tls_size);
+
+    /* Set the header, the rest of the thread descriptor of the C library is
+     * zeroed */
+    header = (TlsHeader *)(area + tls_size);
+    memset(header, 0, sizeof(TlsHeader));
+    memcpy(header, &tls_header, offsetof(TlsHeader, rest));
+    header->tcb = header;
+    header->self = header;
+    header->multiple_threads = 1;
+    header->gscope_flag = 0;
+
+    /* Set the dynamic thread vector */
+    dtv[0].counter = tls_dtv_size;
+    dtv++;
+    dtv[0].counter = tls_dtv_gen;
+    for (size_t i = 1; i <= tls_dtv_size; i++) {
+
+        if (tls_offsets[i] == _TLS_NOT_STATIC) {
+
+            dtv[i].pointer.val = _TLS_DTV_UNALLOCATED;
+        } else if (tls_offsets[i]) {
+
+            dtv[i].pointer.val = (char *)header - tls_offsets[i];
+        }
+    }
+    header->dtv = dtv;
+
+    /* Set a thread id of its own (negative, so that it is not the id of a
+     * kernel thread) */
+    if (tls_tid_offset) {
+
+        *(int *)((char *)header + tls_tid_offset) =
+            -1 - atomic_fetch_add(&tls_nb, 1);
+    }
+
+    /* Have the C library get the CPU number with a system call, as the
+     * kernel updates the restartable sequence area of the kernel threads
+     * only */
+    if (__rseq_size && (__rseq_offset >= offsetof(TlsHeader, rest)) &&
+        (__rseq_offset + sizeof(struct rseq) <= sizeof(TlsHeader))) {
+
+        rseq = (struct rseq *)((char *)header + __rseq_offset);
+        rseq->cpu_id = RSEQ_CPU_ID_UNINITIALIZED;
+    }
+
+    return header;
+}
+
+/**
+ * @brief Free a thread control block
+ * @param[in] tcb Pointer to the thread control block
+ */
+void tls_free(void *tcb) {
+
+    TlsDtv *dtv;
+
+    /* Check for errors */
+    if (!tcb) {
+
+        return;
+    }
+
+    /* Free the blocks the C library allocated on first use, and the dynamic
+     * thread vector (which it may have resized) */
+    dtv = ((TlsHeader *)tcb)->dtv;
+    for (size_t i = 1; i <= dtv[-1].counter; i++) {
+
+        free(dtv[i].pointer.to_free);
+    }
+    free(dtv - 1);
+
+    /* Free the area with the block */
+    free((char *)tcb - tls_size);
+}
@@ -0,0 +1,61 @@
+#ifndef _TLS_H_
+#define _TLS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Size of the header of a thread control block, at least the size of the
+ * thread descriptor of the C library (checked by tls_init()) */
+#ifndef TLS_HEADER_SIZE
+#define TLS_HEADER_SIZE (2560)
+#endif
+
+/**
+ * Header of a thread control block, laid out as the one of the C library
+ * which reaches it through the FS register. The rest of the thread
+ * descriptor of the C library follows the fields the library sets, zeroed
+ * but for the thread id and the restartable sequence area (see tls_alloc())
+ *
+ * @note Insert this as the first member of the thread control block
+ */
+typedef struct TlsHeader {
+
+    /* Pointer to the thread control block itself */
+    void *tcb;
+
+    /* Dynamic thread vector */
+    void *dtv;
+
+    /* Pointer to the thread control block itself */
+    void *self;
+
+    /* Multiple threads flag */
+    int multiple_threads;
+
+    /* Global scope flag of the dynamic linker */
+    int gscope_flag;
+
+    /* System call entry */
+    uintptr_t sysinfo;
+
+    /* Stack protector canary */
+    uintptr_t stack_guard;
+
+    /* Pointer guard */
+    uintptr_t pointer_guard;
+
+    /* Rest of the thread descriptor of the C library */
+    char rest[TLS_HEADER_SIZE - 3 * sizeof(void *) - 2 * sizeof(int) -
+              3 * sizeof(uintptr_t)];
+
+} TlsHeader;
+
+void tls_init(void);
+
+void tls_deinit(void);
+
+void *tls_alloc(size_t size);
+
+void tls_free(void *tcb);
+
+#endif
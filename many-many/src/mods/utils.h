@@ -11,6 +11,9 @@
 #include <sys/prctl.h>
 #include <linux/futex.h>
 #include <sys/time.h>
+#include <time.h>
+#include <signal.h>
+#include <pthread.h>
 
 /* Get thread id function declaration to prevent warning */
 pid_t gettid(void);
@@ -35,20 +38,83 @@ static inline int atomic_cas(int *addr, int old_val, int new_val) {
     return atomic_compare_exchange_strong(addr, &old_val, new_val);
 }
 
+/**
+ * @brief Raw system call
+ *
+ * Traps into the kernel directly rather than using the glibc wrapper, which
+ * stores the error number in errno. The library reports its errors through
+ * thread_errno, hence its own system calls use this routine so that they do
+ * not clobber the errno of the user thread they are made for
+ *
+ * @param[in] nr System call number
+ * @param[in] a1 - a6 System call arguments
+ * @return Result of the system call or negated errno
+ */
+static inline long raw_syscall(long nr, long a1, long a2, long a3,
+                               long a4, long a5, long a6) {
+
+    long ret;
+
+    /* Bind the fourth to sixth arguments to their registers */
+    register long r10 __asm__ ("r10") = a4;
+    register long r8 __asm__ ("r8") = a5;
+    register long r9 __asm__ ("r9") = a6;
+
+    /* Trap into the kernel */
+    __asm__ volatile ("syscall"
+                      : "=a" (ret)
+                      : "0" (nr), "D" (a1), "S" (a2), "d" (a3),
+                        "r" (r10), "r" (r8), "r" (r9)
+                      : "rcx", "r11", "memory");
+
+    return ret;
+}
+
+/**
+ * @brief Create a kernel thread running on the given stack
+ *
+ * The kernel thread is created by the C library, which sets up its thread
+ * control block at the top of the stack, and which knows from then on that
+ * the process runs several kernel threads (it takes the locks of malloc()
+ * and the like)
+ *
+ * @param[out] kthread Pointer to the kernel thread handle
+ * @param[in] func Function run by the kernel thread
+ * @param[in] arg Argument of the function
+ * @param[in] stack Pointer to the stack instance
+ * @return 0 or errno
+ */
+static inline int kthread_create(pthread_t *kthread, void *(*func)(void *),
+                                 void *arg, stack_t *stack) {
+
+    pthread_attr_t attr;
+    int ret;
+
+    /* Set the stack of the kernel thread */
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, stack->ss_sp, stack->ss_size);
+
+    /* Create the kernel thread */
+    ret = pthread_create(kthread, &attr, func, arg);
+    pthread_attr_destroy(&attr);
+
+    return ret;
+}
+
 /**
  * @brief Futex syscall
  * @param[in] uaddr Pointer to the futex word
  * @param[in] futex_op Operation to be performed
  * @param[in] val Expected value of the futex word
- * @return 0 or errno
+ * @return 0 or negated errno
  */
 static inline int futex(int *uaddr, int futex_op, int val) {
 
     /* Check for errors */
     assert(uaddr);
 
-    /* Use the system call wrapper around the futex system call */
-    return syscall(SYS_futex, uaddr, futex_op, val, NULL, NULL, 0);
+    /* Use the raw system call, as it may fail in a user thread */
+    return raw_syscall(SYS_futex, (long)uaddr, futex_op, val, 0, 0, 0);
 }
 
 /**
@@ -75,6 +141,21 @@ static inline void *get_fs(void) {
     return (void *)addr;
 }
 
+/**
+ * @brief Read a clock
+ * @param[in] clk Clock identifier
+ * @return Value of the clock in nanoseconds
+ */
+static inline unsigned long clock_ns(clockid_t clk) {
+
+    struct timespec ts;
+
+    /* Get the clock value */
+    clock_gettime(clk, &ts);
+
+    return ts.tv_sec * 1000000000ul + ts.tv_nsec;
+}
+
 /**
  * @brief Macro to allocate a single structure of given type
  * @param[in] type Type of the structure
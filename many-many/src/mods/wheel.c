@@ -0,0 +1,158 @@
+#include "./wheel.h"
+
+/**
+ * @brief Get the slot of a member
+ *
+ * Picks the lowest level spanning the time left to the member, and the slot
+ * of the level covering its expiry
+ *
+ * @param[in] wheel Pointer to the wheel instance
+ * @param[in] expiry Expiry tick of the member
+ * @return Pointer to the slot
+ */
+static List *_wheel_slot(Wheel *wheel, unsigned long expiry) {
+
+    unsigned long delta;
+    int level;
+
+    /* If the member has already expired, it expires at the next tick */
+    if ((long)(expiry - wheel->now) < 0) {
+
+        expiry = wheel->now;
+    }
+
+    /* If the member expires beyond the wheel, place it at the farthest tick,
+     * it is placed again once the wheel reaches it */
+    delta = expiry - wheel->now;
+    if (delta > WHEEL_SPAN) {
+
+        delta = WHEEL_SPAN;
+        expiry = wheel->now + delta;
+    }
+
+    /* Get the level spanning the time left */
+    for (level = 0; delta >> (WHEEL_BITS * (level + 1)); level++);
+
+    return &wheel->slots[level][(expiry >> (WHEEL_BITS * level)) & WHEEL_MASK];
+}
+
+/**
+ * @brief Cascade a slot to the lower levels
+ *
+ * @param[in/out] wheel Pointer to the wheel instance
+ * @param[in] level Level of the slot
+ * @return Index of the slot
+ */
+static int _wheel_cascade(Wheel *wheel, int level) {
+
+    WheelMember *mem;
+    List *slot;
+    int index;
+
+    /* Get the slot the wheel reached */
+    index = (wheel->now >> (WHEEL_BITS * level)) & WHEEL_MASK;
+    slot = &wheel->slots[level][index];
+
+    /* While there are members */
+    while (!list_is_empty(slot)) {
+
+        /* Place the member again */
+        mem = list_dequeue(slot, WheelMember, ll_mem);
+        mem->slot = _wheel_slot(wheel, mem->expiry);
+        list_enqueue(mem->slot, mem, ll_mem);
+    }
+
+    return index;
+}
+
+/**
+ * @brief Add a member to the wheel
+ *
+ * @param[in/out] wheel Pointer to the wheel instance
+ * @param[in/out] new Pointer to the wheel member structure
+ */
+void do_wheel_insert(Wheel *wheel, WheelMember *new) {
+
+    /* Place the member */
+    new->slot = _wheel_slot(wheel, new->expiry);
+    list_enqueue(new->slot, new, ll_mem);
+
+    /* Count the member */
+    wheel->count++;
+}
+
+/**
+ * @brief Remove a member from the wheel
+ *
+ * Does nothing if the member has expired already
+ *
+ * @param[in/out] wheel Pointer to the wheel instance
+ * @param[in/out] mem Pointer to the wheel member structure
+ */
+void do_wheel_remove(Wheel *wheel, WheelMember *mem) {
+
+    /* If the member is not in a slot */
+    if (!mem->slot) {
+
+        return;
+    }
+
+    /* Unlink the member */
+    list_remove(mem->slot, mem, ll_mem);
+    mem->slot = NULL;
+
+    /* Uncount the member */
+    wheel->count--;
+}
+
+/**
+ * @brief Advance the wheel up to a tick
+ *
+ * Processes every tick up to the given one, cascading the slots of the
+ * higher levels reached and moving the members of the slots of the lowest
+ * level reached to the expired list
+ *
+ * @param[in/out] wheel Pointer to the wheel instance
+ * @param[in] tick Tick to be reached
+ * @param[out] expired Pointer to the list of expired members
+ */
+void do_wheel_advance(Wheel *wheel, unsigned long tick, List *expired) {
+
+    WheelMember *mem;
+    List *slot;
+    int index, level;
+
+    /* While the tick is not reached */
+    while ((long)(tick - wheel->now) >= 0) {
+
+        /* If the wheel is empty, skip the ticks */
+        if (!wheel->count) {
+
+            wheel->now = tick + 1;
+            break;
+        }
+
+        /* Get the slot of the lowest level */
+        index = wheel->now & WHEEL_MASK;
+
+        /* If the lowest level wrapped, cascade the higher levels as long as
+         * they wrap too */
+        for (level = 1; !index && (level < WHEEL_LEVELS); level++) {
+
+            index = _wheel_cascade(wheel, level);
+        }
+
+        /* Move the members of the slot to the expired list */
+        slot = &wheel->slots[0][wheel->now & WHEEL_MASK];
+        while (!list_is_empty(slot)) {
+
+            mem = list_dequeue(slot, WheelMember, ll_mem);
+            mem->slot = NULL;
+            list_enqueue(expired, mem, ll_mem);
+            wheel->count--;
+        }
+
+        /* Next tick */
+        wheel->now++;
+    }
+}
@@ -0,0 +1,185 @@
+#ifndef _WHEEL_H_
+#define _WHEEL_H_
+
+#include <stddef.h>
+#include <assert.h>
+
+#include "./list.h"
+
+/* Number of levels of the wheel */
+#define WHEEL_LEVELS (4)
+/* Number of bits of the tick indexing the slots of a level */
+#define WHEEL_BITS   (6)
+/* Number of slots per level */
+#define WHEEL_SLOTS  (1 << WHEEL_BITS)
+/* Mask of the slot index */
+#define WHEEL_MASK   (WHEEL_SLOTS - 1)
+/* Largest number of ticks the wheel spans (later expiries are cascaded
+ * again once reached) */
+#define WHEEL_SPAN   ((1ul << (WHEEL_BITS * WHEEL_LEVELS)) - 1)
+
+/**
+ * Hierarchical timer wheel member to time different structures
+ *
+ * @note Insert this as a structure member which needs to expire at a tick
+ */
+typedef struct WheelMember {
+
+    /* Expiry tick */
+    unsigned long expiry;
+
+    /* Slot holding the member (NULL if none) */
+    List *slot;
+
+    /* Slot links */
+    ListMember ll_mem;
+
+} WheelMember;
+
+/**
+ * Hierarchical timer wheel structure
+ *
+ * Level l holds the members expiring within 64^(l + 1) ticks, in slots of
+ * 64^l ticks. A slot of level l is cascaded to the lower levels when the
+ * wheel reaches it, so that adding, removing and expiring a member is O(1)
+ * per tick
+ */
+typedef struct Wheel {
+
+    /* Next tick to be processed */
+    unsigned long now;
+
+    /* Number of members */
+    unsigned long count;
+
+    /* Slots of every level */
+    List slots[WHEEL_LEVELS][WHEEL_SLOTS];
+
+} Wheel;
+
+/**
+ * Functions used internally
+ *
+ * @note One who feels himself/herself to be worthy shall be the one
+ *       to use these functions directly else use the macros defined below
+ */
+void do_wheel_insert(Wheel *wheel, WheelMember *new);
+
+void do_wheel_remove(Wheel *wheel, WheelMember *mem);
+
+void do_wheel_advance(Wheel *wheel, unsigned long tick, List *expired);
+
+/**
+ * @brief Insert a new node to the wheel
+ *
+ * @param[in] wheel Pointer to the wheel instance
+ * @param[in] new Pointer to the any structure to be added
+ * @param[in] mem Name of the WheelMember member in the structure type of #new
+ * @param[in] exp Expiry tick of the new node
+ */
+#define wheel_insert(wheel, new, mem, exp)          \
+    {                                               \
+        assert((new));                              \
+                                                    \
+        (new)->mem.expiry = (exp);                  \
+                                                    \
+        do_wheel_insert((wheel), &(new)->mem);      \
+    }                                               \
+
+/**
+ * @brief Remove a node from the wheel, if it has not expired
+ *
+ * @param[in] wheel Pointer to the wheel instance
+ * @param[in] node Pointer to the structure to be removed
+ * @param[in] mem Name of the WheelMember member in the structure type of #node
+ */
+#define wheel_remove(wheel, node, mem)              \
+    {                                               \
+        assert((node));                             \
+                                                    \
+        do_wheel_remove((wheel), &(node)->mem);     \
+    }                                               \
+
+/**
+ * @brief Advance the wheel up to a tick
+ *
+ * Moves the nodes expiring up to the tick (included) to the list
+ *
+ * @param[in] wheel Pointer to the wheel instance
+ * @param[in] tick Tick to be reached
+ * @param[out] expired Pointer to the list of expired nodes
+ */
+#define wheel_advance(wheel, tick, expired)             \
+    (do_wheel_advance((wheel), (tick), (expired)))
+
+/**
+ * @brief Dequeue a node from the list of expired nodes
+ *
+ * @param[in] expired Pointer to the list of expired nodes
+ * @param[in] type Type of the structure to be returned
+ * @param[in] mem Name of the WheelMember member in the structure of given type
+ * @return Pointer to the structure containing the head WheelMember
+ */
+#define wheel_dequeue(expired, type, mem)                           \
+    ({                                                              \
+        WheelMember *_wmem;                                         \
+                                                                    \
+        _wmem = list_dequeue((expired), WheelMember, ll_mem);       \
+                                                                    \
+        (type *)((void *)_wmem - offsetof(type, mem));              \
+    })
+
+/**
+ * @brief Enqueue a node to a list of expired nodes
+ *
+ * @param[in] expired Pointer to the list of expired nodes
+ * @param[in] node Pointer to the structure to be added
+ * @param[in] mem Name of the WheelMember member in the structure type of #node
+ */
+#define wheel_enqueue(expired, node, mem)               \
+    list_enqueue((expired), &(node)->mem, ll_mem)
+
+/**
+ * @brief Initializes the wheel
+ *
+ * Empties the slots and sets the next tick to be processed
+ *
+ * @param[out] wheel Pointer to the wheel instance
+ * @param[in] tick Current tick
+ */
+static inline void wheel_init(Wheel *wheel, unsigned long tick) {
+
+    /* Check for errors */
+    assert(wheel);
+
+    /* Set the next tick */
+    wheel->now = tick;
+    wheel->count = 0;
+
+    /* Empty the slots */
+    for (int l = 0; l < WHEEL_LEVELS; l++) {
+
+        for (int s = 0; s < WHEEL_SLOTS; s++) {
+
+            list_init(&wheel->slots[l][s]);
+        }
+    }
+}
+
+/**
+ * @brief Is wheel empty
+ *
+ * @param[in] wheel Pointer to the wheel instance
+ * @return 0 if not empty
+ * @return 1 if empty
+ */
+static inline int wheel_is_empty(Wheel *wheel) {
+
+    /* Check for errors */
+    assert(wheel);
+
+    /* Check the number of members */
+    return !wheel->count;
+}
+
+#endif
@@ -2,7 +2,10 @@
 #define _THREAD_H_
 
 #include <errno.h>
+#include <sched.h>
 #include <signal.h>
+#include <sys/types.h>
+#include <sys/socket.h>
 
 /**
  * Required enumerations
@@ -16,12 +19,37 @@ enum {
     THREAD_SUCCESS
 };                              /* Thread return status */
 
+enum {
+
+    /* Lowest scheduling priority */
+    THREAD_PRIO_MIN = 0,
+
+    /* Default scheduling priority */
+    THREAD_PRIO_DEFAULT = 16,
+
+    /* Highest scheduling priority */
+    THREAD_PRIO_MAX = 31
+};                              /* Thread scheduling priority */
+
+enum {
+
+    /* Strict priority, FIFO within a priority */
+    THREAD_SCHED_PRIO,
+
+    /* Fair share of CPU time weighted by priority */
+    THREAD_SCHED_FAIR
+};                              /* Thread scheduling policy */
+
 /**
  * Required structures
  */
 struct Thread;
 struct ThreadSpinLock;
 struct ThreadMutex;
+struct ThreadTaskGroup;
+struct ThreadFuture;
+struct ThreadGraph;
+struct ThreadCoro;
 
 /**
  * Required typedefs
@@ -29,9 +57,32 @@ struct ThreadMutex;
 typedef struct Thread *Thread;
 typedef struct ThreadSpinLock *ThreadSpinLock;
 typedef struct ThreadMutex *ThreadMutex;
+typedef struct ThreadTaskGroup *ThreadTaskGroup;
+typedef struct ThreadFuture *ThreadFuture;
+typedef struct ThreadGraph *ThreadGraph;
+typedef struct ThreadCoro *ThreadCoro;
 typedef int ThreadOnce;
 typedef void *ptr_t;
 typedef void *(*thread_start_t)(void *);
+typedef void (*thread_task_t)(void *);
+typedef void (*thread_range_t)(long, long, void *);
+typedef void *(*thread_map_t)(long, long, void *);
+typedef void *(*thread_combine_t)(void *, void *, void *);
+typedef void *(*thread_cont_t)(void *, void *);
+typedef void (*thread_coro_t)(ThreadCoro, void *);
+
+/**
+ * Message sent to a thread
+ *
+ * @note Insert this as a member of the structure sent, the structure stays
+ *       owned by the sender till it is received
+ */
+typedef struct ThreadMsg {
+
+    /* Mailbox link (used by the library) */
+    struct ThreadMsg *next;
+
+} ThreadMsg;
 
 /**
  * Get the location of the error variable
@@ -43,19 +94,88 @@ int *__get_thread_errno_loc(void);
  */
 #define thread_errno (*__get_thread_errno_loc())
 #define THREAD_ONCE_INIT (-1)
+#define THREAD_SLICE_ADAPTIVE (0ul)
 
 /**
  * Thread control routines
  */
 int thread_create(Thread *thread, thread_start_t start, ptr_t arg);
+int thread_create_many(Thread *thread, size_t nb, thread_start_t start,
+                       ptr_t *args);
 int thread_join(Thread thread, ptr_t *ret);
+int thread_join_timed(Thread thread, ptr_t *ret, unsigned long timeout_ns);
 void thread_exit(ptr_t ret);
 Thread thread_self(void);
 int thread_yield(void);
 int thread_equal(Thread thread1, Thread thread2);
 int thread_once(ThreadOnce *once_control, void (*init_routine)(void));
+int thread_setpriority(Thread thread, int prio);
+int thread_getpriority(Thread thread, int *prio);
+int thread_setschedpolicy(int policy);
+int thread_getschedpolicy(int *policy);
+int thread_setpreemption(int enabled);
+int thread_getpreemption(int *enabled);
+int thread_set_timeslice(Thread thread, unsigned long slice_us);
+int thread_get_timeslice(Thread thread, unsigned long *slice_us);
+int thread_set_deadline(Thread thread, unsigned long relative_ns,
+                        unsigned long budget_ns);
+int thread_get_deadline_misses(Thread thread, unsigned long *misses);
+int thread_setconcurrency(int new_level);
+int thread_getconcurrency(void);
+int thread_block_enter(void);
+int thread_block_exit(void);
+int thread_sleep_ns(unsigned long ns);
+int thread_offload(thread_start_t func, ptr_t arg, ptr_t *ret);
 ptr_t thread_main(ptr_t arg);
 
+/**
+ * Thread task routines
+ */
+int thread_task_group_init(ThreadTaskGroup *group);
+int thread_task_spawn(ThreadTaskGroup *group, thread_task_t task, ptr_t arg);
+int thread_task_wait(ThreadTaskGroup *group);
+int thread_task_group_destroy(ThreadTaskGroup *group);
+int thread_parallel_for(long begin, long end, long grain, thread_range_t body,
+                        ptr_t ctx);
+int thread_parallel_reduce(long begin, long end, long grain, thread_map_t map,
+                           thread_combine_t combine, ptr_t ctx, ptr_t *ret);
+
+/**
+ * Thread future routines
+ */
+int thread_future_init(ThreadFuture *future);
+int thread_future_set(ThreadFuture *future, ptr_t value);
+int thread_future_get(ThreadFuture *future, ptr_t *value);
+int thread_future_then(ThreadFuture *future, thread_cont_t cont, ptr_t arg,
+                       ThreadFuture *next);
+int thread_future_when_all(ThreadFuture *futures, int nb, ThreadFuture *all);
+int thread_future_when_any(ThreadFuture *futures, int nb, ThreadFuture *any);
+int thread_future_destroy(ThreadFuture *future);
+
+/**
+ * Thread task graph routines
+ */
+int thread_graph_init(ThreadGraph *graph);
+int thread_graph_node(ThreadGraph *graph, thread_task_t func, ptr_t arg,
+                      int *node);
+int thread_graph_edge(ThreadGraph *graph, int from, int to);
+int thread_graph_run(ThreadGraph *graph);
+int thread_graph_destroy(ThreadGraph *graph);
+
+/**
+ * Thread coroutine routines
+ */
+int thread_coro_create(ThreadCoro *coro, thread_coro_t func, ptr_t arg);
+int thread_coro_resume(ThreadCoro coro, ptr_t *value);
+int thread_coro_yield_value(ThreadCoro coro, ptr_t value);
+int thread_coro_destroy(ThreadCoro *coro);
+
+/**
+ * Thread message routines
+ */
+int thread_send(Thread thread, ThreadMsg *msg);
+int thread_recv(ThreadMsg **msg);
+
 /**
  * Thread synchronization routines
  */
@@ -66,10 +186,27 @@ int thread_spin_unlock(ThreadSpinLock *spinlock);
 int thread_spin_destroy(ThreadSpinLock *spinlock);
 int thread_mutex_init(ThreadMutex *mutex);
 int thread_mutex_lock(ThreadMutex *mutex);
+int thread_mutex_timedlock(ThreadMutex *mutex, unsigned long timeout_ns);
 int thread_mutex_trylock(ThreadMutex *mutex);
 int thread_mutex_unlock(ThreadMutex *mutex);
 int thread_mutex_destroy(ThreadMutex *mutex);
 
+/**
+ * Thread I/O routines
+ */
+ssize_t thread_read(int fd, void *buf, size_t count);
+ssize_t thread_write(int fd, const void *buf, size_t count);
+int thread_accept(int sockfd, struct sockaddr *addr, socklen_t *addrlen);
+int thread_connect(int sockfd, const struct sockaddr *addr,
+                   socklen_t addrlen);
+
+/**
+ * Thread CPU affinity routines (cpu_set_t requires _GNU_SOURCE)
+ */
+#ifdef __USE_GNU
+int thread_setaffinity(Thread thread, size_t setsize, const cpu_set_t *set);
+#endif
+
 /**
  * Thread signal handling routines
  */
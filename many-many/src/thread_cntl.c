@@ -1,58 +1,30 @@
+#include <limits.h>
+
 #include "./mods/lock.h"
 #include "./mods/utils.h"
 #include "./mmrll.h"
+#include "./mmoffload.h"
+#include "./mmsched.h"
+#include "./mmtimer.h"
 #include "./thread.h"
 #include "./thread_descr.h"
 
 /* Next user thread identifier */
 int nxt_utid;
-/* Next user thread identifier lock */
-Lock nxt_utid_lk;
 
 /**
- * @brief Get next thread id
+ * @brief Get next thread ids
  *
- * Returns the thread id to be used for the next submitted user thread
+ * Returns the first of the consecutive thread ids to be used for the next
+ * submitted user threads
  *
+ * @param[in] nb Number of thread ids
  * @return Integer id
  */
-static int _get_nxt_utid(void) {
-
-    int utid;
-
-    /* Acquire the utid lock */
-    lock_acquire(&nxt_utid_lk);
-
-    /* Get the id */
-    utid = nxt_utid++;
-
-    /* Release the lock */
-    lock_release(&nxt_utid_lk);
-
-    return utid;
-}
-
-/**
- * @brief The actual start function of the thread
- *
- * This function launches the start function with the argument provided by
- * the application program
- */
-static void _many_many_start(void) {
-
-    Thread thread;
-
-    /* Get the thread handle */
-    thread = thread_self();
-
-    /* Launch the thread start function */
-    td_launch(thread);
-
-    /* Disable interrupt */
-    td_disable_intr(thread);
+static int _get_nxt_utid(int nb) {
 
-    /* Set the state as exited */
-    td_set_state(thread, THREAD_STATE_EXITED);
+    /* Get the ids */
+    return atomic_fetch_add(&nxt_utid, nb);
 }
 
 /**
@@ -93,11 +65,98 @@ int thread_create(Thread *thread, thread_start_t start, ptr_t arg) {
         return THREAD_FAIL;
     }
 
-    /* Initialize the descriptor */
-    td_init(*thread, _get_nxt_utid(), start, arg);
+    /* Initialize the descriptor (the stack and the context are set up when
+     * the thread is dispatched first) */
+    td_init(*thread, _get_nxt_utid(1), start, arg);
+
+    /* Disable the interrupts */
+    td_disable_intr(curr_thread);
+
+    /* Push the new thread to the many ready list */
+    mmrll_push((*thread));
+
+    /* Enabe the interrupts */
+    td_enable_intr(curr_thread);
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Create a batch of threads
+ *
+ * Creates many-many threads running the same start routine. The thread ids
+ * are taken at once and the whole batch is added to the ready list in one
+ * operation
+ *
+ * @param[out] thread Array of the thread handles
+ * @param[in] nb Number of threads
+ * @param[in] start Start routine
+ * @param[in] args Array of the arguments to the start routine (NULL passes
+ *                 NULL to every thread)
+ */
+int thread_create_many(Thread *thread, size_t nb, thread_start_t start,
+                       ptr_t *args) {
+
+    Thread curr_thread;
+    List batch;
+    size_t i, j;
+    int utid;
+
+    /* Check for errors */
+    if ((!thread) ||            /* If thread descriptors are not valid */
+        (!start) ||             /* If start function is not valid */
+        (nb > INT_MAX)) {       /* If number of threads is not valid */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* If there is no thread to create */
+    if (!nb) {
+
+        return THREAD_SUCCESS;
+    }
+
+    /* Get the current thread handle */
+    curr_thread = thread_self();
+
+    /* Allocate the thread descriptors */
+    for (i = 0; i < nb; i++) {
+
+        thread[i] = td_alloc();
+        /* Check for errors */
+        if (!thread[i]) {
+
+            /* Free the descriptors allocated so far */
+            for (j = 0; j < i; j++) {
+
+                td_free(thread[j]);
+            }
+
+            /* Set the errno */
+            thread_errno = EAGAIN;
+            /* Return failure */
+            return THREAD_FAIL;
+        }
+    }
+
+    /* Get the thread ids */
+    utid = _get_nxt_utid(nb);
+
+    /* Initialize the batch */
+    list_init(&batch);
 
-    /* Initialize the start routine context */
-    td_init_cxt(*thread, _many_many_start);
+    /* For every thread */
+    for (i = 0; i < nb; i++) {
+
+        /* Initialize the descriptor */
+        td_init(thread[i], utid + i, start, args ? args[i] : NULL);
+
+        /* Add the thread to the batch */
+        mmrll_batch(&batch, thread[i]);
+    }
 
     /* Disable the interrupts */
     td_disable_intr(curr_thread);
@@ -105,13 +164,160 @@ int thread_create(Thread *thread, thread_start_t start, ptr_t arg) {
     /* Acquire the many ready list lock */
     mmrll_lock();
 
-    /* Add the current thread to the list  */
-    mmrll_enqueue((*thread));
+    /* Add the batch to the list */
+    mmrll_enqueue_batch(&batch, nb);
 
     /* Release the many ready list lock */
     mmrll_unlock();
 
-    /* Enabe the interrupts */
+    /* Enable the interrupts */
+    td_enable_intr(curr_thread);
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Take a thread which has not started yet off the ready list
+ *
+ * The thread is taken only if it would be dispatched next, so that running
+ * it inline does not overtake the threads ahead of it, and if the calling
+ * thread is preempted as the thread would be (the preemption status is read
+ * when a thread is dispatched)
+ *
+ * @param[in] curr_thread Calling thread handle
+ * @param[in] thread Thread handle
+ * @return 1 if the thread was taken off the ready list
+ * @return 0 if the thread already started, is being dispatched or is not the
+ *         next one to be dispatched
+ * @note Interrupts should be disabled
+ */
+static int _thread_claim(Thread curr_thread, Thread thread) {
+
+    int claimed;
+
+    /* If the preemption status changed since the calling thread was
+     * dispatched */
+    if (td_get_sched(curr_thread)->preempt != mmsched_getpreemption()) {
+
+        return 0;
+    }
+
+    /* Acquire the many ready list lock */
+    mmrll_lock();
+
+    /* A thread gets its context when it is dispatched first, hence a
+     * thread still on the ready list without a context never ran */
+    claimed = (!td_has_cxt(thread) && mmrll_claim(thread));
+
+    /* Release the many ready list lock */
+    mmrll_unlock();
+
+    return claimed;
+}
+
+/**
+ * @brief Run a thread which has not started yet inline
+ *
+ * The start routine of the thread is called on the stack of the calling
+ * thread, as the thread: it takes the place of the calling thread on its
+ * scheduler and borrows its contexts, hence thread_self(), the signals, the
+ * priority and the affinity are the ones of the thread, which can block and
+ * be preempted. The calling thread is suspended till the start routine
+ * returns or the thread exits
+ *
+ * @param[in] curr_thread Calling thread handle
+ * @param[in] thread Thread handle
+ */
+static void _thread_run_inline(Thread curr_thread, Thread thread) {
+
+    void *jmp[5];
+#if MMSCHED_PREEMPT == MMSCHED_PREEMPT_TIMER
+    sigset_t mask, old_mask;
+
+    /* The timer interrupt restarts the timer of the thread it finds running
+     * even with the interrupts disabled, hence it is blocked while the
+     * timer moves from a thread to the other */
+    sigfillset(&mask);
+#endif
+
+    /* Disable the interrupts */
+    td_disable_intr(curr_thread);
+
+#if MMSCHED_PREEMPT == MMSCHED_PREEMPT_TIMER
+    sigprocmask(SIG_BLOCK, &mask, &old_mask);
+#endif
+
+    /* Take the place of the calling thread */
+    td_lend_cxt(curr_thread, thread);
+    td_get_sched(thread)->curr = thread;
+    set_fs(thread);
+
+#if MMSCHED_PREEMPT == MMSCHED_PREEMPT_TIMER
+    sigprocmask(SIG_SETMASK, &old_mask, NULL);
+#endif
+
+    /* Note where the run ends (for thread_exit()) */
+    td_set_inline_jmp(thread, jmp);
+
+    /* Launch the thread start function (thread_exit() jumps back) */
+    if (!__builtin_setjmp(jmp)) {
+
+        /* Enable the interrupts */
+        td_enable_intr(thread);
+
+        td_launch(thread);
+    }
+
+    /* Disable the interrupts */
+    td_disable_intr(thread);
+
+#if MMSCHED_PREEMPT == MMSCHED_PREEMPT_TIMER
+    sigprocmask(SIG_BLOCK, &mask, &old_mask);
+#endif
+
+    /* Give the place back to the calling thread, on the scheduler the
+     * thread runs on by now */
+    td_take_cxt(curr_thread, thread);
+    td_get_sched(curr_thread)->curr = curr_thread;
+    set_fs(curr_thread);
+
+#if MMSCHED_PREEMPT == MMSCHED_PREEMPT_TIMER
+    sigprocmask(SIG_SETMASK, &old_mask, NULL);
+#endif
+
+    /* Set the state as exited */
+    td_set_state(thread, THREAD_STATE_EXITED);
+    td_set_over(thread);
+
+    /* Enable the interrupts */
+    td_enable_intr(curr_thread);
+}
+
+/**
+ * @brief Reap a completed thread
+ * @param[in] curr_thread Calling thread handle
+ * @param[in] thread Thread handle
+ * @param[out] ret Pointer to return value holder
+ */
+static int _thread_reap(Thread curr_thread, Thread thread, ptr_t *ret) {
+
+    /* If the return value is requested */
+    if (ret) {
+
+        /* Get the return value from the thread local storage */
+        *ret = td_get_ret(thread);
+    }
+
+    /* Update the state of the target thread */
+    td_set_state(thread, THREAD_STATE_JOINED);
+
+    /* Disable the interrupts, as the stack goes back to the cache */
+    td_disable_intr(curr_thread);
+
+    /* Free the memory and resources of the descriptor */
+    td_free(thread);
+
+    /* Enable the interrupts */
     td_enable_intr(curr_thread);
 
     return THREAD_SUCCESS;
@@ -120,12 +326,15 @@ int thread_create(Thread *thread, thread_start_t start, ptr_t arg) {
 /**
  * @brief Joins with the target thread
  *
- * Waits for the target thread to complete its execution
+ * Waits for the target thread to complete its execution. If the wait is not
+ * timed and the target thread has not started yet, it is run inline by the
+ * calling thread instead
  *
  * @param[in] thread Pointer to the thread handle
  * @param[out] ret Pointer to return value holder
+ * @param[in] timeout_ns Time to wait for in nano seconds (negative if none)
  */
-int thread_join(Thread thread, ptr_t *ret) {
+static int _thread_join(Thread thread, ptr_t *ret, long timeout_ns) {
 
     Thread curr_thread;
 
@@ -174,6 +383,22 @@ int thread_join(Thread thread, ptr_t *ret) {
     /* Set the joining thread */
     td_set_joining(thread, curr_thread);
 
+    /* If the wait is not timed and the target thread has not started */
+    if ((timeout_ns < 0) && _thread_claim(curr_thread, thread)) {
+
+        /* Release the member lock */
+        td_unlock(thread);
+
+        /* Enable the interrupts */
+        td_enable_intr(curr_thread);
+
+        /* Run the target thread inline */
+        _thread_run_inline(curr_thread, thread);
+
+        /* Reap the target thread */
+        return _thread_reap(curr_thread, thread, ret);
+    }
+
     /* Set the thread, the calling thread is waiting for */
     td_set_wait_thread(curr_thread, thread);
 
@@ -183,6 +408,12 @@ int thread_join(Thread thread, ptr_t *ret) {
     /* Check if the target thread did not completed its execution */
     if (!td_is_over(thread)) {
 
+        /* If the wait is timed, set the expiry tick */
+        if (timeout_ns >= 0) {
+
+            td_set_timeout(curr_thread, mmtimer_tick(timeout_ns));
+        }
+
         /* Return to the scheduler */
         td_ret_cxt(curr_thread);
 
@@ -201,20 +432,71 @@ int thread_join(Thread thread, ptr_t *ret) {
     /* Enable the interrupts */
     td_enable_intr(curr_thread);
 
-    /* If the return value is requested */
-    if (ret) {
+    /* If the wait was timed */
+    if (td_is_timed(curr_thread)) {
 
-        /* Get the return value from the thread local storage */
-        *ret = td_get_ret(thread);
+        /* Acquire the member lock */
+        td_lock(thread);
+
+        /* If the timeout expired before the target thread completed */
+        if ((td_clear_timed(curr_thread) == THREAD_TIMED_EXPIRED) &&
+            !td_is_over(thread)) {
+
+            /* Stop waiting for the target thread */
+            td_set_joining(thread, NULL);
+            /* Release the member lock */
+            td_unlock(thread);
+            /* Set the errno */
+            thread_errno = ETIMEDOUT;
+            /* Return failure */
+            return THREAD_FAIL;
+        }
+
+        /* Release the member lock */
+        td_unlock(thread);
     }
 
-    /* Update the state of the target thread */
-    td_set_state(thread, THREAD_STATE_JOINED);
+    /* Reap the target thread */
+    return _thread_reap(curr_thread, thread, ret);
+}
 
-    /* Free the memory and resources of the descriptor */
-    td_free(thread);
+/**
+ * @brief Joins with the target thread
+ *
+ * Waits for the target thread to complete its execution
+ *
+ * @param[in] thread Pointer to the thread handle
+ * @param[out] ret Pointer to return value holder
+ */
+int thread_join(Thread thread, ptr_t *ret) {
 
-    return THREAD_SUCCESS;
+    /* Wait without a timeout */
+    return _thread_join(thread, ret, -1);
+}
+
+/**
+ * @brief Joins with the target thread, with a timeout
+ *
+ * Waits for the target thread to complete its execution for at most the
+ * given time. The target thread can be joined again after a timeout
+ *
+ * @param[in] thread Pointer to the thread handle
+ * @param[out] ret Pointer to return value holder
+ * @param[in] timeout_ns Time to wait for in nano seconds
+ */
+int thread_join_timed(Thread thread, ptr_t *ret, unsigned long timeout_ns) {
+
+    /* Check for errors */
+    if ((long)timeout_ns < 0) {
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Wait with the timeout */
+    return _thread_join(thread, ret, timeout_ns);
 }
 
 /**
@@ -238,6 +520,16 @@ void thread_exit(ptr_t ret) {
         return;
     }
 
+    /* If the thread runs inline, jump back to the join */
+    if (td_get_inline_jmp(thread)) {
+
+        /* Set the return value */
+        td_set_ret(thread, ret);
+
+        /* Jump back to the join */
+        __builtin_longjmp(td_get_inline_jmp(thread), 1);
+    }
+
     /* Set the return value */
     td_set_ret(thread, ret);
 
@@ -335,3 +627,679 @@ int thread_once(ThreadOnce *once_control, void (*init_routine)(void)) {
 
     return THREAD_SUCCESS;
 }
+
+/**
+ * @brief Set the scheduling priority of a thread
+ *
+ * Threads of higher priority are always dispatched before the threads of
+ * lower priority. If the target thread is waiting to be scheduled then it is
+ * moved to the new priority level immediately
+ *
+ * @param[in] thread Thread handle
+ * @param[in] prio Priority between THREAD_PRIO_MIN and THREAD_PRIO_MAX
+ */
+int thread_setpriority(Thread thread, int prio) {
+
+    Thread curr_thread;
+
+    /* Check for errors */
+    if ((!thread) ||                /* If thread descriptor is not valid */
+        (prio < THREAD_PRIO_MIN) || /* If priority is below range */
+        (prio > THREAD_PRIO_MAX)) { /* If priority is above range */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Get the current thread handle */
+    curr_thread = thread_self();
+
+    /* Disable the interrupts */
+    td_disable_intr(curr_thread);
+
+    /* Acquire the many ready list lock */
+    mmrll_lock();
+
+    /* If the thread is on the ready list */
+    if (mmrll_remove(thread)) {
+
+        /* Update the priority */
+        td_set_prio(thread, prio);
+        td_reset_eff_prio(thread);
+
+        /* Add the thread back at its new position */
+        mmrll_enqueue(thread);
+    } else {
+
+        /* Update the priority */
+        td_set_prio(thread, prio);
+        td_reset_eff_prio(thread);
+    }
+
+    /* Release the many ready list lock */
+    mmrll_unlock();
+
+    /* Enable the interrupts */
+    td_enable_intr(curr_thread);
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Get the scheduling priority of a thread
+ * @param[in] thread Thread handle
+ * @param[out] prio Pointer to the priority holder
+ */
+int thread_getpriority(Thread thread, int *prio) {
+
+    /* Check for errors */
+    if ((!thread) ||            /* If thread descriptor is not valid */
+        (!prio)) {              /* If priority holder is not valid */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Get the base priority */
+    *prio = td_get_prio(thread);
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Set the scheduling policy of the many-many threads
+ *
+ * Under THREAD_SCHED_PRIO the highest priority ready thread is always
+ * dispatched first. Under THREAD_SCHED_FAIR every thread gets a share of the
+ * CPU time proportional to the weight of its priority, the ready thread
+ * which consumed the least weighted CPU time is dispatched first
+ *
+ * @param[in] policy Scheduling policy
+ */
+int thread_setschedpolicy(int policy) {
+
+    Thread curr_thread;
+
+    /* Check for errors */
+    if ((policy != THREAD_SCHED_PRIO) && /* If policy is not valid */
+        (policy != THREAD_SCHED_FAIR)) {
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+#if MMRLL_LOCKFREE
+    /* The lock-free ready list is a plain FIFO queue */
+    if (policy != THREAD_SCHED_PRIO) {
+
+        /* Set the errno */
+        thread_errno = ENOTSUP;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+#endif
+
+    /* Get the current thread handle */
+    curr_thread = thread_self();
+
+    /* Disable the interrupts */
+    td_disable_intr(curr_thread);
+
+    /* Acquire the many ready list lock */
+    mmrll_lock();
+
+    /* Move the ready threads under the new policy */
+    mmrll_set_policy(policy);
+
+    /* Release the many ready list lock */
+    mmrll_unlock();
+
+    /* Enable the interrupts */
+    td_enable_intr(curr_thread);
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Get the scheduling policy of the many-many threads
+ * @param[out] policy Pointer to the policy holder
+ */
+int thread_getschedpolicy(int *policy) {
+
+    /* Check for errors */
+    if (!policy) {              /* If policy holder is not valid */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Get the policy */
+    *policy = mmrll_get_policy();
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Enable or disable the preemption of the many-many threads
+ *
+ * Without preemption the threads are scheduled cooperatively, a thread runs
+ * till it yields, waits or exits, and the schedulers arm no timer. Takes
+ * effect from the next dispatch of every kernel thread
+ *
+ * @param[in] enabled 1 to enable the preemption, 0 to disable it
+ */
+int thread_setpreemption(int enabled) {
+
+    /* Check for errors */
+    if ((enabled != 0) && (enabled != 1)) {    /* If status is not valid */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Set the preemption status */
+    if (!mmsched_setpreemption(enabled)) {
+
+        /* The preemption is compiled out, set the errno */
+        thread_errno = ENOTSUP;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Get the preemption status of the many-many threads
+ * @param[out] enabled Pointer to the status holder (1 if preempted)
+ */
+int thread_getpreemption(int *enabled) {
+
+    /* Check for errors */
+    if (!enabled) {             /* If status holder is not valid */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Get the status */
+    *enabled = mmsched_getpreemption();
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Set the time slice of a thread
+ *
+ * A thread is preempted once it ran for its time slice. With an adaptive
+ * slice, the slice starts from the current one and is doubled every time the
+ * thread uses it whole (CPU bound threads are dispatched less often), and
+ * halved every time the thread waits before its end (I/O bound threads get
+ * short slices and a priority boost). Takes effect from the next dispatch of
+ * the thread
+ *
+ * @param[in] thread Thread handle
+ * @param[in] slice_us Time slice in micro seconds, between
+ *                     MMSCHED_SLICE_MIN_us and MMSCHED_SLICE_MAX_us, or
+ *                     THREAD_SLICE_ADAPTIVE for an adaptive slice
+ */
+int thread_set_timeslice(Thread thread, unsigned long slice_us) {
+
+    /* Check for errors */
+    if ((!thread) ||                /* If thread descriptor is not valid */
+        ((slice_us != THREAD_SLICE_ADAPTIVE) &&
+         ((slice_us < MMSCHED_SLICE_MIN_us) ||  /* If slice is too short */
+          (slice_us > MMSCHED_SLICE_MAX_us)))) {/* If slice is too long */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* If the slice is adaptive */
+    if (slice_us == THREAD_SLICE_ADAPTIVE) {
+
+        /* Start from the current slice */
+        td_set_slice_adaptive(thread, 1);
+    } else {
+
+        /* Set the fixed slice */
+        td_set_slice_adaptive(thread, 0);
+        td_set_slice(thread, slice_us);
+    }
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Get the time slice of a thread
+ * @param[in] thread Thread handle
+ * @param[out] slice_us Pointer to the time slice holder (in micro seconds,
+ *                      the current one for an adaptive slice)
+ */
+int thread_get_timeslice(Thread thread, unsigned long *slice_us) {
+
+    /* Check for errors */
+    if ((!thread) ||            /* If thread descriptor is not valid */
+        (!slice_us)) {          /* If slice holder is not valid */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Get the time slice */
+    *slice_us = td_get_slice(thread);
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Set the deadline of the next job of a thread
+ *
+ * A thread with a deadline and CPU budget left is dispatched before all the
+ * other threads, earliest deadline first. The budget is consumed by the CPU
+ * time the thread uses, once it is exhausted the thread is scheduled under
+ * the normal policy till its next deadline is set. Setting a new deadline
+ * completes the current job, which is counted as missed if its deadline has
+ * already passed
+ *
+ * @param[in] thread Thread handle
+ * @param[in] relative_ns Deadline relative to now in nano seconds, 0 removes
+ *                        the thread from the deadline class
+ * @param[in] budget_ns CPU budget of the job in nano seconds
+ */
+int thread_set_deadline(Thread thread, unsigned long relative_ns,
+                        unsigned long budget_ns) {
+
+    Thread curr_thread;
+    unsigned long now;
+
+    /* Check for errors */
+    if ((!thread) ||                       /* If thread is not valid */
+        (relative_ns && !budget_ns)) {     /* If budget is not valid */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+#if MMRLL_LOCKFREE
+    /* The lock-free ready list has no deadline class */
+    if (relative_ns) {
+
+        /* Set the errno */
+        thread_errno = ENOTSUP;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+#endif
+
+    /* Get the current thread handle */
+    curr_thread = thread_self();
+
+    /* Get the current time */
+    now = clock_ns(CLOCK_MONOTONIC);
+
+    /* Disable the interrupts */
+    td_disable_intr(curr_thread);
+
+    /* Acquire the many ready list lock */
+    mmrll_lock();
+
+    /* If the current job completed after its deadline */
+    if (td_has_deadline(thread) && (now > td_get_deadline(thread))) {
+
+        /* Count the miss */
+        td_add_dl_miss(thread);
+    }
+
+    /* If the thread is on the ready list */
+    if (mmrll_remove(thread)) {
+
+        /* Set the deadline of the next job */
+        td_set_deadline(thread, relative_ns ? now + relative_ns : 0,
+                        budget_ns);
+
+        /* Add the thread back at its new position */
+        mmrll_enqueue(thread);
+    } else {
+
+        /* Set the deadline of the next job */
+        td_set_deadline(thread, relative_ns ? now + relative_ns : 0,
+                        budget_ns);
+    }
+
+    /* Release the many ready list lock */
+    mmrll_unlock();
+
+    /* Enable the interrupts */
+    td_enable_intr(curr_thread);
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Get the number of deadlines missed by a thread
+ * @param[in] thread Thread handle
+ * @param[out] misses Pointer to the number of misses holder
+ */
+int thread_get_deadline_misses(Thread thread, unsigned long *misses) {
+
+    /* Check for errors */
+    if ((!thread) ||            /* If thread descriptor is not valid */
+        (!misses)) {            /* If misses holder is not valid */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Get the number of misses */
+    *misses = td_get_dl_misses(thread);
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Set the CPU affinity of a thread
+ *
+ * A many-many thread is not bound to a kernel thread, hence the affinity is
+ * taken as a hint. The first scheduler pinned to a CPU of the set becomes
+ * the preferred scheduler of the thread, which dispatches it before the
+ * threads of the scheduling policy. Other schedulers run the thread only
+ * when they have nothing else to run. If every scheduler is pinned to a CPU
+ * of the set the hint is cleared
+ *
+ * @param[in] thread Thread handle
+ * @param[in] setsize Size of the CPU set in bytes
+ * @param[in] set Pointer to the CPU set
+ */
+int thread_setaffinity(Thread thread, size_t setsize, const cpu_set_t *set) {
+
+    Thread curr_thread;
+    int sched;
+
+    /* Check for errors */
+    if ((!thread) ||            /* If thread descriptor is not valid */
+        (!set)) {               /* If CPU set is not valid */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Get the current thread handle */
+    curr_thread = thread_self();
+
+    /* Disable the interrupts */
+    td_disable_intr(curr_thread);
+
+    /* If no scheduler is pinned to a CPU of the set */
+    if (!mmsched_find_cpu(setsize, set, &sched)) {
+
+        /* Enable the interrupts */
+        td_enable_intr(curr_thread);
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Acquire the many ready list lock */
+    mmrll_lock();
+
+    /* If the thread is on the ready list */
+    if (mmrll_remove(thread)) {
+
+        /* Update the preferred scheduler */
+        td_set_affine(thread, sched);
+
+        /* Add the thread back at its new position */
+        mmrll_enqueue(thread);
+    } else {
+
+        /* Update the preferred scheduler */
+        td_set_affine(thread, sched);
+    }
+
+    /* Release the many ready list lock */
+    mmrll_unlock();
+
+    /* Enable the interrupts */
+    td_enable_intr(curr_thread);
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Set the number of kernel threads scheduling the many-many threads
+ *
+ * Kernel threads are added immediately. A removed kernel thread retires once
+ * it is done with the user thread it is running. With zero the number of
+ * kernel threads is scaled automatically between one and the number of CPUs
+ * the process is allowed to run on, a kernel thread is added when the ready
+ * threads outnumber the kernel threads by MMSCHED_AUTO_GROW_LEN times and one
+ * is removed when a kernel thread stays idle for MMSCHED_AUTO_IDLE_ms
+ *
+ * @param[in] new_level Number of kernel threads, 0 for automatic scaling
+ */
+int thread_setconcurrency(int new_level) {
+
+    Thread curr_thread;
+
+    /* Check for errors */
+    if ((new_level < 0) ||                      /* If level is not valid */
+        (new_level > MMSCHED_MAX_SCHEDS)) {
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Get the current thread handle */
+    curr_thread = thread_self();
+
+    /* Disable the interrupts */
+    td_disable_intr(curr_thread);
+
+    /* Resize the scheduler pool */
+    mmsched_setconcurrency(new_level);
+
+    /* Enable the interrupts */
+    td_enable_intr(curr_thread);
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Get the number of kernel threads scheduling the many-many threads
+ * @return Number of active kernel threads
+ */
+int thread_getconcurrency(void) {
+
+    /* Return the number of active schedulers */
+    return mmsched_getconcurrency();
+}
+
+/**
+ * @brief Mark the start of a system call which may block
+ *
+ * The kernel thread running the calling thread stays with it for the system
+ * call, while the scheduling of the other threads is handed to a spare
+ * kernel thread. The time slice is paused so that the system call is not
+ * interrupted. Should be followed by thread_block_exit() once the
+ * system call returns
+ */
+int thread_block_enter(void) {
+
+    Thread curr_thread;
+
+    /* Get the current thread handle */
+    curr_thread = thread_self();
+
+    /* Disable the interrupts */
+    td_disable_intr(curr_thread);
+
+    /* Pause the time slice */
+    mmsched_pause(curr_thread);
+
+    /* Hand the scheduling to a spare kernel thread */
+    mmsched_detach(td_get_sched(curr_thread));
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Mark the end of a system call which may block
+ *
+ * The calling thread is given back to the ready list, to be run by one of
+ * the schedulers, and the kernel thread it was running on becomes a spare
+ */
+int thread_block_exit(void) {
+
+    Thread curr_thread;
+
+    /* Get the current thread handle */
+    curr_thread = thread_self();
+
+    /* Yield to the lent kernel thread, which puts the thread on the ready
+     * list (interrupts are already disabled) */
+    td_ret_cxt(curr_thread);
+
+    /* Enable the interrupts */
+    td_enable_intr(curr_thread);
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Sleep for a given time
+ *
+ * The calling thread gives up the control till the time elapsed, without
+ * blocking the kernel thread it runs on. The time is rounded up to the tick
+ * of the timer wheel (MMTIMER_TICK_us)
+ *
+ * @param[in] ns Time to sleep in nano seconds
+ */
+int thread_sleep_ns(unsigned long ns) {
+
+    Thread curr_thread;
+
+    /* Check for errors */
+    if ((long)ns < 0) {
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Get the current thread handle */
+    curr_thread = thread_self();
+
+    /* Disable the interrupts */
+    td_disable_intr(curr_thread);
+
+    /* Set the expiry tick */
+    td_set_timeout(curr_thread, mmtimer_tick(ns));
+
+    /* Update the state */
+    td_set_state(curr_thread, THREAD_STATE_WAIT_SLEEP);
+
+    /* Return to the scheduler, which adds the timeout to the timer wheel */
+    td_ret_cxt(curr_thread);
+
+    /* Update the state */
+    td_set_state(curr_thread, THREAD_STATE_RUNNING);
+
+    /* The timeout expired */
+    td_clear_timed(curr_thread);
+
+    /* Enable the interrupts */
+    td_enable_intr(curr_thread);
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Run a function on a helper kernel thread
+ *
+ * The calling thread gives up the control till the function returned, so
+ * that a blocking call (e.g. a file read or a name lookup) does not block the
+ * kernel thread scheduling the threads. The function runs as the calling
+ * thread (thread_self() and thread_errno refer to it)
+ *
+ * @param[in] func Function to be run
+ * @param[in] arg Argument
+ * @param[out] ret Pointer to return value holder
+ */
+int thread_offload(thread_start_t func, ptr_t arg, ptr_t *ret) {
+
+    Thread curr_thread;
+    OffloadJob job;
+
+    /* Check for errors */
+    if (!func) {
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Get the current thread handle */
+    curr_thread = thread_self();
+
+    /* Set the call */
+    job.func = func;
+    job.arg = arg;
+
+    /* Disable the interrupts */
+    td_disable_intr(curr_thread);
+
+    /* Set the call, the calling thread is waiting for */
+    td_set_wait_job(curr_thread, &job);
+
+    /* Update the state */
+    td_set_state(curr_thread, THREAD_STATE_WAIT_OFFLOAD);
+
+    /* Return to the scheduler, which hands the call to the helpers */
+    td_ret_cxt(curr_thread);
+
+    /* Update the state */
+    td_set_state(curr_thread, THREAD_STATE_RUNNING);
+
+    /* Clear the wait for call */
+    td_set_wait_job(curr_thread, NULL);
+
+    /* Enable the interrupts */
+    td_enable_intr(curr_thread);
+
+    /* If the return value is requested */
+    if (ret) {
+
+        *ret = job.ret;
+    }
+
+    return THREAD_SUCCESS;
+}
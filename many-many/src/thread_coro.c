@@ -0,0 +1,302 @@
+#include "./mods/utils.h"
+#include "./mods/stack.h"
+#include "./thread.h"
+#include "./thread_descr.h"
+#include "./thread_coro.h"
+
+/**
+ * @brief Jump to a jump buffer
+ *
+ * Kept out of line, as a function cannot jump to a buffer it set itself
+ *
+ * @param[in] jmp Jump buffer
+ */
+static void __attribute__((noinline)) _thread_coro_jump(void **jmp) {
+
+    /* Jump back to where the buffer was set */
+    __builtin_longjmp(jmp, 1);
+}
+
+/**
+ * @brief Take a stack from the stack cache, or give it back
+ * @param[in] coro Coroutine handle
+ * @param[in] get 1 to take a stack, 0 to give it back
+ * @return 0 on success
+ * @return -1 if no stack is left to take
+ */
+static int _thread_coro_stack(ThreadCoro coro, int get) {
+
+    Thread curr_thread;
+    int ret = 0;
+
+    /* Get the current thread handle */
+    curr_thread = thread_self();
+
+    /* Disable the interrupts, as the cache is protected by a spinlock */
+    td_disable_intr(curr_thread);
+
+    /* Take or give back the stack */
+    if (get) {
+
+        ret = stack_cache_get(&coro->stack);
+    } else {
+
+        stack_cache_put(&coro->stack);
+    }
+
+    /* Enable the interrupts */
+    td_enable_intr(curr_thread);
+
+    return ret;
+}
+
+/**
+ * @brief Coroutine launch function
+ * @param[in] coro Coroutine handle
+ */
+static void __attribute__((noreturn)) _thread_coro_launch(ThreadCoro coro) {
+
+    /* Call the coroutine function */
+    coro->func(coro, coro->arg);
+
+    /* Set the state as done */
+    coro->state = CORO_STATE_DONE;
+
+    /* Jump back to the resumer for the last time */
+    _thread_coro_jump(coro->ret_jmp);
+    __builtin_unreachable();
+}
+
+/**
+ * @brief Enter a coroutine for the first time
+ *
+ * Switches to the top of the stack of the coroutine and calls the launch
+ * function there. Unlike setcontext() the signal mask is left alone, the
+ * coroutine runs with the mask of its resumer
+ *
+ * @param[in] coro Coroutine handle
+ */
+static void __attribute__((noinline, noreturn)) _thread_coro_enter(
+                                                        ThreadCoro coro) {
+
+    unsigned long top;
+
+    /* Get the top of the stack, aligned as the ABI requires at a call */
+    top = ((unsigned long)coro->stack.ss_sp + coro->stack.ss_size) & ~15ul;
+
+    /* Switch the stack and call the launch function (it never returns) */
+    __asm__ volatile ("mov %0, %%rsp\n\t"
+                      "call *%1\n\t"
+                      "ud2"
+                      :
+                      : "r" (top), "r" (_thread_coro_launch), "D" (coro)
+                      : "memory");
+    __builtin_unreachable();
+}
+
+/**
+ * @brief Create a coroutine
+ *
+ * The coroutine does not run till it is resumed, it runs on its own stack
+ * within the user thread resuming it
+ *
+ * @param[out] coro Pointer to the coroutine handle
+ * @param[in] func Coroutine function
+ * @param[in] arg Argument
+ */
+int thread_coro_create(ThreadCoro *coro, thread_coro_t func, ptr_t arg) {
+
+    /* Check for errors */
+    if (!coro || !func) {       /* If pointer to coro or func is invalid */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Allocate the memory */
+    (*coro) = alloc_mem(struct ThreadCoro);
+
+    /* Check for errors */
+    if (!(*coro)) {
+
+        /* Set the errno */
+        thread_errno = EAGAIN;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Set the members */
+    (*coro)->func = func;
+    (*coro)->arg = arg;
+    (*coro)->value = NULL;
+    (*coro)->state = CORO_STATE_SUSPENDED;
+    (*coro)->started = 0;
+
+    /* Take a stack of the cache, the launch function is called on it at
+     * the first resume */
+    if (_thread_coro_stack(*coro, 1)) {
+
+        /* Free the coroutine object */
+        free(*coro);
+
+        /* Set the errno */
+        thread_errno = EAGAIN;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Resume a coroutine
+ *
+ * Runs the coroutine till it yields a value, which is stored at the location
+ * pointed by value (if not NULL). The switches neither go through the
+ * scheduler nor a system call
+ *
+ * @param[in] coro Coroutine handle
+ * @param[out] value Pointer to the value holder
+ */
+int thread_coro_resume(ThreadCoro coro, ptr_t *value) {
+
+    /* Check for errors */
+    if (!coro) {                /* If the coroutine is invalid */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Check for errors */
+    if (!atomic_cas(&coro->state, CORO_STATE_SUSPENDED,
+                    CORO_STATE_RUNNING)) {  /* If it cannot be resumed */
+
+        /* Set the errno */
+        thread_errno = (coro->state == CORO_STATE_DONE) ? ESRCH : EBUSY;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Switch to the coroutine (it jumps back when it yields) */
+    if (!__builtin_setjmp(coro->ret_jmp)) {
+
+        /* If the coroutine runs first, enter it on its stack */
+        if (!coro->started) {
+
+            coro->started = 1;
+            _thread_coro_enter(coro);
+        }
+
+        /* Jump to where it yielded */
+        _thread_coro_jump(coro->jmp);
+    }
+
+    /* If the coroutine function returned */
+    if (coro->state == CORO_STATE_DONE) {
+
+        /* Give the stack back to the cache */
+        _thread_coro_stack(coro, 0);
+
+        /* Set the errno */
+        thread_errno = ESRCH;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Get the value yielded */
+    if (value) {
+
+        *value = coro->value;
+    }
+
+    /* The coroutine can be resumed again */
+    atomic_store(&coro->state, CORO_STATE_SUSPENDED);
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Yield a value from a coroutine
+ *
+ * Switches back to the resumer of the coroutine, which gets the value. Returns
+ * once the coroutine is resumed again
+ *
+ * @param[in] coro Coroutine handle (of the calling coroutine)
+ * @param[in] value Value
+ */
+int thread_coro_yield_value(ThreadCoro coro, ptr_t value) {
+
+    /* Check for errors */
+    if (!coro) {                /* If the coroutine is invalid */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Check for errors */
+    if (coro->state != CORO_STATE_RUNNING) {    /* If it does not run */
+
+        /* Set the errno */
+        thread_errno = EPERM;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Set the value */
+    coro->value = value;
+
+    /* Switch back to the resumer (it jumps back when it resumes) */
+    if (!__builtin_setjmp(coro->jmp)) {
+
+        _thread_coro_jump(coro->ret_jmp);
+    }
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Destroy a coroutine
+ *
+ * Free the allocated memory for the coroutine object. A coroutine which did
+ * not return is dropped where it yielded
+ *
+ * @param[in] coro Pointer to the coroutine handle
+ */
+int thread_coro_destroy(ThreadCoro *coro) {
+
+    /* Check for errors */
+    if (!(coro) ||              /* Pointer to coro is valid */
+        !(*coro)) {             /* The argument points to a structure */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Check for errors */
+    if ((*coro)->state == CORO_STATE_RUNNING) { /* If the coroutine runs */
+
+        /* Set the errno */
+        thread_errno = EBUSY;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* If the coroutine function did not return, give the stack back */
+    if ((*coro)->state != CORO_STATE_DONE) {
+
+        _thread_coro_stack(*coro, 0);
+    }
+
+    /* Free the coroutine object */
+    free(*coro);
+
+    return THREAD_SUCCESS;
+}
@@ -0,0 +1,53 @@
+#ifndef _THREAD_CORO_H_
+#define _THREAD_CORO_H_
+
+#include <signal.h>
+#include "./mods/utils.h"
+#include "./thread.h"
+
+/**
+ * Coroutine states
+ */
+enum {
+
+    /* Coroutine waits to be resumed */
+    CORO_STATE_SUSPENDED,
+
+    /* Coroutine runs */
+    CORO_STATE_RUNNING,
+
+    /* Coroutine function returned */
+    CORO_STATE_DONE
+};
+
+/**
+ * Thread coroutine
+ */
+struct ThreadCoro {
+
+    /* Jump buffer of the coroutine (where it yielded) */
+    void *jmp[5];
+
+    /* Jump buffer of the resumer (where it resumed the coroutine) */
+    void *ret_jmp[5];
+
+    /* Stack of the coroutine */
+    stack_t stack;
+
+    /* Coroutine function */
+    thread_coro_t func;
+
+    /* Argument */
+    ptr_t arg;
+
+    /* Value yielded last */
+    ptr_t value;
+
+    /* Coroutine state */
+    int state;
+
+    /* Coroutine function was called */
+    int started;
+};
+
+#endif
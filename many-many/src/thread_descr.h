@@ -10,8 +10,13 @@
 #include "./mods/utils.h"
 #include "./mods/stack.h"
 #include "./mods/list.h"
+#include "./mods/heap.h"
+#include "./mods/wheel.h"
 #include "./mods/lock.h"
+#include "./mods/mpsc.h"
 #include "./mods/timer.h"
+#include "./mods/tls.h"
+#include "./mmsched.h"
 #include "./thread.h"
 
 /**
@@ -32,14 +37,97 @@ enum {
     THREAD_STATE_WAIT_JOIN,
 
     /* Thread is waiting for mutex */
-    THREAD_STATE_WAIT_MUTEX
+    THREAD_STATE_WAIT_MUTEX,
+
+    /* Thread is waiting for a file descriptor to be ready */
+    THREAD_STATE_WAIT_IO,
+
+    /* Thread is sleeping */
+    THREAD_STATE_WAIT_SLEEP,
+
+    /* Thread is waiting for an offloaded call */
+    THREAD_STATE_WAIT_OFFLOAD,
+
+    /* Thread is waiting for an I/O operation on a completion ring */
+    THREAD_STATE_WAIT_RING,
+
+    /* Thread is waiting for a task group */
+    THREAD_STATE_WAIT_TASK,
+
+    /* Thread is waiting for a future */
+    THREAD_STATE_WAIT_FUTURE,
+
+    /* Thread is waiting for a message */
+    THREAD_STATE_WAIT_MSG
 };
 
+/**
+ * Timed wait states
+ */
+enum {
+
+    /* Thread is not waiting with a timeout */
+    THREAD_TIMED_NONE,
+
+    /* Thread is waiting with a timeout */
+    THREAD_TIMED_ARMED,
+
+    /* Thread was woken before the timeout */
+    THREAD_TIMED_WOKEN,
+
+    /* Timeout expired before the thread was woken */
+    THREAD_TIMED_EXPIRED
+};
+
+/**
+ * Ready list structures holding a thread
+ */
+enum {
+
+    /* Thread is not on the ready list */
+    THREAD_QUEUED_NONE,
+
+    /* Thread is on a priority level list */
+    THREAD_QUEUED_PRIO,
+
+    /* Thread is on the fair heap */
+    THREAD_QUEUED_FAIR,
+
+    /* Thread is on the earliest deadline first heap */
+    THREAD_QUEUED_EDF,
+
+    /* Thread is on the list of its preferred scheduler */
+    THREAD_QUEUED_AFFINE,
+
+    /* Thread is taken ahead by a scheduler, on its batch */
+    THREAD_QUEUED_BATCH
+};
+
+/* Scheduler state (defined by the scheduler) */
+struct Scheduler;
+
+/**
+ * Message sent to a thread, its link is used as a mailbox member
+ */
+typedef union Message {
+
+    /* Message of the user */
+    ThreadMsg msg;
+
+    /* Mailbox links */
+    MpscMember mb_mem;
+
+} Message;
+
 /**
  * Thread control block / thread descriptor definition
  */
 struct Thread {
 
+    /* Thread control block header (the FS register points to the thread
+     * descriptor) */
+    TlsHeader tls;
+
     /* User thread id */
     int utid;
 
@@ -61,9 +149,6 @@ struct Thread {
     /* Pending signal mask */
     int pend_sig;
 
-    /* Stack canary */
-    ptr_t __stack_canary;
-
     /* Current context*/
     ucontext_t *curr_cxt;
 
@@ -73,16 +158,27 @@ struct Thread {
     /* List links */
     ListMember ll_mem;
 
+    /* Ready list links (pushed without the ready list lock) */
+    MpscMember rl_mem;
+
     /* Error number */
     int error;
 
     /* Pointer to the thread waiting for current thread to join */
     Thread join_thread;
 
+    /* Jump buffer ending the run of the thread inline, by the thread which
+     * joined it before it started (for thread_exit()) */
+    void **inline_jmp;
+
     /* Pointer to the object the current thread is waiting for
      * This can be -
      * 1. Another thread
-     * 2. Mutex  */
+     * 2. Mutex
+     * 3. Offloaded call
+     * 4. Ring operation
+     * 5. Task group
+     * 6. Future */
     ptr_t wait_for;
 
     /* Disable timer interrupt */
@@ -91,6 +187,66 @@ struct Thread {
     /* Timer object */
     Timer timer;
 
+    /* Time slice (in micro seconds) */
+    unsigned long slice_us;
+
+    /* Time slice adapted to the behaviour of the thread */
+    int slice_adaptive;
+
+    /* Thread was preempted at the end of its time slice */
+    int preempted;
+
+    /* Base scheduling priority */
+    int prio;
+
+    /* Effective scheduling priority (base priority raised by aging) */
+    int eff_prio;
+
+    /* Ready list structure holding the thread */
+    int queued;
+
+    /* Weighted CPU time consumed (in nano seconds) */
+    unsigned long vruntime;
+
+    /* Heap links */
+    HeapMember hp_mem;
+
+    /* Absolute deadline of the current job (0 if none) */
+    unsigned long deadline;
+
+    /* CPU time left to the current job (in nano seconds) */
+    long budget;
+
+    /* Number of jobs which completed after their deadline */
+    unsigned long dl_misses;
+
+    /* Index of the preferred scheduler (-1 if none) */
+    int affine;
+
+    /* Scheduler which dispatched the thread last */
+    struct Scheduler *sched;
+
+    /* File descriptor the thread is waiting for */
+    int io_fd;
+
+    /* Readiness events the thread is waiting for */
+    unsigned int io_events;
+
+    /* Error number reported by the poller (0 if none) */
+    int io_err;
+
+    /* Timed wait state (decides between the waker and the timeout) */
+    int timed;
+
+    /* Timer wheel links (expiry tick of the timeout) */
+    WheelMember wh_mem;
+
+    /* Mailbox of the messages sent to the thread */
+    Mpsc mailbox;
+
+    /* Thread is parked on its empty mailbox */
+    int mb_parked;
+
     /* Lock for accessing members */
     Lock mem_lock;
 };
@@ -105,7 +261,14 @@ struct Thread {
 #define td_is_joined(thread)        ((thread)->state == THREAD_STATE_JOINED)
 #define td_is_waiting(thread)                           \
     (((thread)->state == THREAD_STATE_WAIT_JOIN) ||     \
-     ((thread)->state == THREAD_STATE_WAIT_MUTEX))
+     ((thread)->state == THREAD_STATE_WAIT_MUTEX) ||    \
+     ((thread)->state == THREAD_STATE_WAIT_IO) ||       \
+     ((thread)->state == THREAD_STATE_WAIT_SLEEP) ||    \
+     ((thread)->state == THREAD_STATE_WAIT_OFFLOAD) ||  \
+     ((thread)->state == THREAD_STATE_WAIT_RING) ||     \
+     ((thread)->state == THREAD_STATE_WAIT_TASK) ||     \
+     ((thread)->state == THREAD_STATE_WAIT_FUTURE) ||   \
+     ((thread)->state == THREAD_STATE_WAIT_MSG))
 
 /**
  * Thread descriptor launch
@@ -119,21 +282,29 @@ struct Thread {
 #define td_get_ret(thread)          ((thread)->ret)
 
 /**
- * Thread descriptor memory allocation
+ * Thread descriptor memory allocation (the contexts and the stack are
+ * allocated when the thread is dispatched first)
  */
 #define td_alloc()                              \
     ({                                          \
         Thread __td;                            \
                                                 \
-        /* Allocate the descriptor */           \
-        __td = alloc_mem(struct Thread);        \
+        /* Allocate the descriptor, with the    \
+         * Thread-Local-Storage of the thread   \
+         * below it, as the FS register points  \
+         * to the descriptor */                 \
+        __td = tls_alloc(sizeof(*__td));        \
+                                                \
+        /* No context yet */                    \
+        if (__td) {                             \
                                                 \
-        /* Allocate the contexts */             \
-        __td->curr_cxt = alloc_mem(ucontext_t); \
-        __td->ret_cxt = alloc_mem(ucontext_t);  \
+            __td->curr_cxt = NULL;              \
+            __td->ret_cxt = NULL;               \
                                                 \
-        /* Allocate the stack */                \
-        stack_alloc(&__td->curr_cxt->uc_stack); \
+            /* No message yet */                \
+            mpsc_init(&__td->mailbox);          \
+            __td->mb_parked = 0;                \
+        }                                       \
                                                 \
         /* Return the thread descriptor */      \
         __td;                                   \
@@ -142,17 +313,13 @@ struct Thread {
 /**
  * Thread descriptor memory free
  */
-#define td_free(thread)                             \
-    {                                               \
-        /* Free the stack */                        \
-        stack_free(&(thread)->curr_cxt->uc_stack);  \
-                                                    \
-        /* Free the contexts */                     \
-        free((thread)->curr_cxt);                   \
-        free((thread)->ret_cxt);                    \
-                                                    \
-        /* Free the descriptor */                   \
-        free(thread);                               \
+#define td_free(thread)                                     \
+    {                                                       \
+        /* Give the stack back if it is still held */      \
+        td_put_cxt(thread);                                 \
+                                                            \
+        /* Free the descriptor */                           \
+        tls_free(thread);                                   \
     }
 
 /**
@@ -178,8 +345,12 @@ struct Thread {
         /* Set the join thread to none */       \
         (thread)->join_thread = NULL;           \
                                                 \
-        /* Set the interrupt handling status */ \
-        (thread)->intr_off = 0;                 \
+        /* The thread is not run inline */      \
+        (thread)->inline_jmp = NULL;            \
+                                                \
+        /* Disable the interrupts till the      \
+         * thread starts */                     \
+        (thread)->intr_off = 1;                 \
                                                 \
         /* Set the pending signals */           \
         (thread)->pend_sig = 0;                 \
@@ -187,23 +358,104 @@ struct Thread {
         /* Set the wait for object */           \
         (thread)->wait_for = NULL;              \
                                                 \
+        /* Set the default time slice */        \
+        td_set_slice(thread,                    \
+                     MMSCHED_TIME_SLICE_us);    \
+        td_set_slice_adaptive(thread, 0);       \
+        td_set_preempted(thread, 0);            \
+                                                \
+        /* Set the default priority */          \
+        (thread)->prio = THREAD_PRIO_DEFAULT;   \
+                                                \
+        /* Set the effective priority */        \
+        td_reset_eff_prio(thread);              \
+                                                \
+        /* Not on the ready list yet */         \
+        td_clear_queued(thread);                \
+                                                \
+        /* No CPU time consumed yet */          \
+        (thread)->vruntime = 0;                 \
+                                                \
+        /* No deadline */                       \
+        (thread)->deadline = 0;                 \
+        (thread)->budget = 0;                   \
+        (thread)->dl_misses = 0;                \
+                                                \
+        /* No preferred scheduler */            \
+        (thread)->affine = -1;                  \
+                                                \
+        /* Not dispatched yet */                \
+        (thread)->sched = NULL;                 \
+                                                \
+        /* Not waiting for a file descriptor */ \
+        (thread)->io_fd = -1;                   \
+        (thread)->io_events = 0;                \
+        (thread)->io_err = 0;                   \
+                                                \
+        /* Not waiting with a timeout */        \
+        (thread)->timed = THREAD_TIMED_NONE;    \
+        (thread)->wh_mem.slot = NULL;           \
+                                                \
         /* Initialize the member lock */        \
         lock_init(&(thread)->mem_lock);         \
     }
 
 /**
  * Thread descriptor context handling
+ *
+ * The current and return contexts of a thread are kept at the top of its
+ * stack, which saves allocating them (the stack is TD_CXT_SIZE bytes
+ * shorter). td_init_cxt() evaluates to 0 if no stack is left, td_put_cxt()
+ * gives the stack back once the thread no longer runs on it
  */
-#define td_init_cxt(thread, func)                           \
+#define TD_CXT_SIZE ((2 * sizeof(ucontext_t) + 63) & ~63ul)
+#define td_has_cxt(thread) ((thread)->curr_cxt != NULL)
+#define td_init_cxt(thread, model, func)                        \
+    ({                                                          \
+        stack_t __stack;                                        \
+        int __ok;                                               \
+                                                                \
+        /* Take a stack from the cache */                       \
+        __ok = !stack_cache_get(&__stack);                      \
+        if (__ok) {                                             \
+                                                                \
+            /* Keep the contexts at the top of the stack */     \
+            __stack.ss_size -= TD_CXT_SIZE;                     \
+            (thread)->curr_cxt = (ucontext_t *)                 \
+                (__stack.ss_sp + __stack.ss_size);              \
+            (thread)->ret_cxt = (thread)->curr_cxt + 1;         \
+                                                                \
+            /* Copy the model context, which saves getting the  \
+             * context from the kernel */                       \
+            *(thread)->curr_cxt = *(model);                     \
+            (thread)->curr_cxt->uc_mcontext.fpregs =            \
+                &(thread)->curr_cxt->__fpregs_mem;              \
+            (thread)->curr_cxt->uc_stack = __stack;             \
+                                                                \
+            /* Set the back link */                             \
+            (thread)->curr_cxt->uc_link = (thread)->ret_cxt;    \
+                                                                \
+            /* Make the context of the given function */        \
+            makecontext((thread)->curr_cxt, func, 0);           \
+        }                                                       \
+                                                                \
+        __ok;                                                   \
+    })
+#define td_put_cxt(thread)                                  \
     {                                                       \
-        /* Get the current context */                       \
-        getcontext((thread)->curr_cxt);                     \
+        /* If the thread has a stack */                     \
+        if (td_has_cxt(thread)) {                           \
                                                             \
-        /* Set the back link */                             \
-        (thread)->curr_cxt->uc_link = (thread)->ret_cxt;    \
+            /* Give the whole stack back to the cache, with \
+             * the contexts at its top */                   \
+            stack_t __stack = (thread)->curr_cxt->uc_stack; \
+            __stack.ss_size += TD_CXT_SIZE;                 \
+            stack_cache_put(&__stack);                      \
                                                             \
-        /* Make the context of the given function */        \
-        makecontext((thread)->curr_cxt, func, 0);           \
+            /* The contexts are gone with the stack */      \
+            (thread)->curr_cxt = NULL;                      \
+            (thread)->ret_cxt = NULL;                       \
+        }                                                   \
     }
 #define td_set_cxt(thread)                                  \
     {                                                       \
@@ -226,9 +478,30 @@ struct Thread {
 
 /**
  * Thread descriptor wait/completion handling
+ *
+ * The wait word is 1 till the thread completes, and 2 while a kernel thread
+ * outside of the schedulers sleeps on it, which the completion wakes
  */
 #define td_is_over(thread)  (!(thread)->wait)
-#define td_set_over(thread) ((thread)->wait = 0)
+#define td_set_over(thread)                                     \
+    {                                                           \
+        /* Clear the wait word, and wake the sleeping waiter */ \
+        if (atomic_exchange(&(thread)->wait, 0) == 2) {         \
+                                                                \
+            futex(&(thread)->wait, FUTEX_WAKE, 1);              \
+        }                                                       \
+    }
+#define td_wait_over(thread)                                    \
+    {                                                           \
+        /* Mark the wait word, unless the thread is over */     \
+        atomic_cas(&(thread)->wait, 1, 2);                      \
+                                                                \
+        /* Sleep till the thread is over */                     \
+        while (!td_is_over(thread)) {                           \
+                                                                \
+            futex(&(thread)->wait, FUTEX_WAIT, 2);              \
+        }                                                       \
+    }
 
 /**
  * Thread descriptor pending signals handling
@@ -260,6 +533,30 @@ struct Thread {
 #define td_set_joining(thread, join_thd)        \
     ((thread)->join_thread = (join_thd))
 
+/**
+ * Thread descriptor inline run handling
+ *
+ * A thread run inline borrows the contexts, the time slice timer and the
+ * scheduler of the thread running it, and gives the timer and the scheduler
+ * back once it is over
+ */
+#define td_set_inline_jmp(thread, jmp)  ((thread)->inline_jmp = (jmp))
+#define td_get_inline_jmp(thread)       ((thread)->inline_jmp)
+#define td_lend_cxt(thread, td)                     \
+    {                                               \
+        (td)->curr_cxt = (thread)->curr_cxt;        \
+        (td)->ret_cxt = (thread)->ret_cxt;          \
+        (td)->timer = (thread)->timer;              \
+        td_set_sched(td, td_get_sched(thread));     \
+    }
+#define td_take_cxt(thread, td)                     \
+    {                                               \
+        (thread)->timer = (td)->timer;              \
+        td_set_sched(thread, td_get_sched(td));     \
+        (td)->curr_cxt = NULL;                      \
+        (td)->ret_cxt = NULL;                       \
+    }
+
 /**
  * Thread descriptor wait objects handling
  */
@@ -267,20 +564,166 @@ struct Thread {
 #define td_set_wait_mutex(thread, mut)  ((thread)->wait_for = (mut))
 #define td_get_wait_thread(thread)      ((Thread)((thread)->wait_for))
 #define td_get_wait_mutex(thread)       ((ThreadMutex)((thread)->wait_for))
+#define td_set_wait_job(thread, job)    ((thread)->wait_for = (job))
+#define td_get_wait_job(thread)                         \
+    ((struct OffloadJob *)((thread)->wait_for))
+#define td_set_wait_op(thread, op)      ((thread)->wait_for = (op))
+#define td_get_wait_op(thread)                          \
+    ((struct RingOp *)((thread)->wait_for))
+#define td_set_wait_group(thread, grp)  ((thread)->wait_for = (grp))
+#define td_get_wait_group(thread)       ((ThreadTaskGroup)((thread)->wait_for))
+#define td_set_wait_future(thread, fut) ((thread)->wait_for = (fut))
+#define td_get_wait_future(thread)      ((ThreadFuture)((thread)->wait_for))
+
+/**
+ * Thread descriptor mailbox handling
+ */
+#define td_send_msg(thread, m)                          \
+    mpsc_push(&(thread)->mailbox, (Message *)(m), mb_mem)
+#define td_recv_msg(thread)                             \
+    ((ThreadMsg *)mpsc_pop(&(thread)->mailbox, Message, mb_mem))
+#define td_has_msg(thread)      (!mpsc_is_empty(&(thread)->mailbox))
+#define td_park_mailbox(thread) (atomic_store(&(thread)->mb_parked, 1))
+#define td_unpark_mailbox(thread)                       \
+    (atomic_exchange(&(thread)->mb_parked, 0))
 
 /**
  * Thread descriptor interrupt handling
  */
+#if MMSCHED_PREEMPT == MMSCHED_PREEMPT_NONE
+/* No thread is preempted, hence there is no interrupt to disable */
+#define td_disable_intr(thread) ((void)(thread))
+#define td_enable_intr(thread)  ((void)(thread))
+#define td_is_intr_off(thread)  (1)
+#else
 #define td_disable_intr(thread) ((thread)->intr_off = 1)
 #define td_enable_intr(thread)  ((thread)->intr_off = 0)
 #define td_is_intr_off(thread)  ((thread)->intr_off)
+#endif
 
 /**
  * Thread descriptor timer handling
  */
-#define td_timer_init(thread, act, tms) (timer_set(&(thread)->timer, act, tms))
+#define td_timer_init(thread, act, tus) (timer_set(&(thread)->timer, act, tus))
 #define td_timer_start(thread)          (timer_start(&(thread)->timer))
 #define td_timer_stop(thread)           (timer_stop(&(thread)->timer))
+#define td_timer_pause(thread)          (timer_pause(&(thread)->timer))
+
+/**
+ * Thread descriptor time slice handling
+ */
+#define td_set_slice(thread, us)        ((thread)->slice_us = (us))
+#define td_get_slice(thread)            ((thread)->slice_us)
+#define td_set_slice_adaptive(thread, a) ((thread)->slice_adaptive = (a))
+#define td_is_slice_adaptive(thread)    ((thread)->slice_adaptive)
+#define td_set_preempted(thread, p)     ((thread)->preempted = (p))
+#define td_is_preempted(thread)         ((thread)->preempted)
+
+/**
+ * Thread descriptor priority handling
+ */
+#define td_set_prio(thread, pr)     ((thread)->prio = (pr))
+#define td_get_prio(thread)         ((thread)->prio)
+#define td_set_eff_prio(thread, pr) ((thread)->eff_prio = (pr))
+#define td_get_eff_prio(thread)     ((thread)->eff_prio)
+#define td_reset_eff_prio(thread)   ((thread)->eff_prio = (thread)->prio)
+
+/**
+ * Thread descriptor virtual runtime handling
+ */
+#define td_get_vruntime(thread)     ((thread)->vruntime)
+#define td_set_vruntime(thread, vr) ((thread)->vruntime = (vr))
+
+/**
+ * Thread descriptor ready list membership handling
+ */
+#define td_set_queued(thread, q) ((thread)->queued = (q))
+#define td_get_queued(thread)    ((thread)->queued)
+#define td_clear_queued(thread)  ((thread)->queued = THREAD_QUEUED_NONE)
+#define td_is_queued(thread)     ((thread)->queued != THREAD_QUEUED_NONE)
+
+/**
+ * Thread descriptor deadline handling
+ */
+#define td_has_deadline(thread)  ((thread)->deadline != 0)
+#define td_get_deadline(thread)  ((thread)->deadline)
+#define td_get_budget(thread)    ((thread)->budget)
+#define td_is_edf(thread)                                   \
+    (td_has_deadline(thread) && ((thread)->budget > 0))
+#define td_set_deadline(thread, dl, bud)        \
+    {                                           \
+        /* Set the absolute deadline */         \
+        (thread)->deadline = (dl);              \
+                                                \
+        /* Set the budget */                    \
+        (thread)->budget = (bud);               \
+    }
+#define td_use_budget(thread, ns) ((thread)->budget -= (ns))
+#define td_add_dl_miss(thread)   ((thread)->dl_misses++)
+#define td_get_dl_misses(thread) ((thread)->dl_misses)
+
+/**
+ * Thread descriptor preferred scheduler handling
+ */
+#define td_set_affine(thread, sch)  ((thread)->affine = (sch))
+#define td_get_affine(thread)       ((thread)->affine)
+#define td_has_affine(thread)       ((thread)->affine != -1)
+
+/**
+ * Thread descriptor scheduler handling
+ */
+#define td_set_sched(thread, sch)   ((thread)->sched = (sch))
+#define td_get_sched(thread)        ((thread)->sched)
+#define td_is_task(thread)                                      \
+    (td_get_sched(thread) && (td_get_sched(thread)->task_td == (thread)))
+
+/**
+ * Thread descriptor file descriptor readiness handling
+ */
+#define td_set_wait_io(thread, fd, ev)          \
+    {                                           \
+        /* Set the file descriptor */           \
+        (thread)->io_fd = (fd);                 \
+                                                \
+        /* Set the readiness events */          \
+        (thread)->io_events = (ev);             \
+                                                \
+        /* Clear the reported error */          \
+        (thread)->io_err = 0;                   \
+    }
+#define td_get_io_fd(thread)        ((thread)->io_fd)
+#define td_get_io_events(thread)    ((thread)->io_events)
+#define td_set_io_err(thread, err)  ((thread)->io_err = (err))
+#define td_get_io_err(thread)       ((thread)->io_err)
+
+/**
+ * Thread descriptor timed wait handling
+ */
+#define td_set_timeout(thread, tick)                \
+    {                                               \
+        /* Set the expiry tick */                   \
+        (thread)->wh_mem.expiry = (tick);           \
+                                                    \
+        /* Arm the timed wait */                    \
+        (thread)->timed = THREAD_TIMED_ARMED;       \
+    }
+#define td_get_timeout(thread)      ((thread)->wh_mem.expiry)
+#define td_is_timed(thread)         ((thread)->timed != THREAD_TIMED_NONE)
+#define td_set_timed(thread, old, new)              \
+    (atomic_cas(&(thread)->timed, (old), (new)))
+#define td_clear_timed(thread)                      \
+    ({                                              \
+        int __timed;                                \
+                                                    \
+        /* Get the outcome of the timed wait */     \
+        __timed = (thread)->timed;                  \
+                                                    \
+        /* Not waiting with a timeout anymore */    \
+        (thread)->timed = THREAD_TIMED_NONE;        \
+                                                    \
+        /* Return the outcome */                    \
+        __timed;                                    \
+    })
 
 /**
  * Thread descriptor exclusive access handling
@@ -0,0 +1,741 @@
+#include "./mods/utils.h"
+#include "./mods/list.h"
+#include "./mods/lock.h"
+#include "./mmrll.h"
+#include "./mmtask.h"
+#include "./thread.h"
+#include "./thread_descr.h"
+#include "./thread_future.h"
+
+/* Free continuations kept for reuse */
+static List future_conts;
+/* Free combinations kept for reuse */
+static List future_joins;
+/* Number of free continuations and combinations */
+static int future_nb_free;
+/* Lock of the free lists */
+static Lock future_lk = LOCK_INITIALIZER;
+
+static void _thread_future_fire(FutureCont *cont, ptr_t value);
+
+/**
+ * @brief Allocate a continuation
+ *
+ * Reuses a free continuation if one is left
+ *
+ * @return Pointer to the continuation
+ * @return NULL if no memory is left
+ * @note Interrupts should be disabled if called from a user thread
+ */
+static FutureCont *_thread_future_cont_alloc(void) {
+
+    FutureCont *cont = NULL;
+
+    /* Acquire the free list lock */
+    lock_acquire(&future_lk);
+
+    /* Take a free continuation */
+    if (!list_is_empty(&future_conts)) {
+
+        cont = list_dequeue(&future_conts, FutureCont, cll_mem);
+        future_nb_free--;
+    }
+
+    /* Release the free list lock */
+    lock_release(&future_lk);
+
+    /* Else allocate one */
+    return cont ? cont : alloc_mem(FutureCont);
+}
+
+/**
+ * @brief Allocate a combination
+ *
+ * Reuses a free combination if one is left
+ *
+ * @return Pointer to the combination
+ * @return NULL if no memory is left
+ * @note Interrupts should be disabled if called from a user thread
+ */
+static FutureJoin *_thread_future_join_alloc(void) {
+
+    FutureJoin *join = NULL;
+
+    /* Acquire the free list lock */
+    lock_acquire(&future_lk);
+
+    /* Take a free combination */
+    if (!list_is_empty(&future_joins)) {
+
+        join = list_dequeue(&future_joins, FutureJoin, jll_mem);
+        future_nb_free--;
+    }
+
+    /* Release the free list lock */
+    lock_release(&future_lk);
+
+    /* Else allocate one */
+    return join ? join : alloc_mem(FutureJoin);
+}
+
+/**
+ * @brief Free a continuation
+ *
+ * The combination the continuation refers to is freed with its last
+ * continuation. Both are kept for reuse up to FUTURE_CACHE_MAX, and always
+ * when freed by a task, which does not free memory
+ *
+ * @param[in] cont Pointer to the continuation
+ * @note Interrupts should be disabled if called from a user thread
+ */
+static void _thread_future_cont_free(FutureCont *cont) {
+
+    FutureJoin *join = NULL;
+    int keep;
+
+    /* If the continuation is the last one of a combination */
+    if (cont->join && (atomic_fetch_sub(&cont->join->refs, 1) == 1)) {
+
+        /* Free the combination too */
+        join = cont->join;
+    }
+
+    /* Keep them if called from a task */
+    keep = td_is_task(thread_self());
+
+    /* Acquire the free list lock */
+    lock_acquire(&future_lk);
+
+    /* If they can be kept, add them to the free lists */
+    if (keep || (future_nb_free < FUTURE_CACHE_MAX)) {
+
+        keep = 1;
+        list_enqueue(&future_conts, cont, cll_mem);
+        future_nb_free++;
+        if (join) {
+
+            list_enqueue(&future_joins, join, jll_mem);
+            future_nb_free++;
+        }
+    }
+
+    /* Release the free list lock */
+    lock_release(&future_lk);
+
+    /* Else free them */
+    if (!keep) {
+
+        free(join);
+        free(cont);
+    }
+}
+
+/**
+ * @brief Set the value of a future
+ *
+ * Wakes the threads waiting for the value and fires the continuations
+ *
+ * @param[in] future Future handle
+ * @param[in] value Value
+ * @return 1 if the value is set
+ * @return 0 if the future was already set
+ * @note Interrupts should be disabled if called from a user thread
+ */
+static int _thread_future_set(ThreadFuture future, ptr_t value) {
+
+    List waiters, conts;
+    Thread thread;
+    FutureCont *cont;
+
+    /* Acquire the member lock */
+    fut_lock(future);
+
+    /* If the future was already set */
+    if (fut_is_ready(future)) {
+
+        /* Release the member lock */
+        fut_unlock(future);
+
+        return 0;
+    }
+
+    /* Set the value */
+    future->value = value;
+    future->ready = 1;
+
+    /* Take the waiting threads and the continuations */
+    list_init(&waiters);
+    list_init(&conts);
+    list_splice(&waiters, &future->waitll);
+    list_splice(&conts, &future->contll);
+
+    /* Release the member lock */
+    fut_unlock(future);
+
+    /* If threads are waiting */
+    if (!list_is_empty(&waiters)) {
+
+        /* Acquire the many list lock */
+        mmrll_lock();
+
+        /* Add the threads to the many many ready list */
+        while (!list_is_empty(&waiters)) {
+
+            thread = list_dequeue(&waiters, struct Thread, ll_mem);
+            mmrll_enqueue(thread);
+        }
+
+        /* Release the many list lock */
+        mmrll_unlock();
+    }
+
+    /* Fire the continuations */
+    while (!list_is_empty(&conts)) {
+
+        cont = list_dequeue(&conts, FutureCont, cll_mem);
+        _thread_future_fire(cont, value);
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Run a continuation
+ * @param[in] arg Pointer to the continuation (freed)
+ */
+static void _thread_future_cont_run(void *arg) {
+
+    FutureCont *cont = arg;
+    ptr_t ret;
+
+    /* Run the function on the value */
+    ret = cont->func(cont->value, cont->arg);
+
+    /* If a future is set to the result, set it */
+    if (cont->next) {
+
+        _thread_future_set(cont->next, ret);
+    }
+
+    /* Free the continuation */
+    _thread_future_cont_free(cont);
+}
+
+/**
+ * @brief Fire a continuation of a future which was set
+ *
+ * A combination is updated at once, a function is run as a task (or at once
+ * if memory is short)
+ *
+ * @param[in] cont Pointer to the continuation (freed)
+ * @param[in] value Value of the future
+ */
+static void _thread_future_fire(FutureCont *cont, ptr_t value) {
+
+    FutureJoin *join = cont->join;
+
+    /* If the continuation is part of a combination */
+    if (join) {
+
+        /* If the combination is set by this future */
+        if (join->any ? atomic_cas(&join->pending, 1, 0) :
+                        (atomic_fetch_sub(&join->pending, 1) == 1)) {
+
+            /* Set it (to the index of the future for when any) */
+            _thread_future_set(join->out, join->any ? cont->arg : NULL);
+        }
+
+        /* Free the continuation */
+        _thread_future_cont_free(cont);
+
+        return;
+    }
+
+    /* Set the value */
+    cont->value = value;
+
+    /* Run the function as a task */
+    if (!mmtask_spawn(NULL, _thread_future_cont_run, cont)) {
+
+        _thread_future_cont_run(cont);
+    }
+}
+
+/**
+ * @brief Add a continuation to a future
+ *
+ * The continuation fires at once if the future is set already
+ *
+ * @param[in] future Future handle
+ * @param[in] cont Pointer to the continuation
+ * @note Interrupts should be disabled if called from a user thread
+ */
+static void _thread_future_add_cont(ThreadFuture future, FutureCont *cont) {
+
+    /* Acquire the member lock */
+    fut_lock(future);
+
+    /* If the future is not set */
+    if (!fut_is_ready(future)) {
+
+        /* Keep the continuation till it is */
+        fut_add_cont(future, cont);
+
+        /* Release the member lock */
+        fut_unlock(future);
+
+        return;
+    }
+
+    /* Release the member lock */
+    fut_unlock(future);
+
+    /* Fire the continuation */
+    _thread_future_fire(cont, fut_get_value(future));
+}
+
+/**
+ * @brief Combine futures
+ * @param[in] futures Array of the future handles
+ * @param[in] nb Number of futures
+ * @param[out] out Pointer to the combined future handle
+ * @param[in] any 1 for when any, 0 for when all
+ */
+static int _thread_future_when(ThreadFuture *futures, int nb,
+                               ThreadFuture *out, int any) {
+
+    Thread curr_thread;
+    FutureJoin *join;
+    FutureCont **conts;
+    int i;
+
+    /* Check for errors */
+    if (!futures || (nb <= 0) || !out) {
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* For every future */
+    for (i = 0; i < nb; i++) {
+
+        /* Check for errors */
+        if (!futures[i]) {
+
+            /* Set the errno */
+            thread_errno = EINVAL;
+            /* Return failure */
+            return THREAD_FAIL;
+        }
+    }
+
+    /* Get the current thread handle */
+    curr_thread = thread_self();
+
+    /* Disable the interrupts */
+    td_disable_intr(curr_thread);
+
+    /* Allocate the combined future, the combination and the continuations */
+    *out = fut_alloc();
+    join = _thread_future_join_alloc();
+    conts = calloc(nb, sizeof(FutureCont *));
+    for (i = 0; conts && (i < nb); i++) {
+
+        conts[i] = _thread_future_cont_alloc();
+        if (!conts[i]) {
+
+            break;
+        }
+    }
+
+    /* Check for errors */
+    if (!(*out) || !join || !conts || (i < nb)) {
+
+        /* Free what was allocated */
+        while (conts && (i-- > 0)) {
+
+            free(conts[i]);
+        }
+        free(conts);
+        free(join);
+        free(*out);
+
+        /* Enable the interrupts */
+        td_enable_intr(curr_thread);
+
+        /* Set the errno */
+        thread_errno = EAGAIN;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Initialize the combined future */
+    fut_init(*out);
+
+    /* Set the combination */
+    join->refs = nb;
+    join->pending = any ? 1 : nb;
+    join->any = any;
+    join->out = *out;
+
+    /* For every future */
+    for (i = 0; i < nb; i++) {
+
+        /* Set the continuation */
+        conts[i]->func = NULL;
+        conts[i]->arg = (ptr_t)(long)i;
+        conts[i]->next = NULL;
+        conts[i]->join = join;
+
+        /* Add it to the future */
+        _thread_future_add_cont(futures[i], conts[i]);
+    }
+
+    /* Enable the interrupts */
+    td_enable_intr(curr_thread);
+
+    /* Free the array */
+    free(conts);
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Initialize a future
+ * @param[out] future Pointer to the future handle
+ */
+int thread_future_init(ThreadFuture *future) {
+
+    /* Check for errors */
+    if (!future) {              /* If pointer to future is invalid */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Allocate the memory */
+    (*future) = fut_alloc();
+
+    /* Check for errors */
+    if (!(*future)) {
+
+        /* Set the errno */
+        thread_errno = EAGAIN;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Initialize the future */
+    fut_init(*future);
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Set the value of a future (fulfil the promise)
+ *
+ * Wakes the threads waiting for the value and runs the continuations of the
+ * future as tasks. A future is set once
+ *
+ * @param[in] future Pointer to the future handle
+ * @param[in] value Value
+ */
+int thread_future_set(ThreadFuture *future, ptr_t value) {
+
+    Thread curr_thread;
+    int set;
+
+    /* Check for errors */
+    if (!future || !(*future)) {    /* If the future is invalid */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Get the current thread handle */
+    curr_thread = thread_self();
+
+    /* Disable the interrupts */
+    td_disable_intr(curr_thread);
+
+    /* Set the value */
+    set = _thread_future_set(*future, value);
+
+    /* Enable the interrupts */
+    td_enable_intr(curr_thread);
+
+    /* Check for errors */
+    if (!set) {                 /* If the future was already set */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Get the value of a future
+ *
+ * Waits till the future is set. The value is kept, hence any number of
+ * threads can get it
+ *
+ * @param[in] future Pointer to the future handle
+ * @param[out] value Pointer to the value holder
+ */
+int thread_future_get(ThreadFuture *future, ptr_t *value) {
+
+    Thread curr_thread;
+
+    /* Check for errors */
+    if (!future || !(*future)) {    /* If the future is invalid */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Get the current thread handle */
+    curr_thread = thread_self();
+
+    /* Disable the interrupts */
+    td_disable_intr(curr_thread);
+
+    /* Acquire the member lock */
+    fut_lock(*future);
+
+    /* If the future is not set */
+    if (!fut_is_ready(*future)) {
+
+        /* Check for errors */
+        if (td_is_task(curr_thread)) {  /* If a task would wait */
+
+            /* Release the member lock */
+            fut_unlock(*future);
+
+            /* Enable the interrupts */
+            td_enable_intr(curr_thread);
+
+            /* Set the errno */
+            thread_errno = EPERM;
+            /* Return failure */
+            return THREAD_FAIL;
+        }
+
+        /* Add the thread to the waiting threads */
+        fut_add_wait_thread(*future, curr_thread);
+
+        /* Set the future, the calling thread is waiting for */
+        td_set_wait_future(curr_thread, *future);
+
+        /* Update the state */
+        td_set_state(curr_thread, THREAD_STATE_WAIT_FUTURE);
+
+        /* Return to the scheduler, which releases the member lock */
+        td_ret_cxt(curr_thread);
+
+        /* Update the state */
+        td_set_state(curr_thread, THREAD_STATE_RUNNING);
+
+        /* Clear the wait for future */
+        td_set_wait_future(curr_thread, NULL);
+    } else {
+
+        /* Release the member lock */
+        fut_unlock(*future);
+    }
+
+    /* Enable the interrupts */
+    td_enable_intr(curr_thread);
+
+    /* If the value is requested */
+    if (value) {
+
+        *value = fut_get_value(*future);
+    }
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Add a continuation to a future
+ *
+ * Once the future is set, cont(value, arg) runs as a task (see
+ * thread_task_spawn()), and the new future next (if not NULL) is set to its
+ * result. If the future is set already, the task is queued at once
+ *
+ * @param[in] future Pointer to the future handle
+ * @param[in] cont Function run on the value
+ * @param[in] arg Argument of the function
+ * @param[out] next Pointer to the handle of the future of the result (NULL
+ *                  if not needed)
+ */
+int thread_future_then(ThreadFuture *future, thread_cont_t cont, ptr_t arg,
+                       ThreadFuture *next) {
+
+    Thread curr_thread;
+    FutureCont *fcont;
+
+    /* Check for errors */
+    if (!future || !(*future) ||    /* If the future is invalid */
+        !cont) {                    /* If the function is invalid */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Get the current thread handle */
+    curr_thread = thread_self();
+
+    /* Disable the interrupts */
+    td_disable_intr(curr_thread);
+
+    /* Allocate the continuation, and the future of the result */
+    fcont = _thread_future_cont_alloc();
+    if (fcont && next) {
+
+        *next = fut_alloc();
+    }
+
+    /* Check for errors */
+    if (!fcont || (next && !(*next))) {
+
+        /* Free what was allocated */
+        free(fcont);
+
+        /* Enable the interrupts */
+        td_enable_intr(curr_thread);
+
+        /* Set the errno */
+        thread_errno = EAGAIN;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Initialize the future of the result */
+    if (next) {
+
+        fut_init(*next);
+    }
+
+    /* Set the continuation */
+    fcont->func = cont;
+    fcont->arg = arg;
+    fcont->next = next ? *next : NULL;
+    fcont->join = NULL;
+
+    /* Add the continuation to the future */
+    _thread_future_add_cont(*future, fcont);
+
+    /* Enable the interrupts */
+    td_enable_intr(curr_thread);
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Combine futures into a future set once all of them are set
+ *
+ * The combined future is set to NULL, the values are got from the futures
+ *
+ * @param[in] futures Array of the future handles
+ * @param[in] nb Number of futures
+ * @param[out] all Pointer to the combined future handle
+ */
+int thread_future_when_all(ThreadFuture *futures, int nb, ThreadFuture *all) {
+
+    /* Combine the futures */
+    return _thread_future_when(futures, nb, all, 0);
+}
+
+/**
+ * @brief Combine futures into a future set once any of them is set
+ *
+ * The combined future is set to the index of the first future set
+ *
+ * @param[in] futures Array of the future handles
+ * @param[in] nb Number of futures
+ * @param[out] any Pointer to the combined future handle
+ */
+int thread_future_when_any(ThreadFuture *futures, int nb, ThreadFuture *any) {
+
+    /* Combine the futures */
+    return _thread_future_when(futures, nb, any, 1);
+}
+
+/**
+ * @brief Destroy a future
+ *
+ * The continuations waiting for the future are dropped
+ *
+ * @param[in] future Pointer to the future handle
+ */
+int thread_future_destroy(ThreadFuture *future) {
+
+    Thread curr_thread;
+    List conts;
+    int busy;
+
+    /* Check for errors */
+    if (!future || !(*future)) {    /* If the future is invalid */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Get the current thread handle */
+    curr_thread = thread_self();
+
+    /* Disable the interrupts */
+    td_disable_intr(curr_thread);
+
+    /* Acquire the member lock */
+    fut_lock(*future);
+
+    /* Take the continuations, unless threads are waiting */
+    list_init(&conts);
+    busy = fut_has_wait_thread(*future);
+    if (!busy) {
+
+        list_splice(&conts, &(*future)->contll);
+    }
+
+    /* Release the member lock */
+    fut_unlock(*future);
+
+    /* Drop the continuations */
+    while (!list_is_empty(&conts)) {
+
+        _thread_future_cont_free(list_dequeue(&conts, FutureCont, cll_mem));
+    }
+
+    /* Enable the interrupts */
+    td_enable_intr(curr_thread);
+
+    /* Check for errors */
+    if (busy) {                 /* If threads wait for the future */
+
+        /* Set the errno */
+        thread_errno = EBUSY;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Free the future object */
+    fut_free(*future);
+
+    return THREAD_SUCCESS;
+}
@@ -0,0 +1,120 @@
+#ifndef _THREAD_FUTURE_H_
+#define _THREAD_FUTURE_H_
+
+#include "./mods/utils.h"
+#include "./mods/list.h"
+#include "./mods/lock.h"
+#include "./thread.h"
+
+/**
+ * Thread future
+ */
+struct ThreadFuture {
+
+    /* Value is set */
+    int ready;
+
+    /* Value */
+    ptr_t value;
+
+    /* Linked list of waiting threads */
+    List waitll;
+
+    /* Linked list of continuations waiting for the value */
+    List contll;
+
+    /* Lock for members */
+    Lock mem_lock;
+};
+
+/**
+ * Combination of futures (when all or when any of them is set)
+ */
+typedef struct FutureJoin {
+
+    /* Number of continuations referring to the combination */
+    int refs;
+
+    /* Number of futures to be set before the combination is set */
+    int pending;
+
+    /* Combination is set by the first future set (when any) */
+    int any;
+
+    /* Combined future */
+    ThreadFuture out;
+
+    /* List member (once free) */
+    ListMember jll_mem;
+
+} FutureJoin;
+
+/**
+ * Continuation of a future
+ */
+typedef struct FutureCont {
+
+    /* Function run on the value (NULL for a combination) */
+    thread_cont_t func;
+
+    /* Argument of the function, or index of the future in a combination */
+    ptr_t arg;
+
+    /* Value of the future (once set) */
+    ptr_t value;
+
+    /* Future set to the result of the function (NULL if none) */
+    ThreadFuture next;
+
+    /* Combination the future is part of (NULL if none) */
+    FutureJoin *join;
+
+    /* List member */
+    ListMember cll_mem;
+
+} FutureCont;
+
+/* Maximum number of free continuations and combinations kept for reuse (a
+ * task keeps them all) */
+#ifndef FUTURE_CACHE_MAX
+#define FUTURE_CACHE_MAX (1024)
+#endif
+
+/**
+ * Future members handling
+ */
+#define fut_lock(fut)              (lock_acquire(&(fut)->mem_lock))
+#define fut_unlock(fut)            (lock_release(&(fut)->mem_lock))
+#define fut_is_ready(fut)          ((fut)->ready)
+#define fut_get_value(fut)         ((fut)->value)
+#define fut_has_wait_thread(fut)   (!list_is_empty(&(fut)->waitll))
+#define fut_add_wait_thread(fut, thread)                \
+    (list_enqueue(&(fut)->waitll, (thread), ll_mem))
+#define fut_add_cont(fut, cont)                         \
+    (list_enqueue(&(fut)->contll, (cont), cll_mem))
+#define fut_alloc()                                 \
+    ({                                              \
+        ThreadFuture __future;                      \
+                                                    \
+        /* Allocate memory */                       \
+        __future = alloc_mem(struct ThreadFuture);  \
+                                                    \
+        /* Return the pointer */                    \
+        __future;                                   \
+    })
+#define fut_init(fut)                           \
+    {                                           \
+        /* No value yet */                      \
+        (fut)->ready = 0;                       \
+        (fut)->value = NULL;                    \
+                                                \
+        /* Initialize the lists */              \
+        list_init(&(fut)->waitll);              \
+        list_init(&(fut)->contll);              \
+                                                \
+        /* Initialize the lock */               \
+        lock_init(&(fut)->mem_lock);            \
+    }
+#define fut_free(fut)              (free(fut))
+
+#endif
@@ -0,0 +1,459 @@
+#include "./mods/utils.h"
+#include "./mods/lock.h"
+#include "./mmtask.h"
+#include "./thread.h"
+#include "./thread_descr.h"
+#include "./thread_graph.h"
+
+/**
+ * @brief Grow an array if it is full
+ * @param[in/out] arr Pointer to the array
+ * @param[in/out] max Pointer to the size of the array
+ * @param[in] nb Number of elements used
+ * @param[in] size Size of an element
+ * @return 1 if the array has room for another element
+ * @return 0 if no memory is left
+ */
+static int _thread_graph_grow(void **arr, int *max, int nb, size_t size) {
+
+    void *grown;
+    int new_max;
+
+    /* If the array has room */
+    if (nb < *max) {
+
+        return 1;
+    }
+
+    /* Double the size of the array */
+    new_max = *max ? *max * 2 : GRAPH_INIT_SIZE;
+    grown = realloc(*arr, new_max * size);
+
+    /* Check for errors */
+    if (!grown) {
+
+        return 0;
+    }
+
+    /* Update the array */
+    *arr = grown;
+    *max = new_max;
+
+    return 1;
+}
+
+/**
+ * @brief Check if a graph has no cycle
+ *
+ * Removes the nodes without predecessors one by one, and their edges, a
+ * cycle is left if not every node is removed
+ *
+ * @param[in] graph Graph handle
+ * @return 1 if the graph has no cycle
+ * @return 0 if the graph has a cycle
+ * @return -1 if no memory is left
+ */
+static int _thread_graph_check(ThreadGraph graph) {
+
+    int *ready, *preds;
+    int nb_ready = 0, nb_done = 0, node;
+
+    /* Allocate the arrays */
+    ready = malloc(graph->nb * sizeof(int));
+    preds = malloc(graph->nb * sizeof(int));
+
+    /* Check for errors */
+    if (!ready || !preds) {
+
+        free(ready);
+        free(preds);
+        return -1;
+    }
+
+    /* Start from the nodes without predecessors */
+    for (int i = 0; i < graph->nb; i++) {
+
+        preds[i] = graph->nodes[i].nb_pred;
+        if (!preds[i]) {
+
+            ready[nb_ready++] = i;
+        }
+    }
+
+    /* While there are nodes without predecessors left */
+    while (nb_done < nb_ready) {
+
+        /* Remove the node and its edges */
+        node = ready[nb_done++];
+        for (int i = 0; i < graph->nodes[node].nb_succ; i++) {
+
+            if (!--preds[graph->nodes[node].succ[i]]) {
+
+                ready[nb_ready++] = graph->nodes[node].succ[i];
+            }
+        }
+    }
+
+    /* Free the arrays */
+    free(ready);
+    free(preds);
+
+    return (nb_done == graph->nb);
+}
+
+/**
+ * @brief Run a node of a graph
+ *
+ * Once the node completed, its successors whose predecessors all completed
+ * are ready. The last one is run on the same kernel thread at once, the
+ * others are queued as tasks. A successor which cannot be queued (a task
+ * does not allocate task structures) is kept and run after, without
+ * recursion
+ *
+ * @param[in] arg Pointer to the node
+ */
+static void _thread_graph_run_node(void *arg) {
+
+    GraphNode *node = arg;
+    GraphNode *succ, *next, *held = NULL;
+
+    /* While there is a node to run */
+    while (node) {
+
+        /* Run the node */
+        node->func(node->arg);
+
+        /* For every successor */
+        next = NULL;
+        for (int i = 0; i < node->nb_succ; i++) {
+
+            /* If the successor is not ready yet */
+            succ = &node->graph->nodes[node->succ[i]];
+            if (atomic_fetch_sub(&succ->pending, 1) != 1) {
+
+                continue;
+            }
+
+            /* Queue the successor found ready before, keep this one */
+            if (next && !mmtask_spawn(&node->graph->group,
+                                      _thread_graph_run_node, next)) {
+
+                /* If it cannot be queued, keep it too */
+                next->held = held;
+                held = next;
+            }
+            next = succ;
+        }
+
+        /* If no successor is ready, go on with a node kept */
+        if (!next && held) {
+
+            next = held;
+            held = held->held;
+        }
+
+        /* Go on with the last successor found ready */
+        node = next;
+    }
+}
+
+/**
+ * @brief Initialize a task graph
+ * @param[out] graph Pointer to the graph handle
+ */
+int thread_graph_init(ThreadGraph *graph) {
+
+    /* Check for errors */
+    if (!graph) {               /* If pointer to graph is invalid */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Allocate the memory */
+    (*graph) = alloc_mem(struct ThreadGraph);
+
+    /* Check for errors */
+    if (!(*graph)) {
+
+        /* Set the errno */
+        thread_errno = EAGAIN;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* No node yet */
+    (*graph)->nodes = NULL;
+    (*graph)->nb = 0;
+    (*graph)->max = 0;
+    (*graph)->checked = 1;
+    (*graph)->running = 0;
+
+    /* Initialize the task group */
+    (*graph)->group.pending = 0;
+    (*graph)->group.waiter = NULL;
+    lock_init(&(*graph)->group.mem_lock);
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Add a node to a task graph
+ * @param[in] graph Pointer to the graph handle
+ * @param[in] func Function to be run
+ * @param[in] arg Argument
+ * @param[out] node Pointer to the node index holder
+ */
+int thread_graph_node(ThreadGraph *graph, thread_task_t func, ptr_t arg,
+                      int *node) {
+
+    GraphNode *new;
+
+    /* Check for errors */
+    if (!graph || !(*graph) ||  /* If the graph is invalid */
+        !func || !node) {       /* If the function or the holder is invalid */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Check for errors */
+    if ((*graph)->running) {    /* If the graph is running */
+
+        /* Set the errno */
+        thread_errno = EBUSY;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Make room for the node */
+    if (!_thread_graph_grow((void **)&(*graph)->nodes, &(*graph)->max,
+                            (*graph)->nb, sizeof(GraphNode))) {
+
+        /* Set the errno */
+        thread_errno = EAGAIN;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Set the node */
+    new = &(*graph)->nodes[(*graph)->nb];
+    new->func = func;
+    new->arg = arg;
+    new->succ = NULL;
+    new->nb_succ = 0;
+    new->max_succ = 0;
+    new->nb_pred = 0;
+    new->pending = 0;
+    new->graph = *graph;
+
+    /* Return the index of the node */
+    *node = (*graph)->nb++;
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Add an edge to a task graph
+ *
+ * The node to runs once the node from completed
+ *
+ * @param[in] graph Pointer to the graph handle
+ * @param[in] from Index of the predecessor
+ * @param[in] to Index of the successor
+ */
+int thread_graph_edge(ThreadGraph *graph, int from, int to) {
+
+    GraphNode *pred;
+
+    /* Check for errors */
+    if (!graph || !(*graph) ||  /* If the graph is invalid */
+        (from < 0) || (from >= (*graph)->nb) ||     /* If a node is invalid */
+        (to < 0) || (to >= (*graph)->nb)) {
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Check for errors */
+    if ((*graph)->running) {    /* If the graph is running */
+
+        /* Set the errno */
+        thread_errno = EBUSY;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Make room for the successor */
+    pred = &(*graph)->nodes[from];
+    if (!_thread_graph_grow((void **)&pred->succ, &pred->max_succ,
+                            pred->nb_succ, sizeof(int))) {
+
+        /* Set the errno */
+        thread_errno = EAGAIN;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Add the edge */
+    pred->succ[pred->nb_succ++] = to;
+    (*graph)->nodes[to].nb_pred++;
+
+    /* The graph is to be checked for cycles again */
+    (*graph)->checked = 0;
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Run a task graph
+ *
+ * Runs every node once its predecessors completed, the nodes run as tasks
+ * (see thread_task_spawn()). Waits till every node completed. The graph can
+ * be run again, nothing is allocated for a run
+ *
+ * @param[in] graph Pointer to the graph handle
+ */
+int thread_graph_run(ThreadGraph *graph) {
+
+    Thread curr_thread;
+    ThreadTaskGroup group;
+    GraphNode *node;
+    int ret = 1;
+
+    /* Check for errors */
+    if (!graph || !(*graph)) {  /* If the graph is invalid */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Get the current thread handle */
+    curr_thread = thread_self();
+
+    /* Check for errors */
+    if (td_is_task(curr_thread)) {  /* If a task would wait */
+
+        /* Set the errno */
+        thread_errno = EPERM;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Check for errors */
+    if (!atomic_cas(&(*graph)->running, 0, 1)) {    /* If already running */
+
+        /* Set the errno */
+        thread_errno = EBUSY;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* If the graph changed since it was checked for cycles */
+    if (!(*graph)->checked) {
+
+        /* Check it */
+        ret = _thread_graph_check(*graph);
+        (*graph)->checked = (ret == 1);
+    }
+
+    /* Check for errors */
+    if (ret != 1) {             /* If the graph has a cycle */
+
+        /* The graph does not run */
+        (*graph)->running = 0;
+
+        /* Set the errno */
+        thread_errno = ret ? EAGAIN : EDEADLK;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Set the number of predecessors to wait for */
+    for (int i = 0; i < (*graph)->nb; i++) {
+
+        (*graph)->nodes[i].pending = (*graph)->nodes[i].nb_pred;
+    }
+
+    /* Disable the interrupts */
+    td_disable_intr(curr_thread);
+
+    /* For every node without predecessors */
+    for (int i = 0; i < (*graph)->nb; i++) {
+
+        node = &(*graph)->nodes[i];
+        if (node->nb_pred) {
+
+            continue;
+        }
+
+        /* Queue the node, or run it at once if memory is short */
+        if (!mmtask_spawn(&(*graph)->group, _thread_graph_run_node, node)) {
+
+            td_enable_intr(curr_thread);
+            _thread_graph_run_node(node);
+            td_disable_intr(curr_thread);
+        }
+    }
+
+    /* Enable the interrupts */
+    td_enable_intr(curr_thread);
+
+    /* Wait for the nodes */
+    group = &(*graph)->group;
+    thread_task_wait(&group);
+
+    /* The graph can be run again */
+    (*graph)->running = 0;
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Destroy a task graph
+ *
+ * Free the allocated memory for the graph object
+ *
+ * @param[in] graph Pointer to the graph handle
+ */
+int thread_graph_destroy(ThreadGraph *graph) {
+
+    /* Check for errors */
+    if (!(graph) ||             /* Pointer to graph is valid */
+        !(*graph)) {            /* The argument points to a structure */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Check for errors */
+    if ((*graph)->running) {    /* If the graph is running */
+
+        /* Set the errno */
+        thread_errno = EBUSY;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Free the nodes */
+    for (int i = 0; i < (*graph)->nb; i++) {
+
+        free((*graph)->nodes[i].succ);
+    }
+    free((*graph)->nodes);
+
+    /* Free the graph object */
+    free(*graph);
+
+    return THREAD_SUCCESS;
+}
@@ -0,0 +1,70 @@
+#ifndef _THREAD_GRAPH_H_
+#define _THREAD_GRAPH_H_
+
+#include "./mods/utils.h"
+#include "./mmtask.h"
+#include "./thread.h"
+
+/**
+ * Node of a task graph
+ */
+typedef struct GraphNode {
+
+    /* Function to be run */
+    thread_task_t func;
+
+    /* Argument */
+    ptr_t arg;
+
+    /* Indices of the successors */
+    int *succ;
+
+    /* Number of successors */
+    int nb_succ;
+
+    /* Size of the array of the successors */
+    int max_succ;
+
+    /* Number of predecessors */
+    int nb_pred;
+
+    /* Number of predecessors which did not complete in the current run */
+    int pending;
+
+    /* Graph of the node */
+    ThreadGraph graph;
+
+    /* Next node kept to be run by the same task, as no task structure was
+     * free to queue it */
+    struct GraphNode *held;
+
+} GraphNode;
+
+/**
+ * Task graph
+ */
+struct ThreadGraph {
+
+    /* Array of the nodes */
+    GraphNode *nodes;
+
+    /* Number of nodes */
+    int nb;
+
+    /* Size of the array of the nodes */
+    int max;
+
+    /* Graph was checked for cycles since it last changed */
+    int checked;
+
+    /* Graph is running */
+    int running;
+
+    /* Task group of the current run */
+    struct ThreadTaskGroup group;
+};
+
+/* Initial size of the arrays of a task graph */
+#define GRAPH_INIT_SIZE (8)
+
+#endif
@@ -0,0 +1,391 @@
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/io_uring.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#include "./mods/utils.h"
+#include "./mmpoll.h"
+#include "./mmuring.h"
+#include "./thread.h"
+#include "./thread_descr.h"
+
+/**
+ * @brief Make a file descriptor non blocking
+ * @param[in] fd File descriptor
+ * @return 0 or negated errno
+ */
+static long _thread_io_nonblock(int fd) {
+
+    long flags;
+
+    /* Get the file status flags */
+    flags = raw_syscall(SYS_fcntl, fd, F_GETFL, 0, 0, 0, 0);
+
+    /* Check for errors */
+    if (flags < 0) {
+
+        return flags;
+    }
+
+    /* If the file descriptor is already non blocking */
+    if (flags & O_NONBLOCK) {
+
+        return 0;
+    }
+
+    /* Set the non blocking flag */
+    return raw_syscall(SYS_fcntl, fd, F_SETFL, flags | O_NONBLOCK, 0, 0, 0);
+}
+
+/**
+ * @brief Wait for a file descriptor to be ready
+ *
+ * The calling thread gives up the control and is put back on the ready list
+ * by the poller once the file descriptor is ready
+ *
+ * @param[in] fd File descriptor
+ * @param[in] events Readiness event (EPOLLIN or EPOLLOUT)
+ * @return 0 or negated errno
+ */
+static long _thread_io_wait(int fd, unsigned int events) {
+
+    Thread thread;
+    long ret;
+
+    /* Prepare the poll state of the file descriptor */
+    ret = mmpoll_prepare(fd);
+
+    /* Check for errors */
+    if (ret) {
+
+        return ret;
+    }
+
+    /* Get the thread handle */
+    thread = thread_self();
+
+    /* Disable interrupt */
+    td_disable_intr(thread);
+
+    /* Set the file descriptor and the event waited for */
+    td_set_wait_io(thread, fd, events);
+
+    /* Update the state */
+    td_set_state(thread, THREAD_STATE_WAIT_IO);
+
+    /* Return to the scheduler, which hands the thread to the poller */
+    td_ret_cxt(thread);
+
+    /* Update the state */
+    td_set_state(thread, THREAD_STATE_RUNNING);
+
+    /* Enable the interrupt */
+    td_enable_intr(thread);
+
+    return -td_get_io_err(thread);
+}
+
+/**
+ * @brief Run an I/O operation on the ring of the scheduler
+ *
+ * The calling thread gives up the control, the scheduler queues the
+ * operation on its ring and the thread is put back on the ready list once
+ * the operation completed
+ *
+ * @param[in] opcode Operation code (IORING_OP_*)
+ * @param[in] fd File descriptor
+ * @param[in] addr Buffer or address
+ * @param[in] len Length of the buffer
+ * @param[in] off File offset, or address length
+ * @param[in] op_flags Flags of the operation
+ * @return Result of the operation, -EAGAIN if the ring cannot run it
+ */
+static long _thread_io_submit(unsigned char opcode, int fd,
+                              unsigned long addr, size_t len,
+                              unsigned long off, unsigned int op_flags) {
+
+    Thread thread;
+    RingOp op;
+
+    /* If the io_uring backend is not used */
+    if (!mmuring_is_enabled()) {
+
+        return -EAGAIN;
+    }
+
+    /* Set the operation (the length is 32 bits wide on the ring) */
+    op.opcode = opcode;
+    op.fd = fd;
+    op.addr = addr;
+    op.len = (len < INT_MAX) ? len : INT_MAX;
+    op.off = off;
+    op.op_flags = op_flags;
+
+    /* Get the thread handle */
+    thread = thread_self();
+
+    /* While the operation is interrupted */
+    do {
+
+        /* Disable interrupt */
+        td_disable_intr(thread);
+
+        /* Set the operation the thread is waiting for */
+        td_set_wait_op(thread, &op);
+
+        /* Update the state */
+        td_set_state(thread, THREAD_STATE_WAIT_RING);
+
+        /* Return to the scheduler, which queues the operation */
+        td_ret_cxt(thread);
+
+        /* Update the state */
+        td_set_state(thread, THREAD_STATE_RUNNING);
+
+        /* Clear the wait for operation */
+        td_set_wait_op(thread, NULL);
+
+        /* Enable the interrupt */
+        td_enable_intr(thread);
+
+    } while (op.res == -EINTR);
+
+    return op.res;
+}
+
+/**
+ * Run a non blocking system call, waiting for the file descriptor to be
+ * ready as long as the system call would block
+ */
+#define _thread_io_call(ret, fd, events, call)                  \
+    {                                                           \
+        /* Make the file descriptor non blocking */             \
+        (ret) = _thread_io_nonblock(fd);                        \
+                                                                \
+        /* While no error occured */                            \
+        while (!(ret)) {                                        \
+                                                                \
+            /* Run the system call */                           \
+            (ret) = (call);                                     \
+                                                                \
+            /* If it would block */                             \
+            if (((ret) == -EAGAIN) || ((ret) == -EWOULDBLOCK)) {\
+                                                                \
+                /* Wait for the file descriptor to be ready */  \
+                (ret) = _thread_io_wait(fd, events);            \
+                                                                \
+            /* If it was interrupted */                         \
+            } else if ((ret) == -EINTR) {                       \
+                                                                \
+                /* Retry */                                     \
+                (ret) = 0;                                      \
+                                                                \
+            } else {                                            \
+                                                                \
+                break;                                          \
+            }                                                   \
+        }                                                       \
+    }
+
+/**
+ * @brief Read from a file descriptor
+ *
+ * The read is run on the ring of the scheduler. Without the ring, the file
+ * descriptor is made non blocking, and if no data is available the calling
+ * thread waits for the file descriptor to be readable. In both cases the
+ * kernel thread is not blocked
+ *
+ * @param[in] fd File descriptor
+ * @param[out] buf Buffer to read into
+ * @param[in] count Maximum number of bytes to read
+ * @return Number of bytes read, THREAD_FAIL on error
+ */
+ssize_t thread_read(int fd, void *buf, size_t count) {
+
+    long ret;
+
+    /* Read on the ring of the scheduler */
+    ret = _thread_io_submit(IORING_OP_READ, fd, (unsigned long)buf, count,
+                            -1ul, 0);
+
+    /* If the ring cannot run it */
+    if (ret == -EAGAIN) {
+
+        /* Read once the file descriptor is readable */
+        _thread_io_call(ret, fd, EPOLLIN,
+                        raw_syscall(SYS_read, fd, (long)buf, count,
+                                    0, 0, 0));
+    }
+
+    /* Check for errors */
+    if (ret < 0) {
+
+        /* Set the errno */
+        thread_errno = -ret;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Write to a file descriptor
+ *
+ * The write is run on the ring of the scheduler. Without the ring, the file
+ * descriptor is made non blocking, and if no space is available the calling
+ * thread waits for the file descriptor to be writable. In both cases the
+ * kernel thread is not blocked
+ *
+ * @param[in] fd File descriptor
+ * @param[in] buf Buffer to write from
+ * @param[in] count Maximum number of bytes to write
+ * @return Number of bytes written, THREAD_FAIL on error
+ */
+ssize_t thread_write(int fd, const void *buf, size_t count) {
+
+    long ret;
+
+    /* Write on the ring of the scheduler */
+    ret = _thread_io_submit(IORING_OP_WRITE, fd, (unsigned long)buf, count,
+                            -1ul, 0);
+
+    /* If the ring cannot run it */
+    if (ret == -EAGAIN) {
+
+        /* Write once the file descriptor is writable */
+        _thread_io_call(ret, fd, EPOLLOUT,
+                        raw_syscall(SYS_write, fd, (long)buf, count,
+                                    0, 0, 0));
+    }
+
+    /* Check for errors */
+    if (ret < 0) {
+
+        /* Set the errno */
+        thread_errno = -ret;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Accept a connection on a socket
+ *
+ * The accept is run on the ring of the scheduler. Without the ring, the
+ * listening socket is made non blocking, and if no connection is pending
+ * the calling thread waits for one. In both cases the kernel thread is not
+ * blocked. The accepted socket is non blocking
+ *
+ * @param[in] sockfd Listening socket
+ * @param[out] addr Pointer to the peer address (can be NULL)
+ * @param[in,out] addrlen Pointer to the size of the peer address
+ * @return Accepted socket, THREAD_FAIL on error
+ */
+int thread_accept(int sockfd, struct sockaddr *addr, socklen_t *addrlen) {
+
+    long ret;
+
+    /* Accept on the ring of the scheduler */
+    ret = _thread_io_submit(IORING_OP_ACCEPT, sockfd, (unsigned long)addr, 0,
+                            (unsigned long)addrlen, SOCK_NONBLOCK);
+
+    /* If the ring cannot run it */
+    if (ret == -EAGAIN) {
+
+        /* Accept once a connection is pending */
+        _thread_io_call(ret, sockfd, EPOLLIN,
+                        raw_syscall(SYS_accept4, sockfd, (long)addr,
+                                    (long)addrlen, SOCK_NONBLOCK, 0, 0));
+    }
+
+    /* Check for errors */
+    if (ret < 0) {
+
+        /* Set the errno */
+        thread_errno = -ret;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Connect a socket
+ *
+ * The connection is run on the ring of the scheduler. Without the ring, the
+ * socket is made non blocking, and if the connection cannot be completed
+ * right away the calling thread waits for it. In both cases the kernel
+ * thread is not blocked
+ *
+ * @param[in] sockfd Socket
+ * @param[in] addr Pointer to the peer address
+ * @param[in] addrlen Size of the peer address
+ * @return THREAD_SUCCESS, THREAD_FAIL on error
+ */
+int thread_connect(int sockfd, const struct sockaddr *addr,
+                   socklen_t addrlen) {
+
+    socklen_t len;
+    long ret;
+    int err;
+
+    /* Connect on the ring of the scheduler */
+    ret = _thread_io_submit(IORING_OP_CONNECT, sockfd, (unsigned long)addr, 0,
+                            addrlen, 0);
+
+    /* If the ring cannot run it */
+    if (ret == -EAGAIN) {
+
+        /* Make the socket non blocking */
+        ret = _thread_io_nonblock(sockfd);
+
+        /* Start the connection */
+        while (!ret) {
+
+            ret = raw_syscall(SYS_connect, sockfd, (long)addr, addrlen,
+                              0, 0, 0);
+
+            /* If interrupted, retry */
+            if (ret != -EINTR) {
+
+                break;
+            }
+
+            ret = 0;
+        }
+    }
+
+    /* If the connection is in progress (also reported by the ring for a non
+     * blocking socket on older kernels) */
+    if (ret == -EINPROGRESS) {
+
+        /* Wait for the socket to be writable */
+        ret = _thread_io_wait(sockfd, EPOLLOUT);
+
+        /* If it became writable */
+        if (!ret) {
+
+            /* Get the result of the connection */
+            len = sizeof(err);
+            ret = raw_syscall(SYS_getsockopt, sockfd, SOL_SOCKET, SO_ERROR,
+                              (long)&err, (long)&len, 0);
+            ret = ret ? ret : -err;
+        }
+    }
+
+    /* Check for errors */
+    if (ret < 0) {
+
+        /* Set the errno */
+        thread_errno = -ret;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    return THREAD_SUCCESS;
+}
@@ -1,13 +1,16 @@
 #include "./mods/lock.h"
 #include "./mmrll.h"
+#include "./mmoffload.h"
+#include "./mmpoll.h"
 #include "./mmsched.h"
+#include "./mmtask.h"
+#include "./mmtimer.h"
+#include "./mmuring.h"
 #include "./thread.h"
 #include "./thread_descr.h"
 
 /* Get the global user thread id */
 extern int nxt_utid;
-/* Get the global user thrad id lock */
-extern Lock nxt_utid_lk;
 
 /* Default number of kernel threads */
 #define DEFAULT_NB_KTHREADS  (1u)
@@ -37,27 +40,46 @@ int main(int argc, char *argv[]) {
         nb_kthreads = DEFAULT_NB_KTHREADS;
     } else {
 
-        /* Else use the given number of kernel threads */
+        /* Else use the given number of kernel threads (0 scales the number
+         * of kernel threads automatically) */
         nb_kthreads = atoi(argv[1]);
     }
 
     /* Initialize the global user thread id */
     nxt_utid = 0;
 
-    /* Initialize the global use thread id lock */
-    lock_init(&nxt_utid_lk);
+    /* Initialize the Thread-Local-Storage areas */
+    tls_init();
+
+    /* Initialize the stack cache */
+    stack_cache_init();
 
     /* Initialize the many-many ready list */
     mmrll_init();
 
+    /* Initialize the poller */
+    mmpoll_init();
+
+    /* Initialize the completion rings */
+    mmuring_init();
+
+    /* Initialize the timer wheel */
+    mmtimer_init();
+
+    /* Initialize the offloading */
+    mmoffload_init();
+
+    /* Initialize the tasks */
+    mmtask_init();
+
     /* Initialize the schedulers */
     mmsched_init(nb_kthreads);
 
     /* Create the main thread */
     thread_create(&main_td, thread_main, NULL);
 
-    /* Wait for its completion */
-    while (!td_is_over(main_td));
+    /* Sleep till its completion */
+    td_wait_over(main_td);
 
     /* If the main thread is not joined */
     if (!td_is_joined(main_td)) {
@@ -69,5 +91,23 @@ int main(int argc, char *argv[]) {
     /* Deinitialize the schedulers */
     mmsched_deinit();
 
+    /* Deinitialize the poller */
+    mmpoll_deinit();
+
+    /* Deinitialize the completion rings */
+    mmuring_deinit();
+
+    /* Deinitialize the offloading */
+    mmoffload_deinit();
+
+    /* Deinitialize the tasks */
+    mmtask_deinit();
+
+    /* Deallocate the cached stacks */
+    stack_cache_deinit();
+
+    /* Deinitialize the Thread-Local-Storage areas */
+    tls_deinit();
+
     return 0;
 }
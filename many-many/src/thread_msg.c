@@ -0,0 +1,120 @@
+#include "./mods/utils.h"
+#include "./mods/mpsc.h"
+#include "./mmrll.h"
+#include "./thread.h"
+#include "./thread_descr.h"
+
+/**
+ * @brief Send a message to a thread
+ *
+ * Pushes the message to the mailbox of the thread without any lock nor
+ * allocation, the message node is provided by the sender. If the thread is
+ * parked on its empty mailbox, the sender makes it ready
+ *
+ * @param[in] thread Thread handle
+ * @param[in] msg Pointer to the message node
+ */
+int thread_send(Thread thread, ThreadMsg *msg) {
+
+    Thread curr_thread;
+
+    /* Check for errors */
+    if (!thread ||              /* If the thread is invalid */
+        !msg) {                 /* If the message is invalid */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Check for errors */
+    if (td_is_exited(thread) || /* If the thread exited */
+        td_is_joined(thread)) {
+
+        /* Set the errno */
+        thread_errno = ESRCH;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Push the message to the mailbox */
+    td_send_msg(thread, msg);
+
+    /* If the thread is parked, the first sender makes it ready */
+    if (td_unpark_mailbox(thread)) {
+
+        /* Get the current thread handle */
+        curr_thread = thread_self();
+
+        /* Disable the interrupts */
+        td_disable_intr(curr_thread);
+
+        /* Push the thread to the ready list */
+        mmrll_push(thread);
+
+        /* Enable the interrupts */
+        td_enable_intr(curr_thread);
+    }
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Receive a message
+ *
+ * Takes the oldest message of the mailbox of the calling thread, the thread
+ * is parked till a message is sent if the mailbox is empty
+ *
+ * @param[out] msg Pointer to the message node holder
+ */
+int thread_recv(ThreadMsg **msg) {
+
+    Thread curr_thread;
+    ThreadMsg *mail;
+
+    /* Check for errors */
+    if (!msg) {                 /* If pointer to msg is invalid */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Get the current thread handle */
+    curr_thread = thread_self();
+
+    /* While the mailbox is empty */
+    while (!(mail = td_recv_msg(curr_thread))) {
+
+        /* Check for errors */
+        if (td_is_task(curr_thread)) {  /* If a task would wait */
+
+            /* Set the errno */
+            thread_errno = EPERM;
+            /* Return failure */
+            return THREAD_FAIL;
+        }
+
+        /* Disable the interrupts */
+        td_disable_intr(curr_thread);
+
+        /* Update the state */
+        td_set_state(curr_thread, THREAD_STATE_WAIT_MSG);
+
+        /* Return to the scheduler, which parks the thread */
+        td_ret_cxt(curr_thread);
+
+        /* Update the state */
+        td_set_state(curr_thread, THREAD_STATE_RUNNING);
+
+        /* Enable the interrupts */
+        td_enable_intr(curr_thread);
+    }
+
+    /* Get the message */
+    *msg = mail;
+
+    return THREAD_SUCCESS;
+}
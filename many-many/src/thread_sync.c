@@ -2,6 +2,7 @@
 #include <stddef.h>
 
 #include "./mmrll.h"
+#include "./mmtimer.h"
 #include "./thread_descr.h"
 #include "./thread_sync.h"
 
@@ -225,12 +226,13 @@ int thread_mutex_init(ThreadMutex *mutex) {
  * @brief Acquires the mutex
  *
  * Acquires the mutex and sets the owner of the lock to the calling thread.
- * The function does not return unless the lock is acquired. However a waiting
- * thread will not consume CPU
+ * The function does not return unless the lock is acquired or the timeout
+ * expired. However a waiting thread will not consume CPU
  *
  * @param[in] mutex Pointer to the mutex instance
+ * @param[in] timeout_ns Time to wait for in nano seconds (negative if none)
  */
-int thread_mutex_lock(ThreadMutex *mutex) {
+static int _thread_mutex_lock(ThreadMutex *mutex, long timeout_ns) {
 
     Thread thread;
 
@@ -274,21 +276,77 @@ int thread_mutex_lock(ThreadMutex *mutex) {
     /* Add the thread to the list */
     mut_add_wait_thread(*mutex, thread);
 
+    /* If the wait is timed, set the expiry tick */
+    if (timeout_ns >= 0) {
+
+        td_set_timeout(thread, mmtimer_tick(timeout_ns));
+    }
+
     /* Return to the scheduler */
     td_ret_cxt(thread);
 
-    /* Clear the wait for mutex */
-    td_set_wait_mutex(thread, NULL);
-
     /* Update the state */
     td_set_state(thread, THREAD_STATE_RUNNING);
 
     /* Enabe the interrupt */
     td_enable_intr(thread);
 
+    /* If the timeout expired before the mutex was handed over (the timer
+     * removed the thread from the list) */
+    if (td_clear_timed(thread) == THREAD_TIMED_EXPIRED) {
+
+        /* Set the errno */
+        thread_errno = ETIMEDOUT;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Clear the wait for mutex */
+    td_set_wait_mutex(thread, NULL);
+
     return THREAD_SUCCESS;
 }
 
+/**
+ * @brief Acquires the mutex
+ *
+ * Acquires the mutex and sets the owner of the lock to the calling thread.
+ * The function does not return unless the lock is acquired. However a waiting
+ * thread will not consume CPU
+ *
+ * @param[in] mutex Pointer to the mutex instance
+ */
+int thread_mutex_lock(ThreadMutex *mutex) {
+
+    /* Wait without a timeout */
+    return _thread_mutex_lock(mutex, -1);
+}
+
+/**
+ * @brief Acquires the mutex, with a timeout
+ *
+ * Acquires the mutex and sets the owner of the lock to the calling thread.
+ * The function returns with ETIMEDOUT if the lock is not acquired within the
+ * given time
+ *
+ * @param[in] mutex Pointer to the mutex instance
+ * @param[in] timeout_ns Time to wait for in nano seconds
+ */
+int thread_mutex_timedlock(ThreadMutex *mutex, unsigned long timeout_ns) {
+
+    /* Check for errors */
+    if ((long)timeout_ns < 0) {
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Wait with the timeout */
+    return _thread_mutex_lock(mutex, timeout_ns);
+}
+
 /**
  * @brief Tries to acquire the mutex
  *
@@ -377,35 +435,39 @@ int thread_mutex_unlock(ThreadMutex *mutex) {
         return THREAD_FAIL;
     }
 
-    /* If there are threads waiting */
-    if (mut_has_wait_thread(*mutex)) {
+    /* Set the owner to none */
+    mut_set_owner(*mutex, NULL);
+
+    /* Disable interrupts */
+    td_disable_intr(thread);
+
+    /* While there are threads waiting */
+    while (mut_has_wait_thread(*mutex)) {
 
         /* Get the first waiting thread */
         wait_thread = mut_get_wait_thread(*mutex);
 
-        /* Set the owner as the wait thread */
-        mut_set_owner(*mutex, wait_thread);
+        /* It is not on the list anymore */
+        td_set_wait_mutex(wait_thread, NULL);
 
-        /* Disable interrupts */
-        td_disable_intr(thread);
+        /* If its timeout expired first, the timer wakes it */
+        if (!mmtimer_cancel(wait_thread)) {
 
-        /* Acquire the many list lock */
-        mmrll_lock();
+            continue;
+        }
 
-        /* Add thread to the many many ready list */
-        mmrll_enqueue(wait_thread);
-
-        /* Acquire the many list lock */
-        mmrll_unlock();
+        /* Set the owner as the wait thread */
+        mut_set_owner(*mutex, wait_thread);
 
-        /* Enable interrupts */
-        td_enable_intr(thread);
-    } else {
+        /* Push thread to the many many ready list */
+        mmrll_push(wait_thread);
 
-        /* Set the owner to none */
-        mut_set_owner(*mutex, NULL);
+        break;
     }
 
+    /* Enable interrupts */
+    td_enable_intr(thread);
+
     /* Acquire the list lock */
     mut_unlock(*mutex);
 
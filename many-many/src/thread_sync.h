@@ -81,6 +81,8 @@ struct ThreadMutex {
     (list_enqueue(&(mut)->waitll, (thread), ll_mem))
 #define mut_get_wait_thread(mut)                            \
     (list_dequeue(&(mut)->waitll, struct Thread, ll_mem))
+#define mut_del_wait_thread(mut, thread)                \
+    (list_remove(&(mut)->waitll, (thread), ll_mem))
 #define mut_alloc()                                 \
     ({                                              \
         ThreadMutex __mutex;                        \
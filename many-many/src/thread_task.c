@@ -0,0 +1,557 @@
+#include "./mods/utils.h"
+#include "./mods/lock.h"
+#include "./mmsched.h"
+#include "./mmtask.h"
+#include "./thread.h"
+#include "./thread_descr.h"
+
+/**
+ * @brief Queue a task from a thread or a task
+ * @param[in] group Task group handle (NULL if none)
+ * @param[in] task Function to be run
+ * @param[in] arg Argument
+ * @return 1 if the task is queued
+ * @return 0 if no memory is left
+ */
+static int _thread_task_queue(ThreadTaskGroup group, thread_task_t task,
+                              ptr_t arg) {
+
+    Thread curr_thread;
+    int spawned;
+
+    /* Get the current thread handle */
+    curr_thread = thread_self();
+
+    /* Disable the interrupts */
+    td_disable_intr(curr_thread);
+
+    /* Queue the task */
+    spawned = mmtask_spawn(group, task, arg);
+
+    /* Enable the interrupts */
+    td_enable_intr(curr_thread);
+
+    return spawned;
+}
+
+/**
+ * @brief Hand the result of a half of a range to its split point
+ *
+ * The half which completes last combines the results of both halves and
+ * hands the result to the enclosing split point, up to the whole range
+ *
+ * @param[in] job Pointer to the loop
+ * @param[in] node Pointer to the split point (NULL for the whole range)
+ * @param[in] side Half of the split point (0 lower, 1 upper)
+ * @param[in] res Result of the half
+ */
+static void _thread_range_deliver(RangeJob *job, RangeNode *node, int side,
+                                  ptr_t res) {
+
+    RangeNode *parent;
+
+    /* While there is a split point */
+    while (node) {
+
+        /* Hand the result */
+        node->res[side] = res;
+
+        /* If the other half did not complete, it combines the results */
+        if (atomic_fetch_sub(&node->pending, 1) != 1) {
+
+            return;
+        }
+
+        /* Combine the results of the halves, lower half first */
+        res = job->combine(node->res[0], node->res[1], job->ctx);
+
+        /* Go to the enclosing split point */
+        parent = node->parent;
+        side = node->side;
+        node = parent;
+    }
+
+    /* Set the result of the whole range */
+    job->ret = res;
+}
+
+/**
+ * @brief Run a range of a parallel loop
+ *
+ * Splits the range in halves till it is not above the grain, the upper halves
+ * are queued as tasks (for the other kernel threads to take) and the lower
+ * halves are split further. The last lower half is run, and its result
+ * handed to its split point for a reduction. The ranges and the split points
+ * are taken from the ones the calling thread allocated, no memory is
+ * allocated by the tasks. If a half cannot be queued the range is run without
+ * being split further
+ *
+ * @param[in] arg Pointer to the range
+ */
+static void _thread_range_run(void *arg) {
+
+    Range *range = arg;
+    RangeJob *job = range->job;
+    RangeNode *node = NULL;
+    Range *upper;
+    long mid;
+
+    /* While the range is above the grain */
+    while (range->end - range->begin > job->grain) {
+
+        /* Take the upper half, and the split point for a reduction */
+        upper = &job->ranges[atomic_fetch_add(&job->nb_ranges, 1)];
+        if (!job->body) {
+
+            node = &job->nodes[atomic_fetch_add(&job->nb_nodes, 1)];
+        }
+
+        /* Get the middle of the range */
+        mid = range->begin + (range->end - range->begin) / 2;
+
+        /* Set the split point */
+        if (node) {
+
+            node->parent = range->parent;
+            node->side = range->side;
+            node->pending = 2;
+        }
+
+        /* Set the upper half */
+        upper->begin = mid;
+        upper->end = range->end;
+        upper->job = job;
+        upper->parent = node;
+        upper->side = 1;
+
+        /* Queue the upper half */
+        if (!_thread_task_queue(job->group, _thread_range_run, upper)) {
+
+            break;
+        }
+
+        /* Go on with the lower half */
+        range->end = mid;
+        range->parent = node;
+        range->side = 0;
+    }
+
+    /* Run the range */
+    if (job->body) {
+
+        job->body(range->begin, range->end, job->ctx);
+    } else {
+
+        _thread_range_deliver(job, range->parent, range->side,
+                              job->map(range->begin, range->end, job->ctx));
+    }
+}
+
+/**
+ * @brief Run a parallel loop
+ *
+ * The calling thread splits the range and runs the lowest half itself, then
+ * waits for the halves queued as tasks. A range not above the grain, or a
+ * loop started from a task (which cannot wait), is run without being split
+ *
+ * @param[in/out] job Pointer to the loop
+ * @param[in] begin First index
+ * @param[in] end Index past the last one
+ */
+static void _thread_parallel(RangeJob *job, long begin, long end) {
+
+    struct ThreadTaskGroup group;
+    Range *range;
+    long min_grain, nb = 1;
+
+    /* If no grain is given, split the range in MMTASK_CHUNKS chunks per
+     * kernel thread */
+    if (job->grain <= 0) {
+
+        job->grain = (end - begin) / (MMTASK_CHUNKS *
+                                      mmsched_getconcurrency());
+        if (job->grain < 1) {
+
+            job->grain = 1;
+        }
+    }
+
+    /* Raise the grain to split the range in MMTASK_CHUNKS_MAX chunks at
+     * most */
+    min_grain = (end - begin + MMTASK_CHUNKS_MAX - 1) / MMTASK_CHUNKS_MAX;
+    if (job->grain < min_grain) {
+
+        job->grain = min_grain;
+    }
+
+    /* If the range is split, allocate the ranges and the split points, at
+     * most a power of two of chunks covering the range */
+    range = NULL;
+    if ((end - begin > job->grain) && !td_is_task(thread_self())) {
+
+        while (nb * job->grain < end - begin) {
+
+            nb *= 2;
+        }
+
+        range = malloc(nb * sizeof(Range) +
+                       (job->body ? 0 : (nb - 1) * sizeof(RangeNode)));
+    }
+
+    /* If the range is not split */
+    if (!range) {
+
+        /* Run it on the calling thread */
+        if (job->body) {
+
+            job->body(begin, end, job->ctx);
+        } else {
+
+            job->ret = job->map(begin, end, job->ctx);
+        }
+
+        return;
+    }
+
+    /* Initialize the task group of the halves */
+    group.pending = 0;
+    group.waiter = NULL;
+    lock_init(&group.mem_lock);
+    job->group = &group;
+
+    /* Take the first range for the whole range */
+    job->ranges = range;
+    job->nodes = (RangeNode *)(range + nb);
+    job->nb_ranges = 1;
+    job->nb_nodes = 0;
+
+    /* Set the whole range */
+    range->begin = begin;
+    range->end = end;
+    range->job = job;
+    range->parent = NULL;
+    range->side = 0;
+
+    /* Split and run the range */
+    _thread_range_run(range);
+
+    /* Wait for the halves queued as tasks */
+    thread_task_wait(&job->group);
+
+    /* Free the ranges and the split points */
+    free(job->ranges);
+}
+
+/**
+ * @brief Initialize a task group
+ * @param[out] group Pointer to the task group handle
+ */
+int thread_task_group_init(ThreadTaskGroup *group) {
+
+    /* Check for errors */
+    if (!group) {               /* If pointer to task group is invalid */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Allocate the memory */
+    (*group) = alloc_mem(struct ThreadTaskGroup);
+
+    /* Check for errors */
+    if (!(*group)) {
+
+        /* Set the errno */
+        thread_errno = EAGAIN;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* No task and no waiting thread yet */
+    (*group)->pending = 0;
+    (*group)->waiter = NULL;
+
+    /* Initialize the member lock */
+    lock_init(&(*group)->mem_lock);
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Spawn a task
+ *
+ * The task runs to completion on the stack of a kernel thread, between the
+ * dispatches of the threads, without a stack or a context of its own. A
+ * task can spawn tasks, but must not wait (join, lock a mutex, sleep, wait
+ * for a task group, etc.). thread_self() returns the task thread descriptor
+ * of the kernel thread while it runs
+ *
+ * @param[in] group Pointer to the task group handle (NULL if none)
+ * @param[in] task Function to be run
+ * @param[in] arg Argument
+ */
+int thread_task_spawn(ThreadTaskGroup *group, thread_task_t task, ptr_t arg) {
+
+    /* Check for errors */
+    if (!task ||                /* If the function is invalid */
+        (group && !(*group))) { /* If the task group is invalid */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Queue the task */
+    if (!_thread_task_queue(group ? *group : NULL, task, arg)) {
+
+        /* If a task spawns it, which does not allocate memory, run it at
+         * once */
+        if (td_is_task(thread_self())) {
+
+            task(arg);
+            return THREAD_SUCCESS;
+        }
+
+        /* Set the errno */
+        thread_errno = EAGAIN;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Wait for the tasks of a group
+ *
+ * Waits till every task spawned in the group so far completed
+ *
+ * @param[in] group Pointer to the task group handle
+ */
+int thread_task_wait(ThreadTaskGroup *group) {
+
+    Thread curr_thread;
+
+    /* Get the current thread handle */
+    curr_thread = thread_self();
+
+    /* Check for errors */
+    if (!group || !(*group)) {  /* If the task group is invalid */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Check for errors */
+    if (td_is_task(curr_thread)) {  /* If a task would wait */
+
+        /* Set the errno */
+        thread_errno = EPERM;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Disable the interrupts */
+    td_disable_intr(curr_thread);
+
+    /* Acquire the member lock */
+    lock_acquire(&(*group)->mem_lock);
+
+    /* If every task completed */
+    if (!(*group)->pending) {
+
+        /* Release the member lock */
+        lock_release(&(*group)->mem_lock);
+
+        /* Enable the interrupts */
+        td_enable_intr(curr_thread);
+
+        return THREAD_SUCCESS;
+    }
+
+    /* Check for errors */
+    if ((*group)->waiter) {     /* If another thread waits for the group */
+
+        /* Release the member lock */
+        lock_release(&(*group)->mem_lock);
+
+        /* Enable the interrupts */
+        td_enable_intr(curr_thread);
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Set the thread waiting for the group */
+    (*group)->waiter = curr_thread;
+
+    /* Set the task group, the calling thread is waiting for */
+    td_set_wait_group(curr_thread, *group);
+
+    /* Update the state */
+    td_set_state(curr_thread, THREAD_STATE_WAIT_TASK);
+
+    /* Return to the scheduler, which releases the member lock */
+    td_ret_cxt(curr_thread);
+
+    /* Update the state */
+    td_set_state(curr_thread, THREAD_STATE_RUNNING);
+
+    /* Clear the wait for task group */
+    td_set_wait_group(curr_thread, NULL);
+
+    /* Enable the interrupts */
+    td_enable_intr(curr_thread);
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Destroy a task group
+ *
+ * Free the allocated memory for the task group object
+ *
+ * @param[in] group Pointer to the task group handle
+ */
+int thread_task_group_destroy(ThreadTaskGroup *group) {
+
+    Thread curr_thread;
+    int pending;
+
+    /* Check for errors */
+    if (!(group) ||             /* Pointer to task group is valid */
+        !(*group)) {            /* The argument points to a structure */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Get the current thread handle */
+    curr_thread = thread_self();
+
+    /* Disable the interrupts */
+    td_disable_intr(curr_thread);
+
+    /* Get the number of tasks left, the lock is taken so that the task which
+     * completed last is done with the group */
+    lock_acquire(&(*group)->mem_lock);
+    pending = (*group)->pending;
+    lock_release(&(*group)->mem_lock);
+
+    /* Enable the interrupts */
+    td_enable_intr(curr_thread);
+
+    /* Check for errors */
+    if (pending) {              /* If tasks did not complete */
+
+        /* Set the errno */
+        thread_errno = EBUSY;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Free the task group object */
+    free(*group);
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Run a function on the chunks of a range in parallel
+ *
+ * The range [begin, end) is split recursively in halves till the halves are
+ * not above grain indices (0 picks a grain), and body(chunk_begin, chunk_end,
+ * ctx) is run on every chunk, on the calling thread and as tasks
+ *
+ * @param[in] begin First index
+ * @param[in] end Index past the last one
+ * @param[in] grain Size below which a range is not split (0 for automatic)
+ * @param[in] body Function run on the chunks
+ * @param[in] ctx Argument of the function
+ */
+int thread_parallel_for(long begin, long end, long grain, thread_range_t body,
+                        ptr_t ctx) {
+
+    RangeJob job;
+
+    /* Check for errors */
+    if (!body ||                /* If the function is invalid */
+        (begin > end) ||        /* If the range is invalid */
+        (grain < 0)) {          /* If the grain is invalid */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Set the loop */
+    job.body = body;
+    job.map = NULL;
+    job.combine = NULL;
+    job.ctx = ctx;
+    job.grain = grain;
+
+    /* Run the loop */
+    _thread_parallel(&job, begin, end);
+
+    return THREAD_SUCCESS;
+}
+
+/**
+ * @brief Reduce a range in parallel
+ *
+ * The range is split as by thread_parallel_for(), every chunk is mapped to a
+ * result by map(chunk_begin, chunk_end, ctx), and the results of adjacent
+ * chunks are combined by combine(lower_result, upper_result, ctx) till one
+ * result is left. An empty range is mapped once
+ *
+ * @param[in] begin First index
+ * @param[in] end Index past the last one
+ * @param[in] grain Size below which a range is not split (0 for automatic)
+ * @param[in] map Function mapping the chunks
+ * @param[in] combine Function combining two results
+ * @param[in] ctx Argument of the functions
+ * @param[out] ret Pointer to the result holder
+ */
+int thread_parallel_reduce(long begin, long end, long grain, thread_map_t map,
+                           thread_combine_t combine, ptr_t ctx, ptr_t *ret) {
+
+    RangeJob job;
+
+    /* Check for errors */
+    if (!map || !combine ||     /* If the functions are invalid */
+        !ret ||                 /* If the result holder is invalid */
+        (begin > end) ||        /* If the range is invalid */
+        (grain < 0)) {          /* If the grain is invalid */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Set the reduction */
+    job.body = NULL;
+    job.map = map;
+    job.combine = combine;
+    job.ctx = ctx;
+    job.grain = grain;
+
+    /* Run the reduction */
+    _thread_parallel(&job, begin, end);
+
+    /* Store the result */
+    *ret = job.ret;
+
+    return THREAD_SUCCESS;
+}
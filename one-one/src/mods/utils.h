@@ -35,20 +35,54 @@ static inline int atomic_cas(int *addr, int old_val, int new_val) {
     return atomic_compare_exchange_strong(addr, &old_val, new_val);
 }
 
+/**
+ * @brief Raw system call
+ *
+ * Traps into the kernel directly, as the glibc wrapper would store the error
+ * number in the thread local storage of glibc, which the library does not set
+ * up. Unused arguments are passed as 0
+ *
+ * @param[in] nr System call number
+ * @param[in] a1 First argument
+ * @param[in] a2 Second argument
+ * @param[in] a3 Third argument
+ * @param[in] a4 Fourth argument
+ * @param[in] a5 Fifth argument
+ * @param[in] a6 Sixth argument
+ * @return Result of the system call, or negated errno
+ */
+static inline long raw_syscall(long nr, long a1, long a2, long a3, long a4,
+                               long a5, long a6) {
+
+    long ret;
+    register long r10 __asm__ ("r10") = a4;
+    register long r8 __asm__ ("r8") = a5;
+    register long r9 __asm__ ("r9") = a6;
+
+    /* Trap into the kernel */
+    __asm__ volatile ("syscall"
+                      : "=a" (ret)
+                      : "0" (nr), "D" (a1), "S" (a2), "d" (a3),
+                        "r" (r10), "r" (r8), "r" (r9)
+                      : "rcx", "r11", "memory");
+
+    return ret;
+}
+
 /**
  * @brief Futex syscall
  * @param[in] uaddr Pointer to the futex word
  * @param[in] futex_op Operation to be performed
  * @param[in] val Expected value of the futex word
- * @return 0 or errno
+ * @return 0 or negated errno
  */
 static inline int futex(int *uaddr, int futex_op, int val) {
 
     /* Check for errors */
     assert(uaddr);
 
-    /* Use the system call wrapper around the futex system call */
-    return syscall(SYS_futex, uaddr, futex_op, val, NULL, NULL, 0);
+    /* Issue the futex system call */
+    return raw_syscall(SYS_futex, (long)uaddr, futex_op, val, 0, 0, 0);
 }
 
 /**
@@ -57,8 +91,8 @@ static inline int futex(int *uaddr, int futex_op, int val) {
  */
 static inline void set_fs(void *addr) {
 
-    /* Use the syscall wrapper */
-    syscall(SYS_arch_prctl, ARCH_SET_FS, (long)addr);
+    /* Issue the system call */
+    raw_syscall(SYS_arch_prctl, ARCH_SET_FS, (long)addr, 0, 0, 0, 0);
 }
 
 /**
@@ -69,8 +103,8 @@ static inline void *get_fs(void) {
 
     long addr;
 
-    /* Use the syscall wrapper */
-    syscall(SYS_arch_prctl, ARCH_GET_FS, &addr);
+    /* Issue the system call */
+    raw_syscall(SYS_arch_prctl, ARCH_GET_FS, (long)&addr, 0, 0, 0, 0);
 
     return (void *)addr;
 }
@@ -91,14 +125,29 @@ static inline void *get_fs(void) {
         __ptr;                                  \
     })
 
+/**
+ * @brief Set the CPU affinity of a kernel thread
+ * @param[in] ktid Kernel thread id
+ * @param[in] setsize Size of the CPU set in bytes
+ * @param[in] set Pointer to the CPU set
+ * @return 0 or negated errno
+ */
+static inline long sys_sched_setaffinity(int ktid, size_t setsize,
+                                         const void *set) {
+
+    /* Issue the system call */
+    return raw_syscall(SYS_sched_setaffinity, ktid, setsize, (long)set,
+                       0, 0, 0);
+}
+
 /**
  * @brief A simple exit system call
  * @param[in] status Integer exit status
  */
 static inline void sys_exit(int status) {
 
-    /* Use the syscall wrapper */
-    syscall(SYS_exit, status);
+    /* Issue the system call */
+    raw_syscall(SYS_exit, status, 0, 0, 0, 0, 0);
 }
 
 #endif
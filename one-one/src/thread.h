@@ -2,6 +2,7 @@
 #define _THREAD_H_
 
 #include <errno.h>
+#include <sched.h>
 #include <signal.h>
 
 /**
@@ -70,6 +71,13 @@ int thread_mutex_trylock(ThreadMutex *mutex);
 int thread_mutex_unlock(ThreadMutex *mutex);
 int thread_mutex_destroy(ThreadMutex *mutex);
 
+/**
+ * Thread CPU affinity routines (cpu_set_t requires _GNU_SOURCE)
+ */
+#ifdef __USE_GNU
+int thread_setaffinity(Thread thread, size_t setsize, const cpu_set_t *set);
+#endif
+
 /**
  * Thread signal handling routines
  */
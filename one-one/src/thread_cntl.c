@@ -256,3 +256,41 @@ int thread_once(ThreadOnce *once_control, void (*init_routine)(void)) {
 
     return THREAD_SUCCESS;
 }
+
+/**
+ * @brief Set the CPU affinity of a thread
+ *
+ * Restricts the kernel thread of the thread to run on the CPUs of the set
+ *
+ * @param[in] thread Thread handle
+ * @param[in] setsize Size of the CPU set in bytes
+ * @param[in] set Pointer to the CPU set
+ */
+int thread_setaffinity(Thread thread, size_t setsize, const cpu_set_t *set) {
+
+    long ret;
+
+    /* Check for errors */
+    if ((!thread) ||            /* If thread descriptor is not valid */
+        (!set)) {               /* If CPU set is not valid */
+
+        /* Set the errno */
+        thread_errno = EINVAL;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    /* Set the affinity of the kernel thread */
+    ret = sys_sched_setaffinity(td_get_ktid(thread), setsize, set);
+
+    /* Check for errors */
+    if (ret < 0) {
+
+        /* Set the errno */
+        thread_errno = -ret;
+        /* Return failure */
+        return THREAD_FAIL;
+    }
+
+    return THREAD_SUCCESS;
+}
@@ -3,6 +3,11 @@
 # Gcc compilation flags
 # GCC_COMPILATION_FLAGS="-DBLOCK_DEBUG_PRINTS"
 
+# Library compilation flags (many-many), also taken from the environment
+# LIB_COMPILATION_FLAGS="-DMMSCHED_DEQ_BATCH=1"
+# LIB_COMPILATION_FLAGS="-DMMSCHED_PREEMPT=MMSCHED_PREEMPT_MONITOR"
+# LIB_COMPILATION_FLAGS="-DMMRLL_LOCKFREE=1"
+
 # If the command line argument is only one
 if [ $# -eq 1 ]
 then
@@ -12,7 +17,10 @@ then
         echo "Usage: ./test.sh <lib_name> <mod_name> <cmd_args>"
         echo "lib_name: one-one/many-many/hybrid"
         echo "mod_name: create/exit/join/spinlock/mutex/signal/yield"
+        echo "one-one and many-many only mod_name: affinity"
+        echo "many-many only mod_name: priority/concurrency/block/io/timer/offload/preempt/timeslice/batch/inline/task/parallel/future/graph/coro/msg/dequeue/ready"
         echo "cmd_args: Integer argument to many-many and hybrid library"
+        echo "LIB_COMPILATION_FLAGS: Compilation flags of the many-many library (environment)"
     else
         echo "Run ./test.sh help for usage"
     fi
@@ -50,7 +58,13 @@ then
 else
     TEST_SRC_PATH="./tests_one_many"
     # Set the list of valid second command line arguments
-    VALID_SECOND_CMD_ARG=("create" "exit" "join" "spinlock" "mutex" "signal" "yield" "equal" "once")
+    VALID_SECOND_CMD_ARG=("create" "exit" "join" "spinlock" "mutex" "signal" "yield" "equal" "once" "affinity")
+fi
+
+# Add the modules which are implemented by the many-many library only
+if [[ $1 == "many-many" ]]
+then
+    VALID_SECOND_CMD_ARG+=("priority" "concurrency" "block" "io" "timer" "offload" "preempt" "timeslice" "batch" "inline" "task" "parallel" "future" "graph" "coro" "msg" "dequeue" "ready")
 fi
 
 # Run the test code of the requested module
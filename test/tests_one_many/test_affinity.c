@@ -0,0 +1,94 @@
+#define _GNU_SOURCE
+#include <stddef.h>
+#include <sched.h>
+#include "./print.h"
+#include "./print_ext.h"
+#include <thread.h>
+
+/* Stop the spinning thread */
+volatile int stop;
+
+/**
+ * User thread spinning till stopped
+ */
+void *thread_spin(void *arg) {
+
+    /* Print information */
+    debug_str("Inside thread_spin(), spinning till stopped\n");
+
+    /* Spin till stopped */
+    while (!stop) {
+
+        thread_yield();
+    }
+
+    return NULL;
+}
+
+/**
+ * Main thread
+ */
+void *thread_main(void *arg) {
+
+    Thread td;
+    cpu_set_t set, one;
+    int cpu;
+
+    /* Print information */
+    print_str("Thread CPU affinity testing\n\n");
+
+    /* Get the CPUs the current thread can run on */
+    sched_getaffinity(0, sizeof(set), &set);
+    for (cpu = 0; !CPU_ISSET(cpu, &set); cpu++);
+    CPU_ZERO(&one);
+    CPU_SET(cpu, &one);
+
+    debug_str("thread_main() created thread_spin()\n");
+    thread_create(&td, thread_spin, NULL);
+
+    /* Test 1 */
+    print_str("Test 1: Setting the affinity of a thread to one of the CPUs "
+              "the process is allowed to run on\n");
+    debug_str("thread_main() set the affinity of thread_spin() to CPU ");
+    debug_int(cpu);
+    if (thread_setaffinity(td, sizeof(one), &one) == THREAD_SUCCESS) {
+
+        print_succ(1);
+    } else {
+
+        print_fail(1);
+    }
+
+    newline;
+
+    /* Test 2 */
+    print_str("Test 2: Setting the affinity of a thread to an empty CPU "
+              "set\n");
+    CPU_ZERO(&set);
+    if ((thread_setaffinity(td, sizeof(set), &set) == THREAD_FAIL) &&
+        (thread_errno == EINVAL)) {
+
+        debug_str("thread_setaffinity() failed with error number EINVAL\n");
+        print_succ(2);
+    } else {
+
+        print_fail(2);
+    }
+
+    newline;
+
+    /* Test 3 */
+    print_str("Test 3: The thread keeps running after its affinity is "
+              "set\n");
+    debug_str("thread_main() stopped thread_spin() and called join on it\n");
+    stop = 1;
+    if (thread_join(td, NULL) == THREAD_SUCCESS) {
+
+        print_succ(3);
+    } else {
+
+        print_fail(3);
+    }
+
+    return NULL;
+}
@@ -0,0 +1,158 @@
+#include <stddef.h>
+#include "./print.h"
+#include "./print_ext.h"
+#include <thread.h>
+
+/* Number of threads in a batch */
+#define NB_THREADS (200)
+/* Number of threads in a large batch */
+#define NB_LARGE (5000)
+
+/* Handles of the large batch */
+Thread large[NB_LARGE];
+
+/**
+ * User thread returning the double of its argument
+ */
+void *thread_double(void *arg) {
+
+    return (void *)((long)arg * 2);
+}
+
+/**
+ * @brief Join a batch of threads doubling their arguments
+ * @param[in] tds Array of the thread handles
+ * @param[in] args Array of the arguments (NULL if none)
+ * @return Number of threads which returned the expected value
+ */
+static int join_batch(Thread *tds, void **args) {
+
+    void *ret;
+    int nb = 0;
+
+    for (int i = 0; i < NB_THREADS; i++) {
+
+        thread_join(tds[i], &ret);
+        if ((long)ret == (args ? (long)args[i] * 2 : 0)) {
+
+            nb++;
+        }
+    }
+
+    return nb;
+}
+
+/**
+ * Main thread
+ */
+void *thread_main(void *arg) {
+
+    Thread tds[NB_THREADS];
+    void *args[NB_THREADS];
+    int nb;
+
+    /* Print information */
+    print_str("Thread batch creation testing\n\n");
+
+    for (int i = 0; i < NB_THREADS; i++) {
+
+        args[i] = (void *)(long)i;
+    }
+
+    /* Test 1 */
+    print_str("Test 1: Every thread of a batch runs with its own "
+              "argument\n");
+    if (thread_create_many(tds, NB_THREADS, thread_double, args) ==
+        THREAD_SUCCESS) {
+
+        nb = join_batch(tds, args);
+        debug_str("Number of threads which returned the double of their "
+                  "argument = ");
+        debug_int(nb);
+        if (nb == NB_THREADS) {
+
+            print_succ(1);
+        } else {
+
+            print_fail(1);
+        }
+    } else {
+
+        print_fail(1);
+    }
+
+    newline;
+
+    /* Test 2 */
+    print_str("Test 2: Every thread of a batch without arguments gets "
+              "NULL\n");
+    if ((thread_create_many(tds, NB_THREADS, thread_double, NULL) ==
+         THREAD_SUCCESS) && (join_batch(tds, NULL) == NB_THREADS)) {
+
+        print_succ(2);
+    } else {
+
+        print_fail(2);
+    }
+
+    newline;
+
+    /* Test 3 */
+    print_str("Test 3: A batch is scheduled under the fair policy\n");
+    thread_setschedpolicy(THREAD_SCHED_FAIR);
+    if ((thread_create_many(tds, NB_THREADS, thread_double, args) ==
+         THREAD_SUCCESS) && (join_batch(tds, args) == NB_THREADS)) {
+
+        print_succ(3);
+    } else {
+
+        print_fail(3);
+    }
+    thread_setschedpolicy(THREAD_SCHED_PRIO);
+
+    newline;
+
+    /* Test 4 */
+    print_str("Test 4: Creating a batch without a start routine, and an "
+              "empty batch\n");
+    if ((thread_create_many(tds, NB_THREADS, NULL, args) == THREAD_FAIL) &&
+        (thread_errno == EINVAL) &&
+        (thread_create_many(tds, 0, thread_double, args) ==
+         THREAD_SUCCESS)) {
+
+        debug_str("thread_create_many() failed with error number EINVAL, "
+                  "and created no thread for an empty batch\n");
+        print_succ(4);
+    } else {
+
+        print_fail(4);
+    }
+
+    newline;
+
+    /* Test 5 */
+    print_str("Test 5: A large batch of threads waiting to start\n");
+    nb = 0;
+    if (thread_create_many(large, NB_LARGE, thread_double, NULL) ==
+        THREAD_SUCCESS) {
+
+        for (int i = 0; i < NB_LARGE; i++) {
+
+            if (thread_join(large[i], NULL) == THREAD_SUCCESS) {
+
+                nb++;
+            }
+        }
+    }
+    debug_str("Number of threads joined = ");
+    debug_int(nb);
+    if (nb == NB_LARGE) {
+
+        print_succ(5);
+    } else {
+
+        print_fail(5);
+    }
+
+    return NULL;
+}
@@ -0,0 +1,109 @@
+#define _GNU_SOURCE
+#include <stddef.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "./print.h"
+#include "./print_ext.h"
+#include <thread.h>
+
+/* Set by the other thread */
+volatile int other_ran;
+/* Observed by the blocking thread once it woke up */
+volatile int seen;
+
+/**
+ * @brief Sleep in a system call
+ * @param[in] ms Time to sleep in milli seconds
+ */
+static void sleep_ms(long ms) {
+
+    struct timespec ts = {ms / 1000, (ms % 1000) * 1000000};
+
+    /* Use the system call directly */
+    syscall(SYS_nanosleep, &ts, NULL);
+}
+
+/**
+ * User thread blocking in a system call
+ */
+void *thread_block(void *arg) {
+
+    /* Print information */
+    debug_str("Inside thread_block(), sleeping for 300 ms\n");
+
+    /* Sleep with the scheduling handed over */
+    thread_block_enter();
+    sleep_ms(300);
+    thread_block_exit();
+
+    /* Note if the other thread ran meanwhile */
+    seen = other_ran;
+
+    return NULL;
+}
+
+/**
+ * User thread running while the other thread blocks
+ */
+void *thread_other(void *arg) {
+
+    /* Print information */
+    debug_str("Inside thread_other()\n");
+
+    other_ran = 1;
+
+    return NULL;
+}
+
+/**
+ * Main thread
+ */
+void *thread_main(void *arg) {
+
+    Thread td_block, td_other;
+    int level;
+
+    /* Print information */
+    print_str("Thread blocking system call testing\n\n");
+
+    /* Test 1 */
+    print_str("Test 1: A thread blocking in a system call does not stall "
+              "the other threads (run with one kernel thread)\n");
+    debug_str("thread_main() created thread_block() and thread_other()\n");
+    thread_create(&td_block, thread_block, NULL);
+    thread_create(&td_other, thread_other, NULL);
+    thread_join(td_block, NULL);
+    thread_join(td_other, NULL);
+    if (seen) {
+
+        debug_str("thread_other() ran while thread_block() was sleeping\n");
+        print_succ(1);
+    } else {
+
+        print_fail(1);
+    }
+
+    newline;
+
+    /* Test 2 */
+    print_str("Test 2: Blocking repeatedly reuses the spare kernel threads and "
+              "leaves the number of kernel threads scheduling unchanged\n");
+    level = thread_getconcurrency();
+    debug_str("thread_main() blocked five times for 10 ms\n");
+    for (int i = 0; i < 5; i++) {
+
+        thread_block_enter();
+        sleep_ms(10);
+        thread_block_exit();
+    }
+    if (thread_getconcurrency() == level) {
+
+        print_succ(2);
+    } else {
+
+        print_fail(2);
+    }
+
+    return NULL;
+}
@@ -0,0 +1,136 @@
+#include <stddef.h>
+#include "./print.h"
+#include "./print_ext.h"
+#include <thread.h>
+
+/* Number of worker threads */
+#define NB_THREADS (8)
+
+/* Shared counter */
+ThreadSpinLock lock;
+volatile int cnt;
+
+/**
+ * Worker user thread
+ */
+void *thread_work(void *arg) {
+
+    /* Update the counter a number of times, yielding in between */
+    for (int i = 0; i < 1000; i++) {
+
+        thread_spin_lock(&lock);
+        cnt++;
+        thread_spin_unlock(&lock);
+
+        thread_yield();
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Run the worker threads
+ * @return 1 if all the updates were done
+ */
+static int run_workers(void) {
+
+    Thread td[NB_THREADS];
+
+    /* Create and join the workers */
+    cnt = 0;
+    for (int i = 0; i < NB_THREADS; i++) {
+
+        thread_create(&td[i], thread_work, NULL);
+    }
+    for (int i = 0; i < NB_THREADS; i++) {
+
+        thread_join(td[i], NULL);
+    }
+
+    debug_str("cnt = ");
+    debug_int(cnt);
+
+    return (cnt == NB_THREADS * 1000);
+}
+
+/**
+ * Main thread
+ */
+void *thread_main(void *arg) {
+
+    /* Print information */
+    print_str("Thread concurrency testing\n\n");
+
+    thread_spin_init(&lock);
+
+    /* Test 1 */
+    print_str("Test 1: Growing the number of kernel threads to four and "
+              "running threads on them\n");
+    debug_str("thread_main() set the concurrency to 4\n");
+    if ((thread_setconcurrency(4) == THREAD_SUCCESS) &&
+        (thread_getconcurrency() == 4) && run_workers()) {
+
+        print_succ(1);
+    } else {
+
+        print_fail(1);
+    }
+
+    newline;
+
+    /* Test 2 */
+    print_str("Test 2: Shrinking the number of kernel threads to one, then "
+              "growing it back to three while the retired kernel threads "
+              "are reused\n");
+    debug_str("thread_main() set the concurrency to 1\n");
+    thread_setconcurrency(1);
+    if ((thread_getconcurrency() == 1) && run_workers()) {
+
+        debug_str("thread_main() set the concurrency to 3\n");
+        thread_setconcurrency(3);
+        if ((thread_getconcurrency() == 3) && run_workers()) {
+
+            print_succ(2);
+        } else {
+
+            print_fail(2);
+        }
+    } else {
+
+        print_fail(2);
+    }
+
+    newline;
+
+    /* Test 3 */
+    print_str("Test 3: Setting an invalid number of kernel threads\n");
+    if ((thread_setconcurrency(-1) == THREAD_FAIL) &&
+        (thread_errno == EINVAL)) {
+
+        debug_str("thread_main() failed with error number EINVAL\n");
+        print_succ(3);
+    } else {
+
+        print_fail(3);
+    }
+
+    newline;
+
+    /* Test 4 */
+    print_str("Test 4: Scaling the number of kernel threads automatically\n");
+    debug_str("thread_main() set the concurrency to 0\n");
+    thread_setconcurrency(0);
+    if (run_workers() && (thread_getconcurrency() >= 1)) {
+
+        debug_str("Number of kernel threads = ");
+        debug_int(thread_getconcurrency());
+        print_succ(4);
+    } else {
+
+        print_fail(4);
+    }
+
+    thread_spin_destroy(&lock);
+
+    return NULL;
+}
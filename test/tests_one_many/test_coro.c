@@ -0,0 +1,227 @@
+#include <stddef.h>
+#include <signal.h>
+#include "./print.h"
+#include "./print_ext.h"
+#include <thread.h>
+
+/* Number of values yielded by a generator */
+#define NB_VALUES (1000)
+/* Number of threads running generators */
+#define NB_THREADS (4)
+
+/* Return status and error numbers of the calls from a coroutine */
+int resume_ret, resume_err;
+
+/**
+ * Coroutine yielding the numbers up to the argument
+ */
+void coro_count(ThreadCoro coro, void *arg) {
+
+    for (long i = 0; i < (long)arg; i++) {
+
+        thread_coro_yield_value(coro, (void *)i);
+    }
+}
+
+/**
+ * Coroutine yielding the squares of the even values of another coroutine
+ */
+void coro_even_squares(ThreadCoro coro, void *arg) {
+
+    void *value;
+
+    while (thread_coro_resume((ThreadCoro)arg, &value) == THREAD_SUCCESS) {
+
+        if (!((long)value % 2)) {
+
+            thread_coro_yield_value(coro, (void *)((long)value *
+                                                   (long)value));
+        }
+    }
+}
+
+/**
+ * Coroutine yielding the numbers up to the argument, and yielding the thread
+ * in between
+ */
+void coro_count_yield(ThreadCoro coro, void *arg) {
+
+    for (long i = 0; i < (long)arg; i++) {
+
+        thread_yield();
+        thread_coro_yield_value(coro, (void *)i);
+    }
+}
+
+/**
+ * Coroutine resuming itself
+ */
+void coro_self(ThreadCoro coro, void *arg) {
+
+    resume_ret = thread_coro_resume(coro, NULL);
+    resume_err = thread_errno;
+}
+
+/**
+ * Coroutine yielding if SIGUSR1 is blocked when it starts
+ */
+void coro_mask(ThreadCoro coro, void *arg) {
+
+    sigset_t set, old;
+
+    sigemptyset(&set);
+    thread_sigmask(SIG_BLOCK, &set, &old);
+    thread_coro_yield_value(coro, (void *)(long)sigismember(&old, SIGUSR1));
+}
+
+/**
+ * User thread summing the values of a generator
+ */
+void *thread_sum(void *arg) {
+
+    ThreadCoro coro;
+    void *value;
+    long sum = 0;
+
+    thread_coro_create(&coro, coro_count_yield, (void *)NB_VALUES);
+    while (thread_coro_resume(coro, &value) == THREAD_SUCCESS) {
+
+        sum += (long)value;
+    }
+    thread_coro_destroy(&coro);
+
+    return (void *)sum;
+}
+
+/**
+ * Main thread
+ */
+void *thread_main(void *arg) {
+
+    ThreadCoro coro, inner;
+    Thread tds[NB_THREADS];
+    sigset_t set;
+    void *value;
+    long nb, sum, ret;
+
+    /* Print information */
+    print_str("Thread coroutine testing\n\n");
+
+    /* Test 1 */
+    print_str("Test 1: A generator yields its values in order, then "
+              "returns\n");
+    thread_coro_create(&coro, coro_count, (void *)NB_VALUES);
+    nb = 0;
+    while (thread_coro_resume(coro, &value) == THREAD_SUCCESS) {
+
+        nb += ((long)value == nb);
+    }
+    debug_str("Number of values yielded in order = ");
+    debug_int(nb);
+    if ((nb == NB_VALUES) && (thread_errno == ESRCH) &&
+        (thread_coro_resume(coro, &value) == THREAD_FAIL) &&
+        (thread_errno == ESRCH)) {
+
+        print_succ(1);
+    } else {
+
+        print_fail(1);
+    }
+    thread_coro_destroy(&coro);
+
+    newline;
+
+    /* Test 2 */
+    print_str("Test 2: A coroutine resumes another one\n");
+    thread_coro_create(&inner, coro_count, (void *)10l);
+    thread_coro_create(&coro, coro_even_squares, inner);
+    sum = 0;
+    while (thread_coro_resume(coro, &value) == THREAD_SUCCESS) {
+
+        sum += (long)value;
+    }
+    debug_str("Sum of the squares of the even numbers below 10 = ");
+    debug_int(sum);
+    if (sum == 0 + 4 + 16 + 36 + 64) {
+
+        print_succ(2);
+    } else {
+
+        print_fail(2);
+    }
+    thread_coro_destroy(&coro);
+    thread_coro_destroy(&inner);
+
+    newline;
+
+    /* Test 3 */
+    print_str("Test 3: Threads run generators which yield the threads\n");
+    for (int i = 0; i < NB_THREADS; i++) {
+
+        thread_create(&tds[i], thread_sum, NULL);
+    }
+    nb = 0;
+    for (int i = 0; i < NB_THREADS; i++) {
+
+        thread_join(tds[i], &value);
+        ret = (long)value;
+        nb += (ret == (long)NB_VALUES * (NB_VALUES - 1) / 2);
+    }
+    debug_str("Number of threads which got the sum = ");
+    debug_int(nb);
+    if (nb == NB_THREADS) {
+
+        print_succ(3);
+    } else {
+
+        print_fail(3);
+    }
+
+    newline;
+
+    /* Test 4 */
+    print_str("Test 4: Resuming a running coroutine, yielding from a "
+              "suspended one, and destroying one which did not return\n");
+    thread_coro_create(&coro, coro_self, NULL);
+    thread_coro_resume(coro, NULL);
+    thread_coro_destroy(&coro);
+    thread_coro_create(&coro, coro_count, (void *)NB_VALUES);
+    thread_coro_resume(coro, NULL);
+    if ((resume_ret == THREAD_FAIL) && (resume_err == EBUSY) &&
+        (thread_coro_yield_value(coro, NULL) == THREAD_FAIL) &&
+        (thread_errno == EPERM) &&
+        (thread_coro_destroy(&coro) == THREAD_SUCCESS)) {
+
+        debug_str("thread_coro_resume() failed with error number EBUSY, and "
+                  "thread_coro_yield_value() with error number EPERM\n");
+        print_succ(4);
+    } else {
+
+        print_fail(4);
+    }
+
+    newline;
+
+    /* Test 5 */
+    print_str("Test 5: A coroutine created with SIGUSR1 blocked starts with "
+              "the signal mask of its resumer\n");
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+    thread_sigmask(SIG_BLOCK, &set, NULL);
+    thread_coro_create(&coro, coro_mask, NULL);
+    thread_sigmask(SIG_UNBLOCK, &set, NULL);
+    value = (void *)-1l;
+    thread_coro_resume(coro, &value);
+    thread_coro_destroy(&coro);
+    debug_str("SIGUSR1 blocked in the coroutine = ");
+    debug_int((long)value);
+    if (!value) {
+
+        print_succ(5);
+    } else {
+
+        print_fail(5);
+    }
+
+    return NULL;
+}
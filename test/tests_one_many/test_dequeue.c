@@ -0,0 +1,143 @@
+#include <stddef.h>
+#include <time.h>
+#include "./print.h"
+#include "./print_ext.h"
+#include <thread.h>
+
+/* Number of short threads created with the spinning thread */
+#define NB_SHORT (16)
+/* Time the spinning thread waits at most for the short threads (in milli
+ * seconds) */
+#define SPIN_MAX_ms (2000ul)
+/* Number of rounds of threads */
+#define NB_ROUNDS (50)
+/* Number of threads of a round */
+#define NB_THREADS (64)
+
+/* Number of short threads done */
+volatile int nb_done;
+
+/**
+ * @brief Get the current time
+ * @return Time in milli seconds
+ */
+static unsigned long now_ms(void) {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000ul + ts.tv_nsec / 1000000;
+}
+
+/**
+ * User thread spinning without yielding till the short threads are done (the
+ * first one of a batch), or else counting itself as a short thread done
+ */
+void *thread_spin_or_count(void *arg) {
+
+    unsigned long start;
+
+    /* If the thread is a short thread */
+    if (arg) {
+
+        __sync_fetch_and_add(&nb_done, 1);
+        return NULL;
+    }
+
+    /* Spin till the short threads are done, or for too long */
+    start = now_ms();
+    while ((nb_done < NB_SHORT) && (now_ms() - start < SPIN_MAX_ms));
+
+    return (void *)(long)nb_done;
+}
+
+/**
+ * User thread returning the double of its argument
+ */
+void *thread_double(void *arg) {
+
+    return (void *)((long)arg * 2);
+}
+
+/**
+ * Main thread
+ */
+void *thread_main(void *arg) {
+
+    Thread tds[NB_THREADS + 1];
+    void *args[NB_THREADS + 1];
+    unsigned long start;
+    int enabled, level;
+    void *ret;
+    long nb;
+
+    /* Print information */
+    print_str("Thread dequeue testing (run with the dequeue batches, and "
+              "with -DMMSCHED_DEQ_BATCH=1 to compare)\n\n");
+
+    /* Test 1 */
+    print_str("Test 1: Threads created behind a thread which is never "
+              "preempted run on the other kernel thread\n");
+    thread_getpreemption(&enabled);
+    level = thread_getconcurrency();
+    thread_setpreemption(0);
+    thread_setconcurrency(2);
+    thread_sleep_ns(20000000ul);
+    for (int i = 0; i <= NB_THREADS; i++) {
+
+        args[i] = (void *)(long)i;
+    }
+    nb_done = 0;
+    thread_create_many(tds, NB_SHORT + 1, thread_spin_or_count, args);
+    for (int i = 1; i <= NB_SHORT; i++) {
+
+        thread_join(tds[i], NULL);
+    }
+    thread_join(tds[0], &ret);
+    thread_setconcurrency(level);
+    thread_setpreemption(enabled);
+    debug_str("Number of short threads done while spinning = ");
+    debug_int((long)ret); debug_newline;
+    if ((long)ret == NB_SHORT) {
+
+        print_succ(1);
+    } else {
+
+        print_fail(1);
+    }
+
+    newline;
+
+    /* Test 2 */
+    print_str("Test 2: Rounds of threads whose priority changes while they "
+              "wait, joined as they come\n");
+    start = now_ms();
+    nb = 0;
+    for (int r = 0; r < NB_ROUNDS; r++) {
+
+        thread_create_many(tds, NB_THREADS, thread_double, args);
+        for (int i = 0; i < NB_THREADS; i += 2) {
+
+            thread_setpriority(tds[i], THREAD_PRIO_DEFAULT + 1);
+        }
+        for (int i = 0; i < NB_THREADS; i++) {
+
+            thread_join(tds[i], &ret);
+            nb += ((long)ret == 2 * i);
+        }
+    }
+    debug_str("Time to run the rounds (ms) = ");
+    debug_int(now_ms() - start); debug_newline;
+    debug_str("Number of threads which returned the expected value = ");
+    debug_int(nb); debug_newline;
+    if (nb == NB_ROUNDS * NB_THREADS) {
+
+        print_succ(2);
+    } else {
+
+        print_fail(2);
+    }
+
+    return NULL;
+}
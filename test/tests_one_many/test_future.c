@@ -0,0 +1,225 @@
+#include <stddef.h>
+#include "./print.h"
+#include "./print_ext.h"
+#include <thread.h>
+
+/* Number of threads getting the same future */
+#define NB_THREADS (4)
+/* Number of combined futures */
+#define NB_FUTURES (3)
+
+/* Future of the consumers */
+ThreadFuture shared;
+/* Return status and error number of a get from a task */
+int get_ret, get_err;
+
+/**
+ * User thread getting the shared future
+ */
+void *thread_consume(void *arg) {
+
+    void *value;
+
+    thread_future_get(&shared, &value);
+
+    return value;
+}
+
+/**
+ * User thread setting a future to its index
+ */
+void *thread_produce(void *arg) {
+
+    ThreadFuture *futures = arg;
+
+    for (long i = 0; i < NB_FUTURES; i++) {
+
+        thread_yield();
+        thread_future_set(&futures[i], (void *)(i * 10));
+    }
+
+    return NULL;
+}
+
+/**
+ * Continuation adding one to the value
+ */
+void *cont_inc(void *value, void *arg) {
+
+    return (void *)((long)value + 1);
+}
+
+/**
+ * Continuation doubling the value
+ */
+void *cont_double(void *value, void *arg) {
+
+    return (void *)((long)value * 2);
+}
+
+/**
+ * Task getting a future which is not set
+ */
+void task_get(void *arg) {
+
+    get_ret = thread_future_get((ThreadFuture *)arg, NULL);
+    get_err = thread_errno;
+}
+
+/**
+ * Main thread
+ */
+void *thread_main(void *arg) {
+
+    Thread tds[NB_THREADS], td;
+    ThreadFuture futures[NB_FUTURES], f, g, h, all, any;
+    ThreadTaskGroup group;
+    void *ret;
+    int nb;
+
+    /* Print information */
+    print_str("Thread future testing\n\n");
+
+    /* Test 1 */
+    print_str("Test 1: Every thread waiting for a future gets its value\n");
+    thread_future_init(&shared);
+    for (int i = 0; i < NB_THREADS; i++) {
+
+        thread_create(&tds[i], thread_consume, NULL);
+    }
+    thread_yield();
+    thread_future_set(&shared, (void *)42l);
+    nb = 0;
+    for (int i = 0; i < NB_THREADS; i++) {
+
+        thread_join(tds[i], &ret);
+        nb += ((long)ret == 42);
+    }
+    debug_str("Number of threads which got 42 = ");
+    debug_int(nb);
+    if (nb == NB_THREADS) {
+
+        print_succ(1);
+    } else {
+
+        print_fail(1);
+    }
+
+    newline;
+
+    /* Test 2 */
+    print_str("Test 2: A chain of continuations runs once the future is "
+              "set, and on a future already set\n");
+    thread_future_init(&f);
+    thread_future_then(&f, cont_inc, NULL, &g);
+    thread_future_then(&g, cont_double, NULL, &h);
+    thread_future_set(&f, (void *)10l);
+    thread_future_get(&h, &ret);
+    debug_str("(10 + 1) * 2 = ");
+    debug_int((long)ret);
+    if ((long)ret == 22) {
+
+        thread_future_destroy(&h);
+        thread_future_then(&g, cont_inc, NULL, &h);
+        thread_future_get(&h, &ret);
+        debug_str("(10 + 1) + 1 = ");
+        debug_int((long)ret);
+    }
+    if ((long)ret == 12) {
+
+        print_succ(2);
+    } else {
+
+        print_fail(2);
+    }
+    thread_future_destroy(&f);
+    thread_future_destroy(&g);
+    thread_future_destroy(&h);
+
+    newline;
+
+    /* Test 3 */
+    print_str("Test 3: A combination of futures is set once all of them "
+              "are set\n");
+    for (int i = 0; i < NB_FUTURES; i++) {
+
+        thread_future_init(&futures[i]);
+    }
+    thread_future_when_all(futures, NB_FUTURES, &all);
+    thread_create(&td, thread_produce, futures);
+    thread_future_get(&all, NULL);
+    nb = 0;
+    for (int i = 0; i < NB_FUTURES; i++) {
+
+        thread_future_get(&futures[i], &ret);
+        nb += ((long)ret == i * 10);
+    }
+    thread_join(td, NULL);
+    if (nb == NB_FUTURES) {
+
+        debug_str("Every future was set with its value\n");
+        print_succ(3);
+    } else {
+
+        print_fail(3);
+    }
+    thread_future_destroy(&all);
+    for (int i = 0; i < NB_FUTURES; i++) {
+
+        thread_future_destroy(&futures[i]);
+    }
+
+    newline;
+
+    /* Test 4 */
+    print_str("Test 4: A combination of futures is set to the index of the "
+              "first future set\n");
+    for (int i = 0; i < NB_FUTURES; i++) {
+
+        thread_future_init(&futures[i]);
+    }
+    thread_future_when_any(futures, NB_FUTURES, &any);
+    thread_future_set(&futures[2], NULL);
+    thread_future_set(&futures[0], NULL);
+    thread_future_get(&any, &ret);
+    debug_str("Index of the first future set = ");
+    debug_int((long)ret);
+    if ((long)ret == 2) {
+
+        print_succ(4);
+    } else {
+
+        print_fail(4);
+    }
+    thread_future_destroy(&any);
+    for (int i = 0; i < NB_FUTURES; i++) {
+
+        thread_future_destroy(&futures[i]);
+    }
+
+    newline;
+
+    /* Test 5 */
+    print_str("Test 5: Setting a future twice, and waiting for a future "
+              "from a task\n");
+    thread_future_init(&f);
+    thread_task_group_init(&group);
+    thread_task_spawn(&group, task_get, &f);
+    thread_task_wait(&group);
+    if ((thread_future_set(&f, NULL) == THREAD_SUCCESS) &&
+        (thread_future_set(&f, NULL) == THREAD_FAIL) &&
+        (thread_errno == EINVAL) &&
+        (get_ret == THREAD_FAIL) && (get_err == EPERM)) {
+
+        debug_str("thread_future_set() failed with error number EINVAL, and "
+                  "thread_future_get() with error number EPERM\n");
+        print_succ(5);
+    } else {
+
+        print_fail(5);
+    }
+    thread_task_group_destroy(&group);
+    thread_future_destroy(&f);
+
+    return NULL;
+}
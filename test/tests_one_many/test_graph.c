@@ -0,0 +1,163 @@
+#include <stddef.h>
+#include "./print.h"
+#include "./print_ext.h"
+#include <thread.h>
+
+/* Number of layers of the graph */
+#define NB_LAYERS (8)
+/* Number of nodes per layer */
+#define LAYER_SIZE (6)
+/* Number of nodes */
+#define NB_NODES (NB_LAYERS * LAYER_SIZE)
+/* Number of runs of the graph */
+#define NB_RUNS (100)
+
+/* Sequence number of the nodes */
+int seq;
+/* Sequence number at which every node ran last */
+int stamps[NB_NODES];
+/* Number of runs of every node */
+int runs[NB_NODES];
+
+/**
+ * Node noting when it ran
+ */
+void node_stamp(void *arg) {
+
+    long index = (long)arg;
+
+    stamps[index] = __sync_add_and_fetch(&seq, 1);
+    __sync_fetch_and_add(&runs[index], 1);
+}
+
+/**
+ * @brief Check that every node of a layer ran after the nodes it depends on
+ * @return Number of edges whose predecessor ran first
+ */
+static int check_order(void) {
+
+    int nb = 0;
+
+    for (int l = 1; l < NB_LAYERS; l++) {
+
+        for (int i = 0; i < LAYER_SIZE; i++) {
+
+            /* Node i depends on nodes i and i + 1 of the previous layer */
+            for (int j = i; j <= i + 1; j++) {
+
+                nb += (stamps[(l - 1) * LAYER_SIZE + (j % LAYER_SIZE)] <
+                       stamps[l * LAYER_SIZE + i]);
+            }
+        }
+    }
+
+    return nb;
+}
+
+/**
+ * Main thread
+ */
+void *thread_main(void *arg) {
+
+    ThreadGraph graph, cyclic;
+    int nodes[NB_NODES], a, b, nb;
+
+    /* Print information */
+    print_str("Thread task graph testing\n\n");
+
+    /* Build a graph of layers, every node depends on two nodes of the
+     * previous layer */
+    thread_graph_init(&graph);
+    for (long i = 0; i < NB_NODES; i++) {
+
+        thread_graph_node(&graph, node_stamp, (void *)i, &nodes[i]);
+    }
+    for (int l = 1; l < NB_LAYERS; l++) {
+
+        for (int i = 0; i < LAYER_SIZE; i++) {
+
+            thread_graph_edge(&graph, nodes[(l - 1) * LAYER_SIZE + i],
+                              nodes[l * LAYER_SIZE + i]);
+            thread_graph_edge(&graph,
+                              nodes[(l - 1) * LAYER_SIZE +
+                                    (i + 1) % LAYER_SIZE],
+                              nodes[l * LAYER_SIZE + i]);
+        }
+    }
+
+    /* Test 1 */
+    print_str("Test 1: Every node runs after its predecessors\n");
+    thread_graph_run(&graph);
+    nb = check_order();
+    debug_str("Number of edges run in order = ");
+    debug_int(nb);
+    if (nb == 2 * (NB_LAYERS - 1) * LAYER_SIZE) {
+
+        print_succ(1);
+    } else {
+
+        print_fail(1);
+    }
+
+    newline;
+
+    /* Test 2 */
+    print_str("Test 2: A graph runs again, every node once per run\n");
+    for (int r = 1; r < NB_RUNS; r++) {
+
+        thread_graph_run(&graph);
+    }
+    nb = 0;
+    for (int i = 0; i < NB_NODES; i++) {
+
+        nb += (runs[i] == NB_RUNS);
+    }
+    debug_str("Number of nodes which ran once per run = ");
+    debug_int(nb);
+    if ((nb == NB_NODES) && (check_order() == 2 * (NB_LAYERS - 1) *
+                                              LAYER_SIZE)) {
+
+        print_succ(2);
+    } else {
+
+        print_fail(2);
+    }
+
+    newline;
+
+    /* Test 3 */
+    print_str("Test 3: Running a graph with a cycle\n");
+    thread_graph_init(&cyclic);
+    thread_graph_node(&cyclic, node_stamp, (void *)0l, &a);
+    thread_graph_node(&cyclic, node_stamp, (void *)1l, &b);
+    thread_graph_edge(&cyclic, a, b);
+    thread_graph_edge(&cyclic, b, a);
+    if ((thread_graph_run(&cyclic) == THREAD_FAIL) &&
+        (thread_errno == EDEADLK)) {
+
+        debug_str("thread_graph_run() failed with error number EDEADLK\n");
+        print_succ(3);
+    } else {
+
+        print_fail(3);
+    }
+
+    newline;
+
+    /* Test 4 */
+    print_str("Test 4: Adding an edge to a node which does not exist, and "
+              "destroying the graphs\n");
+    if ((thread_graph_edge(&graph, nodes[0], NB_NODES) == THREAD_FAIL) &&
+        (thread_errno == EINVAL) &&
+        (thread_graph_destroy(&graph) == THREAD_SUCCESS) &&
+        (thread_graph_destroy(&cyclic) == THREAD_SUCCESS)) {
+
+        debug_str("thread_graph_edge() failed with error number EINVAL\n");
+        print_succ(4);
+    } else {
+
+        print_fail(4);
+    }
+
+    return NULL;
+}
@@ -0,0 +1,178 @@
+#include <stddef.h>
+#include "./print.h"
+#include "./print_ext.h"
+#include <thread.h>
+
+/* Argument of the fibonacci tree */
+#define FIB_ARG (16)
+/* Fibonacci number of the argument */
+#define FIB_VAL (987)
+
+/* Distance from the frame of the joining thread within which a thread runs
+ * on its stack */
+#define FRAME_DIST (16384l)
+/* Priority of the thread run inline */
+#define INLINE_PRIO (THREAD_PRIO_DEFAULT - 1)
+
+/* Handle of the joining thread */
+Thread joiner;
+/* Handle of the thread joined */
+Thread target;
+/* Address in the frame of the joining thread */
+char *joiner_frame;
+
+/**
+ * User thread computing a fibonacci number with a thread per call
+ */
+void *thread_fib(void *arg) {
+
+    long n = (long)arg;
+    Thread td1, td2;
+    void *ret1, *ret2;
+
+    if (n < 2) {
+
+        return (void *)n;
+    }
+
+    thread_create(&td1, thread_fib, (void *)(n - 1));
+    thread_create(&td2, thread_fib, (void *)(n - 2));
+    thread_join(td1, &ret1);
+    thread_join(td2, &ret2);
+
+    return (void *)((long)ret1 + (long)ret2);
+}
+
+/**
+ * User thread exiting with its argument
+ */
+void *thread_exiting(void *arg) {
+
+    thread_exit(arg);
+
+    return NULL;
+}
+
+/**
+ * Check if the calling thread runs on the stack of the joining thread
+ */
+int on_joiner_stack(void) {
+
+    char local;
+
+    return ((joiner_frame > &local) && (joiner_frame - &local < FRAME_DIST));
+}
+
+/**
+ * User thread checking if it runs inline as itself
+ */
+void *thread_check(void *arg) {
+
+    return (void *)(long)(on_joiner_stack() &&
+                          thread_equal(thread_self(), target) &&
+                          !thread_equal(thread_self(), joiner));
+}
+
+/**
+ * User thread checking if it runs inline with its priority, and sleeping
+ */
+void *thread_block(void *arg) {
+
+    int prio = -1;
+    int inlined;
+
+    inlined = on_joiner_stack();
+    thread_getpriority(thread_self(), &prio);
+    thread_sleep_ns(1000000ul);
+
+    return (void *)(long)(inlined && (prio == INLINE_PRIO) &&
+                          thread_equal(thread_self(), target));
+}
+
+/**
+ * Main thread
+ */
+void *thread_main(void *arg) {
+
+    Thread td;
+    void *ret;
+    int level;
+    char frame;
+
+    /* Print information */
+    print_str("Thread inline join testing\n\n");
+
+    /* Test 1 */
+    print_str("Test 1: A tree of threads joining their children computes "
+              "a fibonacci number\n");
+    thread_create(&td, thread_fib, (void *)(long)FIB_ARG);
+    thread_join(td, &ret);
+    debug_str("Fibonacci number = ");
+    debug_int((long)ret);
+    if ((long)ret == FIB_VAL) {
+
+        print_succ(1);
+    } else {
+
+        print_fail(1);
+    }
+
+    newline;
+
+    /* Test 2 */
+    print_str("Test 2: A thread exiting returns its value to the joining "
+              "thread, which goes on\n");
+    thread_create(&td, thread_exiting, (void *)42l);
+    thread_join(td, &ret);
+    if ((long)ret == 42) {
+
+        debug_str("thread_exiting() returned 42\n");
+        print_succ(2);
+    } else {
+
+        print_fail(2);
+    }
+
+    newline;
+
+    /* Test 3 */
+    print_str("Test 3: A thread joined before it started runs inline, as "
+              "itself (run with one kernel thread)\n");
+    level = thread_getconcurrency();
+    thread_setconcurrency(1);
+    thread_sleep_ns(20000000ul);
+    joiner = thread_self();
+    joiner_frame = &frame;
+    thread_create(&target, thread_check, NULL);
+    thread_join(target, &ret);
+    if (ret) {
+
+        debug_str("thread_check() ran on the stack of thread_main(), as "
+                  "itself\n");
+        print_succ(3);
+    } else {
+
+        print_fail(3);
+    }
+
+    newline;
+
+    /* Test 4 */
+    print_str("Test 4: A thread run inline keeps its priority and blocks, "
+              "then the joining thread goes on\n");
+    thread_create(&target, thread_block, NULL);
+    thread_setpriority(target, INLINE_PRIO);
+    thread_join(target, &ret);
+    thread_setconcurrency(level);
+    if (ret && thread_equal(thread_self(), joiner) && on_joiner_stack()) {
+
+        debug_str("thread_block() ran inline with its priority, and "
+                  "thread_main() went on as itself\n");
+        print_succ(4);
+    } else {
+
+        print_fail(4);
+    }
+
+    return NULL;
+}
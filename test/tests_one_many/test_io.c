@@ -0,0 +1,209 @@
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "./print.h"
+#include "./print_ext.h"
+#include <thread.h>
+
+/* Number of reading threads */
+#define NB_THREADS (64)
+
+/* Set by the main thread before writing */
+volatile int written;
+/* Observed by the reading thread once its read completed */
+volatile int seen;
+/* Number of reading threads which got their message */
+volatile int nb_read;
+/* Lock of the count */
+ThreadSpinLock lock;
+
+/**
+ * User thread reading from an empty socket
+ */
+void *thread_reader(void *arg) {
+
+    char buf[8] = {0};
+    int fd = *(int *)arg;
+
+    /* Print information */
+    debug_str("Inside thread_reader(), reading from an empty socket\n");
+
+    /* Read till the main thread writes */
+    if ((thread_read(fd, buf, sizeof(buf)) == 5) && !strcmp(buf, "ping")) {
+
+        /* Note if the main thread wrote meanwhile */
+        seen = written;
+    }
+
+    return NULL;
+}
+
+/**
+ * User thread reading its message from a socket
+ */
+void *thread_many(void *arg) {
+
+    char buf[8] = {0};
+    int fd = *(int *)arg;
+
+    /* Count the thread if it read the message */
+    if ((thread_read(fd, buf, sizeof(buf)) == 5) && !strcmp(buf, "many")) {
+
+        thread_spin_lock(&lock);
+        nb_read++;
+        thread_spin_unlock(&lock);
+    }
+
+    return NULL;
+}
+
+/**
+ * User thread echoing a message on an accepted connection
+ */
+void *thread_server(void *arg) {
+
+    char buf[8];
+    int fd, listen_fd = *(int *)arg;
+    ssize_t len;
+
+    /* Print information */
+    debug_str("Inside thread_server(), accepting a connection\n");
+
+    /* Accept the connection */
+    fd = thread_accept(listen_fd, NULL, NULL);
+    if (fd == THREAD_FAIL) {
+
+        return NULL;
+    }
+
+    /* Echo the message */
+    len = thread_read(fd, buf, sizeof(buf));
+    if (len > 0) {
+
+        thread_write(fd, buf, len);
+    }
+
+    close(fd);
+
+    return NULL;
+}
+
+/**
+ * Main thread
+ */
+void *thread_main(void *arg) {
+
+    struct sockaddr_in addr;
+    socklen_t addr_len;
+    Thread td, tds[NB_THREADS];
+    int sv[2], svs[NB_THREADS][2], listen_fd, fd;
+    char buf[8] = {0};
+
+    /* Print information */
+    print_str("Thread I/O testing\n\n");
+
+    /* Test 1 */
+    print_str("Test 1: A thread reading from an empty socket does not stall "
+              "the other threads (run with one kernel thread)\n");
+    socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+    debug_str("thread_main() created thread_reader()\n");
+    thread_create(&td, thread_reader, &sv[0]);
+    thread_yield();
+    written = 1;
+    debug_str("thread_main() wrote to the socket\n");
+    thread_write(sv[1], "ping", 5);
+    thread_join(td, NULL);
+    if (seen) {
+
+        debug_str("thread_reader() read the message written later\n");
+        print_succ(1);
+    } else {
+
+        print_fail(1);
+    }
+    close(sv[0]);
+    close(sv[1]);
+
+    newline;
+
+    /* Test 2 */
+    print_str("Test 2: Accepting and connecting a socket, then echoing a "
+              "message over it\n");
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr_len = sizeof(addr);
+    bind(listen_fd, (struct sockaddr *)&addr, addr_len);
+    getsockname(listen_fd, (struct sockaddr *)&addr, &addr_len);
+    listen(listen_fd, 1);
+    debug_str("thread_main() created thread_server()\n");
+    thread_create(&td, thread_server, &listen_fd);
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if ((thread_connect(fd, (struct sockaddr *)&addr, addr_len) ==
+         THREAD_SUCCESS) &&
+        (thread_write(fd, "echo", 5) == 5) &&
+        (thread_read(fd, buf, sizeof(buf)) == 5) && !strcmp(buf, "echo")) {
+
+        debug_str("thread_main() got the message echoed\n");
+        print_succ(2);
+    } else {
+
+        print_fail(2);
+    }
+    thread_join(td, NULL);
+    close(fd);
+    close(listen_fd);
+
+    newline;
+
+    /* Test 3 */
+    print_str("Test 3: Reading from an invalid file descriptor\n");
+    if ((thread_read(-1, buf, sizeof(buf)) == THREAD_FAIL) &&
+        (thread_errno == EBADF)) {
+
+        debug_str("thread_read() failed with error number EBADF\n");
+        print_succ(3);
+    } else {
+
+        print_fail(3);
+    }
+
+    newline;
+
+    /* Test 4 */
+    print_str("Test 4: Many threads reading from empty sockets get the "
+              "messages written later\n");
+    thread_spin_init(&lock);
+    debug_str("thread_main() created 64 thread_many()\n");
+    for (int i = 0; i < NB_THREADS; i++) {
+
+        socketpair(AF_UNIX, SOCK_STREAM, 0, svs[i]);
+        thread_create(&tds[i], thread_many, &svs[i][0]);
+    }
+    thread_yield();
+    for (int i = 0; i < NB_THREADS; i++) {
+
+        thread_write(svs[i][1], "many", 5);
+    }
+    for (int i = 0; i < NB_THREADS; i++) {
+
+        thread_join(tds[i], NULL);
+        close(svs[i][0]);
+        close(svs[i][1]);
+    }
+    debug_str("Number of threads which read their message = ");
+    debug_int(nb_read);
+    if (nb_read == NB_THREADS) {
+
+        print_succ(4);
+    } else {
+
+        print_fail(4);
+    }
+    thread_spin_destroy(&lock);
+
+    return NULL;
+}
@@ -0,0 +1,230 @@
+#include <stddef.h>
+#include "./print.h"
+#include "./print_ext.h"
+#include <thread.h>
+
+/* Number of messages sent by a thread */
+#define NB_MSGS (1000)
+/* Number of sending threads */
+#define NB_SENDERS (8)
+
+/**
+ * Message carrying a value
+ */
+typedef struct Msg {
+
+    /* Message node */
+    ThreadMsg node;
+
+    /* Value */
+    long value;
+
+} Msg;
+
+/* Handle of the main thread */
+Thread main_thread;
+/* Handle of the consumer */
+Thread consumer;
+/* Return status and error number of a receive from a task */
+int recv_ret, recv_err;
+/* Messages of the producers */
+Msg msgs[NB_SENDERS][NB_MSGS];
+
+/**
+ * User thread sending every message back, plus one
+ */
+void *thread_echo(void *arg) {
+
+    ThreadMsg *msg;
+
+    for (int i = 0; i < NB_MSGS; i++) {
+
+        thread_recv(&msg);
+        ((Msg *)msg)->value++;
+        thread_send(main_thread, msg);
+    }
+
+    return NULL;
+}
+
+/**
+ * User thread sending numbered messages to the consumer
+ */
+void *thread_produce(void *arg) {
+
+    Msg *msg;
+
+    for (long i = 0; i < NB_MSGS; i++) {
+
+        msg = &msgs[(long)arg][i];
+        msg->value = ((long)arg << 32) | i;
+        thread_send(consumer, &msg->node);
+        if (!(i % 100)) {
+
+            thread_yield();
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * User thread receiving the messages of the producers
+ */
+void *thread_consume(void *arg) {
+
+    long next[NB_SENDERS] = {0};
+    long msg, nb = 0;
+    ThreadMsg *node;
+
+    for (int i = 0; i < NB_SENDERS * NB_MSGS; i++) {
+
+        thread_recv(&node);
+        msg = ((Msg *)node)->value;
+
+        /* Count the messages received in the order of their sender */
+        if ((msg & 0xffffffff) == next[msg >> 32]) {
+
+            nb++;
+        }
+        next[msg >> 32] = (msg & 0xffffffff) + 1;
+    }
+
+    return (void *)nb;
+}
+
+/**
+ * User thread receiving one message
+ */
+void *thread_wait(void *arg) {
+
+    ThreadMsg *msg;
+
+    thread_recv(&msg);
+
+    return (void *)((Msg *)msg)->value;
+}
+
+/**
+ * Task receiving a message
+ */
+void task_recv(void *arg) {
+
+    ThreadMsg *msg;
+
+    recv_ret = thread_recv(&msg);
+    recv_err = thread_errno;
+}
+
+/**
+ * Main thread
+ */
+void *thread_main(void *arg) {
+
+    Thread td, tds[NB_SENDERS];
+    ThreadTaskGroup group;
+    ThreadMsg *node;
+    Msg msg;
+    void *ret;
+    long nb;
+
+    /* Print information */
+    print_str("Thread message testing\n\n");
+
+    main_thread = thread_self();
+
+    /* Test 1 */
+    print_str("Test 1: Messages sent back and forth between two threads\n");
+    thread_create(&td, thread_echo, NULL);
+    nb = 0;
+    for (long i = 0; i < NB_MSGS; i++) {
+
+        msg.value = i;
+        thread_send(td, &msg.node);
+        thread_recv(&node);
+        nb += ((node == &msg.node) && (msg.value == i + 1));
+    }
+    thread_join(td, NULL);
+    debug_str("Number of messages sent back = ");
+    debug_int(nb);
+    if (nb == NB_MSGS) {
+
+        print_succ(1);
+    } else {
+
+        print_fail(1);
+    }
+
+    newline;
+
+    /* Test 2 */
+    print_str("Test 2: Many threads send to one thread, which receives the "
+              "messages of each sender in order\n");
+    thread_create(&consumer, thread_consume, NULL);
+    for (long i = 0; i < NB_SENDERS; i++) {
+
+        thread_create(&tds[i], thread_produce, (void *)i);
+    }
+    for (int i = 0; i < NB_SENDERS; i++) {
+
+        thread_join(tds[i], NULL);
+    }
+    thread_join(consumer, &ret);
+    debug_str("Number of messages received in order = ");
+    debug_int((long)ret);
+    if ((long)ret == NB_SENDERS * NB_MSGS) {
+
+        print_succ(2);
+    } else {
+
+        print_fail(2);
+    }
+
+    newline;
+
+    /* Test 3 */
+    print_str("Test 3: A thread waiting on its empty mailbox gets the first "
+              "message sent\n");
+    thread_create(&td, thread_wait, NULL);
+    for (int i = 0; i < 10; i++) {
+
+        thread_yield();
+    }
+    msg.value = 42;
+    thread_send(td, &msg.node);
+    thread_join(td, &ret);
+    debug_str("Message received = ");
+    debug_int((long)ret);
+    if ((long)ret == 42) {
+
+        print_succ(3);
+    } else {
+
+        print_fail(3);
+    }
+
+    newline;
+
+    /* Test 4 */
+    print_str("Test 4: Sending an invalid message, receiving with an invalid "
+              "holder, and receiving from a task\n");
+    thread_task_group_init(&group);
+    thread_task_spawn(&group, task_recv, NULL);
+    thread_task_wait(&group);
+    thread_task_group_destroy(&group);
+    if ((thread_send(main_thread, NULL) == THREAD_FAIL) &&
+        (thread_errno == EINVAL) &&
+        (thread_recv(NULL) == THREAD_FAIL) && (thread_errno == EINVAL) &&
+        (recv_ret == THREAD_FAIL) && (recv_err == EPERM)) {
+
+        debug_str("thread_send() and thread_recv() failed with error "
+                  "number EINVAL, and thread_recv() with error number EPERM "
+                  "from a task\n");
+        print_succ(4);
+    } else {
+
+        print_fail(4);
+    }
+
+    return NULL;
+}
@@ -0,0 +1,169 @@
+#define _GNU_SOURCE
+#include <stddef.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "./print.h"
+#include "./print_ext.h"
+#include <thread.h>
+
+/* Number of offloading threads */
+#define NB_THREADS (8)
+
+/* Set by the other thread */
+volatile int other_ran;
+/* Observed by the offloaded call once it woke up */
+volatile int seen;
+/* Number of calls running */
+volatile int nb_running;
+/* Highest number of calls running at once */
+volatile int max_running;
+
+/**
+ * Call sleeping in a system call for the given time (in milli seconds)
+ */
+void *call_sleep(void *arg) {
+
+    long ms = (long)arg;
+    struct timespec ts = {ms / 1000, (ms % 1000) * 1000000};
+    int running;
+
+    /* Count the call and note the highest count */
+    running = __sync_add_and_fetch(&nb_running, 1);
+    while (running > max_running) {
+
+        __sync_bool_compare_and_swap(&max_running, max_running, running);
+    }
+
+    /* Use the system call directly */
+    syscall(SYS_nanosleep, &ts, NULL);
+
+    /* Uncount the call */
+    __sync_sub_and_fetch(&nb_running, 1);
+
+    /* Note if the other thread ran meanwhile */
+    seen = other_ran;
+
+    return arg;
+}
+
+/**
+ * Call returning the thread it runs as
+ */
+void *call_self(void *arg) {
+
+    return thread_self();
+}
+
+/**
+ * User thread offloading a sleeping call
+ */
+void *thread_offloading(void *arg) {
+
+    void *ret;
+
+    /* Offload the call */
+    thread_offload(call_sleep, arg, &ret);
+
+    return ret;
+}
+
+/**
+ * User thread running while the other thread waits for its call
+ */
+void *thread_other(void *arg) {
+
+    /* Print information */
+    debug_str("Inside thread_other()\n");
+
+    other_ran = 1;
+
+    return NULL;
+}
+
+/**
+ * Main thread
+ */
+void *thread_main(void *arg) {
+
+    Thread td, td_other, tds[NB_THREADS];
+    void *ret;
+    int nb_ok;
+
+    /* Print information */
+    print_str("Thread offload testing\n\n");
+
+    /* Test 1 */
+    print_str("Test 1: A thread waiting for a blocking call does not stall "
+              "the other threads (run with one kernel thread)\n");
+    debug_str("thread_main() created thread_offloading() for 200 ms and "
+              "thread_other()\n");
+    thread_create(&td, thread_offloading, (void *)200l);
+    thread_create(&td_other, thread_other, NULL);
+    thread_join(td, &ret);
+    thread_join(td_other, NULL);
+    if (seen && ((long)ret == 200)) {
+
+        debug_str("thread_other() ran while the call was sleeping\n");
+        print_succ(1);
+    } else {
+
+        print_fail(1);
+    }
+
+    newline;
+
+    /* Test 2 */
+    print_str("Test 2: The call runs as the calling thread\n");
+    if ((thread_offload(call_self, NULL, &ret) == THREAD_SUCCESS) &&
+        (ret == thread_self())) {
+
+        print_succ(2);
+    } else {
+
+        print_fail(2);
+    }
+
+    newline;
+
+    /* Test 3 */
+    print_str("Test 3: Calls of several threads run in parallel on the "
+              "helper kernel threads\n");
+    debug_str("thread_main() created 8 threads offloading 100 ms calls\n");
+    max_running = 0;
+    for (int i = 0; i < NB_THREADS; i++) {
+
+        thread_create(&tds[i], thread_offloading, (void *)100l);
+    }
+    nb_ok = 0;
+    for (int i = 0; i < NB_THREADS; i++) {
+
+        thread_join(tds[i], &ret);
+        nb_ok += ((long)ret == 100);
+    }
+    debug_str("Highest number of calls running at once = ");
+    debug_int(max_running);
+    if ((nb_ok == NB_THREADS) && (max_running > 1)) {
+
+        print_succ(3);
+    } else {
+
+        print_fail(3);
+    }
+
+    newline;
+
+    /* Test 4 */
+    print_str("Test 4: Offloading no function\n");
+    if ((thread_offload(NULL, NULL, NULL) == THREAD_FAIL) &&
+        (thread_errno == EINVAL)) {
+
+        debug_str("thread_offload() failed with error number EINVAL\n");
+        print_succ(4);
+    } else {
+
+        print_fail(4);
+    }
+
+    return NULL;
+}
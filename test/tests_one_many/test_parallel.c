@@ -0,0 +1,200 @@
+#include <stddef.h>
+#include "./print.h"
+#include "./print_ext.h"
+#include <thread.h>
+
+/* Number of elements of the array */
+#define NB_ELEMS (1000000)
+/* Grain of the loops */
+#define GRAIN (1000)
+/* Maximum number of chunks of a loop (MMTASK_CHUNKS_MAX by default) */
+#define MAX_CHUNKS (4096)
+
+/* Array of the loops */
+long elems[NB_ELEMS];
+/* Number of chunks which ran */
+int nb_chunks;
+
+/**
+ * Loop body setting the elements of a chunk to the double of their index
+ */
+void body_double(long begin, long end, void *ctx) {
+
+    long *arr = ctx;
+
+    for (long i = begin; i < end; i++) {
+
+        arr[i] = i * 2;
+    }
+}
+
+/**
+ * Map summing the elements of a chunk
+ */
+void *map_sum(long begin, long end, void *ctx) {
+
+    long *arr = ctx;
+    long sum = 0;
+
+    __sync_fetch_and_add(&nb_chunks, 1);
+    for (long i = begin; i < end; i++) {
+
+        sum += arr[i];
+    }
+
+    return (void *)sum;
+}
+
+/**
+ * Combination adding two sums
+ */
+void *combine_sum(void *lower, void *upper, void *ctx) {
+
+    return (void *)((long)lower + (long)upper);
+}
+
+/**
+ * Map of a chunk to its bounds (begin * 2^32 + end)
+ */
+void *map_bounds(long begin, long end, void *ctx) {
+
+    return (void *)((begin << 32) | end);
+}
+
+/**
+ * Combination of the bounds of adjacent chunks, or -1 if they are not
+ * adjacent in order
+ */
+void *combine_bounds(void *lower, void *upper, void *ctx) {
+
+    long l = (long)lower, u = (long)upper;
+
+    if ((l == -1) || (u == -1) || ((l & 0xffffffff) != (u >> 32))) {
+
+        return (void *)-1l;
+    }
+
+    return (void *)((l & ~0xffffffffl) | (u & 0xffffffff));
+}
+
+/**
+ * Main thread
+ */
+void *thread_main(void *arg) {
+
+    void *ret;
+    long nb;
+
+    /* Print information */
+    print_str("Thread parallel loop testing\n\n");
+
+    /* Test 1 */
+    print_str("Test 1: A parallel loop runs the body on every element\n");
+    thread_parallel_for(0, NB_ELEMS, GRAIN, body_double, elems);
+    nb = 0;
+    for (long i = 0; i < NB_ELEMS; i++) {
+
+        nb += (elems[i] == i * 2);
+    }
+    debug_str("Number of elements set = ");
+    debug_int(nb);
+    if (nb == NB_ELEMS) {
+
+        print_succ(1);
+    } else {
+
+        print_fail(1);
+    }
+
+    newline;
+
+    /* Test 2 */
+    print_str("Test 2: A parallel reduction sums the elements\n");
+    nb_chunks = 0;
+    thread_parallel_reduce(0, NB_ELEMS, GRAIN, map_sum, combine_sum, elems,
+                           &ret);
+    debug_str("Sum = ");
+    debug_int((long)ret);
+    debug_str("Number of chunks = ");
+    debug_int(nb_chunks);
+    if (((long)ret == (long)NB_ELEMS * (NB_ELEMS - 1)) && (nb_chunks > 1)) {
+
+        print_succ(2);
+    } else {
+
+        print_fail(2);
+    }
+
+    newline;
+
+    /* Test 3 */
+    print_str("Test 3: A parallel reduction combines adjacent chunks in "
+              "order, with an automatic grain\n");
+    thread_parallel_reduce(0, NB_ELEMS, 0, map_bounds, combine_bounds, NULL,
+                           &ret);
+    if ((long)ret == NB_ELEMS) {
+
+        debug_str("The chunks combined to the whole range\n");
+        print_succ(3);
+    } else {
+
+        print_fail(3);
+    }
+
+    newline;
+
+    /* Test 4 */
+    print_str("Test 4: A range not above the grain is not split, and an "
+              "empty range is mapped once\n");
+    nb_chunks = 0;
+    thread_parallel_reduce(0, GRAIN, GRAIN, map_sum, combine_sum, elems, &ret);
+    thread_parallel_reduce(5, 5, GRAIN, map_sum, combine_sum, elems, &ret);
+    if ((nb_chunks == 2) && ((long)ret == 0)) {
+
+        print_succ(4);
+    } else {
+
+        print_fail(4);
+    }
+
+    newline;
+
+    /* Test 5 */
+    print_str("Test 5: Running a loop without a body, and over an inverted "
+              "range\n");
+    if ((thread_parallel_for(0, 10, 1, NULL, NULL) == THREAD_FAIL) &&
+        (thread_errno == EINVAL) &&
+        (thread_parallel_reduce(10, 0, 1, map_sum, combine_sum, elems,
+                                &ret) == THREAD_FAIL) &&
+        (thread_errno == EINVAL)) {
+
+        debug_str("thread_parallel_for() and thread_parallel_reduce() failed "
+                  "with error number EINVAL\n");
+        print_succ(5);
+    } else {
+
+        print_fail(5);
+    }
+
+    newline;
+
+    /* Test 6 */
+    print_str("Test 6: A parallel reduction with a grain of one index is "
+              "split in a bounded number of chunks\n");
+    nb_chunks = 0;
+    thread_parallel_reduce(0, NB_ELEMS, 1, map_sum, combine_sum, elems, &ret);
+    debug_str("Sum = ");
+    debug_int((long)ret);
+    debug_str("Number of chunks = ");
+    debug_int(nb_chunks);
+    if (((long)ret == (long)NB_ELEMS * (NB_ELEMS - 1)) &&
+        (nb_chunks > 1) && (nb_chunks <= MAX_CHUNKS)) {
+
+        print_succ(6);
+    } else {
+
+        print_fail(6);
+    }
+
+    return NULL;
+}
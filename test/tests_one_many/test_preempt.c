@@ -0,0 +1,180 @@
+#include <stddef.h>
+#include <time.h>
+#include "./print.h"
+#include "./print_ext.h"
+#include <thread.h>
+
+/* Events logged by the spinning threads */
+volatile char events[4];
+/* Number of events logged */
+volatile int nb_events;
+/* Start times of the spinning threads (in milli seconds) */
+volatile unsigned long starts[2];
+
+/* Time after which a thread spinning past its time slice should have been
+ * preempted (in milli seconds) */
+#define PREEMPT_MAX_ms (50ul)
+
+/**
+ * @brief Get the current time
+ * @return Time in milli seconds
+ */
+static unsigned long now_ms(void) {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000ul + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Log an event
+ * @param[in] event Event
+ */
+static void log_event(char event) {
+
+    events[__sync_fetch_and_add(&nb_events, 1)] = event;
+}
+
+/**
+ * User thread spinning for the given time (in milli seconds) without ever
+ * yielding, it logs its start and its end (upper case letters for the first
+ * thread, lower case letters for the second)
+ */
+void *thread_spin(void *arg) {
+
+    unsigned long ms = (unsigned long)arg & 0xff;
+    int first = !((unsigned long)arg & 0x100);
+    unsigned long start = now_ms();
+
+    /* Log the start */
+    starts[!first] = start;
+    log_event(first ? 'S' : 's');
+
+    /* Spin */
+    while (now_ms() - start < ms);
+
+    /* Log the end */
+    log_event(first ? 'E' : 'e');
+
+    return NULL;
+}
+
+/**
+ * @brief Run two spinning threads and log their events
+ * @param[in] ms Spinning time of the first thread (in milli seconds)
+ */
+static void run_spinning(unsigned long ms) {
+
+    Thread td1, td2;
+
+    nb_events = 0;
+    thread_create(&td1, thread_spin, (void *)ms);
+    thread_create(&td2, thread_spin, (void *)(0x100ul | 20));
+    thread_join(td1, NULL);
+    thread_join(td2, NULL);
+}
+
+/**
+ * Main thread
+ */
+void *thread_main(void *arg) {
+
+    int enabled, level;
+
+    /* Print information */
+    print_str("Thread preemption testing\n\n");
+
+    /* Run with one kernel thread, so that the order of the threads is
+     * decided by the preemption only */
+    level = thread_getconcurrency();
+    thread_setconcurrency(1);
+    thread_sleep_ns(20000000ul);
+
+    /* Test 1 */
+    print_str("Test 1: The threads are preempted by default\n");
+    if ((thread_getpreemption(&enabled) == THREAD_SUCCESS) && enabled) {
+
+        print_succ(1);
+    } else {
+
+        print_fail(1);
+    }
+
+    newline;
+
+    /* Test 2 */
+    print_str("Test 2: Without preemption, threads run to completion in the "
+              "order they were made ready\n");
+    thread_setpreemption(0);
+    debug_str("thread_main() disabled the preemption and created two "
+              "spinning threads\n");
+    run_spinning(50);
+    if ((thread_getpreemption(&enabled) == THREAD_SUCCESS) && !enabled &&
+        (events[0] == 'S') && (events[1] == 'E') &&
+        (events[2] == 's') && (events[3] == 'e')) {
+
+        debug_str("The first thread ended before the second one started\n");
+        print_succ(2);
+    } else {
+
+        print_fail(2);
+    }
+
+    newline;
+
+    /* Test 3 */
+    print_str("Test 3: With the preemption enabled again, a spinning thread "
+              "does not stall the other thread\n");
+    thread_setpreemption(1);
+    debug_str("thread_main() enabled the preemption and created two "
+              "spinning threads\n");
+    run_spinning(100);
+    if ((events[0] == 'S') && (events[1] == 's') && (events[3] == 'E')) {
+
+        debug_str("The second thread ran while the first one was spinning\n");
+        print_succ(3);
+    } else {
+
+        print_fail(3);
+    }
+
+    newline;
+
+    /* Test 4 */
+    print_str("Test 4: A thread spinning past its time slice is preempted "
+              "within a few time slices (build the library with "
+              "-DMMSCHED_PREEMPT=MMSCHED_PREEMPT_MONITOR to test the monitor)"
+              "\n");
+    run_spinning(200);
+    debug_str("The second thread started after (ms) = ");
+    debug_int(starts[1] - starts[0]); debug_newline;
+    if ((events[0] == 'S') && (events[1] == 's') &&
+        (starts[1] - starts[0] < PREEMPT_MAX_ms)) {
+
+        print_succ(4);
+    } else {
+
+        print_fail(4);
+    }
+
+    newline;
+
+    /* Test 5 */
+    print_str("Test 5: Setting an invalid preemption status\n");
+    if ((thread_setpreemption(2) == THREAD_FAIL) &&
+        (thread_errno == EINVAL)) {
+
+        debug_str("thread_setpreemption() failed with error number EINVAL\n");
+        print_succ(5);
+    } else {
+
+        print_fail(5);
+    }
+
+    /* Restore the number of kernel threads */
+    thread_setconcurrency(level);
+
+    return NULL;
+}
@@ -0,0 +1,264 @@
+#include <stddef.h>
+#include <time.h>
+#include "./print.h"
+#include "./print_ext.h"
+#include <thread.h>
+
+/* Order in which the threads ran */
+int order[3];
+/* Number of threads which ran */
+int nb_ran;
+
+/* Loop counters of the fair share threads */
+volatile unsigned long cnt_low, cnt_high;
+/* Stop the fair share threads */
+volatile int stop;
+
+/**
+ * Low priority user thread
+ */
+void *thread_low(void *arg) {
+
+    /* Print information */
+    debug_str("Inside thread_low()\n");
+
+    /* Record the order */
+    order[nb_ran++] = THREAD_PRIO_MIN;
+
+    return NULL;
+}
+
+/**
+ * High priority user thread
+ */
+void *thread_high(void *arg) {
+
+    /* Print information */
+    debug_str("Inside thread_high()\n");
+
+    /* Record the order */
+    order[nb_ran++] = THREAD_PRIO_MAX;
+
+    return NULL;
+}
+
+/**
+ * Deadline user thread
+ */
+void *thread_deadline(void *arg) {
+
+    /* Print information */
+    debug_str("Inside thread_deadline()\n");
+
+    /* Record the order */
+    order[nb_ran++] = (long)arg;
+
+    return NULL;
+}
+
+/**
+ * Deadline user thread spinning beyond its budget
+ */
+void *thread_overrun(void *arg) {
+
+    /* Print information */
+    debug_str("Inside thread_overrun(), spinning till stopped\n");
+
+    /* Spin till stopped */
+    while (!stop);
+
+    return NULL;
+}
+
+/**
+ * Normal user thread stopping the other threads
+ */
+void *thread_stop(void *arg) {
+
+    /* Print information */
+    debug_str("Inside thread_stop()\n");
+
+    /* Stop the other threads */
+    stop = 1;
+
+    return NULL;
+}
+
+/**
+ * Fair share user thread
+ */
+void *thread_count(void *arg) {
+
+    volatile unsigned long *cnt = arg;
+
+    /* Count till asked to stop */
+    while (!stop) {
+
+        (*cnt)++;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Get the monotonic time in milli seconds
+ */
+static long now_ms(void) {
+
+    struct timespec ts;
+
+    /* Get the time */
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * Main thread
+ */
+void *thread_main(void *arg) {
+
+    Thread td_low, td_high, td[3];
+    unsigned long misses;
+    long start;
+    int prio;
+
+    /* Print information */
+    print_str("Thread priority testing\n\n");
+
+    /* Test 1 */
+    print_str("Test 1: Setting and getting the priority of a thread\n");
+    debug_str("thread_main() set its own priority to THREAD_PRIO_MAX\n");
+    thread_setpriority(thread_self(), THREAD_PRIO_MAX);
+    debug_str("thread_main() got its own priority\n");
+    if ((thread_getpriority(thread_self(), &prio) == THREAD_SUCCESS) &&
+        (prio == THREAD_PRIO_MAX)) {
+
+        print_succ(1);
+    } else {
+
+        print_fail(1);
+    }
+
+    newline;
+
+    /* Test 2 */
+    print_str("Test 2: Setting a priority which is out of range\n");
+    debug_str("thread_main() set its own priority to THREAD_PRIO_MAX + 1\n");
+    if ((thread_setpriority(thread_self(), THREAD_PRIO_MAX + 1) == THREAD_FAIL) &&
+        (thread_errno == EINVAL)) {
+
+        debug_str("thread_main() failed with error number EINVAL\n");
+        print_succ(2);
+    } else {
+
+        print_fail(2);
+    }
+
+    newline;
+
+    /* Test 3 */
+    print_str("Test 3: Creating a low priority thread and then a high priority "
+              "thread, the high priority thread should run first (run with one "
+              "kernel thread)\n");
+    nb_ran = 0;
+    debug_str("thread_main() created thread_low() and thread_high()\n");
+    thread_create(&td_low, thread_low, NULL);
+    thread_create(&td_high, thread_high, NULL);
+    debug_str("thread_main() set the priorities of the threads\n");
+    thread_setpriority(td_low, THREAD_PRIO_MIN);
+    thread_setpriority(td_high, THREAD_PRIO_MAX);
+    debug_str("thread_main() called join on the threads\n");
+    thread_join(td_low, NULL);
+    thread_join(td_high, NULL);
+    if ((order[0] == THREAD_PRIO_MAX) && (order[1] == THREAD_PRIO_MIN)) {
+
+        debug_str("thread_high() ran before thread_low()\n");
+        print_succ(3);
+    } else {
+
+        print_fail(3);
+    }
+
+    newline;
+
+    /* Test 4 */
+    print_str("Test 4: Under the fair policy, a thread five priority levels "
+              "above another should get about three times its CPU time (run "
+              "with one kernel thread)\n");
+    debug_str("thread_main() set the fair policy\n");
+    thread_setschedpolicy(THREAD_SCHED_FAIR);
+    debug_str("thread_main() created two counting threads\n");
+    thread_create(&td_low, thread_count, (void *)&cnt_low);
+    thread_create(&td_high, thread_count, (void *)&cnt_high);
+    thread_setpriority(td_high, THREAD_PRIO_DEFAULT + 5);
+    debug_str("thread_main() let the threads run for one second\n");
+    for (start = now_ms(); now_ms() - start < 1000; thread_yield());
+    stop = 1;
+    thread_join(td_low, NULL);
+    thread_join(td_high, NULL);
+    debug_str("cnt_high * 10 / cnt_low = ");
+    debug_int(cnt_high * 10 / cnt_low);
+    if ((2 * cnt_high > 3 * cnt_low) && (cnt_high < 6 * cnt_low)) {
+
+        print_succ(4);
+    } else {
+
+        print_fail(4);
+    }
+
+    newline;
+
+    /* Test 5 */
+    print_str("Test 5: Threads with deadlines run before the highest priority "
+              "thread, earliest deadline first (run with one kernel thread)\n");
+    thread_setschedpolicy(THREAD_SCHED_PRIO);
+    nb_ran = 0;
+    debug_str("thread_main() created three threads\n");
+    thread_create(&td[0], thread_deadline, (void *)0l);
+    thread_create(&td[1], thread_deadline, (void *)1l);
+    thread_create(&td[2], thread_deadline, (void *)2l);
+    debug_str("thread_main() gave deadlines of 50 ms and 10 ms to the second "
+              "and third thread and highest priority to the first\n");
+    thread_setpriority(td[0], THREAD_PRIO_MAX);
+    thread_set_deadline(td[1], 50000000ul, 1000000ul);
+    thread_set_deadline(td[2], 10000000ul, 1000000ul);
+    thread_join(td[0], NULL);
+    thread_join(td[1], NULL);
+    thread_join(td[2], NULL);
+    if ((order[0] == 2) && (order[1] == 1) && (order[2] == 0)) {
+
+        print_succ(5);
+    } else {
+
+        print_fail(5);
+    }
+
+    newline;
+
+    /* Test 6 */
+    print_str("Test 6: A deadline thread exceeding its budget falls back to "
+              "the normal policy and the deadline miss is counted\n");
+    stop = 0;
+    debug_str("thread_main() created a spinning thread with a budget of 2 ms "
+              "and a normal thread stopping it\n");
+    thread_create(&td[0], thread_overrun, NULL);
+    thread_set_deadline(td[0], 5000000ul, 2000000ul);
+    thread_create(&td[1], thread_stop, NULL);
+    thread_join(td[1], NULL);
+    thread_join(td[0], NULL);
+    debug_str("thread_main() took a deadline of 1 ms and spun for 5 ms\n");
+    thread_set_deadline(thread_self(), 1000000ul, 10000000ul);
+    for (start = now_ms(); now_ms() - start < 5;);
+    thread_set_deadline(thread_self(), 0, 0);
+    if ((thread_get_deadline_misses(thread_self(), &misses) == THREAD_SUCCESS) &&
+        (misses == 1)) {
+
+        print_succ(6);
+    } else {
+
+        print_fail(6);
+    }
+
+    return NULL;
+}
@@ -0,0 +1,236 @@
+#include <stddef.h>
+#include "./print.h"
+#include "./print_ext.h"
+#include <thread.h>
+
+/* Number of kernel threads */
+#define NB_KTHREADS (4)
+/* Number of threads of each kind */
+#define NB_THREADS (8)
+/* Number of rounds of a thread */
+#define NB_ROUNDS (200)
+/* Depth of the trees of threads creating threads */
+#define TREE_DEPTH (8)
+
+/**
+ * Message passed back and forth by a pair of threads
+ */
+typedef struct Msg {
+
+    /* Message node */
+    ThreadMsg node;
+
+    /* Number of hops */
+    long hops;
+
+} Msg;
+
+/* Handles of the threads passing messages */
+Thread pongs[NB_THREADS];
+/* Messages of the pairs */
+Msg msgs[NB_THREADS];
+/* Number of rounds done by the threads */
+volatile long nb_rounds;
+
+/**
+ * User thread yielding every round
+ */
+void *thread_yield_rounds(void *arg) {
+
+    for (int i = 0; i < NB_ROUNDS; i++) {
+
+        thread_yield();
+        __sync_fetch_and_add(&nb_rounds, 1);
+    }
+
+    return NULL;
+}
+
+/**
+ * User thread sleeping every round
+ */
+void *thread_sleep_rounds(void *arg) {
+
+    for (int i = 0; i < NB_ROUNDS; i++) {
+
+        thread_sleep_ns(10000ul);
+        __sync_fetch_and_add(&nb_rounds, 1);
+    }
+
+    return NULL;
+}
+
+/**
+ * Call offloaded by a thread
+ */
+void *offloaded(void *arg) {
+
+    return arg;
+}
+
+/**
+ * User thread offloading a call every round
+ */
+void *thread_offload_rounds(void *arg) {
+
+    void *ret;
+
+    for (long i = 0; i < NB_ROUNDS; i++) {
+
+        thread_offload(offloaded, (void *)i, &ret);
+        if ((long)ret == i) {
+
+            __sync_fetch_and_add(&nb_rounds, 1);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * User thread sending back every message it receives, the first one of a
+ * pair
+ */
+void *thread_ping(void *arg) {
+
+    ThreadMsg *msg;
+
+    thread_send(pongs[(long)arg], &msgs[(long)arg].node);
+    for (int i = 0; i < NB_ROUNDS; i++) {
+
+        thread_recv(&msg);
+        ((Msg *)msg)->hops++;
+        if (i < NB_ROUNDS - 1) {
+
+            thread_send(pongs[(long)arg], msg);
+        }
+        __sync_fetch_and_add(&nb_rounds, 1);
+    }
+
+    return NULL;
+}
+
+/**
+ * User thread sending back every message it receives, the second one of a
+ * pair
+ */
+void *thread_pong(void *arg) {
+
+    ThreadMsg *msg;
+
+    for (int i = 0; i < NB_ROUNDS; i++) {
+
+        thread_recv(&msg);
+        ((Msg *)msg)->hops++;
+        thread_send(*(Thread *)arg, msg);
+    }
+
+    return NULL;
+}
+
+/**
+ * User thread creating two threads till the depth is reached
+ */
+void *thread_tree(void *arg) {
+
+    Thread left, right;
+    void *nb_left, *nb_right;
+
+    if (!arg) {
+
+        return (void *)1l;
+    }
+
+    thread_create(&left, thread_tree, (void *)((long)arg - 1));
+    thread_create(&right, thread_tree, (void *)((long)arg - 1));
+    thread_join(left, &nb_left);
+    thread_join(right, &nb_right);
+
+    return (void *)((long)nb_left + (long)nb_right + 1);
+}
+
+/**
+ * Main thread
+ */
+void *thread_main(void *arg) {
+
+    Thread yielders[NB_THREADS], sleepers[NB_THREADS];
+    Thread offloaders[NB_THREADS], pings[NB_THREADS];
+    Thread trees[NB_THREADS];
+    int level, succ;
+    long hops;
+    void *ret;
+
+    /* Print information */
+    print_str("Ready list contention testing\n\n");
+
+    level = thread_getconcurrency();
+    thread_setconcurrency(NB_KTHREADS);
+
+    /* Test 1 */
+    print_str("Test 1: Threads yielding, sleeping, offloading and passing "
+              "messages at once all run their rounds\n");
+    nb_rounds = 0;
+    for (long i = 0; i < NB_THREADS; i++) {
+
+        thread_create(&pongs[i], thread_pong, &pings[i]);
+        thread_create(&pings[i], thread_ping, (void *)i);
+        thread_create(&yielders[i], thread_yield_rounds, NULL);
+        thread_create(&sleepers[i], thread_sleep_rounds, NULL);
+        thread_create(&offloaders[i], thread_offload_rounds, NULL);
+    }
+    for (int i = 0; i < NB_THREADS; i++) {
+
+        thread_join(pings[i], NULL);
+        thread_join(pongs[i], NULL);
+        thread_join(yielders[i], NULL);
+        thread_join(sleepers[i], NULL);
+        thread_join(offloaders[i], NULL);
+    }
+    hops = 0;
+    for (int i = 0; i < NB_THREADS; i++) {
+
+        hops += msgs[i].hops;
+    }
+    debug_str("Number of rounds done = ");
+    debug_int(nb_rounds); debug_newline;
+    debug_str("Number of message hops = ");
+    debug_int(hops); debug_newline;
+    if ((nb_rounds == 4 * NB_THREADS * NB_ROUNDS) &&
+        (hops == 2 * NB_THREADS * NB_ROUNDS)) {
+
+        print_succ(1);
+    } else {
+
+        print_fail(1);
+    }
+
+    newline;
+
+    /* Test 2 */
+    print_str("Test 2: Trees of threads creating threads at once all "
+              "complete\n");
+    for (int i = 0; i < NB_THREADS; i++) {
+
+        thread_create(&trees[i], thread_tree, (void *)(long)TREE_DEPTH);
+    }
+    succ = 1;
+    for (int i = 0; i < NB_THREADS; i++) {
+
+        thread_join(trees[i], &ret);
+        succ &= ((long)ret == (2l << TREE_DEPTH) - 1);
+    }
+    debug_str("Number of threads of the last tree = ");
+    debug_int((long)ret); debug_newline;
+    if (succ) {
+
+        print_succ(2);
+    } else {
+
+        print_fail(2);
+    }
+
+    thread_setconcurrency(level);
+
+    return NULL;
+}
@@ -0,0 +1,201 @@
+#include <stddef.h>
+#include "./print.h"
+#include "./print_ext.h"
+#include <thread.h>
+
+/* Number of tasks in a group */
+#define NB_TASKS (10000)
+/* Depth of the tree of tasks */
+#define TREE_DEPTH (12)
+/* Number of threads spawning tasks */
+#define NB_THREADS (8)
+
+/* Number of tasks which ran */
+int nb_ran;
+/* Task group of the tree */
+ThreadTaskGroup tree;
+/* Return status and error number of a wait from a task */
+int wait_ret, wait_err;
+/* Task group of the threads */
+ThreadTaskGroup shared;
+
+/**
+ * Task counting its run
+ */
+void task_count(void *arg) {
+
+    __sync_fetch_and_add(&nb_ran, 1);
+}
+
+/**
+ * Task spawning two tasks one level deeper, the leaves count their run
+ */
+void task_tree(void *arg) {
+
+    long depth = (long)arg;
+
+    if (!depth) {
+
+        __sync_fetch_and_add(&nb_ran, 1);
+        return;
+    }
+
+    thread_task_spawn(&tree, task_tree, (void *)(depth - 1));
+    thread_task_spawn(&tree, task_tree, (void *)(depth - 1));
+}
+
+/**
+ * Task waiting for a task group
+ */
+void task_wait(void *arg) {
+
+    wait_ret = thread_task_wait((ThreadTaskGroup *)arg);
+    wait_err = thread_errno;
+}
+
+/**
+ * Call spawning tasks, offloaded by a thread
+ */
+void *offloaded_spawn(void *arg) {
+
+    for (int i = 0; i < NB_TASKS / NB_THREADS; i++) {
+
+        thread_task_spawn(&shared, task_count, NULL);
+    }
+
+    return NULL;
+}
+
+/**
+ * User thread spawning tasks, half of them from an offloaded call
+ */
+void *thread_spawn(void *arg) {
+
+    for (int i = 0; i < NB_TASKS / NB_THREADS; i++) {
+
+        thread_task_spawn(&shared, task_count, NULL);
+        if (!(i % 16)) {
+
+            thread_yield();
+        }
+    }
+    thread_offload(offloaded_spawn, NULL, NULL);
+
+    return NULL;
+}
+
+/**
+ * Main thread
+ */
+void *thread_main(void *arg) {
+
+    ThreadTaskGroup group;
+    Thread tds[NB_THREADS];
+    int level;
+
+    /* Print information */
+    print_str("Thread task testing\n\n");
+
+    thread_task_group_init(&group);
+
+    /* Test 1 */
+    print_str("Test 1: Every task of a group ran once the group is waited "
+              "for\n");
+    nb_ran = 0;
+    for (int i = 0; i < NB_TASKS; i++) {
+
+        thread_task_spawn(&group, task_count, NULL);
+    }
+    thread_task_wait(&group);
+    debug_str("Number of tasks which ran = ");
+    debug_int(nb_ran);
+    if (nb_ran == NB_TASKS) {
+
+        print_succ(1);
+    } else {
+
+        print_fail(1);
+    }
+
+    newline;
+
+    /* Test 2 */
+    print_str("Test 2: Tasks spawning tasks in the same group\n");
+    nb_ran = 0;
+    thread_task_group_init(&tree);
+    thread_task_spawn(&tree, task_tree, (void *)(long)TREE_DEPTH);
+    thread_task_wait(&tree);
+    debug_str("Number of leaves which ran = ");
+    debug_int(nb_ran);
+    if (nb_ran == (1 << TREE_DEPTH)) {
+
+        print_succ(2);
+    } else {
+
+        print_fail(2);
+    }
+    thread_task_group_destroy(&tree);
+
+    newline;
+
+    /* Test 3 */
+    print_str("Test 3: Waiting for a task group from a task\n");
+    thread_task_spawn(&group, task_wait, (void *)&group);
+    thread_task_wait(&group);
+    if ((wait_ret == THREAD_FAIL) && (wait_err == EPERM)) {
+
+        debug_str("thread_task_wait() failed with error number EPERM\n");
+        print_succ(3);
+    } else {
+
+        print_fail(3);
+    }
+
+    newline;
+
+    /* Test 4 */
+    print_str("Test 4: Spawning a task without a function, and destroying "
+              "a group whose tasks completed\n");
+    if ((thread_task_spawn(&group, NULL, NULL) == THREAD_FAIL) &&
+        (thread_errno == EINVAL) &&
+        (thread_task_group_destroy(&group) == THREAD_SUCCESS)) {
+
+        debug_str("thread_task_spawn() failed with error number EINVAL\n");
+        print_succ(4);
+    } else {
+
+        print_fail(4);
+    }
+
+    newline;
+
+    /* Test 5 */
+    print_str("Test 5: Threads on several kernel threads and offloaded calls "
+              "spawn tasks in the same group\n");
+    level = thread_getconcurrency();
+    thread_setconcurrency(4);
+    nb_ran = 0;
+    thread_task_group_init(&shared);
+    for (int i = 0; i < NB_THREADS; i++) {
+
+        thread_create(&tds[i], thread_spawn, NULL);
+    }
+    for (int i = 0; i < NB_THREADS; i++) {
+
+        thread_join(tds[i], NULL);
+    }
+    thread_task_wait(&shared);
+    thread_task_group_destroy(&shared);
+    thread_setconcurrency(level);
+    debug_str("Number of tasks which ran = ");
+    debug_int(nb_ran);
+    if (nb_ran == 2 * (NB_TASKS / NB_THREADS) * NB_THREADS) {
+
+        print_succ(5);
+    } else {
+
+        print_fail(5);
+    }
+
+    return NULL;
+}
@@ -0,0 +1,222 @@
+#include <stddef.h>
+#include <time.h>
+#include "./print.h"
+#include "./print_ext.h"
+#include <thread.h>
+
+/* Number of sleeping threads */
+#define NB_THREADS (200)
+
+/* Set by the other thread */
+volatile int other_ran;
+/* Set to let the waiting thread complete */
+volatile int released;
+/* Number of sleeping threads which woke up in time */
+volatile int nb_woken;
+/* Lock of the count */
+ThreadSpinLock lock;
+/* Mutex to be locked with a timeout */
+ThreadMutex mutex;
+
+/**
+ * @brief Get the current time
+ * @return Time in nano seconds
+ */
+static unsigned long now_ns(void) {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000000000ul + ts.tv_nsec;
+}
+
+/**
+ * User thread sleeping for the given time (in milli seconds)
+ */
+void *thread_sleep(void *arg) {
+
+    unsigned long ms = (unsigned long)arg;
+    unsigned long start = now_ns();
+
+    /* Sleep */
+    thread_sleep_ns(ms * 1000000ul);
+
+    /* Count the thread if it did not wake up early */
+    if (now_ns() - start >= ms * 1000000ul) {
+
+        thread_spin_lock(&lock);
+        nb_woken++;
+        thread_spin_unlock(&lock);
+    }
+
+    return NULL;
+}
+
+/**
+ * User thread sleeping till it is released
+ */
+void *thread_wait(void *arg) {
+
+    /* Sleep for a milli second at a time */
+    while (!released) {
+
+        thread_sleep_ns(1000000ul);
+    }
+
+    return NULL;
+}
+
+/**
+ * User thread running while the other thread sleeps
+ */
+void *thread_other(void *arg) {
+
+    /* Print information */
+    debug_str("Inside thread_other()\n");
+
+    other_ran = 1;
+
+    return NULL;
+}
+
+/**
+ * User thread locking the mutex with a timeout
+ */
+void *thread_lock(void *arg) {
+
+    unsigned long ms = (unsigned long)arg;
+
+    /* Print information */
+    debug_str("Inside thread_lock(), locking the mutex\n");
+
+    /* Lock the mutex */
+    if (thread_mutex_timedlock(&mutex, ms * 1000000ul) == THREAD_FAIL) {
+
+        return (void *)(long)thread_errno;
+    }
+
+    thread_mutex_unlock(&mutex);
+
+    return NULL;
+}
+
+/**
+ * Main thread
+ */
+void *thread_main(void *arg) {
+
+    Thread td, td_other, tds[NB_THREADS];
+    unsigned long start;
+    void *ret;
+
+    /* Print information */
+    print_str("Thread timer testing\n\n");
+
+    thread_spin_init(&lock);
+    thread_mutex_init(&mutex);
+
+    /* Test 1 */
+    print_str("Test 1: A sleeping thread does not stall the other threads "
+              "(run with one kernel thread)\n");
+    debug_str("thread_main() created thread_sleep() for 50 ms and "
+              "thread_other()\n");
+    thread_create(&td, thread_sleep, (void *)50ul);
+    thread_create(&td_other, thread_other, NULL);
+    thread_join(td, NULL);
+    thread_join(td_other, NULL);
+    if ((nb_woken == 1) && other_ran) {
+
+        print_succ(1);
+    } else {
+
+        print_fail(1);
+    }
+
+    newline;
+
+    /* Test 2 */
+    print_str("Test 2: Many threads sleeping for different times wake up "
+              "after their time\n");
+    nb_woken = 0;
+    for (int i = 0; i < NB_THREADS; i++) {
+
+        thread_create(&tds[i], thread_sleep, (void *)(1ul + (i * 7) % 100));
+    }
+    for (int i = 0; i < NB_THREADS; i++) {
+
+        thread_join(tds[i], NULL);
+    }
+    debug_str("Number of threads woken in time = ");
+    debug_int(nb_woken);
+    if (nb_woken == NB_THREADS) {
+
+        print_succ(2);
+    } else {
+
+        print_fail(2);
+    }
+
+    newline;
+
+    /* Test 3 */
+    print_str("Test 3: Joining a waiting thread times out, then joins once "
+              "it completed\n");
+    debug_str("thread_main() created thread_wait()\n");
+    thread_create(&td, thread_wait, NULL);
+    start = now_ns();
+    if ((thread_join_timed(td, NULL, 20000000ul) == THREAD_FAIL) &&
+        (thread_errno == ETIMEDOUT) && (now_ns() - start >= 20000000ul)) {
+
+        debug_str("thread_join_timed() timed out, released thread_wait()\n");
+        released = 1;
+        if (thread_join_timed(td, NULL, 1000000000ul) == THREAD_SUCCESS) {
+
+            print_succ(3);
+        } else {
+
+            print_fail(3);
+        }
+    } else {
+
+        released = 1;
+        thread_join(td, NULL);
+        print_fail(3);
+    }
+
+    newline;
+
+    /* Test 4 */
+    print_str("Test 4: Locking a mutex held by another thread times out, "
+              "then succeeds once the mutex is unlocked in time\n");
+    thread_mutex_lock(&mutex);
+    debug_str("thread_main() locked the mutex and created thread_lock() "
+              "with a 20 ms timeout\n");
+    thread_create(&td, thread_lock, (void *)20ul);
+    thread_join(td, &ret);
+    if ((long)ret == ETIMEDOUT) {
+
+        debug_str("thread_lock() timed out, created it again with a 1 s "
+                  "timeout\n");
+        thread_create(&td, thread_lock, (void *)1000ul);
+        thread_sleep_ns(20000000ul);
+        thread_mutex_unlock(&mutex);
+        thread_join(td, &ret);
+        if (!ret) {
+
+            print_succ(4);
+        } else {
+
+            print_fail(4);
+        }
+    } else {
+
+        thread_mutex_unlock(&mutex);
+        print_fail(4);
+    }
+
+    thread_mutex_destroy(&mutex);
+    thread_spin_destroy(&lock);
+
+    return NULL;
+}
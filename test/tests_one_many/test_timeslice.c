@@ -0,0 +1,148 @@
+#include <stddef.h>
+#include <time.h>
+#include "./print.h"
+#include "./print_ext.h"
+#include <thread.h>
+
+/* Default time slice (in micro seconds) */
+#define DEFAULT_SLICE_us (10000ul)
+
+/**
+ * @brief Get the current time
+ * @return Time in milli seconds
+ */
+static unsigned long now_ms(void) {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000ul + ts.tv_nsec / 1000000;
+}
+
+/**
+ * User thread with an adaptive time slice spinning for the given time (in
+ * milli seconds), returns its time slice
+ */
+void *thread_spin(void *arg) {
+
+    unsigned long ms = (unsigned long)arg;
+    unsigned long start = now_ms();
+    unsigned long slice;
+
+    /* Adapt the time slice */
+    thread_set_timeslice(thread_self(), THREAD_SLICE_ADAPTIVE);
+
+    /* Spin */
+    while (now_ms() - start < ms);
+
+    /* Get the time slice */
+    thread_get_timeslice(thread_self(), &slice);
+
+    return (void *)slice;
+}
+
+/**
+ * User thread with an adaptive time slice sleeping the given number of times
+ * for a milli second, returns its time slice
+ */
+void *thread_nap(void *arg) {
+
+    unsigned long nb = (unsigned long)arg;
+    unsigned long slice;
+
+    /* Adapt the time slice */
+    thread_set_timeslice(thread_self(), THREAD_SLICE_ADAPTIVE);
+
+    /* Sleep */
+    for (unsigned long i = 0; i < nb; i++) {
+
+        thread_sleep_ns(1000000ul);
+    }
+
+    /* Get the time slice */
+    thread_get_timeslice(thread_self(), &slice);
+
+    return (void *)slice;
+}
+
+/**
+ * Main thread
+ */
+void *thread_main(void *arg) {
+
+    Thread td;
+    unsigned long slice;
+    void *ret;
+
+    /* Print information */
+    print_str("Thread time slice testing\n\n");
+
+    /* Test 1 */
+    print_str("Test 1: Setting and getting a fixed time slice\n");
+    if ((thread_get_timeslice(thread_self(), &slice) == THREAD_SUCCESS) &&
+        (slice == DEFAULT_SLICE_us) &&
+        (thread_set_timeslice(thread_self(), 2000ul) == THREAD_SUCCESS) &&
+        (thread_get_timeslice(thread_self(), &slice) == THREAD_SUCCESS) &&
+        (slice == 2000ul)) {
+
+        debug_str("The time slice changed from 10000 us to 2000 us\n");
+        print_succ(1);
+    } else {
+
+        print_fail(1);
+    }
+    thread_set_timeslice(thread_self(), DEFAULT_SLICE_us);
+
+    newline;
+
+    /* Test 2 */
+    print_str("Test 2: Setting an out of range time slice\n");
+    if ((thread_set_timeslice(thread_self(), 1ul) == THREAD_FAIL) &&
+        (thread_errno == EINVAL) &&
+        (thread_set_timeslice(thread_self(), 10000000ul) == THREAD_FAIL) &&
+        (thread_errno == EINVAL)) {
+
+        debug_str("thread_set_timeslice() failed with error number EINVAL\n");
+        print_succ(2);
+    } else {
+
+        print_fail(2);
+    }
+
+    newline;
+
+    /* Test 3 */
+    print_str("Test 3: The adaptive time slice of a spinning thread "
+              "lengthens\n");
+    thread_create(&td, thread_spin, (void *)200ul);
+    thread_join(td, &ret);
+    debug_str("Time slice of thread_spin() = ");
+    debug_int((long)ret);
+    if ((unsigned long)ret > DEFAULT_SLICE_us) {
+
+        print_succ(3);
+    } else {
+
+        print_fail(3);
+    }
+
+    newline;
+
+    /* Test 4 */
+    print_str("Test 4: The adaptive time slice of a sleeping thread "
+              "shortens\n");
+    thread_create(&td, thread_nap, (void *)10ul);
+    thread_join(td, &ret);
+    debug_str("Time slice of thread_nap() = ");
+    debug_int((long)ret);
+    if ((unsigned long)ret < DEFAULT_SLICE_us) {
+
+        print_succ(4);
+    } else {
+
+        print_fail(4);
+    }
+
+    return NULL;
+}